@@ -0,0 +1,500 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "counting_sort.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "cpu_host/scan_impl_cpu.h"
+#include "cpu_host/thread_pool.h"
+
+namespace
+{
+int ChunkBegin(int i, int num_of_chunks, int n)
+{
+    return static_cast<int>(static_cast<int64_t>(n) * i / num_of_chunks);
+}
+
+template <typename T>
+void PermuteField(T* data, const uint32_t* destinations, int n)
+{
+    std::vector<bool> placed(n, false);
+    for (uint32_t start = 0; start < static_cast<uint32_t>(n); start++) {
+        if (placed[start])
+            continue;
+
+        T carried = data[start];
+        uint32_t i = destinations[start];
+        while (i != start) {
+            std::swap(carried, data[i]);
+            placed[i] = true;
+            i = destinations[i];
+        }
+
+        data[start] = carried;
+        placed[start] = true;
+    }
+}
+
+// A key touched by an update.
+struct KeyChange
+{
+    uint32_t key_;
+    uint32_t stayers_;
+    uint32_t arrivals_; // Kept ones only.
+    int      shift_;    // Sum of the count changes of the keys before.
+};
+
+template <typename T>
+inline void ScatterElement(void* aux, const void* data, uint32_t dest, int i)
+{
+    static_cast<T*>(aux)[dest] = static_cast<const T*>(data)[i];
+}
+} // Anonymous namespace.
+
+// The sort runs in three steps. The histogram step counts, per chunk of
+// elements, how many of them fall into each range of keys, with one chunk
+// and one range per thread. After a scan of the histograms, the element ids
+// are scattered into their ranges, so that every range can be ranked by a
+// single thread, still in the order of the indices. The offsets of the keys
+// then come from a scan of the counts.
+
+CountingSort::CountingSort(ThreadPool* pool)
+    : pool_(pool)
+    , scan_(new ScanImplCpu(pool))
+    , keys_(nullptr)
+    , num_of_elements_(0)
+    , num_of_keys_(0)
+    , num_of_sorted_(0)
+    , sorted_counts_()
+    , ranks_(1)
+    , destinations_(1)
+    , histogram_()
+    , binned_(1)
+{
+
+}
+
+CountingSort::~CountingSort()
+{
+
+}
+
+void CountingSort::Count(const uint32_t* keys, int n, int num_of_keys,
+                         uint32_t capacity, uint32_t* counts)
+{
+    keys_ = keys;
+    num_of_elements_ = n;
+    num_of_keys_ = num_of_keys;
+    ranks_.resize(std::max(n, 1));
+    destinations_.resize(std::max(n, 1));
+    pool_->ParallelFor(0, num_of_keys, [=](int k0, int k1) {
+        std::fill(counts + k0, counts + k1, 0);
+    });
+
+    int num_of_chunks = pool_->num_of_threads();
+    int num_of_bins = num_of_chunks;
+    auto bin_of = [=](uint32_t key) {
+        return static_cast<int>(static_cast<uint64_t>(key) * num_of_bins /
+                                num_of_keys);
+    };
+
+    // Ordered by bin first, then by chunk.
+    histogram_.assign(num_of_bins * num_of_chunks + 1, 0);
+    uint32_t* histogram = &histogram_[0];
+    uint32_t* ranks = &ranks_[0];
+    pool_->ParallelFor(0, num_of_chunks, [=](int c0, int c1) {
+        for (int c = c0; c < c1; c++) {
+            int end = ChunkBegin(c + 1, num_of_chunks, n);
+            for (int i = ChunkBegin(c, num_of_chunks, n); i < end; i++) {
+                if (keys[i] < static_cast<uint32_t>(num_of_keys))
+                    histogram[bin_of(keys[i]) * num_of_chunks + c]++;
+                else
+                    ranks[i] = kDropped;
+            }
+        }
+    });
+
+    uint32_t sum = 0;
+    for (size_t i = 0; i < histogram_.size(); i++) {
+        uint32_t count = histogram_[i];
+        histogram_[i] = sum;
+        sum += count;
+    }
+
+    binned_.resize(std::max(sum, 1u));
+    uint32_t* binned = &binned_[0];
+    pool_->ParallelFor(0, num_of_chunks, [=](int c0, int c1) {
+        std::vector<uint32_t> cursors(num_of_bins);
+        for (int c = c0; c < c1; c++) {
+            for (int b = 0; b < num_of_bins; b++)
+                cursors[b] = histogram[b * num_of_chunks + c];
+
+            int end = ChunkBegin(c + 1, num_of_chunks, n);
+            for (int i = ChunkBegin(c, num_of_chunks, n); i < end; i++)
+                if (keys[i] < static_cast<uint32_t>(num_of_keys))
+                    binned[cursors[bin_of(keys[i])]++] = i;
+        }
+    });
+
+    pool_->ParallelFor(0, num_of_bins, [=](int b0, int b1) {
+        uint32_t end = histogram[b1 * num_of_chunks];
+        for (uint32_t j = histogram[b0 * num_of_chunks]; j < end; j++) {
+            int i = binned[j];
+            uint32_t* count = counts + keys[i];
+            if (*count >= capacity) {
+                ranks[i] = kDropped;
+            } else {
+                ranks[i] = *count;
+                (*count)++;
+            }
+        }
+    });
+}
+
+int CountingSort::ComputeOffsets(const uint32_t* counts, int num_of_keys,
+                                 uint32_t* offsets)
+{
+    assert(num_of_keys == num_of_keys_);
+    uint32_t num_of_kept = scan_->ExclusiveScan(offsets, counts, num_of_keys);
+
+    // The counts are kept for Update().
+    sorted_counts_.assign(counts, counts + num_of_keys);
+
+    // The kept elements go to the slots of their keys, and the dropped ones
+    // fill up the tail in the order of their indices.
+    int n = num_of_elements_;
+    const uint32_t* keys = keys_;
+    const uint32_t* ranks = &ranks_[0];
+    uint32_t* destinations = &destinations_[0];
+    int num_of_chunks = pool_->num_of_threads();
+    std::vector<uint32_t> dropped(num_of_chunks + 1, 0);
+    pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++) {
+            int end = ChunkBegin(c + 1, num_of_chunks, n);
+            for (int i = ChunkBegin(c, num_of_chunks, n); i < end; i++) {
+                if (ranks[i] == kDropped)
+                    dropped[c + 1]++;
+                else
+                    destinations[i] = offsets[keys[i]] + ranks[i];
+            }
+        }
+    });
+
+    dropped[0] = num_of_kept;
+    for (int c = 0; c < num_of_chunks; c++)
+        dropped[c + 1] += dropped[c];
+
+    pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++) {
+            uint32_t tail = dropped[c];
+            int end = ChunkBegin(c + 1, num_of_chunks, n);
+            for (int i = ChunkBegin(c, num_of_chunks, n); i < end; i++)
+                if (ranks[i] == kDropped)
+                    destinations[i] = tail++;
+        }
+    });
+
+    num_of_sorted_ = static_cast<int>(num_of_kept);
+    return num_of_sorted_;
+}
+
+bool CountingSort::Update(const uint32_t* keys, int n, int num_of_keys,
+                          uint32_t capacity, float max_churn, uint32_t* counts,
+                          uint32_t* offsets)
+{
+    if (sorted_counts_.empty() || num_of_keys != num_of_keys_ ||
+            n < num_of_sorted_)
+        return false;
+
+    // An element keeps its place if it is still within the range of its key.
+    // The ranges of the non-empty keys do not overlap, so the test is exact.
+    int num_of_sorted = num_of_sorted_;
+    const uint32_t* sorted_counts = &sorted_counts_[0];
+    auto is_stayer = [=](int i) {
+        uint32_t key = keys[i];
+        uint32_t u = static_cast<uint32_t>(i);
+        return i < num_of_sorted &&
+            key < static_cast<uint32_t>(num_of_keys) && offsets[key] <= u &&
+            u < offsets[key] + sorted_counts[key];
+    };
+
+    // The last key whose range starts at or before |i|.
+    auto sorted_key_of = [=](int i) {
+        const uint32_t* k = std::upper_bound(offsets, offsets + num_of_keys,
+                                             static_cast<uint32_t>(i));
+        return static_cast<uint32_t>(k - offsets - 1);
+    };
+
+    // The movers are keyed by (key, index), so that sorting them keeps the
+    // index order within a key.
+    int num_of_chunks = pool_->num_of_threads();
+    std::vector<std::vector<uint64_t>> chunk_movers(num_of_chunks);
+    std::vector<std::vector<uint32_t>> chunk_losses(num_of_chunks);
+    std::vector<std::vector<uint32_t>> chunk_dropped(num_of_chunks);
+    pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++) {
+            int end = ChunkBegin(c + 1, num_of_chunks, n);
+            for (int i = ChunkBegin(c, num_of_chunks, n); i < end; i++) {
+                if (is_stayer(i))
+                    continue;
+
+                if (i < num_of_sorted)
+                    chunk_losses[c].push_back(sorted_key_of(i));
+
+                if (keys[i] < static_cast<uint32_t>(num_of_keys))
+                    chunk_movers[c].push_back(
+                        (static_cast<uint64_t>(keys[i]) << 32) | i);
+                else
+                    chunk_dropped[c].push_back(i);
+            }
+        }
+    });
+
+    std::vector<uint64_t> movers;
+    std::vector<uint32_t> losses;
+    std::vector<uint32_t> dropped;
+    for (int c = 0; c < num_of_chunks; c++) {
+        movers.insert(movers.end(), chunk_movers[c].begin(),
+                      chunk_movers[c].end());
+        losses.insert(losses.end(), chunk_losses[c].begin(),
+                      chunk_losses[c].end());
+        dropped.insert(dropped.end(), chunk_dropped[c].begin(),
+                       chunk_dropped[c].end());
+    }
+
+    if (movers.size() + dropped.size() > max_churn * n)
+        return false;
+
+    std::sort(movers.begin(), movers.end());
+    std::sort(losses.begin(), losses.end());
+
+    // Merge the losses and the arrivals into the changes of the keys.
+    std::vector<KeyChange> changes;
+    int shift = 0;
+    size_t a = 0;
+    size_t b = 0;
+    while (a < losses.size() || b < movers.size()) {
+        uint32_t key = static_cast<uint32_t>(-1);
+        if (a < losses.size())
+            key = losses[a];
+
+        if (b < movers.size())
+            key = std::min(key, static_cast<uint32_t>(movers[b] >> 32));
+
+        uint32_t lost = 0;
+        for (; a < losses.size() && losses[a] == key; a++)
+            lost++;
+
+        uint32_t arrived = 0;
+        for (; b < movers.size() && (movers[b] >> 32) == key; b++)
+            arrived++;
+
+        KeyChange change;
+        change.key_ = key;
+        change.stayers_ = sorted_counts[key] - lost;
+        change.arrivals_ = change.stayers_ < capacity ?
+            std::min(arrived, capacity - change.stayers_) : 0;
+        change.shift_ = shift;
+        changes.push_back(change);
+
+        shift += static_cast<int>(change.stayers_ + change.arrivals_) -
+            static_cast<int>(sorted_counts[key]);
+    }
+
+    int num_of_kept = num_of_sorted + shift;
+    auto first_change = [&](uint32_t key) {
+        return std::lower_bound(
+            changes.begin(), changes.end(), key,
+            [](const KeyChange& c, uint32_t k) { return c.key_ < k; }) -
+            changes.begin();
+    };
+    auto shift_at = [&](size_t change_index) {
+        return change_index < changes.size() ?
+            changes[change_index].shift_ : shift;
+    };
+
+    // The stayers are still in key order, so every chunk walks the changes
+    // along, and counts the stayers of the current key as it goes. Only the
+    // key the chunk starts in may have stayers before the chunk.
+    ranks_.resize(std::max(n, 1));
+    destinations_.resize(std::max(n, 1));
+    uint32_t* ranks = &ranks_[0];
+    uint32_t* destinations = &destinations_[0];
+    pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++) {
+            int begin = ChunkBegin(c, num_of_chunks, num_of_sorted);
+            int end = ChunkBegin(c + 1, num_of_chunks, num_of_sorted);
+            size_t j = begin < end ? first_change(sorted_key_of(begin)) : 0;
+            uint32_t current_key = static_cast<uint32_t>(-1);
+            uint32_t rank = 0;
+            for (int i = begin; i < end; i++) {
+                if (!is_stayer(i))
+                    continue;
+
+                uint32_t key = keys[i];
+                if (key != current_key) {
+                    while (j < changes.size() && changes[j].key_ < key)
+                        j++;
+
+                    current_key = key;
+                    rank = 0;
+                    for (uint32_t k = offsets[key];
+                            k < static_cast<uint32_t>(begin); k++)
+                        if (keys[k] == key)
+                            rank++;
+                }
+
+                ranks[i] = rank;
+                destinations[i] = offsets[key] + shift_at(j) + rank;
+                rank++;
+            }
+        }
+    });
+
+    // The arrivals go after the stayers of their keys, and whatever does not
+    // fit goes to the tail along with the undefined ones.
+    uint32_t tail = num_of_kept;
+    for (size_t i = 0; i < dropped.size(); i++) {
+        ranks[dropped[i]] = kDropped;
+        destinations[dropped[i]] = tail++;
+    }
+
+    size_t j = 0;
+    uint32_t previous_key = static_cast<uint32_t>(-1);
+    uint32_t arrival = 0;
+    for (size_t m = 0; m < movers.size(); m++) {
+        uint32_t key = static_cast<uint32_t>(movers[m] >> 32);
+        uint32_t i = static_cast<uint32_t>(movers[m]);
+        if (key != previous_key) {
+            while (changes[j].key_ != key)
+                j++;
+
+            previous_key = key;
+            arrival = 0;
+        }
+
+        const KeyChange& change = changes[j];
+        if (arrival < change.arrivals_) {
+            ranks[i] = change.stayers_ + arrival;
+            destinations[i] = offsets[key] + change.shift_ + ranks[i];
+        } else {
+            ranks[i] = kDropped;
+            destinations[i] = tail++;
+        }
+
+        arrival++;
+    }
+
+    // Finally the offsets and the counts of all the keys.
+    uint32_t* new_sorted_counts = &sorted_counts_[0];
+    pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++) {
+            int begin = ChunkBegin(c, num_of_chunks, num_of_keys);
+            int end = ChunkBegin(c + 1, num_of_chunks, num_of_keys);
+            size_t j = first_change(begin);
+            for (int k = begin; k < end; k++) {
+                uint32_t key = static_cast<uint32_t>(k);
+                while (j < changes.size() && changes[j].key_ < key)
+                    j++;
+
+                offsets[k] += shift_at(j);
+                if (j < changes.size() && changes[j].key_ == key)
+                    counts[k] = changes[j].stayers_ + changes[j].arrivals_;
+                else
+                    counts[k] = new_sorted_counts[k];
+
+                new_sorted_counts[k] = counts[k];
+            }
+        }
+    });
+
+    keys_ = keys;
+    num_of_elements_ = n;
+    num_of_sorted_ = num_of_kept;
+    return true;
+}
+
+void CountingSort::Reset()
+{
+    sorted_counts_.clear();
+    num_of_sorted_ = 0;
+}
+
+void CountingSort::Scatter(const Field* fields, int num_of_fields)
+{
+    const uint32_t* destinations = &destinations_[0];
+    pool_->ParallelFor(0, num_of_elements_, [=](int i0, int i1) {
+        for (int i = i0; i < i1; i++) {
+            uint32_t dest = destinations[i];
+            for (int f = 0; f < num_of_fields; f++) {
+                const Field& field = fields[f];
+                switch (field.byte_width_) {
+                    case 1:
+                        ScatterElement<uint8_t>(field.aux_, field.data_, dest,
+                                                i);
+                        break;
+                    case 2:
+                        ScatterElement<uint16_t>(field.aux_, field.data_, dest,
+                                                 i);
+                        break;
+                    case 4:
+                        ScatterElement<uint32_t>(field.aux_, field.data_, dest,
+                                                 i);
+                        break;
+                    default:
+                        assert(false);
+                        break;
+                }
+            }
+        }
+    });
+}
+
+void CountingSort::Permute(const Field* fields, int num_of_fields)
+{
+    const uint32_t* destinations = &destinations_[0];
+    int n = num_of_elements_;
+    pool_->ParallelFor(0, num_of_fields, [=](int f0, int f1) {
+        for (int f = f0; f < f1; f++) {
+            const Field& field = fields[f];
+            switch (field.byte_width_) {
+                case 1:
+                    PermuteField(static_cast<uint8_t*>(field.data_),
+                                 destinations, n);
+                    break;
+                case 2:
+                    PermuteField(static_cast<uint16_t*>(field.data_),
+                                 destinations, n);
+                    break;
+                case 4:
+                    PermuteField(static_cast<uint32_t*>(field.data_),
+                                 destinations, n);
+                    break;
+                default:
+                    assert(false);
+                    break;
+            }
+        }
+    });
+}
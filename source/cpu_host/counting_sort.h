@@ -0,0 +1,103 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _COUNTING_SORT_H_
+#define _COUNTING_SORT_H_
+
+#include <memory>
+#include <vector>
+
+#include <stdint.h>
+
+class ScanImplCpu;
+class ThreadPool;
+class CountingSort
+{
+public:
+    // One SoA field to be permuted.
+    struct Field
+    {
+        void* data_;
+        void* aux_; // Only used by Scatter().
+        int   byte_width_;
+    };
+
+    static const uint32_t kDropped = 0xFFFFFFFF;
+
+    explicit CountingSort(ThreadPool* pool);
+    ~CountingSort();
+
+    // Ranks the elements within their keys, in the order of their indices.
+    // At most |capacity| elements are kept for every key. The rest, as well
+    // as the ones with a key out of [0, |num_of_keys|), are dropped. |counts|
+    // receives the number of kept elements of every key.
+    //
+    // |keys| must stay valid until the permutation is applied.
+    void Count(const uint32_t* keys, int n, int num_of_keys, uint32_t capacity,
+               uint32_t* counts);
+
+    // Scans |counts| into |offsets| and works out the destination of every
+    // element. The dropped elements go after the kept ones. Returns the
+    // number of kept elements.
+    int ComputeOffsets(const uint32_t* counts, int num_of_keys,
+                       uint32_t* offsets);
+
+    // Patches the order of the last sort, after some of the keys changed and
+    // new elements were appended to the sorted ones. The elements that kept
+    // their keys stay in order, and only the others are sorted and merged
+    // in. |offsets| must still hold what the last sort left there. Returns
+    // false without touching anything if the last sort is not usable, or if
+    // more than |max_churn| of the elements changed, in which case a full
+    // sort is due.
+    bool Update(const uint32_t* keys, int n, int num_of_keys,
+                uint32_t capacity, float max_churn, uint32_t* counts,
+                uint32_t* offsets);
+
+    // Forgets the last sort.
+    void Reset();
+
+    // Moves all the fields to their |aux_| in a single pass over the
+    // elements.
+    void Scatter(const Field* fields, int num_of_fields);
+
+    // Permutes the fields in place by following the cycles of the
+    // permutation, so that no auxiliary copy is needed. The fields are
+    // spread over the threads.
+    void Permute(const Field* fields, int num_of_fields);
+
+    const uint32_t* ranks() const { return &ranks_[0]; }
+    const uint32_t* destinations() const { return &destinations_[0]; }
+
+private:
+    ThreadPool* pool_;
+    std::unique_ptr<ScanImplCpu> scan_;
+    const uint32_t* keys_;
+    int num_of_elements_;
+    int num_of_keys_;
+    int num_of_sorted_;
+    std::vector<uint32_t> sorted_counts_;
+    std::vector<uint32_t> ranks_;
+    std::vector<uint32_t> destinations_;
+    std::vector<uint32_t> histogram_;
+    std::vector<uint32_t> binned_;
+};
+
+#endif // _COUNTING_SORT_H_
\ No newline at end of file
@@ -0,0 +1,85 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _CPU_LINEAR_MEM_H_
+#define _CPU_LINEAR_MEM_H_
+
+#include <memory>
+
+#include <stdint.h>
+
+namespace detail
+{
+class CpuLinearMemBase
+{
+public:
+    CpuLinearMemBase();
+    virtual ~CpuLinearMemBase();
+
+    void* Create(int num_of_elements, int byte_width);
+    void Destroy(void* mem);
+};
+}
+
+
+template <typename T>
+class CpuLinearMem : public detail::CpuLinearMemBase
+{
+public:
+    CpuLinearMem()
+        : mem_(nullptr)
+        , num_of_elements_(0)
+    {
+    }
+
+    virtual ~CpuLinearMem()
+    {
+        Destroy(mem_);
+    }
+
+    bool Create(int num_of_elements)
+    {
+        mem_ = reinterpret_cast<T*>(
+            CpuLinearMemBase::Create(num_of_elements, sizeof(T)));
+        if (mem_) {
+            num_of_elements_ = num_of_elements;
+            return true;
+        }
+
+        return false;
+    }
+
+    T* mem() const { return mem_; }
+    int num_of_elements() const { return num_of_elements_; }
+
+private:
+    CpuLinearMem(const CpuLinearMem&);
+    void operator=(const CpuLinearMem&);
+
+    T* mem_;
+    int num_of_elements_;
+};
+
+typedef CpuLinearMem<uint8_t> CpuLinearMemU8;
+typedef CpuLinearMem<uint16_t> CpuLinearMemU16;
+typedef CpuLinearMem<uint32_t> CpuLinearMemU32;
+
+#endif // _CPU_LINEAR_MEM_H_
\ No newline at end of file
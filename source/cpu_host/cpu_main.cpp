@@ -0,0 +1,481 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "cpu_main.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "cpu_host/cpu_mem_piece.h"
+#include "cpu_host/cpu_volume.h"
+#include "cpu_host/flip_impl_cpu.h"
+#include "cpu_host/fluid_impl_cpu.h"
+#include "cpu_host/poisson_impl_cpu.h"
+#include "cpu_host/scan_impl_cpu.h"
+#include "cpu_host/thread_pool.h"
+#include "cpu_host/volume_rows.h"
+#include "cuda/particle/flip.h"
+#include "cuda/random_helper.h"
+#include "metrics.h"
+#include "third_party/glm/vec3.hpp"
+
+namespace
+{
+::FluidImpulse ToFluidImpulse(CudaMain::FluidImpulse impulse)
+{
+    switch (impulse) {
+        case CudaMain::IMPULSE_HOT_FLOOR:
+            return ::IMPULSE_HOT_FLOOR;
+        case CudaMain::IMPULSE_SPHERE:
+            return ::IMPULSE_SPHERE;
+        case CudaMain::IMPULSE_BUOYANT_JET:
+            return ::IMPULSE_BUOYANT_JET;
+        case CudaMain::IMPULSE_FLYING_BALL:
+            return ::IMPULSE_FLYING_BALL;
+        default:
+            break;
+    }
+
+    return ::IMPULSE_NONE;
+}
+
+template <typename T>
+T* MemOf(const std::shared_ptr<CpuLinearMem<T>>& field)
+{
+    return field ? field->mem() : nullptr;
+}
+
+// An auxiliary set of particles may come without any of the fields, in
+// which case the particles are sorted in place.
+::FlipParticles ToFlipParticles(const CpuMain::FlipParticles& p)
+{
+    ::FlipParticles cpu_p;
+    cpu_p.particle_index_   = MemOf(p.particle_index_);
+    cpu_p.cell_index_       = MemOf(p.cell_index_);
+    cpu_p.in_cell_index_    = MemOf(p.in_cell_index_);
+    cpu_p.particle_count_   = MemOf(p.particle_count_);
+    cpu_p.position_x_       = MemOf(p.position_x_);
+    cpu_p.position_y_       = MemOf(p.position_y_);
+    cpu_p.position_z_       = MemOf(p.position_z_);
+    cpu_p.velocity_x_       = MemOf(p.velocity_x_);
+    cpu_p.velocity_y_       = MemOf(p.velocity_y_);
+    cpu_p.velocity_z_       = MemOf(p.velocity_z_);
+    cpu_p.density_          = MemOf(p.density_);
+    cpu_p.temperature_      = MemOf(p.temperature_);
+    for (int i = 0; i < 9; i++)
+        cpu_p.affine_[i] = MemOf(p.affine_[i]);
+
+    cpu_p.num_of_actives_   = p.num_of_actives_ ? reinterpret_cast<int*>(p.num_of_actives_->mem()) : nullptr;
+    cpu_p.num_of_particles_ = p.num_of_particles_;
+    return cpu_p;
+}
+} // Anonymous namespace.
+
+class CpuMain::FlipObserver : public FlipImplCpu::Observer
+{
+public:
+    virtual void OnEmitted() override
+    {
+        Metrics::Instance()->OnParticleEmitted();
+    }
+    virtual void OnVelocityInterpolated() override
+    {
+        Metrics::Instance()->OnParticleVelocityInterpolated();
+    }
+    virtual void OnResampled() override
+    {
+        Metrics::Instance()->OnParticleResampled();
+    }
+    virtual void OnAdvected() override
+    {
+        Metrics::Instance()->OnParticleAdvected();
+    }
+    virtual void OnCellBound() override
+    {
+        Metrics::Instance()->OnParticleCellBound();
+    }
+    virtual void OnPrefixSumCalculated() override
+    {
+        Metrics::Instance()->OnParticlePrefixSumCalculated();
+    }
+    virtual void OnSorted() override
+    {
+        Metrics::Instance()->OnParticleSorted();
+    }
+    virtual void OnTransferred() override
+    {
+        Metrics::Instance()->OnParticleTransferred();
+    }
+};
+
+CpuMain* CpuMain::Instance()
+{
+    static CpuMain* instance = nullptr;
+    if (!instance)
+        instance = new CpuMain();
+
+    return instance;
+}
+
+void CpuMain::DestroyInstance()
+{
+    delete Instance();
+}
+
+CpuMain::CpuMain()
+    : thread_pool_(new ThreadPool(0))
+    , poisson_impl_(new PoissonImplCpu(thread_pool_.get()))
+    , fluid_impl_(new FluidImplCpu(thread_pool_.get()))
+    , rand_helper_(new RandomHelper())
+    , flip_ob_(std::make_shared<FlipObserver>())
+    , flip_impl_(
+        new FlipImplCpu(flip_ob_.get(), thread_pool_.get(), rand_helper_.get()))
+    , scan_impl_(new ScanImplCpu(thread_pool_.get()))
+{
+
+}
+
+CpuMain::~CpuMain()
+{
+}
+
+void CpuMain::CopyFromVolume(float* dest, std::shared_ptr<CpuVolume> source)
+{
+    glm::ivec3 size = source->size();
+    RowReader reader(*source, 1);
+    for (int z = 0; z < size.z; z++) {
+        for (int y = 0; y < size.y; y++) {
+            const float* row = reader.Read(0, y, z);
+            std::copy(row, row + size.x, dest);
+            dest += size.x;
+        }
+    }
+}
+
+void CpuMain::CopyToVolume(std::shared_ptr<CpuVolume> dest,
+                           const float* source)
+{
+    glm::ivec3 size = dest->size();
+    RowWriter writer(dest.get());
+    for (int z = 0; z < size.z; z++) {
+        for (int y = 0; y < size.y; y++) {
+            std::copy(source, source + size.x, writer.Begin(y, z));
+            writer.End(y, z);
+            source += size.x;
+        }
+    }
+}
+
+void CpuMain::ComputeResidual(std::shared_ptr<CpuVolume> r,
+                              std::shared_ptr<CpuVolume> u,
+                              std::shared_ptr<CpuVolume> b)
+{
+    poisson_impl_->ComputeResidual(r.get(), u.get(), b.get());
+}
+
+void CpuMain::Prolongate(std::shared_ptr<CpuVolume> fine,
+                         std::shared_ptr<CpuVolume> coarse)
+{
+    poisson_impl_->Prolongate(fine.get(), coarse.get());
+}
+
+void CpuMain::ProlongateError(std::shared_ptr<CpuVolume> fine,
+                              std::shared_ptr<CpuVolume> coarse)
+{
+    poisson_impl_->ProlongateError(fine.get(), coarse.get());
+}
+
+void CpuMain::Relax(std::shared_ptr<CpuVolume> u, std::shared_ptr<CpuVolume> b,
+                    int num_of_iterations)
+{
+    poisson_impl_->Relax(u.get(), b.get(), num_of_iterations);
+}
+
+void CpuMain::RelaxJacobi(std::shared_ptr<CpuVolume> unp1,
+                          std::shared_ptr<CpuVolume> un,
+                          std::shared_ptr<CpuVolume> b, float omega)
+{
+    poisson_impl_->RelaxJacobi(unp1.get(), un.get(), b.get(), omega);
+}
+
+void CpuMain::RelaxChebyshev(std::shared_ptr<CpuVolume> unp1,
+                             std::shared_ptr<CpuVolume> un,
+                             std::shared_ptr<CpuVolume> b, float momentum,
+                             float omega)
+{
+    poisson_impl_->RelaxChebyshev(unp1.get(), un.get(), b.get(), momentum,
+                                  omega);
+}
+
+void CpuMain::RelaxWithZeroGuess(std::shared_ptr<CpuVolume> u,
+                                 std::shared_ptr<CpuVolume> b)
+{
+    poisson_impl_->RelaxWithZeroGuess(u.get(), b.get());
+}
+
+void CpuMain::Restrict(std::shared_ptr<CpuVolume> coarse,
+                       std::shared_ptr<CpuVolume> fine)
+{
+    poisson_impl_->Restrict(coarse.get(), fine.get());
+}
+
+void CpuMain::ComputeResidualAndRestrict(std::shared_ptr<CpuVolume> coarse,
+                                         std::shared_ptr<CpuVolume> u,
+                                         std::shared_ptr<CpuVolume> b)
+{
+    poisson_impl_->ComputeResidualAndRestrict(coarse.get(), u.get(), b.get());
+}
+
+void CpuMain::ProlongateErrorAndRelax(std::shared_ptr<CpuVolume> u,
+                                      std::shared_ptr<CpuVolume> b,
+                                      std::shared_ptr<CpuVolume> coarse,
+                                      int num_of_iterations)
+{
+    poisson_impl_->ProlongateErrorAndRelax(u.get(), b.get(), coarse.get(),
+                                           num_of_iterations);
+}
+
+void CpuMain::ApplyStencil(std::shared_ptr<CpuVolume> aux,
+                           std::shared_ptr<CpuVolume> search)
+{
+    poisson_impl_->ApplyStencil(aux.get(), search.get());
+}
+
+void CpuMain::ComputeAlpha(std::shared_ptr<CpuMemPiece> alpha,
+                           std::shared_ptr<CpuMemPiece> rho,
+                           std::shared_ptr<CpuVolume> aux,
+                           std::shared_ptr<CpuVolume> search)
+{
+    poisson_impl_->ComputeAlpha(alpha.get(), rho.get(), aux.get(),
+                                search.get());
+}
+
+void CpuMain::ComputeRho(std::shared_ptr<CpuMemPiece> rho,
+                         std::shared_ptr<CpuVolume> search,
+                         std::shared_ptr<CpuVolume> residual)
+{
+    poisson_impl_->ComputeRho(rho.get(), search.get(), residual.get());
+}
+
+void CpuMain::ComputeRhoAndBeta(std::shared_ptr<CpuMemPiece> beta,
+                                std::shared_ptr<CpuMemPiece> rho_new,
+                                std::shared_ptr<CpuMemPiece> rho,
+                                std::shared_ptr<CpuVolume> aux,
+                                std::shared_ptr<CpuVolume> residual)
+{
+    poisson_impl_->ComputeRhoAndBeta(beta.get(), rho_new.get(), rho.get(),
+                                     aux.get(), residual.get());
+}
+
+void CpuMain::ScaledAdd(std::shared_ptr<CpuVolume> dest,
+                        std::shared_ptr<CpuVolume> v0,
+                        std::shared_ptr<CpuVolume> v1,
+                        std::shared_ptr<CpuMemPiece> coef, float sign)
+{
+    poisson_impl_->ScaledAdd(dest.get(), v0.get(), v1.get(), coef.get(), sign);
+}
+
+void CpuMain::ScaleVector(std::shared_ptr<CpuVolume> dest,
+                          std::shared_ptr<CpuVolume> v,
+                          std::shared_ptr<CpuMemPiece> coef, float sign)
+{
+    poisson_impl_->ScaledAdd(dest.get(), nullptr, v.get(), coef.get(), sign);
+}
+
+void CpuMain::ApplyStencilAndReduce(std::shared_ptr<CpuMemPiece> alpha,
+                                    std::shared_ptr<CpuMemPiece> beta,
+                                    std::shared_ptr<CpuMemPiece> rho,
+                                    std::shared_ptr<CpuVolume> aux,
+                                    std::shared_ptr<CpuVolume> precond,
+                                    std::shared_ptr<CpuVolume> residual,
+                                    bool restart)
+{
+    poisson_impl_->ApplyStencilAndReduce(alpha.get(), beta.get(), rho.get(),
+                                         aux.get(), precond.get(),
+                                         residual.get(), restart);
+}
+
+void CpuMain::UpdateSearchAndVector(std::shared_ptr<CpuVolume> dest,
+                                    std::shared_ptr<CpuVolume> search,
+                                    std::shared_ptr<CpuVolume> v,
+                                    std::shared_ptr<CpuMemPiece> alpha,
+                                    std::shared_ptr<CpuMemPiece> beta,
+                                    float sign)
+{
+    poisson_impl_->UpdateSearchAndVector(dest.get(), search.get(), v.get(),
+                                         alpha.get(), beta.get(), sign);
+}
+
+void CpuMain::Extrapolate(std::shared_ptr<CpuVolume> dest,
+                          std::shared_ptr<CpuVolume> v0,
+                          std::shared_ptr<CpuVolume> v1, float coef)
+{
+    poisson_impl_->Extrapolate(dest.get(), v0.get(), v1.get(), coef);
+}
+
+void CpuMain::ApplyBuoyancy(std::shared_ptr<CpuVolume> vnp1_x,
+                            std::shared_ptr<CpuVolume> vnp1_y,
+                            std::shared_ptr<CpuVolume> vnp1_z,
+                            std::shared_ptr<CpuVolume> vn_x,
+                            std::shared_ptr<CpuVolume> vn_y,
+                            std::shared_ptr<CpuVolume> vn_z,
+                            std::shared_ptr<CpuVolume> temperature,
+                            std::shared_ptr<CpuVolume> density,
+                            float time_step, float ambient_temperature,
+                            float accel_factor, float gravity)
+{
+    fluid_impl_->ApplyBuoyancy(vnp1_x.get(), vnp1_y.get(), vnp1_z.get(),
+                               vn_x.get(), vn_y.get(), vn_z.get(),
+                               temperature.get(), density.get(), time_step,
+                               ambient_temperature, accel_factor, gravity);
+}
+
+void CpuMain::ComputeDivergence(std::shared_ptr<CpuVolume> div,
+                                std::shared_ptr<CpuVolume> vel_x,
+                                std::shared_ptr<CpuVolume> vel_y,
+                                std::shared_ptr<CpuVolume> vel_z)
+{
+    fluid_impl_->ComputeDivergence(div.get(), vel_x.get(), vel_y.get(),
+                                   vel_z.get());
+}
+
+void CpuMain::SubtractGradient(std::shared_ptr<CpuVolume> vel_x,
+                               std::shared_ptr<CpuVolume> vel_y,
+                               std::shared_ptr<CpuVolume> vel_z,
+                               std::shared_ptr<CpuVolume> pressure)
+{
+    fluid_impl_->SubtractGradient(vel_x.get(), vel_y.get(), vel_z.get(),
+                                  pressure.get());
+}
+
+void CpuMain::ComputeMaxSpeed(std::shared_ptr<CpuMemPiece> max_speed,
+                              std::shared_ptr<CpuVolume> vel_x,
+                              std::shared_ptr<CpuVolume> vel_y,
+                              std::shared_ptr<CpuVolume> vel_z)
+{
+    fluid_impl_->ComputeMaxSpeed(max_speed.get(), vel_x.get(), vel_y.get(),
+                                 vel_z.get());
+}
+
+void CpuMain::ConvertVolume(std::shared_ptr<CpuVolume> dest,
+                            std::shared_ptr<CpuVolume> v, float scale,
+                            bool accumulate)
+{
+    poisson_impl_->ConvertVolume(dest.get(), v.get(), scale, accumulate);
+}
+
+void CpuMain::EmitFlipParticles(FlipParticles* particles,
+                                const glm::vec3& center_point,
+                                const glm::vec3& hotspot, float radius,
+                                float density, float temperature,
+                                const glm::vec3& velocity,
+                                const glm::ivec3& volume_size)
+{
+    flip_impl_->Emit(ToFlipParticles(*particles), center_point, hotspot,
+                     radius, density, temperature, velocity, volume_size);
+}
+
+void CpuMain::MoveFlipParticles(FlipParticles* particles,
+                                int* num_active_particles,
+                                const FlipParticles* aux,
+                                std::shared_ptr<CpuVolume> vnp1_x,
+                                std::shared_ptr<CpuVolume> vnp1_y,
+                                std::shared_ptr<CpuVolume> vnp1_z,
+                                std::shared_ptr<CpuVolume> vn_x,
+                                std::shared_ptr<CpuVolume> vn_y,
+                                std::shared_ptr<CpuVolume> vn_z,
+                                std::shared_ptr<CpuVolume> density,
+                                std::shared_ptr<CpuVolume> temperature,
+                                float velocity_dissipation,
+                                float density_dissipation,
+                                float temperature_dissipation, float time_step)
+{
+    flip_impl_->Advect(ToFlipParticles(*particles), num_active_particles,
+                       ToFlipParticles(*aux), vnp1_x.get(), vnp1_y.get(),
+                       vnp1_z.get(), vn_x.get(), vn_y.get(), vn_z.get(),
+                       density.get(), temperature.get(), time_step,
+                       velocity_dissipation, density_dissipation,
+                       temperature_dissipation);
+}
+
+void CpuMain::ResetFlipParticles(FlipParticles* particles,
+                                 const glm::ivec3& volume_size)
+{
+    flip_impl_->Reset(ToFlipParticles(*particles), volume_size);
+}
+
+uint32_t CpuMain::ExclusiveScan(std::shared_ptr<CpuLinearMemU32> dest,
+                                std::shared_ptr<CpuLinearMemU32> source, int n)
+{
+    return scan_impl_->ExclusiveScan(dest->mem(), source->mem(), n);
+}
+
+uint32_t CpuMain::InclusiveScan(std::shared_ptr<CpuLinearMemU32> dest,
+                                std::shared_ptr<CpuLinearMemU32> source, int n)
+{
+    return scan_impl_->InclusiveScan(dest->mem(), source->mem(), n);
+}
+
+void CpuMain::SegmentedScan(std::shared_ptr<CpuLinearMemU32> dest,
+                            std::shared_ptr<CpuLinearMemU32> source,
+                            std::shared_ptr<CpuLinearMemU32> heads, int n)
+{
+    scan_impl_->SegmentedScan(dest->mem(), source->mem(), heads->mem(), n);
+}
+
+int CpuMain::Compact(std::shared_ptr<CpuLinearMemU32> dest,
+                     std::shared_ptr<CpuLinearMemU32> flags, int n)
+{
+    return scan_impl_->Compact(dest->mem(), flags->mem(), n);
+}
+
+void CpuMain::SetCellSize(float cell_size)
+{
+    poisson_impl_->set_cell_size(cell_size);
+    fluid_impl_->set_cell_size(cell_size);
+    flip_impl_->set_cell_size(cell_size);
+}
+
+void CpuMain::SetFluidImpulse(CudaMain::FluidImpulse impulse)
+{
+    flip_impl_->set_fluid_impulse(ToFluidImpulse(impulse));
+}
+
+void CpuMain::SetMaxSortChurn(float churn)
+{
+    flip_impl_->set_max_sort_churn(churn);
+}
+
+void CpuMain::SetParticlesPerCell(int target, int minimum,
+                                  float reseed_density_threshold)
+{
+    flip_impl_->set_particles_per_cell(target);
+    flip_impl_->set_min_particles_per_cell(minimum);
+    flip_impl_->set_reseed_density_threshold(reseed_density_threshold);
+}
+
+void CpuMain::SetOutflow(bool outflow)
+{
+    poisson_impl_->set_outflow(outflow);
+    fluid_impl_->set_outflow(outflow);
+    flip_impl_->set_outflow(outflow);
+}
@@ -0,0 +1,228 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _CPU_MAIN_H_
+#define _CPU_MAIN_H_
+
+#include <memory>
+
+#include "cpu_host/cpu_linear_mem.h"
+#include "cuda_host/cuda_main.h"
+#include "third_party/glm/fwd.hpp"
+
+class CpuMemPiece;
+class CpuVolume;
+class FlipImplCpu;
+class FluidImplCpu;
+class PoissonImplCpu;
+class RandomHelper;
+class ScanImplCpu;
+class ThreadPool;
+class CpuMain
+{
+public:
+    struct FlipParticles
+    {
+        std::shared_ptr<CpuLinearMemU32> particle_index_;
+        std::shared_ptr<CpuLinearMemU32> cell_index_;
+        std::shared_ptr<CpuLinearMemU32> particle_count_;
+        std::shared_ptr<CpuLinearMemU8>  in_cell_index_;
+        std::shared_ptr<CpuLinearMemU16> position_x_;
+        std::shared_ptr<CpuLinearMemU16> position_y_;
+        std::shared_ptr<CpuLinearMemU16> position_z_;
+        std::shared_ptr<CpuLinearMemU16> velocity_x_;
+        std::shared_ptr<CpuLinearMemU16> velocity_y_;
+        std::shared_ptr<CpuLinearMemU16> velocity_z_;
+        std::shared_ptr<CpuLinearMemU16> density_;
+        std::shared_ptr<CpuLinearMemU16> temperature_;
+        std::shared_ptr<CpuLinearMemU16> affine_[9];
+        std::shared_ptr<CpuMemPiece>     num_of_actives_;
+        int                              num_of_particles_;
+    };
+
+    static CpuMain* Instance();
+    static void DestroyInstance();
+
+    CpuMain();
+    ~CpuMain();
+
+    // Dense fp32 copies of a single-component volume, in x-major order.
+    void CopyFromVolume(float* dest, std::shared_ptr<CpuVolume> source);
+    void CopyToVolume(std::shared_ptr<CpuVolume> dest, const float* source);
+
+    // Multigrid.
+    void ComputeResidual(std::shared_ptr<CpuVolume> r,
+                         std::shared_ptr<CpuVolume> u,
+                         std::shared_ptr<CpuVolume> b);
+    void Prolongate(std::shared_ptr<CpuVolume> fine,
+                    std::shared_ptr<CpuVolume> coarse);
+    void ProlongateError(std::shared_ptr<CpuVolume> fine,
+                         std::shared_ptr<CpuVolume> coarse);
+    void Relax(std::shared_ptr<CpuVolume> u, std::shared_ptr<CpuVolume> b,
+               int num_of_iterations);
+    void RelaxJacobi(std::shared_ptr<CpuVolume> unp1,
+                     std::shared_ptr<CpuVolume> un,
+                     std::shared_ptr<CpuVolume> b, float omega);
+    void RelaxChebyshev(std::shared_ptr<CpuVolume> unp1,
+                        std::shared_ptr<CpuVolume> un,
+                        std::shared_ptr<CpuVolume> b, float momentum,
+                        float omega);
+    void RelaxWithZeroGuess(std::shared_ptr<CpuVolume> u,
+                            std::shared_ptr<CpuVolume> b);
+    void Restrict(std::shared_ptr<CpuVolume> coarse,
+                  std::shared_ptr<CpuVolume> fine);
+    void ComputeResidualAndRestrict(std::shared_ptr<CpuVolume> coarse,
+                                    std::shared_ptr<CpuVolume> u,
+                                    std::shared_ptr<CpuVolume> b);
+    void ProlongateErrorAndRelax(std::shared_ptr<CpuVolume> u,
+                                 std::shared_ptr<CpuVolume> b,
+                                 std::shared_ptr<CpuVolume> coarse,
+                                 int num_of_iterations);
+
+    // Conjugate gradient.
+    void ApplyStencil(std::shared_ptr<CpuVolume> aux,
+                      std::shared_ptr<CpuVolume> search);
+    void ComputeAlpha(std::shared_ptr<CpuMemPiece> alpha,
+                      std::shared_ptr<CpuMemPiece> rho,
+                      std::shared_ptr<CpuVolume> aux,
+                      std::shared_ptr<CpuVolume> search);
+    void ComputeRho(std::shared_ptr<CpuMemPiece> rho,
+                    std::shared_ptr<CpuVolume> search,
+                    std::shared_ptr<CpuVolume> residual);
+    void ComputeRhoAndBeta(std::shared_ptr<CpuMemPiece> beta,
+                           std::shared_ptr<CpuMemPiece> rho_new,
+                           std::shared_ptr<CpuMemPiece> rho,
+                           std::shared_ptr<CpuVolume> aux,
+                           std::shared_ptr<CpuVolume> residual);
+    void ScaledAdd(std::shared_ptr<CpuVolume> dest,
+                   std::shared_ptr<CpuVolume> v0,
+                   std::shared_ptr<CpuVolume> v1,
+                   std::shared_ptr<CpuMemPiece> coef, float sign);
+    void ScaleVector(std::shared_ptr<CpuVolume> dest,
+                     std::shared_ptr<CpuVolume> v,
+                     std::shared_ptr<CpuMemPiece> coef, float sign);
+
+    // Pipelined conjugate gradient.
+    void ApplyStencilAndReduce(std::shared_ptr<CpuMemPiece> alpha,
+                               std::shared_ptr<CpuMemPiece> beta,
+                               std::shared_ptr<CpuMemPiece> rho,
+                               std::shared_ptr<CpuVolume> aux,
+                               std::shared_ptr<CpuVolume> precond,
+                               std::shared_ptr<CpuVolume> residual,
+                               bool restart);
+    void UpdateSearchAndVector(std::shared_ptr<CpuVolume> dest,
+                               std::shared_ptr<CpuVolume> search,
+                               std::shared_ptr<CpuVolume> v,
+                               std::shared_ptr<CpuMemPiece> alpha,
+                               std::shared_ptr<CpuMemPiece> beta, float sign);
+
+    // Initial guess.
+    void Extrapolate(std::shared_ptr<CpuVolume> dest,
+                     std::shared_ptr<CpuVolume> v0,
+                     std::shared_ptr<CpuVolume> v1, float coef);
+
+    // Fluid.
+    void ApplyBuoyancy(std::shared_ptr<CpuVolume> vnp1_x,
+                       std::shared_ptr<CpuVolume> vnp1_y,
+                       std::shared_ptr<CpuVolume> vnp1_z,
+                       std::shared_ptr<CpuVolume> vn_x,
+                       std::shared_ptr<CpuVolume> vn_y,
+                       std::shared_ptr<CpuVolume> vn_z,
+                       std::shared_ptr<CpuVolume> temperature,
+                       std::shared_ptr<CpuVolume> density, float time_step,
+                       float ambient_temperature, float accel_factor,
+                       float gravity);
+    void ComputeDivergence(std::shared_ptr<CpuVolume> div,
+                           std::shared_ptr<CpuVolume> vel_x,
+                           std::shared_ptr<CpuVolume> vel_y,
+                           std::shared_ptr<CpuVolume> vel_z);
+    void SubtractGradient(std::shared_ptr<CpuVolume> vel_x,
+                          std::shared_ptr<CpuVolume> vel_y,
+                          std::shared_ptr<CpuVolume> vel_z,
+                          std::shared_ptr<CpuVolume> pressure);
+
+    // Reductions over the velocity field.
+    void ComputeMaxSpeed(std::shared_ptr<CpuMemPiece> max_speed,
+                         std::shared_ptr<CpuVolume> vel_x,
+                         std::shared_ptr<CpuVolume> vel_y,
+                         std::shared_ptr<CpuVolume> vel_z);
+
+    // Mixed precision.
+    void ConvertVolume(std::shared_ptr<CpuVolume> dest,
+                       std::shared_ptr<CpuVolume> v, float scale,
+                       bool accumulate);
+
+    // Particles
+    void EmitFlipParticles(FlipParticles* particles,
+                           const glm::vec3& center_point,
+                           const glm::vec3& hotspot, float radius,
+                           float density, float temperature,
+                           const glm::vec3& velocity,
+                           const glm::ivec3& volume_size);
+    void MoveFlipParticles(FlipParticles* particles, int* num_active_particles,
+                           const FlipParticles* aux,
+                           std::shared_ptr<CpuVolume> vnp1_x,
+                           std::shared_ptr<CpuVolume> vnp1_y,
+                           std::shared_ptr<CpuVolume> vnp1_z,
+                           std::shared_ptr<CpuVolume> vn_x,
+                           std::shared_ptr<CpuVolume> vn_y,
+                           std::shared_ptr<CpuVolume> vn_z,
+                           std::shared_ptr<CpuVolume> density,
+                           std::shared_ptr<CpuVolume> temperature,
+                           float velocity_dissipation,
+                           float density_dissipation,
+                           float temperature_dissipation, float time_step);
+    void ResetFlipParticles(FlipParticles* particles,
+                            const glm::ivec3& volume_size);
+
+    // Scan
+    uint32_t ExclusiveScan(std::shared_ptr<CpuLinearMemU32> dest,
+                           std::shared_ptr<CpuLinearMemU32> source, int n);
+    uint32_t InclusiveScan(std::shared_ptr<CpuLinearMemU32> dest,
+                           std::shared_ptr<CpuLinearMemU32> source, int n);
+    void SegmentedScan(std::shared_ptr<CpuLinearMemU32> dest,
+                       std::shared_ptr<CpuLinearMemU32> source,
+                       std::shared_ptr<CpuLinearMemU32> heads, int n);
+    int Compact(std::shared_ptr<CpuLinearMemU32> dest,
+                std::shared_ptr<CpuLinearMemU32> flags, int n);
+
+    void SetCellSize(float cell_size);
+    void SetFluidImpulse(CudaMain::FluidImpulse impulse);
+    void SetMaxSortChurn(float churn);
+    void SetOutflow(bool outflow);
+    void SetParticlesPerCell(int target, int minimum,
+                             float reseed_density_threshold);
+
+    ThreadPool* thread_pool() const { return thread_pool_.get(); }
+
+private:
+    class FlipObserver;
+
+    std::unique_ptr<ThreadPool> thread_pool_;
+    std::unique_ptr<PoissonImplCpu> poisson_impl_;
+    std::unique_ptr<FluidImplCpu> fluid_impl_;
+    std::unique_ptr<RandomHelper> rand_helper_;
+    std::shared_ptr<FlipObserver> flip_ob_;
+    std::unique_ptr<FlipImplCpu> flip_impl_;
+    std::unique_ptr<ScanImplCpu> scan_impl_;
+};
+
+#endif // _CPU_MAIN_H_
\ No newline at end of file
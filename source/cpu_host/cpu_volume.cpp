@@ -0,0 +1,96 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "cpu_volume.h"
+
+#include <cassert>
+
+#include "third_party/glm/vec3.hpp"
+
+CpuVolume::CpuVolume()
+    : data_(nullptr)
+    , pitch_(0)
+    , slice_pitch_(0)
+    , width_(0)
+    , height_(0)
+    , depth_(0)
+    , num_of_components_(0)
+    , byte_width_(0)
+    , border_(0)
+{
+}
+
+CpuVolume::~CpuVolume()
+{
+    if (data_) {
+        _aligned_free(data_);
+        data_ = nullptr;
+    }
+}
+
+void CpuVolume::Clear()
+{
+    if (data_)
+        memset(data_, 0, slice_pitch_ * (depth_ + border_));
+}
+
+bool CpuVolume::Create(int width, int height, int depth, int num_of_components,
+                       int byte_width, int border)
+{
+    assert(!data_);
+    if (data_)
+        return false;
+
+    int row_size = (width + border) * num_of_components * byte_width;
+    int pitch = (row_size + kAlignment - 1) / kAlignment * kAlignment;
+    int slice_pitch = pitch * (height + border);
+    size_t total_size = static_cast<size_t>(slice_pitch) * (depth + border);
+
+    char* r = static_cast<char*>(_aligned_malloc(total_size, kAlignment));
+    if (!r)
+        return false;
+
+    data_ = r;
+    pitch_ = pitch;
+    slice_pitch_ = slice_pitch;
+    width_ = width;
+    height_ = height;
+    depth_ = depth;
+    num_of_components_ = num_of_components;
+    byte_width_ = byte_width;
+    border_ = border;
+    return true;
+}
+
+bool CpuVolume::HasSameProperties(const CpuVolume& other) const
+{
+    return width_ == other.width_ && height_ == other.height_ &&
+        depth_ == other.depth_ &&
+        num_of_components_ == other.num_of_components_ &&
+        byte_width_ == other.byte_width_ &&
+        border_ == other.border_;
+}
+
+glm::ivec3 CpuVolume::size() const
+{
+    return glm::ivec3(width_, height_, depth_);
+}
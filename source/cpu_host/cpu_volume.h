@@ -0,0 +1,74 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _CPU_VOLUME_H_
+#define _CPU_VOLUME_H_
+
+#include <memory>
+
+#include "third_party/glm/fwd.hpp"
+
+class CpuVolume
+{
+public:
+    // Rows are padded to whole cache lines so that the SIMD loops never
+    // straddle two rows, and every row starts on an aligned address.
+    static const int kAlignment = 64;
+
+    CpuVolume();
+    ~CpuVolume();
+
+    void Clear();
+    bool Create(int width, int height, int depth, int num_of_components,
+                int byte_width, int border);
+    bool HasSameProperties(const CpuVolume& other) const;
+
+    void* GetRowAddress(int y, int z) const
+    {
+        return data_ + z * slice_pitch_ + y * pitch_;
+    }
+
+    void* data() const { return data_; }
+    int pitch() const { return pitch_; }
+    int slice_pitch() const { return slice_pitch_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int depth() const { return depth_; }
+    int num_of_components() const { return num_of_components_; }
+    int byte_width() const { return byte_width_; }
+    glm::ivec3 size() const;
+
+private:
+    CpuVolume(const CpuVolume&);
+    void operator=(const CpuVolume&);
+
+    char* data_;
+    int pitch_;
+    int slice_pitch_;
+    int width_;
+    int height_;
+    int depth_;
+    int num_of_components_;
+    int byte_width_;
+    int border_;
+};
+
+#endif // _CPU_VOLUME_H_
\ No newline at end of file
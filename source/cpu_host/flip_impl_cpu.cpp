@@ -0,0 +1,1134 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "flip_impl_cpu.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "cpu_host/counting_sort.h"
+#include "cpu_host/cpu_volume.h"
+#include "cpu_host/simd_float.h"
+#include "cpu_host/thread_pool.h"
+#include "cpu_host/volume_rows.h"
+#include "cuda/particle/flip.h"
+#include "cuda/random_helper.h"
+#include "third_party/glm/vec3.hpp"
+
+namespace
+{
+// Keep in sync with flip_common.cuh.
+const uint32_t kCellUndefined = static_cast<uint32_t>(-1);
+const uint32_t kMaxNumSamplesForOneTime = 5;
+
+// Unlike the CUDA version, the binning keeps as many particles per cell as
+// |in_cell_index_| can rank, and leaves the density of the particles to the
+// governor.
+const uint32_t kCellCapacity = 255;
+
+const float kInitialWeight = 0.00001f;
+
+enum TransferField
+{
+    TRANSFER_VEL_X,
+    TRANSFER_VEL_Y,
+    TRANSFER_VEL_Z,
+    TRANSFER_DENSITY,
+    TRANSFER_TEMPERATURE,
+
+    NUM_OF_TRANSFER_FIELDS
+};
+
+inline float ToFloat(uint16_t h)
+{
+    return simd::HalfToFloat(h);
+}
+
+inline uint16_t ToHalf(float f)
+{
+    return simd::FloatToHalf(f);
+}
+
+inline bool IsCellUndefined(uint32_t cell_index)
+{
+    return cell_index == kCellUndefined;
+}
+
+inline bool IsStopped(const glm::vec3& v)
+{
+    const float v_epsilon = 0.0001f;
+    return !(v.x > v_epsilon || v.x < -v_epsilon || v.y > v_epsilon ||
+        v.y < -v_epsilon || v.z > v_epsilon || v.z < -v_epsilon);
+}
+
+inline bool IsCellActive(const glm::vec3& v, float density, float temperature)
+{
+    const float kEpsilon = 0.0001f;
+    return !IsStopped(v) || density > kEpsilon || temperature > kEpsilon;
+}
+
+inline void FreeParticle(const FlipParticles& p, int i)
+{
+    p.cell_index_[i] = kCellUndefined;
+    p.position_x_[i] = ToHalf(-1.0f);
+}
+
+inline bool HasAffineFields(const FlipParticles& p)
+{
+    return !!p.affine_[0];
+}
+
+// The particles are in the same cell, so the binding is left as it is.
+inline void SwapParticles(const FlipParticles& p, int i, int j)
+{
+    uint16_t* fields[] = {
+        p.position_x_, p.position_y_, p.position_z_, p.velocity_x_,
+        p.velocity_y_, p.velocity_z_, p.density_,    p.temperature_,
+    };
+    for (uint16_t* field : fields)
+        std::swap(field[i], field[j]);
+
+    if (HasAffineFields(p))
+        for (uint16_t* field : p.affine_)
+            std::swap(field[i], field[j]);
+}
+
+// |rows[c]| is the gradient of velocity component c.
+inline void ReadAffine(const FlipParticles& p, int i, glm::vec3 rows[3])
+{
+    for (int c = 0; c < 3; c++)
+        rows[c] = glm::vec3(ToFloat(p.affine_[3 * c    ][i]),
+                            ToFloat(p.affine_[3 * c + 1][i]),
+                            ToFloat(p.affine_[3 * c + 2][i]));
+}
+
+inline void WriteAffine(const FlipParticles& p, int i,
+                        const glm::vec3 rows[3])
+{
+    for (int c = 0; c < 3; c++) {
+        p.affine_[3 * c    ][i] = ToHalf(rows[c].x);
+        p.affine_[3 * c + 1][i] = ToHalf(rows[c].y);
+        p.affine_[3 * c + 2][i] = ToHalf(rows[c].z);
+    }
+}
+
+inline void ClearAffine(const FlipParticles& p, int i)
+{
+    if (HasAffineFields(p))
+        for (uint16_t* field : p.affine_)
+            field[i] = 0;
+}
+
+// The same hash as random.cuh, so that both implementations scatter the
+// particles alike.
+inline float WangHash(uint32_t* seed)
+{
+    uint32_t local_seed = *seed;
+    local_seed = (local_seed ^ 61) ^ (local_seed >> 16);
+    local_seed *= 9;
+    local_seed = local_seed ^ (local_seed >> 4);
+    local_seed *= 0x27d4eb2d;
+    local_seed = local_seed ^ (local_seed >> 15);
+    *seed = local_seed;
+    return local_seed * (1.0f / 4294967296.0f);
+}
+
+inline glm::vec3 RandomCoordCube(uint32_t* seed)
+{
+    float x = WangHash(seed);
+    float y = WangHash(seed);
+    float z = WangHash(seed);
+    return glm::vec3(x, y, z) - 0.49999f;
+}
+
+int Floor(float f)
+{
+    return static_cast<int>(std::floor(f));
+}
+
+// Reads a single-component volume the way the CUDA kernels read their
+// textures: the cell centers are at the half-integer coordinates, the
+// samples are trilinearly filtered and the coordinates are clamped.
+class VolumeSampler
+{
+public:
+    explicit VolumeSampler(const CpuVolume& volume)
+        : volume_(volume)
+        , max_x_(volume.width() - 1)
+        , max_y_(volume.height() - 1)
+        , max_z_(volume.depth() - 1)
+    {
+        assert(volume.num_of_components() == 1);
+    }
+
+    float Fetch(int x, int y, int z) const
+    {
+        x = std::min(std::max(x, 0), max_x_);
+        y = std::min(std::max(y, 0), max_y_);
+        z = std::min(std::max(z, 0), max_z_);
+
+        const void* row = volume_.GetRowAddress(y, z);
+        if (volume_.byte_width() == 4)
+            return static_cast<const float*>(row)[x];
+
+        return ToFloat(static_cast<const uint16_t*>(row)[x]);
+    }
+
+    float Sample(float x, float y, float z) const
+    {
+        x -= 0.5f;
+        y -= 0.5f;
+        z -= 0.5f;
+
+        int x0 = Floor(x);
+        int y0 = Floor(y);
+        int z0 = Floor(z);
+        float fx = x - x0;
+        float fy = y - y0;
+        float fz = z - z0;
+
+        float c000 = Fetch(x0,     y0,     z0);
+        float c100 = Fetch(x0 + 1, y0,     z0);
+        float c010 = Fetch(x0,     y0 + 1, z0);
+        float c110 = Fetch(x0 + 1, y0 + 1, z0);
+        float c001 = Fetch(x0,     y0,     z0 + 1);
+        float c101 = Fetch(x0 + 1, y0,     z0 + 1);
+        float c011 = Fetch(x0,     y0 + 1, z0 + 1);
+        float c111 = Fetch(x0 + 1, y0 + 1, z0 + 1);
+
+        float c00 = Lerp(c000, c100, fx);
+        float c10 = Lerp(c010, c110, fx);
+        float c01 = Lerp(c001, c101, fx);
+        float c11 = Lerp(c011, c111, fx);
+        return Lerp(Lerp(c00, c10, fy), Lerp(c01, c11, fy), fz);
+    }
+
+    // Also returns the derivatives of the interpolation along the 3 axes.
+    float Sample(float x, float y, float z, glm::vec3* gradient) const
+    {
+        x -= 0.5f;
+        y -= 0.5f;
+        z -= 0.5f;
+
+        int x0 = Floor(x);
+        int y0 = Floor(y);
+        int z0 = Floor(z);
+        float fx = x - x0;
+        float fy = y - y0;
+        float fz = z - z0;
+
+        float c000 = Fetch(x0,     y0,     z0);
+        float c100 = Fetch(x0 + 1, y0,     z0);
+        float c010 = Fetch(x0,     y0 + 1, z0);
+        float c110 = Fetch(x0 + 1, y0 + 1, z0);
+        float c001 = Fetch(x0,     y0,     z0 + 1);
+        float c101 = Fetch(x0 + 1, y0,     z0 + 1);
+        float c011 = Fetch(x0,     y0 + 1, z0 + 1);
+        float c111 = Fetch(x0 + 1, y0 + 1, z0 + 1);
+
+        gradient->x = Lerp(Lerp(c100 - c000, c110 - c010, fy),
+                           Lerp(c101 - c001, c111 - c011, fy), fz);
+        gradient->y = Lerp(Lerp(c010 - c000, c110 - c100, fx),
+                           Lerp(c011 - c001, c111 - c101, fx), fz);
+        gradient->z = Lerp(Lerp(c001 - c000, c101 - c100, fx),
+                           Lerp(c011 - c010, c111 - c110, fx), fy);
+
+        float c00 = Lerp(c000, c100, fx);
+        float c10 = Lerp(c010, c110, fx);
+        float c01 = Lerp(c001, c101, fx);
+        float c11 = Lerp(c011, c111, fx);
+        return Lerp(Lerp(c00, c10, fy), Lerp(c01, c11, fy), fz);
+    }
+
+private:
+    static float Lerp(float a, float b, float t)
+    {
+        return a + (b - a) * t;
+    }
+
+    const CpuVolume& volume_;
+    int max_x_;
+    int max_y_;
+    int max_z_;
+};
+
+class VelocitySampler
+{
+public:
+    VelocitySampler(const CpuVolume& x, const CpuVolume& y,
+                    const CpuVolume& z)
+        : x_(x)
+        , y_(y)
+        , z_(z)
+    {
+    }
+
+    glm::vec3 Sample(const glm::vec3& p) const
+    {
+        return glm::vec3(x_.Sample(p.x + 0.5f, p.y,        p.z),
+                         y_.Sample(p.x,        p.y + 0.5f, p.z),
+                         z_.Sample(p.x,        p.y,        p.z + 0.5f));
+    }
+
+    // |gradients[c]| receives the gradient of component c.
+    glm::vec3 Sample(const glm::vec3& p, glm::vec3 gradients[3]) const
+    {
+        return glm::vec3(
+            x_.Sample(p.x + 0.5f, p.y,        p.z,        &gradients[0]),
+            y_.Sample(p.x,        p.y + 0.5f, p.z,        &gradients[1]),
+            z_.Sample(p.x,        p.y,        p.z + 0.5f, &gradients[2]));
+    }
+
+private:
+    VolumeSampler x_;
+    VolumeSampler y_;
+    VolumeSampler z_;
+};
+
+// Bogacki-Shampine, the same order as the CUDA version.
+glm::vec3 TraceParticle(const VelocitySampler& vel, const glm::vec3& pos_0,
+                        const glm::vec3& vel_0, float time_step_over_cell_size)
+{
+    float t = time_step_over_cell_size;
+    glm::vec3 vel_2 = vel.Sample(pos_0 + 0.5f * t * vel_0);
+    glm::vec3 vel_3 = vel.Sample(pos_0 + 0.75f * t * vel_2);
+    return pos_0 + (2.0f / 9.0f * t) * vel_0 + (3.0f / 9.0f * t) * vel_2 +
+        (4.0f / 9.0f * t) * vel_3;
+}
+
+// Hands out the free particles to the slices in slice order, so that the
+// result does not depend on the threading. |count| tells the number of
+// particles that slice z asks for. |fill| initializes the particles from
+// |base| on, consecutively, and returns how many of them are actually taken,
+// which could be less than asked for when |limit| is reached. Returns the new
+// number of active particles.
+template <typename CountFunc, typename FillFunc>
+int AppendParticles(ThreadPool* pool, const FlipParticles& particles,
+                    int depth, const CountFunc& count, const FillFunc& fill)
+{
+    std::vector<int> bases(depth + 1, 0);
+    pool->ParallelFor(0, depth, [&](int z0, int z1) {
+        for (int z = z0; z < z1; z++)
+            bases[z + 1] = count(z);
+    });
+
+    bases[0] = *particles.num_of_actives_;
+    for (int z = 0; z < depth; z++)
+        bases[z + 1] += bases[z];
+
+    std::vector<int> taken(depth, 0);
+    pool->ParallelFor(0, depth, [&](int z0, int z1) {
+        for (int z = z0; z < z1; z++) {
+            int limit = std::min(bases[z + 1], particles.num_of_particles_);
+            if (bases[z] < limit)
+                taken[z] = fill(z, bases[z], limit);
+        }
+    });
+
+    // Only the slice that runs out of particles takes less than it asks for,
+    // and the ones after it get nothing, so the active particles stay
+    // consecutive.
+    int num_of_actives = *particles.num_of_actives_;
+    for (int z = 0; z < depth; z++)
+        if (taken[z])
+            num_of_actives = bases[z] + taken[z];
+
+    return num_of_actives;
+}
+
+// Accumulates the weighted sums and the weights of the fields, for 3
+// consecutive slices in a ring.
+class TransferSlices
+{
+public:
+    TransferSlices(int width, int height)
+        : slice_size_(width * height)
+        , data_(3 * 2 * NUM_OF_TRANSFER_FIELDS * slice_size_)
+    {
+    }
+
+    void Clear(int z)
+    {
+        int n = NUM_OF_TRANSFER_FIELDS * slice_size_;
+        std::fill(Sums(z, 0), Sums(z, 0) + n, 0.0f);
+        std::fill(Weights(z, 0), Weights(z, 0) + n, kInitialWeight);
+    }
+
+    float* Sums(int z, int field)
+    {
+        int i = (z % 3) * 2 * NUM_OF_TRANSFER_FIELDS + field;
+        return &data_[i * slice_size_];
+    }
+
+    float* Weights(int z, int field)
+    {
+        int i = ((z % 3) * 2 + 1) * NUM_OF_TRANSFER_FIELDS + field;
+        return &data_[i * slice_size_];
+    }
+
+private:
+    int slice_size_;
+    std::vector<float> data_;
+};
+
+// Adds |value| to the 8 nodes around |pos|, which is given in the
+// coordinates of the nodes of the field, extrapolated to every node along
+// |gradient|. Only the slices [z_begin, z_end) are touched.
+void Splat(TransferSlices* slices, int field, const glm::vec3& pos,
+           float value, const glm::vec3& gradient,
+           const glm::ivec3& volume_size, int z_begin, int z_end)
+{
+    int x0 = Floor(pos.x);
+    int y0 = Floor(pos.y);
+    int z0 = Floor(pos.z);
+    float wx[] = {1.0f - (pos.x - x0), pos.x - x0};
+    float wy[] = {1.0f - (pos.y - y0), pos.y - y0};
+    float wz[] = {1.0f - (pos.z - z0), pos.z - z0};
+
+    for (int k = 0; k < 2; k++) {
+        int z = z0 + k;
+        if (z < z_begin || z >= z_end)
+            continue;
+
+        float* sums = slices->Sums(z, field);
+        float* weights = slices->Weights(z, field);
+        for (int j = 0; j < 2; j++) {
+            int y = y0 + j;
+            if (y < 0 || y >= volume_size.y)
+                continue;
+
+            for (int i = 0; i < 2; i++) {
+                int x = x0 + i;
+                if (x < 0 || x >= volume_size.x)
+                    continue;
+
+                float w = wx[i] * wy[j] * wz[k];
+                float v = value + gradient.x * (x - pos.x) +
+                    gradient.y * (y - pos.y) + gradient.z * (z - pos.z);
+                int n = y * volume_size.x + x;
+                sums[n] += w * v;
+                weights[n] += w;
+            }
+        }
+    }
+}
+} // Anonymous namespace.
+
+// The stages follow FlipImplCuda one by one, on the same quantized particle
+// layout. Wherever the kernels rely on atomics to hand out particles or
+// slots, the host version works in two passes over fixed chunks instead, so
+// that the result is the same for any number of threads. Binding and sorting
+// go through CountingSort.
+
+FlipImplCpu::FlipImplCpu(Observer* observer, ThreadPool* pool,
+                         RandomHelper* rand)
+    : observer_(observer)
+    , pool_(pool)
+    , rand_(rand)
+    , cell_size_(0.15f)
+    , impulse_(IMPULSE_HOT_FLOOR)
+    , outflow_(false)
+    , max_sort_churn_(0.0f)
+    , particles_per_cell_(8)
+    , min_particles_per_cell_(3)
+    , reseed_density_threshold_(0.0f)
+    , sorter_(new CountingSort(pool))
+{
+
+}
+
+FlipImplCpu::~FlipImplCpu()
+{
+
+}
+
+void FlipImplCpu::Advect(const FlipParticles& particles,
+                         int* num_active_particles, const FlipParticles& aux,
+                         CpuVolume* vnp1_x, CpuVolume* vnp1_y,
+                         CpuVolume* vnp1_z, CpuVolume* vn_x, CpuVolume* vn_y,
+                         CpuVolume* vn_z, CpuVolume* density,
+                         CpuVolume* temperature, float time_step,
+                         float velocity_dissipation, float density_dissipation,
+                         float temperature_dissipation)
+{
+    glm::ivec3 volume_size = vnp1_x->size();
+
+    InterpolateDeltaVelocity(particles, vnp1_x, vnp1_y, vnp1_z, vn_x, vn_y,
+                             vn_z);
+    observer_->OnVelocityInterpolated();
+
+    Resample(particles, vnp1_x, vnp1_y, vnp1_z, density, temperature,
+             rand_->Iterate());
+    DiffuseAndDecay(particles, time_step, velocity_dissipation,
+                    density_dissipation, temperature_dissipation);
+    observer_->OnResampled();
+
+    AdvectParticles(particles, vnp1_x, vnp1_y, vnp1_z, time_step);
+    observer_->OnAdvected();
+
+    FlipParticles p = particles;
+    CompactParticles(&p, num_active_particles, aux, volume_size);
+    *num_active_particles -= CullParticles(p, volume_size);
+    TransferToGrid(vn_x, vn_y, vn_z, density, temperature, p);
+    observer_->OnTransferred();
+}
+
+void FlipImplCpu::Emit(const FlipParticles& particles,
+                       const glm::vec3& center_point, const glm::vec3& hotspot,
+                       float radius, float density, float temperature,
+                       const glm::vec3& velocity, const glm::ivec3& volume_size)
+{
+    glm::ivec3 region = volume_size;
+    switch (impulse_) {
+        case IMPULSE_HOT_FLOOR:
+            region.y = static_cast<int>(std::ceil(0.025f * volume_size.y));
+            break;
+        case IMPULSE_SPHERE:
+            region.y = static_cast<int>(std::ceil(radius + center_point.y));
+            break;
+        case IMPULSE_BUOYANT_JET:
+            region.x = static_cast<int>(std::ceil(0.02f * volume_size.x));
+            break;
+        default:
+            return;
+    }
+
+    region.x = std::min(region.x, volume_size.x);
+    region.y = std::min(region.y, volume_size.y);
+
+    FluidImpulse impulse = impulse_;
+    auto inside = [=](const glm::vec3& coord) -> bool {
+        glm::vec3 d = coord - center_point;
+        switch (impulse) {
+            case IMPULSE_HOT_FLOOR:
+                return std::hypot(coord.x - hotspot.x,
+                                  coord.z - hotspot.z) < radius;
+            case IMPULSE_BUOYANT_JET:
+                return std::hypot(d.y, d.z) < radius;
+            default:
+                return std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) < radius;
+        }
+    };
+
+    // Everything but the position is refreshed for the particles already in
+    // the cell.
+    const FlipParticles& p = particles;
+    auto refresh = [=](int i, const glm::vec3& pos) {
+        p.density_    [i] = ToHalf(density);
+        p.temperature_[i] = ToHalf(temperature);
+        if (impulse == IMPULSE_BUOYANT_JET) {
+            p.velocity_x_[i] = ToHalf(velocity.x);
+        } else if (impulse == IMPULSE_SPHERE) {
+            glm::vec3 dir = pos - center_point;
+            float len = std::sqrt(dir.x * dir.x + dir.y * dir.y +
+                                  dir.z * dir.z);
+            glm::vec3 vel = len > 0.0f ? dir * (velocity.x / len) : dir;
+            p.velocity_x_[i] = ToHalf(vel.x);
+            p.velocity_y_[i] = ToHalf(vel.y);
+            p.velocity_z_[i] = ToHalf(vel.z);
+        }
+    };
+
+    auto count = [=](int z) {
+        int n = 0;
+        for (int y = 0; y < region.y; y++) {
+            for (int x = 0; x < region.x; x++) {
+                int cell = (z * volume_size.y + y) * volume_size.x + x;
+                if (!p.particle_count_[cell] &&
+                        inside(glm::vec3(x, y, z) + 0.5f))
+                    n += kMaxNumSamplesForOneTime;
+            }
+        }
+
+        return n;
+    };
+
+    uint32_t random_seed = rand_->Iterate();
+    auto fill = [=](int z, int base, int limit) {
+        int index = base;
+        for (int y = 0; y < region.y; y++) {
+            for (int x = 0; x < region.x; x++) {
+                glm::vec3 coord = glm::vec3(x, y, z) + 0.5f;
+                if (!inside(coord))
+                    continue;
+
+                int cell = (z * volume_size.y + y) * volume_size.x + x;
+                int count = p.particle_count_[cell];
+                if (count) {
+                    int p_index = p.particle_index_[cell];
+                    for (int i = p_index; i < p_index + count; i++) {
+                        glm::vec3 pos(ToFloat(p.position_x_[i]),
+                                      ToFloat(p.position_y_[i]),
+                                      ToFloat(p.position_z_[i]));
+                        refresh(i, pos);
+                    }
+
+                    continue;
+                }
+
+                int new_particles = kMaxNumSamplesForOneTime;
+                if (index + new_particles > limit)
+                    continue; // Not enough free particles.
+
+                p.particle_count_[cell] += new_particles;
+                uint32_t seed = random_seed + cell;
+                for (int i = index; i < index + new_particles; i++) {
+                    glm::vec3 pos = coord + RandomCoordCube(&seed);
+
+                    // Assign a valid value to |cell_index_| to activate this
+                    // particle.
+                    p.cell_index_[i] = cell;
+                    p.position_x_[i] = ToHalf(pos.x);
+                    p.position_y_[i] = ToHalf(pos.y);
+                    p.position_z_[i] = ToHalf(pos.z);
+                    p.velocity_x_[i] = 0;
+                    p.velocity_y_[i] = 0;
+                    p.velocity_z_[i] = 0;
+                    ClearAffine(p, i);
+                    refresh(i, pos);
+                }
+
+                index += new_particles;
+            }
+        }
+
+        return index - base;
+    };
+
+    *particles.num_of_actives_ = AppendParticles(pool_, particles,
+                                                 volume_size.z, count, fill);
+    observer_->OnEmitted();
+}
+
+void FlipImplCpu::Reset(const FlipParticles& particles,
+                        const glm::ivec3& volume_size)
+{
+    const FlipParticles& p = particles;
+    pool_->ParallelFor(0, p.num_of_particles_, [=](int i0, int i1) {
+        for (int i = i0; i < i1; i++) {
+            FreeParticle(p, i);
+            p.in_cell_index_[i] = 0;
+            p.position_y_   [i] = 0;
+            p.position_z_   [i] = 0;
+            p.velocity_x_   [i] = 0;
+            p.velocity_y_   [i] = 0;
+            p.velocity_z_   [i] = 0;
+            p.density_      [i] = 0;
+            p.temperature_  [i] = 0;
+        }
+    });
+
+    int num_of_cells = volume_size.x * volume_size.y * volume_size.z;
+    std::fill(p.particle_index_, p.particle_index_ + num_of_cells, 0);
+    std::fill(p.particle_count_, p.particle_count_ + num_of_cells, 0);
+    *p.num_of_actives_ = 0;
+    sorter_->Reset();
+}
+
+void FlipImplCpu::InterpolateDeltaVelocity(const FlipParticles& particles,
+                                           CpuVolume* vnp1_x,
+                                           CpuVolume* vnp1_y,
+                                           CpuVolume* vnp1_z, CpuVolume* vn_x,
+                                           CpuVolume* vn_y, CpuVolume* vn_z)
+{
+    const FlipParticles& p = particles;
+    VelocitySampler vnp1(*vnp1_x, *vnp1_y, *vnp1_z);
+    VelocitySampler vn(*vn_x, *vn_y, *vn_z);
+    if (HasAffineFields(p)) {
+        // APIC: no delta, the new velocity is taken as is, along with its
+        // derivatives.
+        pool_->ParallelFor(0, *p.num_of_actives_, [&](int i0, int i1) {
+            for (int i = i0; i < i1; i++) {
+                glm::vec3 pos(ToFloat(p.position_x_[i]),
+                              ToFloat(p.position_y_[i]),
+                              ToFloat(p.position_z_[i]));
+                glm::vec3 rows[3];
+                glm::vec3 v = vnp1.Sample(pos, rows);
+
+                p.velocity_x_[i] = ToHalf(v.x);
+                p.velocity_y_[i] = ToHalf(v.y);
+                p.velocity_z_[i] = ToHalf(v.z);
+                WriteAffine(p, i, rows);
+            }
+        });
+        return;
+    }
+
+    pool_->ParallelFor(0, *p.num_of_actives_, [&](int i0, int i1) {
+        for (int i = i0; i < i1; i++) {
+            glm::vec3 pos(ToFloat(p.position_x_[i]), ToFloat(p.position_y_[i]),
+                          ToFloat(p.position_z_[i]));
+            glm::vec3 delta = vnp1.Sample(pos) - vn.Sample(pos);
+
+            // v_np1 = (1 - alpha) * v_n_pic + alpha * v_n_flip.
+            // We are using alpha = 1.
+            p.velocity_x_[i] = ToHalf(ToFloat(p.velocity_x_[i]) + delta.x);
+            p.velocity_y_[i] = ToHalf(ToFloat(p.velocity_y_[i]) + delta.y);
+            p.velocity_z_[i] = ToHalf(ToFloat(p.velocity_z_[i]) + delta.z);
+        }
+    });
+}
+
+void FlipImplCpu::Resample(const FlipParticles& particles, CpuVolume* vel_x,
+                           CpuVolume* vel_y, CpuVolume* vel_z,
+                           CpuVolume* density, CpuVolume* temperature,
+                           uint32_t random_seed)
+{
+    const FlipParticles& p = particles;
+    int free_particles = p.num_of_particles_ - *p.num_of_actives_;
+    if (free_particles < static_cast<int>(kMaxNumSamplesForOneTime))
+        return; // No more free particles.
+
+    glm::ivec3 volume_size = vel_x->size();
+    VelocitySampler vel(*vel_x, *vel_y, *vel_z);
+    VolumeSampler d(*density);
+    VolumeSampler t(*temperature);
+
+    // The number of particles every cell asks for, so that the fields are
+    // sampled at the cell centers only once.
+    std::vector<uint8_t> needed(volume_size.x * volume_size.y * volume_size.z);
+    auto count = [&](int z) {
+        int n = 0;
+        for (int y = 0; y < volume_size.y; y++) {
+            for (int x = 0; x < volume_size.x; x++) {
+                int cell = (z * volume_size.y + y) * volume_size.x + x;
+                needed[cell] = 0;
+
+                int count = p.particle_count_[cell];
+                if (count >= min_particles_per_cell_)
+                    continue;
+
+                int m = std::min(particles_per_cell_ - count,
+                                 static_cast<int>(kMaxNumSamplesForOneTime));
+                if (m <= 0)
+                    continue;
+
+                glm::vec3 coord = glm::vec3(x, y, z) + 0.5f;
+                float density = d.Sample(coord.x, coord.y, coord.z);
+                float temperature = t.Sample(coord.x, coord.y, coord.z);
+                if (density < reseed_density_threshold_ ||
+                        !IsCellActive(vel.Sample(coord), density, temperature))
+                    continue;
+
+                needed[cell] = static_cast<uint8_t>(m);
+                n += m;
+            }
+        }
+
+        return n;
+    };
+
+    auto fill = [&](int z, int base, int limit) {
+        int index = base;
+        for (int y = 0; y < volume_size.y; y++) {
+            for (int x = 0; x < volume_size.x; x++) {
+                int cell = (z * volume_size.y + y) * volume_size.x + x;
+                int m = needed[cell];
+                if (!m || index + m > limit)
+                    continue;
+
+                glm::vec3 coord = glm::vec3(x, y, z) + 0.5f;
+                uint32_t seed = random_seed + cell;
+                for (int i = index; i < index + m; i++) {
+                    glm::vec3 pos = coord + RandomCoordCube(&seed);
+                    glm::vec3 v = vel.Sample(pos);
+
+                    p.cell_index_ [i] = cell;
+                    p.position_x_ [i] = ToHalf(pos.x);
+                    p.position_y_ [i] = ToHalf(pos.y);
+                    p.position_z_ [i] = ToHalf(pos.z);
+                    p.velocity_x_ [i] = ToHalf(v.x);
+                    p.velocity_y_ [i] = ToHalf(v.y);
+                    p.velocity_z_ [i] = ToHalf(v.z);
+                    p.density_    [i] = ToHalf(d.Sample(pos.x, pos.y, pos.z));
+                    p.temperature_[i] = ToHalf(t.Sample(pos.x, pos.y, pos.z));
+                    ClearAffine(p, i);
+                }
+
+                index += m;
+            }
+        }
+
+        return index - base;
+    };
+
+    *p.num_of_actives_ = AppendParticles(pool_, p, volume_size.z, count,
+                                         fill);
+}
+
+void FlipImplCpu::DiffuseAndDecay(const FlipParticles& particles,
+                                  float time_step, float velocity_dissipation,
+                                  float density_dissipation,
+                                  float temperature_dissipation)
+{
+    const FlipParticles& p = particles;
+    float v = 1.0f - velocity_dissipation * time_step;
+    float d = 1.0f - density_dissipation * time_step;
+    float t = 1.0f - temperature_dissipation * time_step;
+    pool_->ParallelFor(0, *p.num_of_actives_, [=](int i0, int i1) {
+        for (int i = i0; i < i1; i++) {
+            p.velocity_x_ [i] = ToHalf(v * ToFloat(p.velocity_x_[i]));
+            p.velocity_y_ [i] = ToHalf(v * ToFloat(p.velocity_y_[i]));
+            p.velocity_z_ [i] = ToHalf(v * ToFloat(p.velocity_z_[i]));
+            p.density_    [i] = ToHalf(d * ToFloat(p.density_[i]));
+            p.temperature_[i] = ToHalf(t * ToFloat(p.temperature_[i]));
+        }
+    });
+}
+
+void FlipImplCpu::AdvectParticles(const FlipParticles& particles,
+                                  CpuVolume* vel_x, CpuVolume* vel_y,
+                                  CpuVolume* vel_z, float time_step)
+{
+    const FlipParticles& p = particles;
+    glm::ivec3 volume_size = vel_x->size();
+    VelocitySampler vel(*vel_x, *vel_y, *vel_z);
+    float time_step_over_cell_size = time_step / cell_size_;
+    bool outflow = outflow_;
+    pool_->ParallelFor(0, *p.num_of_actives_, [&](int i0, int i1) {
+        for (int i = i0; i < i1; i++) {
+            // The culled particles wait for the next sort.
+            if (IsCellUndefined(p.cell_index_[i]))
+                continue;
+
+            glm::vec3 pos(ToFloat(p.position_x_[i]), ToFloat(p.position_y_[i]),
+                          ToFloat(p.position_z_[i]));
+
+            // Like the CUDA version, the particles follow the re-sampled
+            // velocity rather than their own.
+            glm::vec3 v = vel.Sample(pos);
+            if (IsStopped(v))
+                continue;
+
+            glm::vec3 result = TraceParticle(vel, pos, v,
+                                             time_step_over_cell_size);
+            if (result.x < 0.0f || result.x >= volume_size.x)
+                p.velocity_x_[i] = 0;
+
+            if (result.y < 0.0f || result.y >= volume_size.y) {
+                if (outflow) {
+                    FreeParticle(p, i);
+                    continue;
+                }
+
+                p.velocity_y_[i] = 0;
+            }
+
+            if (result.z < 0.0f || result.z >= volume_size.z)
+                p.velocity_z_[i] = 0;
+
+            float x = std::min(std::max(result.x, 0.0f), volume_size.x - 1.0f);
+            float y = std::min(std::max(result.y, 0.0f), volume_size.y - 1.0f);
+            float z = std::min(std::max(result.z, 0.0f), volume_size.z - 1.0f);
+
+            p.position_x_[i] = ToHalf(x);
+            p.position_y_[i] = ToHalf(y);
+            p.position_z_[i] = ToHalf(z);
+
+            int xi = static_cast<int>(x);
+            int yi = static_cast<int>(y);
+            int zi = static_cast<int>(z);
+            p.cell_index_[i] = (zi * volume_size.y + yi) * volume_size.x + xi;
+        }
+    });
+}
+
+bool FlipImplCpu::BindParticlesToCells(const FlipParticles& particles,
+                                       const glm::ivec3& volume_size)
+{
+    // The active particles are consecutive on the host, for both emission
+    // and re-sampling append to them. Only the freed ones among them are
+    // undefined.
+    //
+    // Most of the particles stay in their cells from one step to the next,
+    // so the order of the last sort is patched, unless too many of them
+    // moved.
+    const FlipParticles& p = particles;
+    int num_of_cells = volume_size.x * volume_size.y * volume_size.z;
+    int n = *p.num_of_actives_;
+    bool patched = max_sort_churn_ > 0.0f &&
+        sorter_->Update(p.cell_index_, n, num_of_cells, kCellCapacity,
+                        max_sort_churn_, p.particle_count_, p.particle_index_);
+    if (!patched)
+        sorter_->Count(p.cell_index_, n, num_of_cells, kCellCapacity,
+                       p.particle_count_);
+
+    const uint32_t* ranks = sorter_->ranks();
+    pool_->ParallelFor(0, n, [=](int i0, int i1) {
+        for (int i = i0; i < i1; i++) {
+            if (ranks[i] != CountingSort::kDropped)
+                p.in_cell_index_[i] = static_cast<uint8_t>(ranks[i]);
+            else if (!IsCellUndefined(p.cell_index_[i]))
+                FreeParticle(p, i);
+        }
+    });
+
+    return patched;
+}
+
+void FlipImplCpu::BuildCellOffsets(const FlipParticles& particles,
+                                   const glm::ivec3& volume_size)
+{
+    int num_of_cells = volume_size.x * volume_size.y * volume_size.z;
+    sorter_->ComputeOffsets(particles.particle_count_, num_of_cells,
+                            particles.particle_index_);
+}
+
+void FlipImplCpu::SortParticles(const FlipParticles& particles,
+                                int* num_active_particles,
+                                const FlipParticles& aux,
+                                const glm::ivec3& volume_size)
+{
+    const FlipParticles& p_src = particles;
+    const FlipParticles& p_aux = aux;
+    std::vector<CountingSort::Field> fields = {
+        {p_src.cell_index_,    p_aux.cell_index_,    sizeof(uint32_t)},
+        {p_src.in_cell_index_, p_aux.in_cell_index_, sizeof(uint8_t)},
+        {p_src.position_x_,    p_aux.position_x_,    sizeof(uint16_t)},
+        {p_src.position_y_,    p_aux.position_y_,    sizeof(uint16_t)},
+        {p_src.position_z_,    p_aux.position_z_,    sizeof(uint16_t)},
+        {p_src.velocity_x_,    p_aux.velocity_x_,    sizeof(uint16_t)},
+        {p_src.velocity_y_,    p_aux.velocity_y_,    sizeof(uint16_t)},
+        {p_src.velocity_z_,    p_aux.velocity_z_,    sizeof(uint16_t)},
+        {p_src.density_,       p_aux.density_,       sizeof(uint16_t)},
+        {p_src.temperature_,   p_aux.temperature_,   sizeof(uint16_t)},
+    };
+    if (HasAffineFields(p_src))
+        for (int i = 0; i < 9; i++)
+            fields.push_back({p_src.affine_[i], p_aux.affine_[i],
+                              sizeof(uint16_t)});
+
+    // Without an auxiliary set of particles, the fields are sorted in place.
+    int num_of_fields = static_cast<int>(fields.size());
+    if (aux.velocity_x_)
+        sorter_->Scatter(fields.data(), num_of_fields);
+    else
+        sorter_->Permute(fields.data(), num_of_fields);
+
+    int last_cell_index = volume_size.x * volume_size.y * volume_size.z - 1;
+    *p_src.num_of_actives_ = p_src.particle_index_[last_cell_index] +
+        p_src.particle_count_[last_cell_index];
+    *num_active_particles = *p_src.num_of_actives_;
+}
+
+void FlipImplCpu::TransferToGrid(CpuVolume* vel_x, CpuVolume* vel_y,
+                                 CpuVolume* vel_z, CpuVolume* density,
+                                 CpuVolume* temperature,
+                                 const FlipParticles& particles)
+{
+    // Every thread owns a slab of the output slices, and splats the sorted
+    // particles into its own ring of slices instead of using atomics. A slice
+    // is complete as soon as the particles of the next slice are splatted,
+    // so the particles in the slices just outside the slab are splatted by
+    // both of the neighboring threads.
+    const FlipParticles& p = particles;
+    glm::ivec3 volume_size = vel_x->size();
+    int slice_size = volume_size.x * volume_size.y;
+    bool apic = HasAffineFields(p);
+    CpuVolume* dest[NUM_OF_TRANSFER_FIELDS] = {
+        vel_x, vel_y, vel_z, density, temperature
+    };
+
+    pool_->ParallelFor(0, volume_size.z, [&](int z0, int z1) {
+        TransferSlices slices(volume_size.x, volume_size.y);
+        std::vector<RowWriter> writers;
+        for (auto v : dest)
+            writers.emplace_back(v);
+
+        auto splat = [&](int field, const glm::vec3& pos, float value,
+                         const glm::vec3& gradient) {
+            Splat(&slices, field, pos, value, gradient, volume_size, z0, z1);
+        };
+        auto splat_slice = [&](int z) {
+            if (z < 0 || z >= volume_size.z)
+                return;
+
+            int first_cell = z * slice_size;
+            int last_cell = first_cell + slice_size - 1;
+            uint32_t end = p.particle_index_[last_cell] +
+                p.particle_count_[last_cell];
+            for (uint32_t i = p.particle_index_[first_cell]; i < end; i++) {
+                if (IsCellUndefined(p.cell_index_[i]))
+                    continue;
+
+                glm::vec3 pos(ToFloat(p.position_x_[i]),
+                              ToFloat(p.position_y_[i]),
+                              ToFloat(p.position_z_[i]));
+                glm::vec3 center = pos - 0.5f;
+
+                // In APIC mode, the velocities are extrapolated to the nodes
+                // by the affine velocity of the particle.
+                glm::vec3 rows[3] = {glm::vec3(0.0f), glm::vec3(0.0f),
+                                     glm::vec3(0.0f)};
+                if (apic)
+                    ReadAffine(p, i, rows);
+
+                splat(TRANSFER_VEL_X, glm::vec3(pos.x, center.y, center.z),
+                      ToFloat(p.velocity_x_[i]), rows[0]);
+                splat(TRANSFER_VEL_Y, glm::vec3(center.x, pos.y, center.z),
+                      ToFloat(p.velocity_y_[i]), rows[1]);
+                splat(TRANSFER_VEL_Z, glm::vec3(center.x, center.y, pos.z),
+                      ToFloat(p.velocity_z_[i]), rows[2]);
+                splat(TRANSFER_DENSITY, center, ToFloat(p.density_[i]),
+                      glm::vec3(0.0f));
+                splat(TRANSFER_TEMPERATURE, center,
+                      ToFloat(p.temperature_[i]), glm::vec3(0.0f));
+            }
+        };
+
+        auto save_slice = [&](int z) {
+            for (int f = 0; f < NUM_OF_TRANSFER_FIELDS; f++) {
+                const float* sums = slices.Sums(z, f);
+                const float* weights = slices.Weights(z, f);
+                for (int y = 0; y < volume_size.y; y++) {
+                    float* row = writers[f].Begin(y, z);
+                    int base = y * volume_size.x;
+                    for (int x = 0; x < volume_size.x; x++)
+                        row[x] = sums[base + x] / weights[base + x];
+
+                    writers[f].End(y, z);
+                }
+            }
+        };
+
+        slices.Clear(z0);
+        splat_slice(z0 - 1);
+        for (int z = z0; z <= z1; z++) {
+            if (z + 1 < z1)
+                slices.Clear(z + 1);
+
+            splat_slice(z);
+            if (z > z0)
+                save_slice(z - 1);
+        }
+    });
+}
+
+int FlipImplCpu::CullParticles(const FlipParticles& particles,
+                               const glm::ivec3& volume_size)
+{
+    if (particles_per_cell_ <= 0)
+        return 0;
+
+    // The transfer weighs the particles by their positions in the cell, so
+    // the survivors are taken evenly from the 8 octants of the cell, rather
+    // than corrected towards the mean of the cell. The particles keep their
+    // values, and the survivors are moved to the front of the cell. The
+    // culled ones are freed in place, and dropped by the next sort.
+    const FlipParticles& p = particles;
+    uint32_t target = static_cast<uint32_t>(particles_per_cell_);
+    int slice_size = volume_size.x * volume_size.y;
+    std::vector<int> culled(volume_size.z, 0);
+    pool_->ParallelFor(0, volume_size.z, [&](int z0, int z1) {
+        std::vector<uint32_t> order;
+        std::vector<bool> survived;
+        for (int z = z0; z < z1; z++) {
+            for (int cell = z * slice_size; cell < (z + 1) * slice_size;
+                    cell++) {
+                uint32_t count = p.particle_count_[cell];
+                if (count <= target)
+                    continue;
+
+                // The particles are taken in rounds, one from each octant
+                // per round.
+                uint32_t begin = p.particle_index_[cell];
+                uint32_t taken[8] = {0};
+                order.resize(count);
+                for (uint32_t i = 0; i < count; i++) {
+                    glm::vec3 pos(ToFloat(p.position_x_[begin + i]),
+                                  ToFloat(p.position_y_[begin + i]),
+                                  ToFloat(p.position_z_[begin + i]));
+                    glm::vec3 f = pos - glm::vec3(Floor(pos.x), Floor(pos.y),
+                                                  Floor(pos.z));
+                    int octant = (f.x >= 0.5f ? 1 : 0) |
+                        (f.y >= 0.5f ? 2 : 0) | (f.z >= 0.5f ? 4 : 0);
+                    order[i] = (taken[octant]++ << 3 | octant) << 8 | i;
+                }
+
+                std::nth_element(order.begin(), order.begin() + target,
+                                 order.end());
+                survived.assign(count, false);
+                for (uint32_t k = 0; k < target; k++)
+                    survived[order[k] & 0xFF] = true;
+
+                uint32_t back = target;
+                for (uint32_t i = 0; i < target; i++) {
+                    if (survived[i])
+                        continue;
+
+                    while (!survived[back])
+                        back++;
+
+                    SwapParticles(p, begin + i, begin + back);
+                    survived[back++] = false;
+                }
+
+                for (uint32_t i = begin + target; i < begin + count; i++)
+                    FreeParticle(p, static_cast<int>(i));
+
+                p.particle_count_[cell] = target;
+                culled[z] += static_cast<int>(count - target);
+            }
+        }
+    });
+
+    int total = 0;
+    for (int n : culled)
+        total += n;
+
+    return total;
+}
+
+void FlipImplCpu::CompactParticles(FlipParticles* particles,
+                                   int* num_active_particles,
+                                   const FlipParticles& aux,
+                                   const glm::ivec3& volume_size)
+{
+    bool offsets_ready = BindParticlesToCells(*particles, volume_size);
+    observer_->OnCellBound();
+
+    if (!offsets_ready)
+        BuildCellOffsets(*particles, volume_size);
+
+    observer_->OnPrefixSumCalculated();
+
+    SortParticles(*particles, num_active_particles, aux, volume_size);
+    observer_->OnSorted();
+
+    if (!aux.velocity_x_)
+        return;
+
+    particles->cell_index_    = aux.cell_index_;
+    particles->in_cell_index_ = aux.in_cell_index_;
+    particles->position_x_    = aux.position_x_;
+    particles->position_y_    = aux.position_y_;
+    particles->position_z_    = aux.position_z_;
+    particles->velocity_x_    = aux.velocity_x_;
+    particles->velocity_y_    = aux.velocity_y_;
+    particles->velocity_z_    = aux.velocity_z_;
+    particles->density_       = aux.density_;
+    particles->temperature_   = aux.temperature_;
+    for (int i = 0; i < 9; i++)
+        particles->affine_[i] = aux.affine_[i];
+}
@@ -0,0 +1,121 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _FLIP_IMPL_CPU_H_
+#define _FLIP_IMPL_CPU_H_
+
+#include <memory>
+
+#include <stdint.h>
+
+#include "cuda/fluid_impulse.h"
+#include "cuda/particle/flip_impl_cuda.h"
+#include "third_party/glm/fwd.hpp"
+
+struct FlipParticles;
+class CountingSort;
+class CpuVolume;
+class RandomHelper;
+class ThreadPool;
+class FlipImplCpu
+{
+public:
+    // The stages report to the same observer as the CUDA version, so the
+    // metrics of the two are comparable.
+    typedef FlipImplCuda::Observer Observer;
+
+    FlipImplCpu(Observer* observer, ThreadPool* pool, RandomHelper* rand);
+    ~FlipImplCpu();
+
+    void Advect(const FlipParticles& particles, int* num_active_particles,
+                const FlipParticles& aux, CpuVolume* vnp1_x, CpuVolume* vnp1_y,
+                CpuVolume* vnp1_z, CpuVolume* vn_x, CpuVolume* vn_y,
+                CpuVolume* vn_z, CpuVolume* density, CpuVolume* temperature,
+                float time_step, float velocity_dissipation,
+                float density_dissipation, float temperature_dissipation);
+    void Emit(const FlipParticles& particles, const glm::vec3& center_point,
+              const glm::vec3& hotspot, float radius, float density,
+              float temperature, const glm::vec3& velocity,
+              const glm::ivec3& volume_size);
+    void Reset(const FlipParticles& particles, const glm::ivec3& volume_size);
+
+    void set_cell_size(float cell_size) { cell_size_ = cell_size; }
+    void set_fluid_impulse(FluidImpulse i) { impulse_ = i; }
+    void set_max_sort_churn(float churn) { max_sort_churn_ = churn; }
+    void set_min_particles_per_cell(int n) { min_particles_per_cell_ = n; }
+    void set_outflow(bool outflow) { outflow_ = outflow; }
+    void set_particles_per_cell(int n) { particles_per_cell_ = n; }
+    void set_reseed_density_threshold(float density) {
+        reseed_density_threshold_ = density;
+    }
+
+private:
+    friend class FlipUnittest;
+
+    void InterpolateDeltaVelocity(const FlipParticles& particles,
+                                  CpuVolume* vnp1_x, CpuVolume* vnp1_y,
+                                  CpuVolume* vnp1_z, CpuVolume* vn_x,
+                                  CpuVolume* vn_y, CpuVolume* vn_z);
+    void Resample(const FlipParticles& particles, CpuVolume* vel_x,
+                  CpuVolume* vel_y, CpuVolume* vel_z, CpuVolume* density,
+                  CpuVolume* temperature, uint32_t random_seed);
+    void DiffuseAndDecay(const FlipParticles& particles, float time_step,
+                         float velocity_dissipation, float density_dissipation,
+                         float temperature_dissipation);
+    void AdvectParticles(const FlipParticles& particles, CpuVolume* vel_x,
+                         CpuVolume* vel_y, CpuVolume* vel_z, float time_step);
+    bool BindParticlesToCells(const FlipParticles& particles,
+                              const glm::ivec3& volume_size);
+    void BuildCellOffsets(const FlipParticles& particles,
+                          const glm::ivec3& volume_size);
+    void SortParticles(const FlipParticles& particles,
+                       int* num_active_particles, const FlipParticles& aux,
+                       const glm::ivec3& volume_size);
+    void TransferToGrid(CpuVolume* vel_x, CpuVolume* vel_y, CpuVolume* vel_z,
+                        CpuVolume* density, CpuVolume* temperature,
+                        const FlipParticles& particles);
+    void CompactParticles(FlipParticles* particles, int* num_active_particles,
+                          const FlipParticles& aux,
+                          const glm::ivec3& volume_size);
+
+    // Culls the particles of the cells above |particles_per_cell_|. Returns
+    // the number of the culled particles.
+    int CullParticles(const FlipParticles& particles,
+                      const glm::ivec3& volume_size);
+
+    Observer* observer_;
+    ThreadPool* pool_;
+    RandomHelper* rand_;
+    float cell_size_;
+    FluidImpulse impulse_;
+    bool outflow_;
+    float max_sort_churn_;
+
+    // The particle governor. Cells are culled down to |particles_per_cell_|
+    // after sorting, and cells below |min_particles_per_cell_| are re-seeded
+    // up to it, unless their density is below |reseed_density_threshold_|.
+    int particles_per_cell_;
+    int min_particles_per_cell_;
+    float reseed_density_threshold_;
+    std::unique_ptr<CountingSort> sorter_;
+};
+
+#endif // _FLIP_IMPL_CPU_H_
\ No newline at end of file
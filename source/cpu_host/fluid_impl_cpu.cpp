@@ -0,0 +1,287 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "fluid_impl_cpu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cpu_host/cpu_mem_piece.h"
+#include "cpu_host/cpu_volume.h"
+#include "cpu_host/thread_pool.h"
+#include "cpu_host/volume_rows.h"
+#include "third_party/glm/vec3.hpp"
+
+namespace
+{
+void CopyVolumeSlab(CpuVolume* dest, CpuVolume* source, int z0, int z1)
+{
+    glm::ivec3 volume_size = dest->size();
+    RowReader reader(*source, 1);
+    RowWriter writer(dest);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* s = reader.Read(0, y, z);
+            std::copy(s, s + volume_size.x, writer.Begin(y, z));
+            writer.End(y, z);
+        }
+    }
+}
+
+// The y component lives on the lower face of a cell, so the acceleration is
+// averaged between the two cells the face separates. The bottom faces are
+// walls and stay as they are.
+void ApplyBuoyancySlab(CpuVolume* vnp1_y, CpuVolume* vn_y,
+                       CpuVolume* temperature, CpuVolume* density,
+                       float time_step, float ambient_temperature,
+                       float accel_factor, float gravity, int z0, int z1)
+{
+    glm::ivec3 volume_size = vnp1_y->size();
+    RowReader reader(*vn_y, 1);
+    RowReader t_reader(*temperature, 1);
+    RowReader d_reader(*density, 1);
+    RowWriter writer(vnp1_y);
+    std::vector<float> accel_prev(volume_size.x);
+    std::vector<float> accel(volume_size.x);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* t = t_reader.Read(0, y, z);
+            const float* d = d_reader.Read(0, y, z);
+            for (int x = 0; x < volume_size.x; x++)
+                accel[x] = time_step *
+                    ((t[x] - ambient_temperature) * accel_factor -
+                        d[x] * gravity);
+
+            const float* v = reader.Read(0, y, z);
+            float* r = writer.Begin(y, z);
+            if (y == 0) {
+                std::copy(v, v + volume_size.x, r);
+            } else {
+                for (int x = 0; x < volume_size.x; x++)
+                    r[x] = v[x] + (accel_prev[x] + accel[x]) * 0.5f;
+            }
+            writer.End(y, z);
+
+            accel_prev.swap(accel);
+        }
+    }
+}
+
+void ComputeDivergenceSlab(CpuVolume* div, CpuVolume* vel_x,
+                           CpuVolume* vel_y, CpuVolume* vel_z,
+                           float cell_size, bool outflow, int z0, int z1)
+{
+    glm::ivec3 volume_size = div->size();
+    RowReader reader_x(*vel_x, 1);
+    RowReader reader_y(*vel_y, 2);
+    RowReader reader_z(*vel_z, 2);
+    RowWriter writer(div);
+    int last_x = volume_size.x - 1;
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* base_x = reader_x.Read(0, y, z);
+            const float* base_y = reader_y.Read(0, y, z);
+            const float* base_z = reader_z.Read(0, y, z);
+            const float* north = y + 1 < volume_size.y ?
+                reader_y.Read(1, y + 1, z) : nullptr;
+            const float* far = z + 1 < volume_size.z ?
+                reader_z.Read(1, y, z + 1) : nullptr;
+            float* r = writer.Begin(y, z);
+            for (int x = 0; x < volume_size.x; x++) {
+                float diff_ew = x < last_x ?
+                    base_x[x + 1] - base_x[x] : -base_x[x];
+
+                // Handle boundary problem.
+                float diff_ns;
+                if (north)
+                    diff_ns = north[x] - base_y[x];
+                else if (outflow)
+                    diff_ns = base_y[x] < 0.0f ? -base_y[x] : 0.0f;
+                else
+                    diff_ns = -base_y[x];
+
+                float diff_fn = far ? far[x] - base_z[x] : -base_z[x];
+
+                // NOTE: Premultiply h^2 to get a uniformed cell size at all
+                //       levels of multigrid hierarchy.
+                r[x] = cell_size * (diff_ew + diff_ns + diff_fn);
+            }
+            writer.End(y, z);
+        }
+    }
+}
+
+// The components are taken at the same index, the same as the CUDA kernel
+// does, and the maximum of each slice goes to |partial|.
+void ComputeMaxSpeedSlab(float* partial, CpuVolume* vel_x, CpuVolume* vel_y,
+                         CpuVolume* vel_z, int z0, int z1)
+{
+    glm::ivec3 volume_size = vel_x->size();
+    RowReader reader_x(*vel_x, 1);
+    RowReader reader_y(*vel_y, 1);
+    RowReader reader_z(*vel_z, 1);
+    for (int z = z0; z < z1; z++) {
+        float slice_max = 0.0f;
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* v_x = reader_x.Read(0, y, z);
+            const float* v_y = reader_y.Read(0, y, z);
+            const float* v_z = reader_z.Read(0, y, z);
+            for (int x = 0; x < volume_size.x; x++)
+                slice_max = std::max(
+                    slice_max,
+                    v_x[x] * v_x[x] + v_y[x] * v_y[x] + v_z[x] * v_z[x]);
+        }
+
+        partial[z] = slice_max;
+    }
+}
+
+// The pressure of the lower neighbors is read from |lower|, shifted by
+// |lower_offset| along x.
+void SubtractGradientRow(RowReader* reader, RowWriter* writer,
+                         const float* base, const float* lower,
+                         int lower_offset, float inverse_cell_size, int y,
+                         int z)
+{
+    int width = reader->width();
+    const float* v = reader->Read(0, y, z);
+    float* r = writer->Begin(y, z);
+    r[0] = 0.0f;
+    for (int x = 1; x < width; x++)
+        r[x] = v[x] - (base[x] - lower[x + lower_offset]) * inverse_cell_size;
+
+    writer->End(y, z);
+}
+
+// The faces on the lower walls of the domain are solid, so all the three
+// components of a cell touching any of them are zeroed, the same as the
+// CUDA kernel does.
+void SubtractGradientSlab(CpuVolume* vel_x, CpuVolume* vel_y,
+                          CpuVolume* vel_z, CpuVolume* pressure,
+                          float inverse_cell_size, int z0, int z1)
+{
+    glm::ivec3 volume_size = pressure->size();
+    RowReader reader_p(*pressure, 3);
+    RowReader reader_x(*vel_x, 1);
+    RowReader reader_y(*vel_y, 1);
+    RowReader reader_z(*vel_z, 1);
+    RowWriter writer_x(vel_x);
+    RowWriter writer_y(vel_y);
+    RowWriter writer_z(vel_z);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            if (y == 0 || z == 0) {
+                const float* zeros = reader_p.Zeros();
+                std::copy(zeros, zeros + volume_size.x,
+                          writer_x.Begin(y, z));
+                writer_x.End(y, z);
+                std::copy(zeros, zeros + volume_size.x,
+                          writer_y.Begin(y, z));
+                writer_y.End(y, z);
+                std::copy(zeros, zeros + volume_size.x,
+                          writer_z.Begin(y, z));
+                writer_z.End(y, z);
+                continue;
+            }
+
+            const float* base = reader_p.Read(0, y, z);
+            const float* south = reader_p.Read(1, y - 1, z);
+            const float* near = reader_p.Read(2, y, z - 1);
+            SubtractGradientRow(&reader_x, &writer_x, base, base, -1,
+                                inverse_cell_size, y, z);
+            SubtractGradientRow(&reader_y, &writer_y, base, south, 0,
+                                inverse_cell_size, y, z);
+            SubtractGradientRow(&reader_z, &writer_z, base, near, 0,
+                                inverse_cell_size, y, z);
+        }
+    }
+}
+} // Anonymous namespace.
+
+FluidImplCpu::FluidImplCpu(ThreadPool* pool)
+    : pool_(pool)
+    , cell_size_(0.15f)
+    , outflow_(false)
+{
+}
+
+FluidImplCpu::~FluidImplCpu()
+{
+}
+
+void FluidImplCpu::ApplyBuoyancy(CpuVolume* vnp1_x, CpuVolume* vnp1_y,
+                                 CpuVolume* vnp1_z, CpuVolume* vn_x,
+                                 CpuVolume* vn_y, CpuVolume* vn_z,
+                                 CpuVolume* temperature, CpuVolume* density,
+                                 float time_step, float ambient_temperature,
+                                 float accel_factor, float gravity)
+{
+    if (vnp1_x != vn_x)
+        pool_->ParallelFor(0, vnp1_x->depth(), [=](int z0, int z1) {
+            CopyVolumeSlab(vnp1_x, vn_x, z0, z1);
+        });
+
+    if (vnp1_z != vn_z)
+        pool_->ParallelFor(0, vnp1_z->depth(), [=](int z0, int z1) {
+            CopyVolumeSlab(vnp1_z, vn_z, z0, z1);
+        });
+
+    pool_->ParallelFor(0, vnp1_y->depth(), [=](int z0, int z1) {
+        ApplyBuoyancySlab(vnp1_y, vn_y, temperature, density, time_step,
+                          ambient_temperature, accel_factor, gravity, z0, z1);
+    });
+}
+
+void FluidImplCpu::ComputeDivergence(CpuVolume* div, CpuVolume* vel_x,
+                                     CpuVolume* vel_y, CpuVolume* vel_z)
+{
+    float cell_size = cell_size_;
+    bool outflow = outflow_;
+    pool_->ParallelFor(0, div->depth(), [=](int z0, int z1) {
+        ComputeDivergenceSlab(div, vel_x, vel_y, vel_z, cell_size, outflow,
+                              z0, z1);
+    });
+}
+
+void FluidImplCpu::ComputeMaxSpeed(CpuMemPiece* max_speed, CpuVolume* vel_x,
+                                   CpuVolume* vel_y, CpuVolume* vel_z)
+{
+    std::vector<float> partial(vel_x->depth(), 0.0f);
+    float* p = &partial[0];
+    pool_->ParallelFor(0, vel_x->depth(), [=](int z0, int z1) {
+        ComputeMaxSpeedSlab(p, vel_x, vel_y, vel_z, z0, z1);
+    });
+
+    float result = *std::max_element(partial.begin(), partial.end());
+    *static_cast<float*>(max_speed->mem()) = std::sqrt(result);
+}
+
+void FluidImplCpu::SubtractGradient(CpuVolume* vel_x, CpuVolume* vel_y,
+                                    CpuVolume* vel_z, CpuVolume* pressure)
+{
+    float inverse_cell_size = 1.0f / cell_size_;
+    pool_->ParallelFor(0, pressure->depth(), [=](int z0, int z1) {
+        SubtractGradientSlab(vel_x, vel_y, vel_z, pressure, inverse_cell_size,
+                             z0, z1);
+    });
+}
@@ -0,0 +1,59 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _FLUID_IMPL_CPU_H_
+#define _FLUID_IMPL_CPU_H_
+
+#include <memory>
+
+class CpuMemPiece;
+class CpuVolume;
+class ThreadPool;
+class FluidImplCpu
+{
+public:
+    explicit FluidImplCpu(ThreadPool* pool);
+    ~FluidImplCpu();
+
+    // Only the staggered grid is supported, which is the one the FLIP solver
+    // always works with.
+    void ApplyBuoyancy(CpuVolume* vnp1_x, CpuVolume* vnp1_y, CpuVolume* vnp1_z,
+                       CpuVolume* vn_x, CpuVolume* vn_y, CpuVolume* vn_z,
+                       CpuVolume* temperature, CpuVolume* density,
+                       float time_step, float ambient_temperature,
+                       float accel_factor, float gravity);
+    void ComputeDivergence(CpuVolume* div, CpuVolume* vel_x, CpuVolume* vel_y,
+                           CpuVolume* vel_z);
+    void ComputeMaxSpeed(CpuMemPiece* max_speed, CpuVolume* vel_x,
+                         CpuVolume* vel_y, CpuVolume* vel_z);
+    void SubtractGradient(CpuVolume* vel_x, CpuVolume* vel_y, CpuVolume* vel_z,
+                          CpuVolume* pressure);
+
+    void set_cell_size(float cell_size) { cell_size_ = cell_size; }
+    void set_outflow(bool outflow) { outflow_ = outflow; }
+
+private:
+    ThreadPool* pool_;
+    float cell_size_;
+    bool outflow_;
+};
+
+#endif // _FLUID_IMPL_CPU_H_
\ No newline at end of file
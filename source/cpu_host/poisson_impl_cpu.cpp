@@ -0,0 +1,1170 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "poisson_impl_cpu.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "cpu_host/cpu_mem_piece.h"
+#include "cpu_host/cpu_volume.h"
+#include "cpu_host/simd_float.h"
+#include "cpu_host/thread_pool.h"
+#include "cpu_host/volume_rows.h"
+#include "third_party/glm/vec2.hpp"
+#include "third_party/glm/vec3.hpp"
+
+namespace
+{
+enum StencilSlot
+{
+    SLOT_CENTER,
+    SLOT_SOUTH,
+    SLOT_NORTH,
+    SLOT_NEAR,
+    SLOT_FAR,
+
+    NUM_OF_STENCIL_SLOTS
+};
+
+struct StencilRows
+{
+    const float* center_;
+    const float* south_;
+    const float* north_;
+    const float* near_;
+    const float* far_;
+};
+
+// Fetches the 5 rows of the 7-point stencil around row (y, z). Neighbors
+// outside the volume either repeat the center(clamp) or read zero(border),
+// in accordance with the texture address modes of the CUDA kernels.
+StencilRows FetchStencilRows(RowReader* reader, int y, int z,
+                             const glm::ivec3& volume_size, bool clamp)
+{
+    StencilRows r;
+    r.center_ = reader->Read(SLOT_CENTER, y, z);
+
+    const float* ghost = clamp ? r.center_ : reader->Zeros();
+    int max_y = volume_size.y - 1;
+    int max_z = volume_size.z - 1;
+    r.south_ = y > 0 ?     reader->Read(SLOT_SOUTH, y - 1, z) : ghost;
+    r.north_ = y < max_y ? reader->Read(SLOT_NORTH, y + 1, z) : ghost;
+    r.near_  = z > 0 ?     reader->Read(SLOT_NEAR,  y, z - 1) : ghost;
+    r.far_   = z < max_z ? reader->Read(SLOT_FAR,   y, z + 1) : ghost;
+    return r;
+}
+
+// The row-invariant part of ModifyBoundaryCoef().
+float BoundaryCoef(int y, int z, const glm::ivec3& volume_size)
+{
+    float beta = 6.0f;
+    if (y == 0)
+        beta -= 1.0f;
+
+    if (z == 0)
+        beta -= 1.0f;
+
+    if (y == volume_size.y - 1)
+        beta -= 1.0f;
+
+    if (z == volume_size.z - 1)
+        beta -= 1.0f;
+
+    return beta;
+}
+
+// Handles the outflow boundary at the top of the domain.
+void MakeOutflowRow(float* north, const float* center, int width)
+{
+    typedef simd::Lane<simd::Float> V;
+    int x = 0;
+    for (; x + V::kWidth <= width; x += V::kWidth)
+        V::Store(north + x, simd::Min(simd::Float(0.0f) - V::Load(center + x),
+                                      simd::Float(0.0f)));
+
+    for (; x < width; x++)
+        north[x] = std::min(-center[x], 0.0f);
+}
+
+template <typename V, typename Op>
+void EvaluateInterior(float* dest, const StencilRows& r, const float* b, int x,
+                      float beta, const Op& op)
+{
+    typedef simd::Lane<V> L;
+
+    V west   = L::Load(r.center_ + x - 1);
+    V center = L::Load(r.center_ + x);
+    V east   = L::Load(r.center_ + x + 1);
+    V south  = L::Load(r.south_ + x);
+    V north  = L::Load(r.north_ + x);
+    V near   = L::Load(r.near_ + x);
+    V far    = L::Load(r.far_ + x);
+
+    V sum = west + east + south + north + far + near;
+    L::Store(dest + x, op(center, sum, L::Load(b + x), V(beta)));
+}
+
+template <typename Op>
+void EvaluateEnd(float* dest, const StencilRows& r, const float* b, int x,
+                 int width, float beta, bool clamp, const Op& op)
+{
+    float center = r.center_[x];
+    float ghost = clamp ? center : 0.0f;
+    float west = x > 0 ?         r.center_[x - 1] : ghost;
+    float east = x < width - 1 ? r.center_[x + 1] : ghost;
+
+    if (x == 0)
+        beta -= 1.0f;
+
+    if (x == width - 1)
+        beta -= 1.0f;
+
+    float sum = west + east + r.south_[x] + r.north_[x] + r.far_[x] +
+        r.near_[x];
+    dest[x] = op(center, sum, b[x], beta);
+}
+
+// Evaluates |op| for every cell of a row. The interior runs on the vector
+// unit; the two end cells, whose west/east neighbors may fall outside the
+// volume, are taken care of separately.
+template <typename Op>
+void EvaluateRow(float* dest, const StencilRows& r, const float* b, int width,
+                 float beta, bool clamp, const Op& op)
+{
+    EvaluateEnd(dest, r, b, 0, width, beta, clamp, op);
+
+    int x = 1;
+    for (; x + simd::Float::kWidth <= width - 1; x += simd::Float::kWidth)
+        EvaluateInterior<simd::Float>(dest, r, b, x, beta, op);
+
+    for (; x < width - 1; x++)
+        EvaluateInterior<float>(dest, r, b, x, beta, op);
+
+    if (width > 1)
+        EvaluateEnd(dest, r, b, width - 1, width, beta, clamp, op);
+}
+
+struct ResidualOp
+{
+    template <typename V>
+    V operator()(V center, V sum, V b, V beta) const
+    {
+        return b - (sum - V(6.0f) * center);
+    }
+};
+
+struct StencilOp
+{
+    template <typename V>
+    V operator()(V center, V sum, V b, V beta) const
+    {
+        // NOTE: The coefficient 'h^2' is premultiplied in the divergence
+        //       kernel.
+        return sum - V(6.0f) * center;
+    }
+};
+
+struct RedBlackGaussSeidelOp
+{
+    template <typename V>
+    V operator()(V center, V sum, V b, V beta) const
+    {
+        // Using omega = 1.3, the same as the CUDA kernel.
+        return V(-0.3f) * center + (sum - b) * V(1.3f) / beta;
+    }
+};
+
+struct DampedJacobiOp
+{
+    explicit DampedJacobiOp(float omega) : omega_(omega) {}
+
+    template <typename V>
+    V operator()(V center, V sum, V b, V beta) const
+    {
+        return (V(1.0f) - V(omega_)) * center + (sum - b) * V(omega_) / beta;
+    }
+
+    float omega_;
+};
+
+// D^-1 * r, the correction of a plain Jacobi step.
+struct JacobiCorrectionOp
+{
+    template <typename V>
+    V operator()(V center, V sum, V b, V beta) const
+    {
+        return (sum - b) / beta - center;
+    }
+};
+
+struct ZeroGuessOp
+{
+    ZeroGuessOp(float omega, float coef, float omega_over_beta)
+        : omega_(omega)
+        , coef_(coef)
+        , omega_over_beta_(omega_over_beta)
+    {
+    }
+
+    // Here |center| and |sum| come from b.
+    template <typename V>
+    V operator()(V center, V sum, V b, V beta) const
+    {
+        V v = V(coef_) * center;
+        V w = V(-omega_over_beta_) * sum;
+        return (w - center) * V(omega_) / beta + v;
+    }
+
+    float omega_;
+    float coef_;
+    float omega_over_beta_;
+};
+
+template <typename T>
+void StoreColoredCells(CpuVolume* u, const float* result, int start, int y,
+                       int z)
+{
+    T* row = static_cast<T*>(u->GetRowAddress(y, z));
+    for (int x = start; x < u->width(); x += 2)
+        simd::StoreScalar(row + x, result[x]);
+}
+
+float ReadScalar(CpuMemPiece* piece)
+{
+    return *static_cast<float*>(piece->mem());
+}
+
+void WriteScalar(CpuMemPiece* piece, float value)
+{
+    *static_cast<float*>(piece->mem()) = value;
+}
+
+float SafeDivide(float n, float d)
+{
+    if (d > 0.00000001f || d < -0.00000001f)
+        return n / d;
+
+    return 0.0f;
+}
+
+float RowDot(const float* e0, const float* e1, int width)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    simd::Float acc(0.0f);
+    int x = 0;
+    for (; x + V::kWidth <= width; x += V::kWidth)
+        acc = acc + V::Load(e0 + x) * V::Load(e1 + x);
+
+    float tail = 0.0f;
+    for (; x < width; x++)
+        tail += e0[x] * e1[x];
+
+    return simd::Sum(acc) + tail;
+}
+
+// Interpolates the coarse level onto rows of the fine level, with the same
+// weights as the linear filtering of the CUDA kernels.
+class CoarseRowExpander
+{
+public:
+    CoarseRowExpander(const CpuVolume& coarse, const glm::ivec3& fine_size)
+        : reader_(coarse, 4)
+        , fine_size_(fine_size)
+        , coarse_size_(coarse.size())
+        , lerp_(coarse_size_.x)
+    {
+    }
+
+    void Expand(float* dest, int y, int z)
+    {
+        const float* l = Lerp(y, z);
+        ExpandEnd(dest, 0);
+
+        // Away from the ends, fine cells 2i - 1 and 2i blend coarse cell i
+        // with its west and east neighbor respectively.
+        int c = 1;
+        for (; c < coarse_size_.x && 2 * c < fine_size_.x; c++) {
+            dest[2 * c - 1] = 0.75f * l[c - 1] + 0.25f * l[c];
+            dest[2 * c]     = 0.75f * l[c] + 0.25f * l[c - 1];
+        }
+
+        for (int i = 2 * c - 1; i < fine_size_.x; i++)
+            ExpandEnd(dest, i);
+    }
+
+private:
+    // Interpolates the 4 coarse rows around fine row (y, z).
+    const float* Lerp(int y, int z)
+    {
+        typedef simd::Lane<simd::Float> V;
+
+        int cz0 = std::min(z >> 1, coarse_size_.z - 1);
+        int cz1 = std::min((z & 1) ? cz0 + 1 : cz0 - 1, coarse_size_.z - 1);
+        cz1 = std::max(cz1, 0);
+        int cy0 = std::min(y >> 1, coarse_size_.y - 1);
+        int cy1 = std::min((y & 1) ? cy0 + 1 : cy0 - 1, coarse_size_.y - 1);
+        cy1 = std::max(cy1, 0);
+
+        const float* r00 = reader_.Read(0, cy0, cz0);
+        const float* r10 = reader_.Read(1, cy1, cz0);
+        const float* r01 = reader_.Read(2, cy0, cz1);
+        const float* r11 = reader_.Read(3, cy1, cz1);
+
+        const simd::Float w0(0.75f);
+        const simd::Float w1(0.25f);
+        int x = 0;
+        for (; x + V::kWidth <= coarse_size_.x; x += V::kWidth) {
+            simd::Float a = w0 * V::Load(r00 + x) + w1 * V::Load(r10 + x);
+            simd::Float b = w0 * V::Load(r01 + x) + w1 * V::Load(r11 + x);
+            V::Store(&lerp_[x], w0 * a + w1 * b);
+        }
+
+        for (; x < coarse_size_.x; x++)
+            lerp_[x] = 0.75f * (0.75f * r00[x] + 0.25f * r10[x]) +
+                0.25f * (0.75f * r01[x] + 0.25f * r11[x]);
+
+        return &lerp_[0];
+    }
+
+    float Interpolate(int i) const
+    {
+        int cx0 = std::min(i >> 1, coarse_size_.x - 1);
+        int cx1 = std::min((i & 1) ? cx0 + 1 : cx0 - 1, coarse_size_.x - 1);
+        cx1 = std::max(cx1, 0);
+        return 0.75f * lerp_[cx0] + 0.25f * lerp_[cx1];
+    }
+
+    void ExpandEnd(float* dest, int i) { dest[i] = Interpolate(i); }
+
+    RowReader reader_;
+    glm::ivec3 fine_size_;
+    glm::ivec3 coarse_size_;
+    std::vector<float> lerp_;
+};
+
+void AddRow(float* dest, const float* v0, const float* v1, int width)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    int x = 0;
+    for (; x + V::kWidth <= width; x += V::kWidth)
+        V::Store(dest + x, V::Load(v0 + x) + V::Load(v1 + x));
+
+    for (; x < width; x++)
+        dest[x] = v0[x] + v1[x];
+}
+
+// =============================================================================
+
+void ComputeResidualSlab(CpuVolume* r, CpuVolume* u, CpuVolume* b, int z0,
+                         int z1)
+{
+    glm::ivec3 volume_size = u->size();
+    RowReader u_reader(*u, NUM_OF_STENCIL_SLOTS);
+    RowReader b_reader(*b, 1);
+    RowWriter r_writer(r);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            StencilRows rows = FetchStencilRows(&u_reader, y, z, volume_size,
+                                                true);
+            float* dest = r_writer.Begin(y, z);
+            EvaluateRow(dest, rows, b_reader.Read(0, y, z), volume_size.x,
+                        6.0f, true, ResidualOp());
+            r_writer.End(y, z);
+        }
+    }
+}
+
+void ProlongateSlab(CpuVolume* fine, CpuVolume* coarse, bool add, int z0,
+                    int z1)
+{
+    glm::ivec3 volume_size = fine->size();
+    CoarseRowExpander expander(*coarse, volume_size);
+    RowReader fine_reader(*fine, 1);
+    RowWriter fine_writer(fine);
+    std::vector<float> expanded(volume_size.x);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            expander.Expand(&expanded[0], y, z);
+            const float* e = add ? fine_reader.Read(0, y, z) :
+                fine_reader.Zeros();
+            float* dest = fine_writer.Begin(y, z);
+            AddRow(dest, e, &expanded[0], volume_size.x);
+            fine_writer.End(y, z);
+        }
+    }
+}
+
+// Relaxes one color of a plane at a time, so that the sweeps can be
+// scheduled in any order that respects their dependencies.
+class RedBlackRelaxer
+{
+public:
+    RedBlackRelaxer(CpuVolume* u, CpuVolume* b, bool outflow)
+        : u_(u)
+        , outflow_(outflow)
+        , u_reader_(*u, NUM_OF_STENCIL_SLOTS)
+        , b_reader_(*b, 1)
+        , result_(u->width())
+        , outflow_row_(u->width())
+    {
+    }
+
+    void RelaxPlane(int color, int z)
+    {
+        glm::ivec3 volume_size = u_->size();
+        for (int y = 0; y < volume_size.y; y++) {
+            StencilRows rows = FetchStencilRows(&u_reader_, y, z, volume_size,
+                                                false);
+            if (outflow_ && y == volume_size.y - 1) {
+                MakeOutflowRow(&outflow_row_[0], rows.center_, volume_size.x);
+                rows.north_ = &outflow_row_[0];
+            }
+
+            EvaluateRow(&result_[0], rows, b_reader_.Read(0, y, z),
+                        volume_size.x, BoundaryCoef(y, z, volume_size), false,
+                        RedBlackGaussSeidelOp());
+
+            int start = (color + y + z) & 1;
+            if (u_->byte_width() == 2)
+                StoreColoredCells<uint16_t>(u_, &result_[0], start, y, z);
+            else
+                StoreColoredCells<float>(u_, &result_[0], start, y, z);
+        }
+    }
+
+private:
+    CpuVolume* u_;
+    bool outflow_;
+    RowReader u_reader_;
+    RowReader b_reader_;
+    std::vector<float> result_;
+    std::vector<float> outflow_row_;
+};
+
+void RelaxRedBlackSlab(CpuVolume* u, CpuVolume* b, int color, bool outflow,
+                       int z0, int z1)
+{
+    RedBlackRelaxer relaxer(u, b, outflow);
+    for (int z = z0; z < z1; z++)
+        relaxer.RelaxPlane(color, z);
+}
+
+// Runs the half sweeps [0, num_of_passes) of the red-black relaxation, each
+// over the planes [range(s).x, range(s).y). Pass s trails one plane behind
+// pass s - 1, which is exactly what it depends on, so a plane is visited by
+// all the passes while it is still in the cache.
+template <typename PassRange>
+void RelaxWavefront(CpuVolume* u, CpuVolume* b, bool outflow,
+                    int num_of_passes, const PassRange& range)
+{
+    RedBlackRelaxer relaxer(u, b, outflow);
+    int first = u->depth();
+    int last = 0;
+    for (int s = 0; s < num_of_passes; s++) {
+        first = std::min(first, range(s).x);
+        last = std::max(last, range(s).y);
+    }
+
+    for (int t = first; t < last + num_of_passes; t++) {
+        for (int s = 0; s < num_of_passes; s++) {
+            int z = t - s;
+            glm::ivec2 r = range(s);
+            if (z >= r.x && z < r.y)
+                relaxer.RelaxPlane(s & 1, z);
+        }
+    }
+}
+
+void RelaxJacobiSlab(CpuVolume* unp1, CpuVolume* un, CpuVolume* b,
+                     float omega, bool outflow, int z0, int z1)
+{
+    glm::ivec3 volume_size = un->size();
+    RowReader u_reader(*un, NUM_OF_STENCIL_SLOTS);
+    RowReader b_reader(*b, 1);
+    RowWriter u_writer(unp1);
+    std::vector<float> outflow_row(volume_size.x);
+    DampedJacobiOp op(omega);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            StencilRows rows = FetchStencilRows(&u_reader, y, z, volume_size,
+                                                false);
+            if (outflow && y == volume_size.y - 1) {
+                MakeOutflowRow(&outflow_row[0], rows.center_, volume_size.x);
+                rows.north_ = &outflow_row[0];
+            }
+
+            float* dest = u_writer.Begin(y, z);
+            EvaluateRow(dest, rows, b_reader.Read(0, y, z), volume_size.x,
+                        BoundaryCoef(y, z, volume_size), false, op);
+            u_writer.End(y, z);
+        }
+    }
+}
+
+void RelaxChebyshevSlab(CpuVolume* unp1, CpuVolume* un, CpuVolume* b,
+                        float momentum, float omega, bool outflow, int z0,
+                        int z1)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    glm::ivec3 volume_size = un->size();
+    RowReader u_reader(*un, NUM_OF_STENCIL_SLOTS);
+    RowReader b_reader(*b, 1);
+    RowReader prev_reader(*unp1, 1);
+    RowWriter u_writer(unp1);
+    std::vector<float> outflow_row(volume_size.x);
+    std::vector<float> correction(volume_size.x);
+    simd::Float m(momentum);
+    simd::Float w(omega);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            StencilRows rows = FetchStencilRows(&u_reader, y, z, volume_size,
+                                                false);
+            if (outflow && y == volume_size.y - 1) {
+                MakeOutflowRow(&outflow_row[0], rows.center_, volume_size.x);
+                rows.north_ = &outflow_row[0];
+            }
+
+            float* c = &correction[0];
+            EvaluateRow(c, rows, b_reader.Read(0, y, z), volume_size.x,
+                        BoundaryCoef(y, z, volume_size), false,
+                        JacobiCorrectionOp());
+
+            // Every cell reads its own previous value only, so |unp1| can
+            // be updated in-place.
+            const float* u = rows.center_;
+            const float* prev = prev_reader.Read(0, y, z);
+            float* dest = u_writer.Begin(y, z);
+
+            int x = 0;
+            for (; x + V::kWidth <= volume_size.x; x += V::kWidth) {
+                simd::Float t = V::Load(u + x);
+                V::Store(dest + x, t + m * (t - V::Load(prev + x)) +
+                                   w * V::Load(c + x));
+            }
+
+            for (; x < volume_size.x; x++)
+                dest[x] = u[x] + momentum * (u[x] - prev[x]) + omega * c[x];
+
+            u_writer.End(y, z);
+        }
+    }
+}
+
+void RelaxWithZeroGuessSlab(CpuVolume* u, CpuVolume* b, int z0, int z1)
+{
+    const float kBeta = 6.0f;
+    float omega           = 2.0f / 3.0f;
+    float omega_over_beta = omega / kBeta;
+    float coef            = omega * (omega - 1.0f) / kBeta;
+    ZeroGuessOp op(omega, coef, omega_over_beta);
+
+    glm::ivec3 volume_size = u->size();
+    RowReader b_reader(*b, NUM_OF_STENCIL_SLOTS);
+    RowWriter u_writer(u);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            StencilRows rows = FetchStencilRows(&b_reader, y, z, volume_size,
+                                                false);
+            float* dest = u_writer.Begin(y, z);
+            EvaluateRow(dest, rows, rows.center_, volume_size.x,
+                        BoundaryCoef(y, z, volume_size), false, op);
+            u_writer.End(y, z);
+        }
+    }
+}
+
+void RestrictSlab(CpuVolume* coarse, CpuVolume* fine, int z0, int z1)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    glm::ivec3 volume_size = coarse->size();
+    glm::ivec3 fine_size = fine->size();
+    RowReader fine_reader(*fine, 4);
+    RowWriter coarse_writer(coarse);
+    std::vector<float> sum(fine_size.x);
+    for (int z = z0; z < z1; z++) {
+        int fz0 = std::min(2 * z,     fine_size.z - 1);
+        int fz1 = std::min(2 * z + 1, fine_size.z - 1);
+        for (int y = 0; y < volume_size.y; y++) {
+            int fy0 = std::min(2 * y,     fine_size.y - 1);
+            int fy1 = std::min(2 * y + 1, fine_size.y - 1);
+
+            const float* r00 = fine_reader.Read(0, fy0, fz0);
+            const float* r10 = fine_reader.Read(1, fy1, fz0);
+            const float* r01 = fine_reader.Read(2, fy0, fz1);
+            const float* r11 = fine_reader.Read(3, fy1, fz1);
+
+            int x = 0;
+            for (; x + V::kWidth <= fine_size.x; x += V::kWidth)
+                V::Store(&sum[x], V::Load(r00 + x) + V::Load(r10 + x) +
+                         V::Load(r01 + x) + V::Load(r11 + x));
+
+            for (; x < fine_size.x; x++)
+                sum[x] = r00[x] + r10[x] + r01[x] + r11[x];
+
+            // 4 times the average of the 8 children.
+            float* dest = coarse_writer.Begin(y, z);
+            for (int i = 0; i < volume_size.x; i++) {
+                int fx0 = std::min(2 * i,     fine_size.x - 1);
+                int fx1 = std::min(2 * i + 1, fine_size.x - 1);
+                dest[i] = (sum[fx0] + sum[fx1]) * 0.5f;
+            }
+            coarse_writer.End(y, z);
+        }
+    }
+}
+
+void ComputeResidualAndRestrictSlab(CpuVolume* coarse, CpuVolume* u,
+                                    CpuVolume* b, int z0, int z1)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    glm::ivec3 volume_size = coarse->size();
+    glm::ivec3 fine_size = u->size();
+    RowReader u_reader(*u, NUM_OF_STENCIL_SLOTS);
+    RowReader b_reader(*b, 1);
+    RowWriter coarse_writer(coarse);
+    std::vector<float> r(fine_size.x);
+    std::vector<float> sum(fine_size.x);
+    for (int z = z0; z < z1; z++) {
+        int fz0 = std::min(2 * z,     fine_size.z - 1);
+        int fz1 = std::min(2 * z + 1, fine_size.z - 1);
+        for (int y = 0; y < volume_size.y; y++) {
+            int fy0 = std::min(2 * y,     fine_size.y - 1);
+            int fy1 = std::min(2 * y + 1, fine_size.y - 1);
+
+            // The 4 fine residual rows are accumulated in the same order as
+            // RestrictSlab() reads them.
+            int fy[] = {fy0, fy1, fy0, fy1};
+            int fz[] = {fz0, fz0, fz1, fz1};
+            for (int n = 0; n < 4; n++) {
+                StencilRows rows = FetchStencilRows(&u_reader, fy[n], fz[n],
+                                                    fine_size, true);
+                EvaluateRow(&r[0], rows, b_reader.Read(0, fy[n], fz[n]),
+                            fine_size.x, 6.0f, true, ResidualOp());
+
+                if (!n) {
+                    std::copy(r.begin(), r.end(), sum.begin());
+                    continue;
+                }
+
+                int x = 0;
+                for (; x + V::kWidth <= fine_size.x; x += V::kWidth)
+                    V::Store(&sum[x], V::Load(&sum[x]) + V::Load(&r[x]));
+
+                for (; x < fine_size.x; x++)
+                    sum[x] += r[x];
+            }
+
+            float* dest = coarse_writer.Begin(y, z);
+            for (int i = 0; i < volume_size.x; i++) {
+                int fx0 = std::min(2 * i,     fine_size.x - 1);
+                int fx1 = std::min(2 * i + 1, fine_size.x - 1);
+                dest[i] = (sum[fx0] + sum[fx1]) * 0.5f;
+            }
+            coarse_writer.End(y, z);
+        }
+    }
+}
+
+void ApplyStencilSlab(CpuVolume* aux, CpuVolume* search, bool outflow, int z0,
+                      int z1)
+{
+    glm::ivec3 volume_size = aux->size();
+    RowReader reader(*search, NUM_OF_STENCIL_SLOTS);
+    RowWriter writer(aux);
+    std::vector<float> outflow_row(volume_size.x);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            StencilRows rows = FetchStencilRows(&reader, y, z, volume_size,
+                                                true);
+            if (outflow && y == volume_size.y - 1) {
+                MakeOutflowRow(&outflow_row[0], rows.center_, volume_size.x);
+                rows.north_ = &outflow_row[0];
+            }
+
+            float* dest = writer.Begin(y, z);
+            EvaluateRow(dest, rows, reader.Zeros(), volume_size.x, 6.0f, true,
+                        StencilOp());
+            writer.End(y, z);
+        }
+    }
+}
+
+void ScaledAddSlab(CpuVolume* dest, CpuVolume* v0, CpuVolume* v1, float coef,
+                   int z0, int z1)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    glm::ivec3 volume_size = dest->size();
+    std::unique_ptr<RowReader> reader0(v0 ? new RowReader(*v0, 1) : nullptr);
+    RowReader reader1(*v1, 1);
+    RowWriter writer(dest);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* e0 = reader0 ? reader0->Read(0, y, z) :
+                reader1.Zeros();
+            const float* e1 = reader1.Read(0, y, z);
+            float* r = writer.Begin(y, z);
+
+            int x = 0;
+            for (; x + V::kWidth <= volume_size.x; x += V::kWidth)
+                V::Store(r + x,
+                         V::Load(e0 + x) + simd::Float(coef) * V::Load(e1 + x));
+
+            for (; x < volume_size.x; x++)
+                r[x] = e0[x] + coef * e1[x];
+
+            writer.End(y, z);
+        }
+    }
+}
+
+void ExtrapolateSlab(CpuVolume* dest, CpuVolume* v0, CpuVolume* v1,
+                     float coef, int z0, int z1)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    glm::ivec3 volume_size = dest->size();
+    RowReader reader0(*v0, 1);
+    RowReader reader1(*v1, 1);
+    RowWriter writer(dest);
+    simd::Float c(coef);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* e0 = reader0.Read(0, y, z);
+            const float* e1 = reader1.Read(0, y, z);
+            float* r = writer.Begin(y, z);
+
+            int x = 0;
+            for (; x + V::kWidth <= volume_size.x; x += V::kWidth) {
+                simd::Float a = V::Load(e0 + x);
+                V::Store(r + x, a + c * (a - V::Load(e1 + x)));
+            }
+
+            for (; x < volume_size.x; x++)
+                r[x] = e0[x] + coef * (e0[x] - e1[x]);
+
+            writer.End(y, z);
+        }
+    }
+}
+
+// The rows are handed out in fp32 whatever the precision of the volumes, so
+// the conversion comes for free.
+void ConvertVolumeSlab(CpuVolume* dest, CpuVolume* v, float scale,
+                       bool accumulate, int z0, int z1)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    glm::ivec3 volume_size = dest->size();
+    RowReader dest_reader(*dest, 1);
+    RowReader reader(*v, 1);
+    RowWriter writer(dest);
+    simd::Float c(scale);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* e0 = accumulate ? dest_reader.Read(0, y, z) :
+                dest_reader.Zeros();
+            const float* e1 = reader.Read(0, y, z);
+            float* r = writer.Begin(y, z);
+
+            int x = 0;
+            for (; x + V::kWidth <= volume_size.x; x += V::kWidth)
+                V::Store(r + x, V::Load(e0 + x) + c * V::Load(e1 + x));
+
+            for (; x < volume_size.x; x++)
+                r[x] = e0[x] + scale * e1[x];
+
+            writer.End(y, z);
+        }
+    }
+}
+
+void DotProductSlab(double* partial, CpuVolume* v0, CpuVolume* v1, int z0,
+                    int z1)
+{
+    glm::ivec3 volume_size = v0->size();
+    RowReader reader0(*v0, 1);
+    RowReader reader1(*v1, 1);
+    for (int z = z0; z < z1; z++) {
+        double slice_sum = 0.0;
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* e0 = reader0.Read(0, y, z);
+            const float* e1 = reader1.Read(0, y, z);
+            slice_sum += RowDot(e0, e1, volume_size.x);
+        }
+
+        partial[z] = slice_sum;
+    }
+}
+
+void ApplyStencilAndReduceSlab(double* partial_gamma, double* partial_delta,
+                               CpuVolume* aux, CpuVolume* precond,
+                               CpuVolume* residual, bool outflow, int z0,
+                               int z1)
+{
+    glm::ivec3 volume_size = aux->size();
+    RowReader reader(*precond, NUM_OF_STENCIL_SLOTS);
+    RowReader residual_reader(*residual, 1);
+    RowWriter writer(aux);
+    std::vector<float> outflow_row(volume_size.x);
+    for (int z = z0; z < z1; z++) {
+        double gamma = 0.0;
+        double delta = 0.0;
+        for (int y = 0; y < volume_size.y; y++) {
+            StencilRows rows = FetchStencilRows(&reader, y, z, volume_size,
+                                                true);
+            if (outflow && y == volume_size.y - 1) {
+                MakeOutflowRow(&outflow_row[0], rows.center_, volume_size.x);
+                rows.north_ = &outflow_row[0];
+            }
+
+            // The dot products are taken on the fp32 row before it is
+            // stored, as the CUDA version keeps them in registers.
+            float* dest = writer.Begin(y, z);
+            EvaluateRow(dest, rows, reader.Zeros(), volume_size.x, 6.0f, true,
+                        StencilOp());
+
+            const float* r = residual_reader.Read(0, y, z);
+            gamma += RowDot(r, rows.center_, volume_size.x);
+            delta += RowDot(dest, rows.center_, volume_size.x);
+            writer.End(y, z);
+        }
+
+        partial_gamma[z] = gamma;
+        partial_delta[z] = delta;
+    }
+}
+
+void UpdateSearchAndVectorSlab(CpuVolume* dest, CpuVolume* search,
+                               CpuVolume* v, float alpha, float beta, int z0,
+                               int z1)
+{
+    typedef simd::Lane<simd::Float> V;
+
+    glm::ivec3 volume_size = dest->size();
+    RowReader dest_reader(*dest, 1);
+    RowReader search_reader(*search, 1);
+    RowReader v_reader(*v, 1);
+    RowWriter dest_writer(dest);
+    RowWriter search_writer(search);
+    simd::Float a(alpha);
+    simd::Float b(beta);
+    for (int z = z0; z < z1; z++) {
+        for (int y = 0; y < volume_size.y; y++) {
+            const float* d = dest_reader.Read(0, y, z);
+            const float* s = search_reader.Read(0, y, z);
+            const float* e = v_reader.Read(0, y, z);
+            float* dr = dest_writer.Begin(y, z);
+            float* sr = search_writer.Begin(y, z);
+
+            int x = 0;
+            for (; x + V::kWidth <= volume_size.x; x += V::kWidth) {
+                simd::Float t = V::Load(e + x) + b * V::Load(s + x);
+                V::Store(sr + x, t);
+                V::Store(dr + x, V::Load(d + x) + a * t);
+            }
+
+            for (; x < volume_size.x; x++) {
+                float t = e[x] + beta * s[x];
+                sr[x] = t;
+                dr[x] = d[x] + alpha * t;
+            }
+
+            dest_writer.End(y, z);
+            search_writer.End(y, z);
+        }
+    }
+}
+} // Anonymous namespace.
+
+PoissonImplCpu::PoissonImplCpu(ThreadPool* pool)
+    : pool_(pool)
+    , cell_size_(0.15f)
+    , outflow_(false)
+{
+
+}
+
+PoissonImplCpu::~PoissonImplCpu()
+{
+}
+
+void PoissonImplCpu::ComputeResidual(CpuVolume* r, CpuVolume* u, CpuVolume* b)
+{
+    pool_->ParallelFor(0, r->depth(), [=](int z0, int z1) {
+        ComputeResidualSlab(r, u, b, z0, z1);
+    });
+}
+
+void PoissonImplCpu::Prolongate(CpuVolume* fine, CpuVolume* coarse)
+{
+    pool_->ParallelFor(0, fine->depth(), [=](int z0, int z1) {
+        ProlongateSlab(fine, coarse, false, z0, z1);
+    });
+}
+
+void PoissonImplCpu::ProlongateError(CpuVolume* fine, CpuVolume* coarse)
+{
+    pool_->ParallelFor(0, fine->depth(), [=](int z0, int z1) {
+        ProlongateSlab(fine, coarse, true, z0, z1);
+    });
+}
+
+void PoissonImplCpu::Relax(CpuVolume* u, CpuVolume* b, int num_of_iterations)
+{
+    // Red-black Gauss-Seidel, the same as the CUDA version. Updating in-place
+    // is safe as every cell of one color reads only the neighbors of the other
+    // color. The whole row is evaluated to keep the vector unit busy, but
+    // only half of the result is stored.
+    //
+    // Up to |kMaxPassesPerBlock| half sweeps are done in one go with temporal
+    // blocking. Each thread first runs them over its own slab, shrinking by
+    // a plane per pass on the sides that border another slab. Then the
+    // triangles left around the slab boundaries are filled in. Every cell
+    // sees the same operands as in sweep by sweep order, so the result is
+    // bit-identical.
+    const int kMaxPassesPerBlock = 8;
+
+    bool outflow = outflow_;
+    int depth = u->depth();
+    int num_of_passes = 2 * num_of_iterations;
+    while (num_of_passes > 0) {
+        int n = std::min(num_of_passes, kMaxPassesPerBlock);
+        num_of_passes -= n;
+
+        // The slabs must be thick enough to hold the triangles.
+        int num_of_slabs = std::min(pool_->num_of_threads(), depth / (2 * n));
+        num_of_slabs = std::max(num_of_slabs, 1);
+        auto slab_begin = [=](int i) {
+            return static_cast<int>(static_cast<int64_t>(depth) * i /
+                                    num_of_slabs);
+        };
+
+        pool_->ParallelFor(0, num_of_slabs, [=](int i0, int i1) {
+            for (int i = i0; i < i1; i++) {
+                int z0 = slab_begin(i);
+                int z1 = slab_begin(i + 1);
+                RelaxWavefront(u, b, outflow, n, [=](int s) {
+                    return glm::ivec2(i > 0 ? z0 + s : z0,
+                                      i < num_of_slabs - 1 ? z1 - s : z1);
+                });
+            }
+        });
+        pool_->ParallelFor(1, num_of_slabs, [=](int i0, int i1) {
+            for (int i = i0; i < i1; i++) {
+                int z = slab_begin(i);
+                RelaxWavefront(u, b, outflow, n, [=](int s) {
+                    return glm::ivec2(z - s, z + s);
+                });
+            }
+        });
+    }
+}
+
+void PoissonImplCpu::RelaxJacobi(CpuVolume* unp1, CpuVolume* un, CpuVolume* b,
+                                 float omega)
+{
+    assert(unp1 != un);
+    bool outflow = outflow_;
+    pool_->ParallelFor(0, unp1->depth(), [=](int z0, int z1) {
+        RelaxJacobiSlab(unp1, un, b, omega, outflow, z0, z1);
+    });
+}
+
+void PoissonImplCpu::RelaxChebyshev(CpuVolume* unp1, CpuVolume* un,
+                                    CpuVolume* b, float momentum, float omega)
+{
+    assert(unp1 != un);
+    bool outflow = outflow_;
+    pool_->ParallelFor(0, unp1->depth(), [=](int z0, int z1) {
+        RelaxChebyshevSlab(unp1, un, b, momentum, omega, outflow, z0, z1);
+    });
+}
+
+void PoissonImplCpu::RelaxWithZeroGuess(CpuVolume* u, CpuVolume* b)
+{
+    pool_->ParallelFor(0, u->depth(), [=](int z0, int z1) {
+        RelaxWithZeroGuessSlab(u, b, z0, z1);
+    });
+}
+
+void PoissonImplCpu::Restrict(CpuVolume* coarse, CpuVolume* fine)
+{
+    pool_->ParallelFor(0, coarse->depth(), [=](int z0, int z1) {
+        RestrictSlab(coarse, fine, z0, z1);
+    });
+}
+
+void PoissonImplCpu::ComputeResidualAndRestrict(CpuVolume* coarse,
+                                                CpuVolume* u, CpuVolume* b)
+{
+    pool_->ParallelFor(0, coarse->depth(), [=](int z0, int z1) {
+        ComputeResidualAndRestrictSlab(coarse, u, b, z0, z1);
+    });
+}
+
+void PoissonImplCpu::ProlongateErrorAndRelax(CpuVolume* u, CpuVolume* b,
+                                             CpuVolume* coarse,
+                                             int num_of_iterations)
+{
+    // Adding the interpolated error on the fly costs more than the pass it
+    // saves, so the CPU simply composes the two.
+    ProlongateError(u, coarse);
+    Relax(u, b, num_of_iterations);
+}
+
+void PoissonImplCpu::ApplyStencil(CpuVolume* aux, CpuVolume* search)
+{
+    bool outflow = outflow_;
+    pool_->ParallelFor(0, aux->depth(), [=](int z0, int z1) {
+        ApplyStencilSlab(aux, search, outflow, z0, z1);
+    });
+}
+
+void PoissonImplCpu::ComputeAlpha(CpuMemPiece* alpha, CpuMemPiece* rho,
+                                  CpuVolume* aux, CpuVolume* search)
+{
+    float result = static_cast<float>(DotProduct(aux, search));
+    if (result > 0.00000001f || result < -0.00000001f)
+        WriteScalar(alpha, ReadScalar(rho) / result);
+    else
+        WriteScalar(alpha, 0.0f);
+}
+
+void PoissonImplCpu::ComputeRho(CpuMemPiece* rho, CpuVolume* search,
+                                CpuVolume* residual)
+{
+    WriteScalar(rho, static_cast<float>(DotProduct(search, residual)));
+}
+
+void PoissonImplCpu::ComputeRhoAndBeta(CpuMemPiece* beta, CpuMemPiece* rho_new,
+                                       CpuMemPiece* rho, CpuVolume* aux,
+                                       CpuVolume* residual)
+{
+    float result = static_cast<float>(DotProduct(aux, residual));
+    WriteScalar(rho_new, result);
+
+    float t = ReadScalar(rho);
+    if (t > 0.00000001f || t < -0.00000001f)
+        WriteScalar(beta, result / t);
+    else
+        WriteScalar(beta, 0.0f);
+}
+
+void PoissonImplCpu::ScaledAdd(CpuVolume* dest, CpuVolume* v0, CpuVolume* v1,
+                               CpuMemPiece* coef, float sign)
+{
+    // Works as ScaleVector() if |v0| is null, and in that case the sign is
+    // ignored, as the CUDA version does.
+    float c = v0 ? ReadScalar(coef) * sign : ReadScalar(coef);
+    pool_->ParallelFor(0, dest->depth(), [=](int z0, int z1) {
+        ScaledAddSlab(dest, v0, v1, c, z0, z1);
+    });
+}
+
+void PoissonImplCpu::ApplyStencilAndReduce(CpuMemPiece* alpha,
+                                           CpuMemPiece* beta,
+                                           CpuMemPiece* rho, CpuVolume* aux,
+                                           CpuVolume* precond,
+                                           CpuVolume* residual, bool restart)
+{
+    std::vector<double> partial_gamma(aux->depth(), 0.0);
+    std::vector<double> partial_delta(aux->depth(), 0.0);
+    double* pg = &partial_gamma[0];
+    double* pd = &partial_delta[0];
+    bool outflow = outflow_;
+    pool_->ParallelFor(0, aux->depth(), [=](int z0, int z1) {
+        ApplyStencilAndReduceSlab(pg, pd, aux, precond, residual, outflow, z0,
+                                  z1);
+    });
+
+    double g = 0.0;
+    double d = 0.0;
+    for (int z = 0; z < aux->depth(); z++) {
+        g += partial_gamma[z];
+        d += partial_delta[z];
+    }
+
+    // Chronopoulos/Gear: alpha = gamma / (delta - beta * gamma / alpha_old).
+    float gamma = static_cast<float>(g);
+    float delta = static_cast<float>(d);
+    float b = restart ? 0.0f : SafeDivide(gamma, ReadScalar(rho));
+    float denom = delta;
+    if (!restart)
+        denom -= SafeDivide(b * gamma, ReadScalar(alpha));
+
+    WriteScalar(beta, b);
+    WriteScalar(alpha, SafeDivide(gamma, denom));
+    WriteScalar(rho, gamma);
+}
+
+void PoissonImplCpu::UpdateSearchAndVector(CpuVolume* dest, CpuVolume* search,
+                                           CpuVolume* v, CpuMemPiece* alpha,
+                                           CpuMemPiece* beta, float sign)
+{
+    float a = ReadScalar(alpha) * sign;
+    float b = ReadScalar(beta);
+    pool_->ParallelFor(0, dest->depth(), [=](int z0, int z1) {
+        UpdateSearchAndVectorSlab(dest, search, v, a, b, z0, z1);
+    });
+}
+
+void PoissonImplCpu::Extrapolate(CpuVolume* dest, CpuVolume* v0,
+                                 CpuVolume* v1, float coef)
+{
+    pool_->ParallelFor(0, dest->depth(), [=](int z0, int z1) {
+        ExtrapolateSlab(dest, v0, v1, coef, z0, z1);
+    });
+}
+
+void PoissonImplCpu::ConvertVolume(CpuVolume* dest, CpuVolume* v, float scale,
+                                   bool accumulate)
+{
+    pool_->ParallelFor(0, dest->depth(), [=](int z0, int z1) {
+        ConvertVolumeSlab(dest, v, scale, accumulate, z0, z1);
+    });
+}
+
+double PoissonImplCpu::DotProduct(CpuVolume* v0, CpuVolume* v1)
+{
+    // Partial sums are kept per slice, and added up in order afterwards, so
+    // that the result does not depend on the number of threads.
+    std::vector<double> partial(v0->depth(), 0.0);
+    double* p = &partial[0];
+    pool_->ParallelFor(0, v0->depth(), [=](int z0, int z1) {
+        DotProductSlab(p, v0, v1, z0, z1);
+    });
+
+    double r = 0.0;
+    for (double s : partial)
+        r += s;
+
+    return r;
+}
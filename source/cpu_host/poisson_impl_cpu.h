@@ -0,0 +1,91 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _POISSON_IMPL_CPU_H_
+#define _POISSON_IMPL_CPU_H_
+
+#include <memory>
+
+class CpuMemPiece;
+class CpuVolume;
+class ThreadPool;
+class PoissonImplCpu
+{
+public:
+    explicit PoissonImplCpu(ThreadPool* pool);
+    ~PoissonImplCpu();
+
+    // Multigrid.
+    void ComputeResidual(CpuVolume* r, CpuVolume* u, CpuVolume* b);
+    void Prolongate(CpuVolume* fine, CpuVolume* coarse);
+    void ProlongateError(CpuVolume* fine, CpuVolume* coarse);
+    void Relax(CpuVolume* u, CpuVolume* b, int num_of_iterations);
+    void RelaxJacobi(CpuVolume* unp1, CpuVolume* un, CpuVolume* b,
+                     float omega);
+    void RelaxChebyshev(CpuVolume* unp1, CpuVolume* un, CpuVolume* b,
+                        float momentum, float omega);
+    void RelaxWithZeroGuess(CpuVolume* u, CpuVolume* b);
+    void Restrict(CpuVolume* coarse, CpuVolume* fine);
+    void ComputeResidualAndRestrict(CpuVolume* coarse, CpuVolume* u,
+                                    CpuVolume* b);
+    void ProlongateErrorAndRelax(CpuVolume* u, CpuVolume* b,
+                                 CpuVolume* coarse, int num_of_iterations);
+
+    // Conjugate gradient.
+    void ApplyStencil(CpuVolume* aux, CpuVolume* search);
+    void ComputeAlpha(CpuMemPiece* alpha, CpuMemPiece* rho, CpuVolume* aux,
+                      CpuVolume* search);
+    void ComputeRho(CpuMemPiece* rho, CpuVolume* search, CpuVolume* residual);
+    void ComputeRhoAndBeta(CpuMemPiece* beta, CpuMemPiece* rho_new,
+                           CpuMemPiece* rho, CpuVolume* aux,
+                           CpuVolume* residual);
+    void ScaledAdd(CpuVolume* dest, CpuVolume* v0, CpuVolume* v1,
+                   CpuMemPiece* coef, float sign);
+
+    // Pipelined conjugate gradient.
+    void ApplyStencilAndReduce(CpuMemPiece* alpha, CpuMemPiece* beta,
+                               CpuMemPiece* rho, CpuVolume* aux,
+                               CpuVolume* precond, CpuVolume* residual,
+                               bool restart);
+    void UpdateSearchAndVector(CpuVolume* dest, CpuVolume* search,
+                               CpuVolume* v, CpuMemPiece* alpha,
+                               CpuMemPiece* beta, float sign);
+
+    // Initial guess.
+    void Extrapolate(CpuVolume* dest, CpuVolume* v0, CpuVolume* v1,
+                     float coef);
+
+    // Mixed precision.
+    void ConvertVolume(CpuVolume* dest, CpuVolume* v, float scale,
+                       bool accumulate);
+
+    void set_cell_size(float cell_size) { cell_size_ = cell_size; }
+    void set_outflow(bool outflow) { outflow_ = outflow; }
+
+private:
+    double DotProduct(CpuVolume* v0, CpuVolume* v1);
+
+    ThreadPool* pool_;
+    float cell_size_;
+    bool outflow_;
+};
+
+#endif // _POISSON_IMPL_CPU_H_
\ No newline at end of file
@@ -0,0 +1,292 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "scan_impl_cpu.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCAN_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "cpu_host/thread_pool.h"
+
+namespace
+{
+// Below this a chunk is not worth a thread, as the scans are bound by the
+// memory bandwidth anyway.
+const int kMinElementsPerChunk = 1 << 15;
+
+int ChunkBegin(int i, int num_of_chunks, int n)
+{
+    return static_cast<int>(static_cast<int64_t>(n) * i / num_of_chunks);
+}
+
+#ifdef SCAN_USE_SSE2
+inline __m128i Load4(const uint32_t* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline void Store4(uint32_t* p, __m128i v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+
+inline uint32_t HorizontalSum(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(v));
+}
+
+// Mask of the lanes that are not zero.
+inline int NonZeroMask(__m128i v)
+{
+    __m128i zero = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+    return ~_mm_movemask_ps(_mm_castsi128_ps(zero)) & 0xF;
+}
+#endif
+
+uint32_t ReduceRange(const uint32_t* source, int begin, int end)
+{
+    uint32_t sum = 0;
+    int i = begin;
+#ifdef SCAN_USE_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 4 <= end; i += 4)
+        acc = _mm_add_epi32(acc, Load4(source + i));
+
+    sum = HorizontalSum(acc);
+#endif
+    for (; i < end; i++)
+        sum += source[i];
+
+    return sum;
+}
+
+// Scans [begin, end) on top of |carry| and returns the carry for the
+// following elements.
+template <bool Inclusive>
+uint32_t ScanRange(uint32_t* dest, const uint32_t* source, int begin,
+                   int end, uint32_t carry)
+{
+    int i = begin;
+#ifdef SCAN_USE_SSE2
+    // Two shift-and-add steps give the inclusive scan of four lanes.
+    __m128i base = _mm_set1_epi32(static_cast<int>(carry));
+    for (; i + 4 <= end; i += 4) {
+        __m128i v = Load4(source + i);
+        __m128i s = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        s = _mm_add_epi32(s, _mm_slli_si128(s, 8));
+        s = _mm_add_epi32(s, base);
+        Store4(dest + i, Inclusive ? s : _mm_sub_epi32(s, v));
+        base = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    carry = static_cast<uint32_t>(_mm_cvtsi128_si32(base));
+#endif
+    for (; i < end; i++) {
+        uint32_t v = source[i];
+        dest[i] = Inclusive ? carry + v : carry;
+        carry += v;
+    }
+
+    return carry;
+}
+
+int CountNonZeros(const uint32_t* flags, int begin, int end)
+{
+    int count = 0;
+    int i = begin;
+#ifdef SCAN_USE_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 4 <= end; i += 4)
+        acc = _mm_sub_epi32(acc, _mm_cmpeq_epi32(Load4(flags + i), zero));
+
+    count = (i - begin) - static_cast<int>(HorizontalSum(acc));
+#endif
+    for (; i < end; i++)
+        count += flags[i] ? 1 : 0;
+
+    return count;
+}
+
+uint32_t CompactRange(uint32_t* dest, const uint32_t* flags, int begin,
+                      int end, uint32_t pos)
+{
+    int i = begin;
+#ifdef SCAN_USE_SSE2
+    // Flags are mostly sparse, so whole groups of zeros are skipped.
+    for (; i + 4 <= end; i += 4) {
+        int mask = NonZeroMask(Load4(flags + i));
+        if (!mask)
+            continue;
+
+        for (int k = 0; k < 4; k++)
+            if (mask & (1 << k))
+                dest[pos++] = static_cast<uint32_t>(i + k);
+    }
+#endif
+    for (; i < end; i++)
+        if (flags[i])
+            dest[pos++] = static_cast<uint32_t>(i);
+
+    return pos;
+}
+
+template <bool Inclusive>
+uint32_t Scan(ThreadPool* pool, int num_of_chunks, uint32_t* dest,
+              const uint32_t* source, int n)
+{
+    if (num_of_chunks <= 1)
+        return ScanRange<Inclusive>(dest, source, 0, n, 0);
+
+    std::vector<uint32_t> bases(num_of_chunks + 1, 0);
+    pool->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++)
+            bases[c + 1] = ReduceRange(source,
+                                       ChunkBegin(c, num_of_chunks, n),
+                                       ChunkBegin(c + 1, num_of_chunks, n));
+    });
+
+    for (int c = 0; c < num_of_chunks; c++)
+        bases[c + 1] += bases[c];
+
+    pool->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++)
+            ScanRange<Inclusive>(dest, source,
+                                 ChunkBegin(c, num_of_chunks, n),
+                                 ChunkBegin(c + 1, num_of_chunks, n),
+                                 bases[c]);
+    });
+
+    return bases[num_of_chunks];
+}
+} // Anonymous namespace.
+
+// All the scans are two-pass blocked scans over one chunk per thread: the
+// first pass reduces every chunk, and after a serial scan of the chunk
+// results, the second pass scans every chunk on top of its base. Both passes
+// run through SSE2 where it is available.
+
+ScanImplCpu::ScanImplCpu(ThreadPool* pool)
+    : pool_(pool)
+{
+
+}
+
+ScanImplCpu::~ScanImplCpu()
+{
+
+}
+
+uint32_t ScanImplCpu::ExclusiveScan(uint32_t* dest, const uint32_t* source,
+                                    int n)
+{
+    return Scan<false>(pool_, NumOfChunks(n), dest, source, n);
+}
+
+uint32_t ScanImplCpu::InclusiveScan(uint32_t* dest, const uint32_t* source,
+                                    int n)
+{
+    return Scan<true>(pool_, NumOfChunks(n), dest, source, n);
+}
+
+void ScanImplCpu::SegmentedScan(uint32_t* dest, const uint32_t* source,
+                                const uint32_t* heads, int n)
+{
+    // A chunk passes on either the sum of its last segment, if it has a
+    // head, or the carry it received plus its own sum.
+    int num_of_chunks = NumOfChunks(n);
+    std::vector<uint32_t> tails(num_of_chunks, 0);
+    std::vector<uint8_t> has_head(num_of_chunks, 0);
+    if (num_of_chunks > 1) {
+        pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+            for (int c = c0; c < c1; c++) {
+                int begin = ChunkBegin(c, num_of_chunks, n);
+                int i = ChunkBegin(c + 1, num_of_chunks, n);
+                while (i > begin && !heads[i - 1])
+                    i--;
+
+                has_head[c] = i > begin ? 1 : 0;
+                tails[c] = ReduceRange(source, has_head[c] ? i - 1 : begin,
+                                       ChunkBegin(c + 1, num_of_chunks, n));
+            }
+        });
+    }
+
+    std::vector<uint32_t> carries(num_of_chunks, 0);
+    for (int c = 1; c < num_of_chunks; c++)
+        carries[c] = tails[c - 1] + (has_head[c - 1] ? 0 : carries[c - 1]);
+
+    pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++) {
+            uint32_t carry = carries[c];
+            int end = ChunkBegin(c + 1, num_of_chunks, n);
+            for (int i = ChunkBegin(c, num_of_chunks, n); i < end; i++) {
+                uint32_t v = source[i];
+                if (heads[i] || !i)
+                    carry = 0;
+
+                dest[i] = carry;
+                carry += v;
+            }
+        }
+    });
+}
+
+int ScanImplCpu::Compact(uint32_t* dest, const uint32_t* flags, int n)
+{
+    int num_of_chunks = NumOfChunks(n);
+    if (num_of_chunks <= 1)
+        return static_cast<int>(CompactRange(dest, flags, 0, n, 0));
+
+    std::vector<uint32_t> bases(num_of_chunks + 1, 0);
+    pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++)
+            bases[c + 1] = CountNonZeros(flags,
+                                         ChunkBegin(c, num_of_chunks, n),
+                                         ChunkBegin(c + 1, num_of_chunks, n));
+    });
+
+    for (int c = 0; c < num_of_chunks; c++)
+        bases[c + 1] += bases[c];
+
+    pool_->ParallelFor(0, num_of_chunks, [&](int c0, int c1) {
+        for (int c = c0; c < c1; c++)
+            CompactRange(dest, flags, ChunkBegin(c, num_of_chunks, n),
+                         ChunkBegin(c + 1, num_of_chunks, n), bases[c]);
+    });
+
+    return static_cast<int>(bases[num_of_chunks]);
+}
+
+int ScanImplCpu::NumOfChunks(int n) const
+{
+    return std::max(1, std::min(pool_->num_of_threads(),
+                                n / kMinElementsPerChunk));
+}
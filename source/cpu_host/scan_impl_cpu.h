@@ -0,0 +1,57 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _SCAN_IMPL_CPU_H_
+#define _SCAN_IMPL_CPU_H_
+
+#include <stdint.h>
+
+class ThreadPool;
+class ScanImplCpu
+{
+public:
+    explicit ScanImplCpu(ThreadPool* pool);
+    ~ScanImplCpu();
+
+    // Every element of |dest| receives the sum of the elements of |source|
+    // before it. |dest| may be |source|. Returns the sum of all the
+    // elements.
+    uint32_t ExclusiveScan(uint32_t* dest, const uint32_t* source, int n);
+
+    // Same as ExclusiveScan(), but with the element itself included.
+    uint32_t InclusiveScan(uint32_t* dest, const uint32_t* source, int n);
+
+    // An exclusive scan that starts over at every element with a non-zero
+    // |heads|. The first element always starts a segment.
+    void SegmentedScan(uint32_t* dest, const uint32_t* source,
+                       const uint32_t* heads, int n);
+
+    // Writes the indices of the elements with a non-zero |flags| to |dest|,
+    // in ascending order. Returns the number of indices written.
+    int Compact(uint32_t* dest, const uint32_t* flags, int n);
+
+private:
+    int NumOfChunks(int n) const;
+
+    ThreadPool* pool_;
+};
+
+#endif // _SCAN_IMPL_CPU_H_
\ No newline at end of file
@@ -0,0 +1,224 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _SIMD_FLOAT_H_
+#define _SIMD_FLOAT_H_
+
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// A thin layer over the vector unit we are compiled for. The host
+// kernels are written once against simd::Float and the scalar float, and
+// every storage format(fp16 or fp32) is converted on load/store, so that the
+// arithmetic is always carried out in fp32.
+//
+// AVX2 builds rely on F16C for the half conversion, which every AVX2 capable
+// processor supports.
+//
+// Only some of the translation units are built for AVX2, so everything that
+// depends on the instruction set lives in an inline namespace named after it.
+// Otherwise the linker would be free to pick the AVX2 version of an inline
+// function for a unit built without it, or to mix up the layouts of
+// simd::Float.
+#if defined(__AVX2__)
+#define SIMD_ISA avx2
+#else
+#define SIMD_ISA scalar
+#endif
+
+namespace simd
+{
+inline namespace SIMD_ISA
+{
+inline uint32_t FloatBits(float f)
+{
+    uint32_t r;
+    memcpy(&r, &f, sizeof(r));
+    return r;
+}
+
+inline float BitsToFloat(uint32_t u)
+{
+    float r;
+    memcpy(&r, &u, sizeof(r));
+    return r;
+}
+
+inline float HalfToFloat(uint16_t h)
+{
+#if defined(__AVX2__)
+    return _cvtsh_ss(h);
+#else
+    const uint32_t shifted_exp = 0x7C00u << 13;
+    uint32_t r = (h & 0x7FFFu) << 13;
+    uint32_t exp = r & shifted_exp;
+    r += (127 - 15) << 23;
+    if (exp == shifted_exp) {
+        r += (128 - 16) << 23;  // Inf/NaN.
+    } else if (exp == 0) {
+        r += 1 << 23;           // Zero/denormal.
+        r = FloatBits(BitsToFloat(r) - BitsToFloat(113 << 23));
+    }
+
+    return BitsToFloat(r | ((h & 0x8000u) << 16));
+#endif
+}
+
+inline uint16_t FloatToHalf(float f)
+{
+#if defined(__AVX2__)
+    return _cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+    const uint32_t f32_infinity = 255u << 23;
+    const uint32_t f16_overflow = (127u + 16) << 23;
+    const uint32_t denorm_magic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+    uint32_t u = FloatBits(f);
+    uint32_t sign = u & 0x80000000u;
+    u ^= sign;
+
+    uint16_t r;
+    if (u >= f16_overflow) {
+        r = u > f32_infinity ? 0x7E00 : 0x7C00;
+    } else if (u < (113u << 23)) {
+        u = FloatBits(BitsToFloat(u) + BitsToFloat(denorm_magic));
+        r = static_cast<uint16_t>(u - denorm_magic);
+    } else {
+        // Round to nearest even.
+        uint32_t mant_odd = (u >> 13) & 1;
+        u += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF;
+        u += mant_odd;
+        r = static_cast<uint16_t>(u >> 13);
+    }
+
+    return r | static_cast<uint16_t>(sign >> 16);
+#endif
+}
+
+inline float LoadScalar(const float* p) { return *p; }
+inline float LoadScalar(const uint16_t* p) { return HalfToFloat(*p); }
+inline void StoreScalar(float* p, float v) { *p = v; }
+inline void StoreScalar(uint16_t* p, float v) { *p = FloatToHalf(v); }
+
+inline float Min(float a, float b) { return a < b ? a : b; }
+inline float Max(float a, float b) { return a > b ? a : b; }
+inline float Sum(float v) { return v; }
+
+#if defined(__AVX2__)
+struct Float
+{
+    static const int kWidth = 8;
+
+    Float() {}
+    Float(float f) : v_(_mm256_set1_ps(f)) {}
+    Float(__m256 v) : v_(v) {}
+
+    __m256 v_;
+};
+
+inline Float operator+(Float a, Float b) { return _mm256_add_ps(a.v_, b.v_); }
+inline Float operator-(Float a, Float b) { return _mm256_sub_ps(a.v_, b.v_); }
+inline Float operator*(Float a, Float b) { return _mm256_mul_ps(a.v_, b.v_); }
+inline Float operator/(Float a, Float b) { return _mm256_div_ps(a.v_, b.v_); }
+inline Float Min(Float a, Float b) { return _mm256_min_ps(a.v_, b.v_); }
+inline Float Max(Float a, Float b) { return _mm256_max_ps(a.v_, b.v_); }
+inline float Sum(Float a)
+{
+    __m128 r = _mm_add_ps(_mm256_castps256_ps128(a.v_),
+                          _mm256_extractf128_ps(a.v_, 1));
+    r = _mm_hadd_ps(r, r);
+    r = _mm_hadd_ps(r, r);
+    return _mm_cvtss_f32(r);
+}
+
+inline Float Load(const float* p) { return _mm256_loadu_ps(p); }
+inline Float Load(const uint16_t* p)
+{
+    return _mm256_cvtph_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+inline void Store(float* p, Float v) { _mm256_storeu_ps(p, v.v_); }
+inline void Store(uint16_t* p, Float v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                     _mm256_cvtps_ph(v.v_, _MM_FROUND_TO_NEAREST_INT));
+}
+#else
+struct Float
+{
+    static const int kWidth = 1;
+
+    Float() {}
+    Float(float f) : v_(f) {}
+
+    float v_;
+};
+
+inline Float operator+(Float a, Float b) { return a.v_ + b.v_; }
+inline Float operator-(Float a, Float b) { return a.v_ - b.v_; }
+inline Float operator*(Float a, Float b) { return a.v_ * b.v_; }
+inline Float operator/(Float a, Float b) { return a.v_ / b.v_; }
+inline Float Min(Float a, Float b) { return Min(a.v_, b.v_); }
+inline Float Max(Float a, Float b) { return Max(a.v_, b.v_); }
+inline float Sum(Float a) { return a.v_; }
+
+inline Float Load(const float* p) { return *p; }
+inline Float Load(const uint16_t* p) { return HalfToFloat(*p); }
+inline void Store(float* p, Float v) { *p = v.v_; }
+inline void Store(uint16_t* p, Float v) { *p = FloatToHalf(v.v_); }
+#endif
+
+// Loaders that let the kernels be written once for both the vector and the
+// scalar tail.
+template <typename V> struct Lane;
+
+template <>
+struct Lane<float>
+{
+    static const int kWidth = 1;
+
+    template <typename T>
+    static float Load(const T* p) { return LoadScalar(p); }
+
+    template <typename T>
+    static void Store(T* p, float v) { StoreScalar(p, v); }
+};
+
+template <>
+struct Lane<Float>
+{
+    static const int kWidth = Float::kWidth;
+
+    template <typename T>
+    static Float Load(const T* p) { return simd::Load(p); }
+
+    template <typename T>
+    static void Store(T* p, Float v) { simd::Store(p, v); }
+};
+} // namespace SIMD_ISA
+} // namespace simd
+
+#endif // _SIMD_FLOAT_H_
\ No newline at end of file
@@ -0,0 +1,129 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <stdint.h>
+
+ThreadPool::ThreadPool(int num_of_threads)
+    : num_of_threads_(num_of_threads)
+    , workers_()
+    , lock_()
+    , job_ready_()
+    , job_done_()
+    , func_(nullptr)
+    , begin_(0)
+    , end_(0)
+    , num_of_ranges_(0)
+    , pending_(0)
+    , generation_(0)
+    , quit_(false)
+{
+    if (num_of_threads_ <= 0)
+        num_of_threads_ = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < num_of_threads_; i++)
+        workers_.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        quit_ = true;
+    }
+    job_ready_.notify_all();
+
+    for (auto& w : workers_)
+        w.join();
+}
+
+void ThreadPool::ParallelFor(int begin, int end, const RangeFunc& func)
+{
+    if (end <= begin)
+        return;
+
+    int num_of_ranges = std::min(end - begin, num_of_threads_);
+    if (num_of_ranges == 1) {
+        func(begin, end);
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        func_ = &func;
+        begin_ = begin;
+        end_ = end;
+        num_of_ranges_ = num_of_ranges;
+        pending_ = num_of_ranges - 1;
+        generation_++;
+    }
+    job_ready_.notify_all();
+
+    RunRange(0);
+
+    std::unique_lock<std::mutex> lock(lock_);
+    job_done_.wait(lock, [this]() { return pending_ == 0; });
+    func_ = nullptr;
+}
+
+void ThreadPool::RunRange(int index)
+{
+    int total = end_ - begin_;
+    int range_begin = begin_ + static_cast<int>(
+        static_cast<int64_t>(total) * index / num_of_ranges_);
+    int range_end = begin_ + static_cast<int>(
+        static_cast<int64_t>(total) * (index + 1) / num_of_ranges_);
+    (*func_)(range_begin, range_end);
+}
+
+void ThreadPool::WorkerMain(int index)
+{
+    int last_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(lock_);
+            job_ready_.wait(lock, [this, last_generation]() {
+                return quit_ || generation_ != last_generation;
+            });
+            if (quit_)
+                return;
+
+            last_generation = generation_;
+            if (index >= num_of_ranges_)
+                continue;
+        }
+
+        RunRange(index);
+
+        bool finished = false;
+        {
+            std::unique_lock<std::mutex> lock(lock_);
+            finished = --pending_ == 0;
+        }
+        if (finished)
+            job_done_.notify_one();
+    }
+}
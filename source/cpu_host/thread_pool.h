@@ -0,0 +1,73 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    typedef std::function<void (int begin, int end)> RangeFunc;
+
+    // |num_of_threads| includes the calling thread. Zero means one thread per
+    // hardware core.
+    explicit ThreadPool(int num_of_threads);
+    ~ThreadPool();
+
+    // Splits [begin, end) into at most |num_of_threads()| contiguous ranges
+    // and runs |func| over them concurrently. The caller participates in the
+    // work and the call returns only after every range is done.
+    //
+    // The partition depends only on the size of the range and the number of
+    // threads, so anything reduced per-range can be summed up in a
+    // deterministic order.
+    void ParallelFor(int begin, int end, const RangeFunc& func);
+
+    int num_of_threads() const { return num_of_threads_; }
+
+private:
+    ThreadPool(const ThreadPool&);
+    void operator=(const ThreadPool&);
+
+    void RunRange(int index);
+    void WorkerMain(int index);
+
+    int num_of_threads_;
+    std::vector<std::thread> workers_;
+    std::mutex lock_;
+    std::condition_variable job_ready_;
+    std::condition_variable job_done_;
+    const RangeFunc* func_;
+    int begin_;
+    int end_;
+    int num_of_ranges_;
+    int pending_;
+    int generation_;
+    bool quit_;
+};
+
+#endif // _THREAD_POOL_H_
\ No newline at end of file
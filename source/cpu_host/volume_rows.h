@@ -0,0 +1,127 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _VOLUME_ROWS_H_
+#define _VOLUME_ROWS_H_
+
+#include <cassert>
+#include <vector>
+
+#include <stdint.h>
+
+#include "cpu_host/cpu_volume.h"
+#include "cpu_host/simd_float.h"
+
+// Host kernels always compute in fp32. These helpers hand out fp32 rows of a
+// single-component volume: fp32 volumes are accessed in place, and fp16 rows
+// are converted to/from a per-thread scratch buffer.
+//
+// The row conversion is vectorized for the instruction set of the including
+// unit, so the helpers share the inline namespace of simd_float.h.
+inline namespace SIMD_ISA
+{
+
+inline void ConvertRow(float* dest, const uint16_t* source, int n)
+{
+    int x = 0;
+    for (; x + simd::Float::kWidth <= n; x += simd::Float::kWidth)
+        simd::Store(dest + x, simd::Load(source + x));
+
+    for (; x < n; x++)
+        dest[x] = simd::HalfToFloat(source[x]);
+}
+
+inline void ConvertRow(uint16_t* dest, const float* source, int n)
+{
+    int x = 0;
+    for (; x + simd::Float::kWidth <= n; x += simd::Float::kWidth)
+        simd::Store(dest + x, simd::Load(source + x));
+
+    for (; x < n; x++)
+        dest[x] = simd::FloatToHalf(source[x]);
+}
+
+class RowReader
+{
+public:
+    RowReader(const CpuVolume& volume, int num_of_slots)
+        : volume_(volume)
+        , width_(volume.width())
+        , scratch_(volume.byte_width() == 2 ? width_ * num_of_slots : 0)
+        , zeros_(width_, 0.0f)
+    {
+        assert(volume.num_of_components() == 1);
+    }
+
+    // The returned row stays valid until |slot| is read again.
+    const float* Read(int slot, int y, int z)
+    {
+        const void* row = volume_.GetRowAddress(y, z);
+        if (volume_.byte_width() == 4)
+            return static_cast<const float*>(row);
+
+        float* r = &scratch_[slot * width_];
+        ConvertRow(r, static_cast<const uint16_t*>(row), width_);
+        return r;
+    }
+
+    const float* Zeros() const { return &zeros_[0]; }
+    int width() const { return width_; }
+
+private:
+    const CpuVolume& volume_;
+    int width_;
+    std::vector<float> scratch_;
+    std::vector<float> zeros_;
+};
+
+class RowWriter
+{
+public:
+    explicit RowWriter(CpuVolume* volume)
+        : volume_(volume)
+        , scratch_(volume->byte_width() == 2 ? volume->width() : 0)
+    {
+        assert(volume->num_of_components() == 1);
+    }
+
+    float* Begin(int y, int z)
+    {
+        if (volume_->byte_width() == 4)
+            return static_cast<float*>(volume_->GetRowAddress(y, z));
+
+        return &scratch_[0];
+    }
+
+    void End(int y, int z)
+    {
+        if (volume_->byte_width() == 2)
+            ConvertRow(static_cast<uint16_t*>(volume_->GetRowAddress(y, z)),
+                       &scratch_[0], volume_->width());
+    }
+
+private:
+    CpuVolume* volume_;
+    std::vector<float> scratch_;
+};
+} // namespace SIMD_ISA
+
+#endif // _VOLUME_ROWS_H_
\ No newline at end of file
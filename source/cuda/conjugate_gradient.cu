@@ -35,6 +35,7 @@
 #include "cuda/multi_precision.cuh"
 
 surface<void, cudaSurfaceType3D> surf;
+surface<void, cudaSurfaceType3D> surf_1;
 texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex;
 texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_0;
 texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_1;
@@ -169,6 +170,90 @@ __global__ void ScaledAddKernel(Tex3d<StorageType>::ValType* coef, float sign,
     t3d.Store(e0 + *coef * sign * e1, surf, x, y, z);
 }
 
+template <typename StorageType>
+__global__ void ExtrapolateKernel(float coef, uint3 volume_size)
+{
+    using FPType = typename Tex3d<StorageType>::ValType;
+
+    uint x = VolumeX();
+    uint y = VolumeY();
+    uint z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    Tex3d<StorageType> t3d;
+    FPType e0 = t3d(TexSel<StorageType>::Tex(tex_0, texf_0, texd_0), x, y, z);
+    FPType e1 = t3d(TexSel<StorageType>::Tex(tex_1, texf_1, texd_1), x, y, z);
+
+    t3d.Store(e0 + coef * (e0 - e1), surf, x, y, z);
+}
+
+// The kernel is instantiated for the precision of |v|, while that of |dest|
+// is told by |half_dest|, as the two may differ. |dest| is updated in-place
+// when accumulating, which is fine as each thread touches its own cell only.
+template <typename StorageType>
+__global__ void ConvertVolumeKernel(float scale, bool accumulate,
+                                    bool half_dest, uint3 volume_size)
+{
+    uint x = VolumeX();
+    uint y = VolumeY();
+    uint z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    Tex3d<StorageType> t3d;
+    float v = t3d(TexSel<StorageType>::Tex(tex_1, texf_1, texd_1), x, y, z) *
+        scale;
+    if (half_dest) {
+        if (accumulate)
+            v += tex3D(tex_0, x, y, z);
+
+        Tex3d<ushort>().Store(v, surf, x, y, z);
+    } else {
+        if (accumulate)
+            v += tex3D(texf_0, x, y, z);
+
+        Tex3d<float>().Store(v, surf, x, y, z);
+    }
+}
+
+// Both |search| and |dest| are updated in-place. That is fine as each thread
+// touches its own cell only.
+template <typename StorageType>
+__global__ void UpdateSearchAndVectorKernel(Tex3d<StorageType>::ValType* alpha,
+                                            Tex3d<StorageType>::ValType* beta,
+                                            float sign, uint3 volume_size)
+{
+    using FPType = typename Tex3d<StorageType>::ValType;
+
+    uint x = VolumeX();
+    uint y = VolumeY();
+    uint z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    Tex3d<StorageType> t3d;
+    FPType v      = t3d(TexSel<StorageType>::Tex(tex,   texf,   texd),   x, y, z);
+    FPType dest   = t3d(TexSel<StorageType>::Tex(tex_0, texf_0, texd_0), x, y, z);
+    FPType search = t3d(TexSel<StorageType>::Tex(tex_1, texf_1, texd_1), x, y, z);
+
+    FPType s = v + *beta * search;
+    t3d.Store(s, surf_1, x, y, z);
+    t3d.Store(dest + *alpha * sign * s, surf, x, y, z);
+}
+
+template <typename FPType>
+__device__ FPType DivideOrZero(FPType n, FPType d)
+{
+    if (d > 0.00000001f || d < -0.00000001f)
+        return n / d;
+
+    return 0.0f;
+}
+
 template <typename StorageType>
 struct SchemeDefault
 {
@@ -243,6 +328,77 @@ struct SchemeBeta : public SchemeDefault<StorageType>
     FPType* beta_;
 };
 
+// Applies the stencil to |tex|, and accumulates (|tex_0|, |tex|) and
+// (A * |tex|, |tex|) at the same time, for the Chronopoulos/Gear variant of
+// conjugate gradient that needs only one reduction per iteration.
+template <typename StorageType>
+struct SchemePipelined
+{
+    using FPType = typename Tex3d<StorageType>::ValType;
+    __device__ void Load(uint i, uint row_stride, uint slice_stride,
+                         FPType* gamma, FPType* delta)
+    {
+        uint z = i / slice_stride;
+        uint y = (i % slice_stride) / row_stride;
+        uint x = i % row_stride;
+
+        float xf = static_cast<float>(x);
+        float yf = static_cast<float>(y);
+        float zf = static_cast<float>(z);
+
+        Tex3d<StorageType> t3d;
+        FPType near   = t3d(TexSel<StorageType>::Tex(tex,   texf,   texd),   xf,        yf,        zf - 1.0f);
+        FPType south  = t3d(TexSel<StorageType>::Tex(tex,   texf,   texd),   xf,        yf - 1.0f, zf);
+        FPType west   = t3d(TexSel<StorageType>::Tex(tex,   texf,   texd),   xf - 1.0f, yf,        zf);
+        FPType center = t3d(TexSel<StorageType>::Tex(tex,   texf,   texd),   xf,        yf,        zf);
+        FPType east   = t3d(TexSel<StorageType>::Tex(tex,   texf,   texd),   xf + 1.0f, yf,        zf);
+        FPType north  = t3d(TexSel<StorageType>::Tex(tex,   texf,   texd),   xf,        yf + 1.0f, zf);
+        FPType far    = t3d(TexSel<StorageType>::Tex(tex,   texf,   texd),   xf,        yf,        zf + 1.0f);
+        FPType r      = t3d(TexSel<StorageType>::Tex(tex_0, texf_0, texd_0), xf,        yf,        zf);
+
+        if (outflow_) {
+            UpperBoundaryHandlerOutflow<FPType> handler;
+            handler.HandleUpperBoundary(&north, center, y, volume_size_.y);
+        }
+
+        // Kept in sync with ApplyStencilKernel.
+        FPType v = (north + south + east + west + far + near - 6.0f * center);
+        t3d.Store(v, surf, x, y, z);
+
+        *gamma += r * center;
+        *delta += v * center;
+    }
+    __device__ void Save(FPType* rho, FPType gamma, FPType delta)
+    {
+        FPType beta = 0.0f;
+        FPType denom = delta;
+        if (!restart_) {
+            beta = DivideOrZero(gamma, *rho);
+            denom -= DivideOrZero(beta * gamma, *alpha_);
+        }
+
+        *beta_ = beta;
+        *alpha_ = DivideOrZero(gamma, denom);
+        *rho = gamma;
+    }
+
+    __host__ void Init(FPType* alpha, FPType* beta, bool restart,
+                       bool outflow, const uint3& volume_size)
+    {
+        alpha_ = alpha;
+        beta_ = beta;
+        restart_ = restart;
+        outflow_ = outflow;
+        volume_size_ = volume_size;
+    }
+
+    FPType* alpha_;
+    FPType* beta_;
+    bool restart_;
+    bool outflow_;
+    uint3 volume_size_;
+};
+
 #include "volume_reduction.cuh"
 
 // =============================================================================
@@ -276,6 +432,39 @@ DECLARE_KERNEL_META(
     MAKE_INVOKE_DECLARATION(const MemPiece& coef, const uint3& volume_size),
     coef.AsType<FPType>(), volume_size);
 
+template <typename StorageType>
+struct ApplyStencilAndReduceMeta
+{
+    static void Invoke(const MemPiece& alpha, const MemPiece& beta,
+                       const MemPiece& rho, bool restart, bool outflow,
+                       const uint3& volume_size, BlockArrangement* ba,
+                       AuxBufferManager* bm)
+    {
+        using FPType = typename Tex3d<StorageType>::ValType;
+        SchemePipelined<StorageType> scheme;
+        scheme.Init(alpha.AsType<FPType>(), beta.AsType<FPType>(), restart,
+                    outflow, volume_size);
+        ReduceVolumePair(rho.AsType<FPType>(), scheme, volume_size, ba, bm);
+    }
+};
+
+DECLARE_KERNEL_META(
+    UpdateSearchAndVectorKernel,
+    MAKE_INVOKE_DECLARATION(const MemPiece& alpha, const MemPiece& beta,
+                            float sign, const uint3& volume_size),
+    alpha.AsType<FPType>(), beta.AsType<FPType>(), sign, volume_size);
+
+DECLARE_KERNEL_META(
+    ExtrapolateKernel,
+    MAKE_INVOKE_DECLARATION(float coef, const uint3& volume_size),
+    coef, volume_size);
+
+DECLARE_KERNEL_META(
+    ConvertVolumeKernel,
+    MAKE_INVOKE_DECLARATION(float scale, bool accumulate, bool half_dest,
+                            const uint3& volume_size),
+    scale, accumulate, half_dest, volume_size);
+
 // =============================================================================
 
 namespace kern_launcher
@@ -402,4 +591,116 @@ void ScaledAdd(cudaArray* dest, cudaArray* v0, cudaArray* v1,
 
     DCHECK_KERNEL();
 }
+
+void ApplyStencilAndReduce(const MemPiece& alpha, const MemPiece& beta,
+                           const MemPiece& rho, cudaArray* aux,
+                           cudaArray* precond, cudaArray* residual,
+                           bool restart, bool outflow, uint3 volume_size,
+                           BlockArrangement* ba, AuxBufferManager* bm)
+{
+    if (BindCudaSurfaceToArray(&surf, aux) != cudaSuccess)
+        return;
+
+    auto bound = SelectiveBind(precond, false, cudaFilterModePoint,
+                               cudaAddressModeClamp, &tex, &texf, &texd);
+    if (!bound.Succeeded())
+        return;
+
+    auto bound_0 = SelectiveBind(residual, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_0, &texf_0,
+                                 &texd_0);
+    if (!bound_0.Succeeded())
+        return;
+
+    InvokeKernel<ApplyStencilAndReduceMeta>(bound, alpha, beta, rho, restart,
+                                            outflow, volume_size, ba, bm);
+    DCHECK_KERNEL();
+}
+
+void UpdateSearchAndVector(cudaArray* dest, cudaArray* search, cudaArray* v,
+                           const MemPiece& alpha, const MemPiece& beta,
+                           float sign, uint3 volume_size, BlockArrangement* ba)
+{
+    if (BindCudaSurfaceToArray(&surf, dest) != cudaSuccess)
+        return;
+
+    if (BindCudaSurfaceToArray(&surf_1, search) != cudaSuccess)
+        return;
+
+    auto bound = SelectiveBind(v, false, cudaFilterModePoint,
+                               cudaAddressModeClamp, &tex, &texf, &texd);
+    if (!bound.Succeeded())
+        return;
+
+    auto bound_0 = SelectiveBind(dest, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_0, &texf_0,
+                                 &texd_0);
+    if (!bound_0.Succeeded())
+        return;
+
+    auto bound_1 = SelectiveBind(search, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_1, &texf_1,
+                                 &texd_1);
+    if (!bound_1.Succeeded())
+        return;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangeRowScan(&grid, &block, volume_size);
+    InvokeKernel<UpdateSearchAndVectorKernelMeta>(bound, grid, block, alpha,
+                                                  beta, sign, volume_size);
+    DCHECK_KERNEL();
+}
+
+void Extrapolate(cudaArray* dest, cudaArray* v0, cudaArray* v1, float coef,
+                 uint3 volume_size, BlockArrangement* ba)
+{
+    if (BindCudaSurfaceToArray(&surf, dest) != cudaSuccess)
+        return;
+
+    auto bound_0 = SelectiveBind(v0, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_0, &texf_0,
+                                 &texd_0);
+    if (!bound_0.Succeeded())
+        return;
+
+    auto bound_1 = SelectiveBind(v1, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_1, &texf_1,
+                                 &texd_1);
+    if (!bound_1.Succeeded())
+        return;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangeRowScan(&grid, &block, volume_size);
+    InvokeKernel<ExtrapolateKernelMeta>(bound_0, grid, block, coef,
+                                        volume_size);
+    DCHECK_KERNEL();
+}
+
+void ConvertVolume(cudaArray* dest, cudaArray* v, float scale, bool accumulate,
+                   bool half_dest, uint3 volume_size, BlockArrangement* ba)
+{
+    if (BindCudaSurfaceToArray(&surf, dest) != cudaSuccess)
+        return;
+
+    auto bound_0 = SelectiveBind(dest, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_0, &texf_0,
+                                 &texd_0);
+    if (!bound_0.Succeeded())
+        return;
+
+    auto bound_1 = SelectiveBind(v, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_1, &texf_1,
+                                 &texd_1);
+    if (!bound_1.Succeeded())
+        return;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangeRowScan(&grid, &block, volume_size);
+    InvokeKernel<ConvertVolumeKernelMeta>(bound_1, grid, block, scale,
+                                          accumulate, half_dest, volume_size);
+    DCHECK_KERNEL();
+}
 }
@@ -281,6 +281,18 @@ void CudaCore::ClearVolume(cudaArray* dest, const glm::vec4& value,
 
 }
 
+void CudaCore::CopyFromMemPiece(void* dest, const void* source, int size)
+{
+    cudaError_t e = cudaMemcpy(dest, source, size, cudaMemcpyDeviceToHost);
+    assert(e == cudaSuccess);
+}
+
+void CudaCore::CopyToMemPiece(void* dest, const void* source, int size)
+{
+    cudaError_t e = cudaMemcpy(dest, source, size, cudaMemcpyHostToDevice);
+    assert(e == cudaSuccess);
+}
+
 void CudaCore::CopyFromVolume(void* dest, size_t pitch, cudaArray* source, 
                               const glm::ivec3& volume_size)
 {
@@ -317,6 +329,22 @@ void CudaCore::CopyToVolume(cudaArray* dest, void* source, size_t pitch,
     assert(e == cudaSuccess);
 }
 
+void CudaCore::CopyVolumeRegion(cudaArray* dest, const glm::ivec3& dest_pos,
+                                cudaArray* source, const glm::ivec3& source_pos,
+                                const glm::ivec3& extent)
+{
+    // Positions and extent are all in elements, as both ends are arrays.
+    cudaMemcpy3DParms cpy_parms = {};
+    cpy_parms.srcArray = source;
+    cpy_parms.srcPos = make_cudaPos(source_pos.x, source_pos.y, source_pos.z);
+    cpy_parms.dstArray = dest;
+    cpy_parms.dstPos = make_cudaPos(dest_pos.x, dest_pos.y, dest_pos.z);
+    cpy_parms.extent = make_cudaExtent(extent.x, extent.y, extent.z);
+    cpy_parms.kind = cudaMemcpyDeviceToDevice;
+    cudaError_t e = cudaMemcpy3D(&cpy_parms);
+    assert(e == cudaSuccess);
+}
+
 void CudaCore::FlushProfilingData()
 {
     // Still not able to make visual profiler work. Maybe it's a problem with
@@ -340,7 +368,9 @@ void CudaCore::Raycast(GraphicsResource* dest, cudaArray* density,
                        float focal_length, const glm::vec2& screen_size,
                        int num_samples, int num_light_samples, float absorption,
                        float density_factor, float occlusion_factor,
-                       const glm::vec3& volume_size)
+                       const glm::vec3& domain_size,
+                       const glm::vec3& window_origin,
+                       const glm::vec3& window_size)
 {
     cudaGraphicsResource_t res[] = {
         dest->resource()
@@ -363,7 +393,8 @@ void CudaCore::Raycast(GraphicsResource* dest, cudaArray* density,
                            eye_pos, light_color, light_pos, light_intensity,
                            focal_length, screen_size, num_samples,
                            num_light_samples, absorption, density_factor,
-                           occlusion_factor, volume_size);
+                           occlusion_factor, domain_size, window_origin,
+                           window_size);
 
     cudaGraphicsUnmapResources(sizeof(res) / sizeof(res[0]), res);
 }
@@ -50,10 +50,16 @@ public:
     static void FreeVolumeInPlaceMemory(cudaPitchedPtr* mem);
     static void FreeVolumeMemory(cudaArray* mem);
 
+    static void CopyFromMemPiece(void* dest, const void* source, int size);
+    static void CopyToMemPiece(void* dest, const void* source, int size);
     static void CopyFromVolume(void* dest, size_t pitch, cudaArray* source,
                                const glm::ivec3& volume_size);
     static void CopyToVolume(cudaArray* dest, void* source, size_t pitch,
                              const glm::ivec3& volume_size);
+    static void CopyVolumeRegion(cudaArray* dest, const glm::ivec3& dest_pos,
+                                 cudaArray* source,
+                                 const glm::ivec3& source_pos,
+                                 const glm::ivec3& extent);
     static void CopyVolumeAsync(cudaArray* dest, cudaArray* source,
                                 const glm::ivec3& volume_size);
     static void Raycast(GraphicsResource* dest, cudaArray* density,
@@ -64,7 +70,9 @@ public:
                         float focal_length, const glm::vec2& screen_size,
                         int num_samples, int num_light_samples,
                         float absorption, float density_factor,
-                        float occlusion_factor, const glm::vec3& volume_size);
+                        float occlusion_factor, const glm::vec3& domain_size,
+                        const glm::vec3& window_origin,
+                        const glm::vec3& window_size);
 
     void ClearVolume(cudaArray* dest, const glm::vec4& value,
                      const glm::ivec3& volume_size);
@@ -65,7 +65,8 @@ __global__ void RaycastKernel(glm::mat4 inv_rotation, glm::vec2 viewport_size,
                               float step_size, int num_light_samples,
                               float light_scale, float step_absorption,
                               float density_factor, float occlusion_factor,
-                              glm::vec2 screen_size, glm::vec3 normalized_size)
+                              glm::vec2 screen_size, glm::vec3 normalized_size,
+                              glm::vec3 window_min, glm::vec3 window_scale)
 {
     int x = VolumeX();
     int y = VolumeY();
@@ -88,8 +89,10 @@ __global__ void RaycastKernel(glm::mat4 inv_rotation, glm::vec2 viewport_size,
     // Ray origin is already in model space.
     float near;
     float far;
-    IntersectAABB(ray_dir, eye_pos, -normalized_size, normalized_size,
-                  &near, &far);
+    // Only the window of the domain is marched through.
+    glm::vec3 box_min = normalized_size * (2.0f * window_min - 1.0f);
+    glm::vec3 box_max = box_min + 2.0f * normalized_size / window_scale;
+    IntersectAABB(ray_dir, eye_pos, box_min, box_max, &near, &far);
     if (far - near < 0.0001f) {
         ushort4 raw = make_ushort4(0, __float2half_rn(1.0f), 0,
                                    __float2half_rn(0.0f));
@@ -115,8 +118,9 @@ __global__ void RaycastKernel(glm::mat4 inv_rotation, glm::vec2 viewport_size,
 
     for (int i = 0; i < num_samples && travel > 0.0f;
             i++, pos += step, travel -= step_size) {
+        glm::vec3 t = (pos - window_min) * window_scale;
         float density =
-            tex3D(raycast_density, pos.x, pos.y, pos.z) * density_factor;
+            tex3D(raycast_density, t.x, t.y, t.z) * density_factor;
         if (density < 0.02f)
             continue;
 
@@ -125,14 +129,15 @@ __global__ void RaycastKernel(glm::mat4 inv_rotation, glm::vec2 viewport_size,
         glm::vec3 l_pos = pos + light_dir;
 
         for (int j = 0; j < num_light_samples; j++) {
-            float d = tex3D(raycast_density, l_pos.x, l_pos.y, l_pos.z);
+            glm::vec3 l_t = (l_pos - window_min) * window_scale;
+            float d = tex3D(raycast_density, l_t.x, l_t.y, l_t.z);
             light_weight *= __expf(-step_absorption * d * occlusion_factor);
             if (light_weight <= 0.01f)
                 break;
 
             // Early termination. Great performance gain.
-            if (l_pos.x < 0.0f || l_pos.y < 0.0f || l_pos.z < 0.0f ||
-                    l_pos.x > 1.0f || l_pos.y > 1.0f || l_pos.z > 1.0f)
+            if (l_t.x < 0.0f || l_t.y < 0.0f || l_t.z < 0.0f ||
+                    l_t.x > 1.0f || l_t.y > 1.0f || l_t.z > 1.0f)
                 break;
 
             l_pos += light_dir;
@@ -236,7 +241,8 @@ __global__ void RaycastKernel_dir_light(glm::mat4 inv_rotation, glm::vec2 viewpo
                                         float step_size, int num_light_samples,
                                         float step_absorption,
                                         float density_factor, float occlusion_factor,
-                                        glm::vec2 screen_size, glm::vec3 normalized_size)
+                                        glm::vec2 screen_size, glm::vec3 normalized_size,
+                                        glm::vec3 window_min, glm::vec3 window_scale)
 {
     int x = VolumeX();
     int y = VolumeY();
@@ -259,8 +265,10 @@ __global__ void RaycastKernel_dir_light(glm::mat4 inv_rotation, glm::vec2 viewpo
     // Ray origin is already in model space.
     float near;
     float far;
-    IntersectAABB(ray_dir, eye_pos, -normalized_size, normalized_size,
-                  &near, &far);
+    // Only the window of the domain is marched through.
+    glm::vec3 box_min = normalized_size * (2.0f * window_min - 1.0f);
+    glm::vec3 box_max = box_min + 2.0f * normalized_size / window_scale;
+    IntersectAABB(ray_dir, eye_pos, box_min, box_max, &near, &far);
     if (far - near < 0.0001f) {
         ushort4 raw = make_ushort4(0, __float2half_rn(1.0f), 0,
                                    __float2half_rn(0.0f));
@@ -286,8 +294,9 @@ __global__ void RaycastKernel_dir_light(glm::mat4 inv_rotation, glm::vec2 viewpo
 
     for (int i = 0; i < num_samples && travel > 0.0f;
             i++, pos += step, travel -= step_size) {
+        glm::vec3 t = (pos - window_min) * window_scale;
         float density =
-            tex3D(raycast_density, pos.x, pos.y, pos.z) * density_factor;
+            tex3D(raycast_density, t.x, t.y, t.z) * density_factor;
         if (density < 0.02f)
             continue;
 
@@ -295,14 +304,15 @@ __global__ void RaycastKernel_dir_light(glm::mat4 inv_rotation, glm::vec2 viewpo
         glm::vec3 l_pos = pos + light_dir;
 
         for (int j = 0; j < num_light_samples; j++) {
-            float d = tex3D(raycast_density, l_pos.x, l_pos.y, l_pos.z);
+            glm::vec3 l_t = (l_pos - window_min) * window_scale;
+            float d = tex3D(raycast_density, l_t.x, l_t.y, l_t.z);
             light_weight *= __expf(-step_absorption * d * occlusion_factor);
             if (light_weight <= 0.01f)
                 break;
 
             // Early termination. Great performance gain.
-            if (l_pos.x < 0.0f || l_pos.y < 0.0f || l_pos.z < 0.0f ||
-                    l_pos.x > 1.0f || l_pos.y > 1.0f || l_pos.z > 1.0f)
+            if (l_t.x < 0.0f || l_t.y < 0.0f || l_t.z < 0.0f ||
+                    l_t.x > 1.0f || l_t.y > 1.0f || l_t.z > 1.0f)
                 break;
 
             l_pos += light_dir;
@@ -339,7 +349,8 @@ void Raycast(cudaArray* dest_array, cudaArray* density_array,
              const glm::vec3& light_pos, float light_intensity,
              float focal_length, const glm::vec2& screen_size, int num_samples,
              int num_light_samples, float absorption, float density_factor,
-             float occlusion_factor, const glm::vec3& volume_size)
+             float occlusion_factor, const glm::vec3& domain_size,
+             const glm::vec3& window_origin, const glm::vec3& window_size)
 {
     if (BindCudaSurfaceToArray(&raycast_dest, dest_array) != cudaSuccess)
         return;
@@ -360,9 +371,13 @@ void Raycast(cudaArray* dest_array, cudaArray* density_array,
     glm::vec3 intensity = glm::normalize(light_color);
     intensity *= light_intensity;
 
+    // The rays march in the normalized coordinates of the whole domain, so
+    // the look of the smoke stays the same wherever the window moves.
     float max_length =
-        glm::max(glm::max(volume_size.x, volume_size.y), volume_size.z);
-    glm::vec3 normalized_size = volume_size / max_length;
+        glm::max(glm::max(domain_size.x, domain_size.y), domain_size.z);
+    glm::vec3 normalized_size = domain_size / max_length;
+    glm::vec3 window_min = window_origin / domain_size;
+    glm::vec3 window_scale = domain_size / window_size;
     const float kMaxDistance = sqrt(3.0f);
     const float kStepSize = kMaxDistance / static_cast<float>(num_samples);
     const float kLightScale =
@@ -381,13 +396,13 @@ void Raycast(cudaArray* dest_array, cudaArray* density_array,
             inv_rotation, viewport_size, eye_pos, focal_length, offset, light,
             intensity, num_samples, kStepSize, num_light_samples,
             kAbsorptionTimesStepSize, density_factor, occlusion_factor,
-            screen_size, normalized_size);
+            screen_size, normalized_size, window_min, window_scale);
     } else {
         RaycastKernel<<<grid, block>>>(
             inv_rotation, viewport_size, eye_pos, focal_length, offset, light,
             intensity, num_samples, kStepSize, num_light_samples, kLightScale,
             kAbsorptionTimesStepSize, density_factor, occlusion_factor,
-            screen_size, normalized_size);
+            screen_size, normalized_size, window_min, window_scale);
     }
 
     DCHECK_KERNEL();
@@ -82,6 +82,21 @@ void FluidImplCuda::AdvectScalarField(cudaArray* fnp1, cudaArray* fn,
                                          ba_);
 }
 
+void FluidImplCuda::AdvectScalarFields(cudaArray** fnp1, cudaArray** fn,
+                                       cudaArray** aux,
+                                       const float* dissipation,
+                                       int num_of_fields, cudaArray* vel_x,
+                                       cudaArray* vel_y, cudaArray* vel_z,
+                                       float time_step,
+                                       const glm::ivec3& volume_size)
+{
+    kern_launcher::AdvectScalarFields(fnp1, fn, aux, dissipation,
+                                      num_of_fields, vel_x, vel_y, vel_z,
+                                      cell_size_, time_step, advect_method_,
+                                      FromGlmVector(volume_size), staggered_,
+                                      mid_point_, ba_);
+}
+
 void FluidImplCuda::AdvectVectorFields(cudaArray* fnp1_x, cudaArray* fnp1_y,
                                        cudaArray* fnp1_z, cudaArray* fn_x,
                                        cudaArray* fn_y, cudaArray* fn_z,
@@ -244,6 +259,24 @@ void FluidImplCuda::SubtractGradient(cudaArray* vel_x, cudaArray* vel_y,
                                     ba_);
 }
 
+void FluidImplCuda::ComputeMaxSpeed(float* max_speed, cudaArray* vel_x,
+                                    cudaArray* vel_y, cudaArray* vel_z,
+                                    const glm::ivec3& volume_size)
+{
+    kern_launcher::ComputeMaxSpeed(max_speed, vel_x, vel_y, vel_z,
+                                   FromGlmVector(volume_size), ba_);
+}
+
+void FluidImplCuda::FindActiveBricks(uint8_t* active_bricks, cudaArray* vel_x,
+                                     cudaArray* vel_y, cudaArray* vel_z,
+                                     float threshold, int brick_size,
+                                     const glm::ivec3& volume_size)
+{
+    kern_launcher::FindActiveBricks(active_bricks, vel_x, vel_y, vel_z,
+                                    threshold, brick_size,
+                                    FromGlmVector(volume_size));
+}
+
 void FluidImplCuda::AddCurlPsi(cudaArray* vel_x, cudaArray* vel_y,
                                cudaArray* vel_z, cudaArray* psi_x,
                                cudaArray* psi_y, cudaArray* psi_z,
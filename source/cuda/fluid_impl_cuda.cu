@@ -21,6 +21,8 @@
 
 #include <cassert>
 
+#include <stdint.h>
+
 #include "third_party/opengl/glew.h"
 
 #include <helper_math.h>
@@ -417,6 +419,75 @@ __global__ void SubtractGradientStaggeredKernel(float inverse_cell_size,
     surf3Dwrite(r_z, surf_z, x * sizeof(r_z), y, z, cudaBoundaryModeTrap);
 }
 
+// One block per brick. The flag of the brick is raised if any of its cells
+// carries a velocity component above |threshold|.
+__global__ void FindActiveBricksKernel(uint8_t* active_bricks, float threshold,
+                                       uint3 volume_size)
+{
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    int active = 0;
+    if (x < volume_size.x && y < volume_size.y && z < volume_size.z) {
+        float3 coord = make_float3(x, y, z) + 0.5f;
+
+        float v_x = fabsf(tex3D(tex_x, coord.x, coord.y, coord.z));
+        float v_y = fabsf(tex3D(tex_y, coord.x, coord.y, coord.z));
+        float v_z = fabsf(tex3D(tex_z, coord.x, coord.y, coord.z));
+        active = fmaxf(v_x, fmaxf(v_y, v_z)) > threshold;
+    }
+
+    active = __syncthreads_or(active);
+    if (threadIdx.x || threadIdx.y || threadIdx.z)
+        return;
+
+    uint i = (blockIdx.z * gridDim.y + blockIdx.y) * gridDim.x + blockIdx.x;
+    active_bricks[i] = active ? 1 : 0;
+}
+
+// The maximum of each block is reduced in the shared memory, and the blocks
+// are combined with an atomic max on the bits of the float, which sort the
+// same way as the values as long as they are non-negative.
+__global__ void ComputeMaxSpeedKernel(float* max_speed, uint3 volume_size)
+{
+    extern __shared__ float smem[];
+
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    float speed = 0.0f;
+    if (x < volume_size.x && y < volume_size.y && z < volume_size.z) {
+        float3 coord = make_float3(x, y, z) + 0.5f;
+
+        float v_x = tex3D(tex_x, coord.x, coord.y, coord.z);
+        float v_y = tex3D(tex_y, coord.x, coord.y, coord.z);
+        float v_z = tex3D(tex_z, coord.x, coord.y, coord.z);
+        speed = sqrtf(v_x * v_x + v_y * v_y + v_z * v_z);
+    }
+
+    uint tid = (threadIdx.z * blockDim.y + threadIdx.y) * blockDim.x +
+        threadIdx.x;
+    uint num_of_threads = blockDim.x * blockDim.y * blockDim.z;
+    smem[tid] = speed;
+    __syncthreads();
+
+    uint stride = 1;
+    while (stride < num_of_threads)
+        stride <<= 1;
+
+    for (stride >>= 1; stride > 0; stride >>= 1) {
+        if (tid < stride && tid + stride < num_of_threads)
+            smem[tid] = fmaxf(smem[tid], smem[tid + stride]);
+
+        __syncthreads();
+    }
+
+    if (tid == 0)
+        atomicMax(reinterpret_cast<int*>(max_speed), __float_as_int(smem[0]));
+}
+
 // =============================================================================
 
 template <typename StorageType>
@@ -673,4 +744,62 @@ void SubtractGradient(cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z,
 
     DCHECK_KERNEL();
 }
+
+void FindActiveBricks(uint8_t* active_bricks, cudaArray* vel_x,
+                      cudaArray* vel_y, cudaArray* vel_z, float threshold,
+                      int brick_size, uint3 volume_size)
+{
+    auto bound_x = BindHelper::Bind(&tex_x, vel_x, false, cudaFilterModePoint,
+                                    cudaAddressModeClamp);
+    if (bound_x.error() != cudaSuccess)
+        return;
+
+    auto bound_y = BindHelper::Bind(&tex_y, vel_y, false, cudaFilterModePoint,
+                                    cudaAddressModeClamp);
+    if (bound_y.error() != cudaSuccess)
+        return;
+
+    auto bound_z = BindHelper::Bind(&tex_z, vel_z, false, cudaFilterModePoint,
+                                    cudaAddressModeClamp);
+    if (bound_z.error() != cudaSuccess)
+        return;
+
+    dim3 block(brick_size, brick_size, brick_size);
+    dim3 grid((volume_size.x + brick_size - 1) / brick_size,
+              (volume_size.y + brick_size - 1) / brick_size,
+              (volume_size.z + brick_size - 1) / brick_size);
+    FindActiveBricksKernel<<<grid, block>>>(active_bricks, threshold,
+                                            volume_size);
+    DCHECK_KERNEL();
+}
+
+void ComputeMaxSpeed(float* max_speed, cudaArray* vel_x, cudaArray* vel_y,
+                     cudaArray* vel_z, uint3 volume_size,
+                     BlockArrangement* ba)
+{
+    auto bound_x = BindHelper::Bind(&tex_x, vel_x, false, cudaFilterModePoint,
+                                    cudaAddressModeClamp);
+    if (bound_x.error() != cudaSuccess)
+        return;
+
+    auto bound_y = BindHelper::Bind(&tex_y, vel_y, false, cudaFilterModePoint,
+                                    cudaAddressModeClamp);
+    if (bound_y.error() != cudaSuccess)
+        return;
+
+    auto bound_z = BindHelper::Bind(&tex_z, vel_z, false, cudaFilterModePoint,
+                                    cudaAddressModeClamp);
+    if (bound_z.error() != cudaSuccess)
+        return;
+
+    if (cudaMemsetAsync(max_speed, 0, sizeof(*max_speed)) != cudaSuccess)
+        return;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangePrefer3dLocality(&grid, &block, volume_size);
+    int smem_size = block.x * block.y * block.z * sizeof(float);
+    ComputeMaxSpeedKernel<<<grid, block, smem_size>>>(max_speed, volume_size);
+    DCHECK_KERNEL();
+}
 }
\ No newline at end of file
@@ -24,6 +24,8 @@
 
 #include <memory>
 
+#include <stdint.h>
+
 #include "advection_method.h"
 #include "fluid_impulse.h"
 #include "third_party/glm/fwd.hpp"
@@ -48,6 +50,11 @@ public:
                            cudaArray* vel_y, cudaArray* vel_z, cudaArray* aux,
                            float time_step, float dissipation,
                            const glm::ivec3& volume_size);
+    void AdvectScalarFields(cudaArray** fnp1, cudaArray** fn, cudaArray** aux,
+                            const float* dissipation, int num_of_fields,
+                            cudaArray* vel_x, cudaArray* vel_y,
+                            cudaArray* vel_z, float time_step,
+                            const glm::ivec3& volume_size);
     void AdvectVectorFields(cudaArray* fnp1_x, cudaArray* fnp1_y,
                             cudaArray* fnp1_z, cudaArray* fn_x, cudaArray* fn_y,
                             cudaArray* fn_z, cudaArray* vel_x, cudaArray* vel_y,
@@ -91,6 +98,13 @@ public:
     void SubtractGradient(cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z,
                           cudaArray* pressure, const glm::ivec3& volume_size);
 
+    // Reductions over the velocity field.
+    void ComputeMaxSpeed(float* max_speed, cudaArray* vel_x, cudaArray* vel_y,
+                         cudaArray* vel_z, const glm::ivec3& volume_size);
+    void FindActiveBricks(uint8_t* active_bricks, cudaArray* vel_x,
+                          cudaArray* vel_y, cudaArray* vel_z, float threshold,
+                          int brick_size, const glm::ivec3& volume_size);
+
     // Vorticity.
     void AddCurlPsi(cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z,
                     cudaArray* psi_x, cudaArray* psi_y, cudaArray* psi_z,
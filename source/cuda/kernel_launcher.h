@@ -40,7 +40,7 @@ namespace kern_launcher
 {
 extern void ClearVolume(cudaArray* dest_array, const float4& value, const uint3& volume_size, BlockArrangement* ba);
 extern void CopyToVbo(void* point_vbo, void* extra_vbo, uint16_t* pos_x, uint16_t* pos_y, uint16_t* pos_z, uint16_t* density, uint16_t* temperature, float crit_density, int* num_of_active_particles, int num_of_particles, BlockArrangement* ba);
-extern void Raycast(cudaArray* dest_array, cudaArray* density_array, const glm::mat4& inv_rotation, const glm::ivec2& surface_size, const glm::vec3& eye_pos, const glm::vec3& light_color, const glm::vec3& light_pos, float light_intensity, float focal_length, const glm::vec2& screen_size, int num_samples, int num_light_samples, float absorption, float density_factor, float occlusion_factor, const glm::vec3& volume_size);
+extern void Raycast(cudaArray* dest_array, cudaArray* density_array, const glm::mat4& inv_rotation, const glm::ivec2& surface_size, const glm::vec3& eye_pos, const glm::vec3& light_color, const glm::vec3& light_pos, float light_intensity, float focal_length, const glm::vec2& screen_size, int num_samples, int num_light_samples, float absorption, float density_factor, float occlusion_factor, const glm::vec3& domain_size, const glm::vec3& window_origin, const glm::vec3& window_size);
 
 extern void ApplyBuoyancy(cudaArray* vnp1_x, cudaArray* vnp1_y, cudaArray* vnp1_z, cudaArray* vn_x, cudaArray* vn_y, cudaArray* vn_z, cudaArray* temperature, cudaArray* density, float time_step, float ambient_temperature, float accel_factor, float gravity, bool staggered, uint3 volume_size, BlockArrangement* ba);
 extern void ComputeDivergence(cudaArray* div, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, float cell_size, bool outflow, bool staggered, uint3 volume_size, BlockArrangement* ba);
@@ -50,8 +50,11 @@ extern void ImpulseVelocity(cudaArray* vnp1_x, cudaArray* vnp1_y, cudaArray* vnp
 extern void Relax(cudaArray* unp1, cudaArray* un, cudaArray* b, bool outflow, int num_of_iterations, uint3 volume_size, BlockArrangement* ba);
 extern void RoundPassed(int* dest_array, int round, int x);
 extern void SubtractGradient(cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, cudaArray* pressure, float cell_size, bool staggered, uint3 volume_size, BlockArrangement* ba);
+extern void ComputeMaxSpeed(float* max_speed, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, uint3 volume_size, BlockArrangement* ba);
+extern void FindActiveBricks(uint8_t* active_bricks, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, float threshold, int brick_size, uint3 volume_size);
 
 extern void AdvectScalarField(cudaArray* fnp1, cudaArray* fn, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, cudaArray* aux, float cell_size, float time_step, float dissipation, AdvectionMethod method, uint3 volume_size, bool mid_point, BlockArrangement* ba);
+extern void AdvectScalarFields(cudaArray** fnp1, cudaArray** fn, cudaArray** aux, const float* dissipation, int num_of_fields, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, float cell_size, float time_step, AdvectionMethod method, uint3 volume_size, bool staggered, bool mid_point, BlockArrangement* ba);
 extern void AdvectScalarFieldStaggered(cudaArray* fnp1, cudaArray* fn, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, cudaArray* aux, float cell_size, float time_step, float dissipation, AdvectionMethod method, uint3 volume_size, bool mid_point, BlockArrangement* ba);
 extern void AdvectVectorField(cudaArray* fnp1_x, cudaArray* fnp1_y, cudaArray* fnp1_z, cudaArray* fn_x, cudaArray* fn_y, cudaArray* fn_z, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, cudaArray* aux, float cell_size, float time_step, float dissipation, AdvectionMethod method, uint3 volume_size, bool mid_point, BlockArrangement* ba);
 extern void AdvectVelocityStaggered(cudaArray* fnp1_x, cudaArray* fnp1_y, cudaArray* fnp1_z, cudaArray* fn_x, cudaArray* fn_y, cudaArray* fn_z, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, cudaArray* aux, float cell_size, float time_step, float dissipation, AdvectionMethod method, uint3 volume_size, bool mid_point, BlockArrangement* ba);
@@ -63,8 +66,12 @@ extern void ImpulseScalar(cudaArray* dest, cudaArray* original, float3 center_po
 extern void ComputeResidual(cudaArray* r, cudaArray* u, cudaArray* b, uint3 volume_size, BlockArrangement* ba);
 extern void Prolongate(cudaArray* fine, cudaArray* coarse, uint3 volume_size_fine, BlockArrangement* ba);
 extern void ProlongateError(cudaArray* fine, cudaArray* coarse, uint3 volume_size_fine, BlockArrangement* ba);
+extern void RelaxJacobi(cudaArray* unp1, cudaArray* un, cudaArray* b, float omega, bool outflow, uint3 volume_size, BlockArrangement* ba);
+extern void RelaxChebyshev(cudaArray* unp1, cudaArray* un, cudaArray* b, float momentum, float omega, bool outflow, uint3 volume_size, BlockArrangement* ba);
 extern void RelaxWithZeroGuess(cudaArray* u, cudaArray* b, uint3 volume_size, BlockArrangement* ba);
 extern void Restrict(cudaArray* coarse, cudaArray* fine, uint3 volume_size, BlockArrangement* ba);
+extern void ComputeResidualAndRestrict(cudaArray* coarse, cudaArray* u, cudaArray* b, uint3 volume_size, uint3 volume_size_fine, BlockArrangement* ba);
+extern void ProlongateErrorAndRelax(cudaArray* u, cudaArray* b, cudaArray* coarse, bool outflow, int num_of_iterations, uint3 volume_size, BlockArrangement* ba);
 
 // Conjugate gradient.
 extern void ApplyStencil(cudaArray* aux, cudaArray* search, bool outflow, uint3 volume_size, BlockArrangement* ba);
@@ -72,6 +79,12 @@ extern void ComputeAlpha(const MemPiece& alpha, const MemPiece& rho, cudaArray*
 extern void ComputeRho(const MemPiece& rho, cudaArray* search, cudaArray* residual, uint3 volume_size, BlockArrangement* ba, AuxBufferManager* bm);
 extern void ComputeRhoAndBeta(const MemPiece& beta, const MemPiece& rho_new, const MemPiece& rho, cudaArray* vec0, cudaArray* vec1, uint3 volume_size, BlockArrangement* ba, AuxBufferManager* bm);
 extern void ScaledAdd(cudaArray* dest, cudaArray* v0, cudaArray* v1, const MemPiece& coef, float sign, uint3 volume_size, BlockArrangement* ba);
+extern void ApplyStencilAndReduce(const MemPiece& alpha, const MemPiece& beta, const MemPiece& rho, cudaArray* aux, cudaArray* precond, cudaArray* residual, bool restart, bool outflow, uint3 volume_size, BlockArrangement* ba, AuxBufferManager* bm);
+extern void UpdateSearchAndVector(cudaArray* dest, cudaArray* search, cudaArray* v, const MemPiece& alpha, const MemPiece& beta, float sign, uint3 volume_size, BlockArrangement* ba);
+extern void Extrapolate(cudaArray* dest, cudaArray* v0, cudaArray* v1, float coef, uint3 volume_size, BlockArrangement* ba);
+
+// Mixed precision.
+extern void ConvertVolume(cudaArray* dest, cudaArray* v, float scale, bool accumulate, bool half_dest, uint3 volume_size, BlockArrangement* ba);
 
 // Vorticity.
 extern void AddCurlPsi(cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, cudaArray* psi_x, cudaArray* psi_y, cudaArray* psi_z, float cell_size, uint3 volume_size, BlockArrangement* ba);
@@ -86,7 +99,6 @@ extern void StretchVorticesStaggered(cudaArray* vnp1_x, cudaArray* vnp1_y, cudaA
 extern void AdvectFlipParticles(const FlipParticles& particles, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, float time_step, float cell_size, bool outflow, uint3 volume_size, BlockArrangement* ba);
 extern void AdvectParticles(uint16_t* pos_x, uint16_t* pos_y, uint16_t* pos_z, uint16_t* density, uint16_t* life, int num_of_particles, cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, float time_step, float cell_size, bool outflow, uint3 volume_size, BlockArrangement* ba);
 extern void BindParticlesToCells(const FlipParticles& particles, uint3 volume_size, BlockArrangement* ba);
-extern void BuildCellOffsets(uint* cell_offsets, const uint* cell_particles_counts, int num_of_cells, BlockArrangement* ba, AuxBufferManager* bm);
 extern void DiffuseAndDecay(const FlipParticles& particles, float time_step, float velocity_dissipation, float density_dissipation, float temperature_dissipation, BlockArrangement* ba);
 extern void EmitFlipParticles(const FlipParticles& particles, float3 center, float3 hotspot, float radius, float density, float temperature, float3 velocity, FluidImpulse impulse, uint random_seed, uint3 volume_size, BlockArrangement* ba);
 extern void EmitParticles(uint16_t* pos_x, uint16_t* pos_y, uint16_t* pos_z, uint16_t* density, uint16_t* life, int* tail, int num_of_particles, int num_to_emit, float3 location, float radius, float density_value, uint random_seed, BlockArrangement* ba);
@@ -95,6 +107,12 @@ extern void Resample(const FlipParticles& particles, cudaArray* vel_x, cudaArray
 extern void ResetParticles(const FlipParticles& particles, uint3 volume_size, BlockArrangement* ba);
 extern void SortParticles(FlipParticles particles, int* num_active_particles, FlipParticles aux, uint3 volume_size, BlockArrangement* ba);
 extern void TransferToGrid(cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z, cudaArray* density, cudaArray* temperature, const FlipParticles& particles, const FlipParticles& aux, uint3 volume_size, BlockArrangement* ba);
+
+// Scan.
+extern int Compact(uint* dest, const uint* flags, int num_of_elements, BlockArrangement* ba, AuxBufferManager* bm);
+extern void ExclusiveScan(uint* dest, const uint* source, int num_of_elements, BlockArrangement* ba, AuxBufferManager* bm);
+extern void InclusiveScan(uint* dest, const uint* source, int num_of_elements, BlockArrangement* ba, AuxBufferManager* bm);
+extern void SegmentedScan(uint* dest, const uint* source, const uint* heads, int num_of_elements, BlockArrangement* ba, AuxBufferManager* bm);
 }
 
 #endif // _KERNEL_LAUNCHER_H_
\ No newline at end of file
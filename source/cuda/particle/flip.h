@@ -38,6 +38,13 @@ struct FlipParticles
     uint16_t* velocity_z_;
     uint16_t* density_;
     uint16_t* temperature_;
+
+    // The affine velocity of APIC, present only when the host transfers in
+    // that mode.
+    // Row-major, |affine_[3 * i + j]| is the derivative of velocity
+    // component i along axis j, in cells.
+    uint16_t* affine_[9];
+
     int* num_of_actives_;
     int num_of_particles_;
 };
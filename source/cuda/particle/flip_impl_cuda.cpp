@@ -126,9 +126,9 @@ void FlipImplCuda::CompactParticles(FlipParticles* particles,
                                         ba_);
     observer_->OnCellBound();
 
-    kern_launcher::BuildCellOffsets(particles->particle_index_,
-                                    particles->particle_count_, num_of_cells,
-                                    ba_, bm_);
+    kern_launcher::ExclusiveScan(particles->particle_index_,
+                                 particles->particle_count_, num_of_cells, ba_,
+                                 bm_);
     observer_->OnPrefixSumCalculated();
 
     kern_launcher::SortParticles(*particles, num_active_particles, aux,
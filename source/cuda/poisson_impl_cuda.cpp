@@ -76,6 +76,23 @@ void PoissonImplCuda::ProlongateError(cudaArray* fine, cudaArray* coarse,
                                    ba_);
 }
 
+void PoissonImplCuda::RelaxJacobi(cudaArray* unp1, cudaArray* un,
+                                  cudaArray* b, float omega,
+                                  const glm::ivec3& volume_size)
+{
+    kern_launcher::RelaxJacobi(unp1, un, b, omega, outflow_,
+                               FromGlmVector(volume_size), ba_);
+}
+
+void PoissonImplCuda::RelaxChebyshev(cudaArray* unp1, cudaArray* un,
+                                     cudaArray* b, float momentum,
+                                     float omega,
+                                     const glm::ivec3& volume_size)
+{
+    kern_launcher::RelaxChebyshev(unp1, un, b, momentum, omega, outflow_,
+                                  FromGlmVector(volume_size), ba_);
+}
+
 void PoissonImplCuda::RelaxWithZeroGuess(cudaArray* u, cudaArray* b,
                                          const glm::ivec3& volume_size)
 {
@@ -88,6 +105,31 @@ void PoissonImplCuda::Restrict(cudaArray* coarse, cudaArray* fine,
     kern_launcher::Restrict(coarse, fine, FromGlmVector(volume_size), ba_);
 }
 
+void PoissonImplCuda::ComputeResidualAndRestrict(
+    cudaArray* coarse, cudaArray* u, cudaArray* b,
+    const glm::ivec3& volume_size, const glm::ivec3& volume_size_fine)
+{
+    kern_launcher::ComputeResidualAndRestrict(coarse, u, b,
+                                              FromGlmVector(volume_size),
+                                              FromGlmVector(volume_size_fine),
+                                              ba_);
+}
+
+void PoissonImplCuda::ProlongateErrorAndRelax(cudaArray* u, cudaArray* b,
+                                              cudaArray* coarse,
+                                              int num_of_iterations,
+                                              const glm::ivec3& volume_size)
+{
+    if (num_of_iterations <= 0) {
+        ProlongateError(u, coarse, volume_size);
+        return;
+    }
+
+    kern_launcher::ProlongateErrorAndRelax(u, b, coarse, outflow_,
+                                           num_of_iterations,
+                                           FromGlmVector(volume_size), ba_);
+}
+
 void PoissonImplCuda::ApplyStencil(cudaArray* aux, cudaArray* search,
                                    const glm::ivec3& volume_size)
 {
@@ -128,3 +170,41 @@ void PoissonImplCuda::ScaledAdd(cudaArray* dest, cudaArray* v0, cudaArray* v1,
     kern_launcher::ScaledAdd(dest, v0, v1, coef, sign,
                              FromGlmVector(volume_size), ba_);
 }
+
+void PoissonImplCuda::ApplyStencilAndReduce(const MemPiece& alpha,
+                                            const MemPiece& beta,
+                                            const MemPiece& rho,
+                                            cudaArray* aux, cudaArray* precond,
+                                            cudaArray* residual, bool restart,
+                                            const glm::ivec3& volume_size)
+{
+    kern_launcher::ApplyStencilAndReduce(alpha, beta, rho, aux, precond,
+                                         residual, restart, outflow_,
+                                         FromGlmVector(volume_size), ba_, bm_);
+}
+
+void PoissonImplCuda::UpdateSearchAndVector(cudaArray* dest,
+                                            cudaArray* search, cudaArray* v,
+                                            const MemPiece& alpha,
+                                            const MemPiece& beta, float sign,
+                                            const glm::ivec3& volume_size)
+{
+    kern_launcher::UpdateSearchAndVector(dest, search, v, alpha, beta, sign,
+                                         FromGlmVector(volume_size), ba_);
+}
+
+void PoissonImplCuda::Extrapolate(cudaArray* dest, cudaArray* v0,
+                                  cudaArray* v1, float coef,
+                                  const glm::ivec3& volume_size)
+{
+    kern_launcher::Extrapolate(dest, v0, v1, coef, FromGlmVector(volume_size),
+                               ba_);
+}
+
+void PoissonImplCuda::ConvertVolume(cudaArray* dest, cudaArray* v, float scale,
+                                    bool accumulate, bool half_dest,
+                                    const glm::ivec3& volume_size)
+{
+    kern_launcher::ConvertVolume(dest, v, scale, accumulate, half_dest,
+                                 FromGlmVector(volume_size), ba_);
+}
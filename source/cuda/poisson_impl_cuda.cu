@@ -131,6 +131,61 @@ __global__ void RestrictLerpKernel(uint3 volume_size)
     t3d.Store(v, surf, x, y, z);
 }
 
+template <typename StorageType>
+__device__ typename Tex3d<StorageType>::ValType FineResidual(float x, float y,
+                                                             float z)
+{
+    using FPType = typename Tex3d<StorageType>::ValType;
+
+    Tex3d<StorageType> t3d;
+    FPType near   = t3d(TexSel<StorageType>::Tex(tex, texf, texd),       x,        y,        z - 1.0f);
+    FPType south  = t3d(TexSel<StorageType>::Tex(tex, texf, texd),       x,        y - 1.0f, z);
+    FPType west   = t3d(TexSel<StorageType>::Tex(tex, texf, texd),       x - 1.0f, y,        z);
+    FPType center = t3d(TexSel<StorageType>::Tex(tex, texf, texd),       x,        y,        z);
+    FPType east   = t3d(TexSel<StorageType>::Tex(tex, texf, texd),       x + 1.0f, y,        z);
+    FPType north  = t3d(TexSel<StorageType>::Tex(tex, texf, texd),       x,        y + 1.0f, z);
+    FPType far    = t3d(TexSel<StorageType>::Tex(tex, texf, texd),       x,        y,        z + 1.0f);
+    FPType b      = t3d(TexSel<StorageType>::Tex(tex_b, texf_b, texd_b), x,        y,        z);
+
+    return b - (north + south + east + west + far + near - 6.0f * center);
+}
+
+// The residual of the 8 fine cells is summed up in registers, instead of
+// being stored and then read back with linear filtering.
+template <typename StorageType>
+__global__ void ComputeResidualAndRestrictKernel(uint3 volume_size,
+                                                 uint3 volume_size_fine)
+{
+    using FPType = typename Tex3d<StorageType>::ValType;
+
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    float fx0 = 2 * x;
+    float fy0 = 2 * y;
+    float fz0 = 2 * z;
+    float fx1 = min(2 * x + 1, static_cast<int>(volume_size_fine.x) - 1);
+    float fy1 = min(2 * y + 1, static_cast<int>(volume_size_fine.y) - 1);
+    float fz1 = min(2 * z + 1, static_cast<int>(volume_size_fine.z) - 1);
+
+    FPType v =
+        FineResidual<StorageType>(fx0, fy0, fz0) +
+        FineResidual<StorageType>(fx1, fy0, fz0) +
+        FineResidual<StorageType>(fx0, fy1, fz0) +
+        FineResidual<StorageType>(fx1, fy1, fz0) +
+        FineResidual<StorageType>(fx0, fy0, fz1) +
+        FineResidual<StorageType>(fx1, fy0, fz1) +
+        FineResidual<StorageType>(fx0, fy1, fz1) +
+        FineResidual<StorageType>(fx1, fy1, fz1);
+
+    Tex3d<StorageType> t3d;
+    t3d.Store(v * 0.5f, surf, x, y, z);
+}
+
 // =============================================================================
 
 DECLARE_KERNEL_META(
@@ -153,6 +208,12 @@ DECLARE_KERNEL_META(
     MAKE_INVOKE_DECLARATION(const uint3& volume_size),
     volume_size);
 
+DECLARE_KERNEL_META(
+    ComputeResidualAndRestrictKernel,
+    MAKE_INVOKE_DECLARATION(const uint3& volume_size,
+                            const uint3& volume_size_fine),
+    volume_size, volume_size_fine);
+
 // =============================================================================
 namespace kern_launcher
 {
@@ -242,4 +303,31 @@ void Restrict(cudaArray* coarse, cudaArray* fine, uint3 volume_size,
     InvokeKernel<RestrictLerpKernelMeta>(bound, grid, block, volume_size);
     DCHECK_KERNEL();
 }
+
+void ComputeResidualAndRestrict(cudaArray* coarse, cudaArray* u, cudaArray* b,
+                                uint3 volume_size, uint3 volume_size_fine,
+                                BlockArrangement* ba)
+{
+    if (BindCudaSurfaceToArray(&surf, coarse) != cudaSuccess)
+        return;
+
+    auto bound_u = SelectiveBind(u, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex, &texf, &texd);
+    if (!bound_u.Succeeded())
+        return;
+
+    auto bound_b = SelectiveBind(b, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_b, &texf_b,
+                                 &texd_b);
+    if (!bound_b.Succeeded())
+        return;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangePrefer3dLocality(&grid, &block, volume_size);
+    InvokeKernel<ComputeResidualAndRestrictKernelMeta>(bound_u, grid, block,
+                                                       volume_size,
+                                                       volume_size_fine);
+    DCHECK_KERNEL();
+}
 }
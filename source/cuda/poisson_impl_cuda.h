@@ -45,10 +45,22 @@ public:
                     const glm::ivec3& volume_size);
     void ProlongateError(cudaArray* fine, cudaArray* coarse,
                          const glm::ivec3& volume_size);
+    void RelaxJacobi(cudaArray* unp1, cudaArray* un, cudaArray* b, float omega,
+                     const glm::ivec3& volume_size);
+    void RelaxChebyshev(cudaArray* unp1, cudaArray* un, cudaArray* b,
+                        float momentum, float omega,
+                        const glm::ivec3& volume_size);
     void RelaxWithZeroGuess(cudaArray* u, cudaArray* b,
                             const glm::ivec3& volume_size);
     void Restrict(cudaArray* coarse, cudaArray* fine,
                   const glm::ivec3& volume_size);
+    void ComputeResidualAndRestrict(cudaArray* coarse, cudaArray* u,
+                                    cudaArray* b,
+                                    const glm::ivec3& volume_size,
+                                    const glm::ivec3& volume_size_fine);
+    void ProlongateErrorAndRelax(cudaArray* u, cudaArray* b,
+                                 cudaArray* coarse, int num_of_iterations,
+                                 const glm::ivec3& volume_size);
 
     // Conjugate gradient.
     void ApplyStencil(cudaArray* aux, cudaArray* search,
@@ -65,6 +77,25 @@ public:
                    const MemPiece& coef, float sign,
                    const glm::ivec3& volume_size);
 
+    // Pipelined conjugate gradient.
+    void ApplyStencilAndReduce(const MemPiece& alpha, const MemPiece& beta,
+                               const MemPiece& rho, cudaArray* aux,
+                               cudaArray* precond, cudaArray* residual,
+                               bool restart, const glm::ivec3& volume_size);
+    void UpdateSearchAndVector(cudaArray* dest, cudaArray* search,
+                               cudaArray* v, const MemPiece& alpha,
+                               const MemPiece& beta, float sign,
+                               const glm::ivec3& volume_size);
+
+    // Initial guess.
+    void Extrapolate(cudaArray* dest, cudaArray* v0, cudaArray* v1, float coef,
+                     const glm::ivec3& volume_size);
+
+    // Mixed precision.
+    void ConvertVolume(cudaArray* dest, cudaArray* v, float scale,
+                       bool accumulate, bool half_dest,
+                       const glm::ivec3& volume_size);
+
     void set_cell_size(float cell_size) { cell_size_ = cell_size; }
     void set_outflow(bool outflow) { outflow_ = outflow; }
 
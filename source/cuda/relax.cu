@@ -39,6 +39,9 @@ texture<float, cudaTextureType3D, cudaReadModeElementType> texf_u;
 texture<float, cudaTextureType3D, cudaReadModeElementType> texf_b;
 texture<long2, cudaTextureType3D, cudaReadModeElementType> texd_u;
 texture<long2, cudaTextureType3D, cudaReadModeElementType> texd_b;
+texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_p;
+texture<float, cudaTextureType3D, cudaReadModeElementType> texf_p;
+texture<long2, cudaTextureType3D, cudaReadModeElementType> texd_p;
 
 const float kBeta  = 6.0f;
 
@@ -125,6 +128,44 @@ __global__ void DampedJacobiKernel(float omega, uint3 volume_size,
     t3d.Store(u, surf, x, y, z);
 }
 
+// The surface is bound to the same volume as |tex_p|, which is fine as every
+// thread reads its own cell only.
+template <typename StorageType, typename UpperBoundaryHandler>
+__global__ void ChebyshevKernel(float momentum, float omega, uint3 volume_size,
+                                UpperBoundaryHandler handler)
+{
+    using FPType = typename Tex3d<StorageType>::ValType;
+
+    uint x = VolumeX();
+    uint y = VolumeY();
+    uint z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    Tex3d<StorageType> t3d;
+    FPType near =   t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z - 1.0f);
+    FPType south =  t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y - 1.0f, z);
+    FPType west =   t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x - 1.0f, y,        z);
+    FPType center = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z);
+    FPType east =   t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x + 1.0f, y,        z);
+    FPType north =  t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y + 1.0f, z);
+    FPType far =    t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z + 1.0f);
+    FPType b =      t3d(TexSel<StorageType>::Tex(tex_b, texf_b, texd_b), x,        y,        z);
+    FPType prev =   t3d(TexSel<StorageType>::Tex(tex_p, texf_p, texd_p), x,        y,        z);
+
+    handler.HandleUpperBoundary(&north, center, y, volume_size.y);
+
+    FPType beta = 6.0f;
+    ModifyBoundaryCoef(&beta, x, y, z, volume_size);
+
+    FPType correction =
+        (west + east + south + north + far + near - b) / beta - center;
+    FPType u = center + momentum * (center - prev) + omega * correction;
+
+    t3d.Store(u, surf, x, y, z);
+}
+
 __device__ void ReadBlockAndHalo_32x6(int z, uint tx, uint ty, float2* smem)
 {
     uint linear_index = ty * blockDim.x + tx;
@@ -597,6 +638,99 @@ __global__ void RelaxRedBlackGaussSeidelKernel(uint3 volume_size, uint offset,
     t3d.Store(u, surf, x, y, z);
 }
 
+// Interpolates the error of the coarse level at fine cell (x, y, z), which
+// is zero outside the volume, the same as the border of |tex_u|.
+template <typename StorageType>
+__device__ typename Tex3d<StorageType>::ValType CoarseError(
+    int x, int y, int z, const uint3& volume_size)
+{
+    if (x < 0 || y < 0 || z < 0 || x >= volume_size.x ||
+            y >= volume_size.y || z >= volume_size.z)
+        return 0.0f;
+
+    float3 coord = (make_float3(x, y, z) + 0.5f) * 0.5f;
+
+    Tex3d<StorageType> t3d;
+    return t3d(TexSel<StorageType>::Tex(tex_p, texf_p, texd_p), coord.x,
+               coord.y, coord.z);
+}
+
+// The first color of the first iteration after the prolongation. None of the
+// cells is corrected yet, so the coarse error is added to every cell read.
+template <typename StorageType, typename UpperBoundaryHandler>
+__global__ void ProlongateAndRelaxFirstColorKernel(uint3 volume_size,
+                                                   UpperBoundaryHandler handler)
+{
+    using FPType = typename Tex3d<StorageType>::ValType;
+
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    x = (x << 1) + ((y + z) & 0x1);
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    Tex3d<StorageType> t3d;
+    FPType near   = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z - 1.0f) + CoarseError<StorageType>(x,     y,     z - 1, volume_size);
+    FPType south  = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y - 1.0f, z)        + CoarseError<StorageType>(x,     y - 1, z,     volume_size);
+    FPType west   = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x - 1.0f, y,        z)        + CoarseError<StorageType>(x - 1, y,     z,     volume_size);
+    FPType center = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z)        + CoarseError<StorageType>(x,     y,     z,     volume_size);
+    FPType east   = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x + 1.0f, y,        z)        + CoarseError<StorageType>(x + 1, y,     z,     volume_size);
+    FPType north  = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y + 1.0f, z)        + CoarseError<StorageType>(x,     y + 1, z,     volume_size);
+    FPType far    = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z + 1.0f) + CoarseError<StorageType>(x,     y,     z + 1, volume_size);
+    FPType b      = t3d(TexSel<StorageType>::Tex(tex_b, texf_b, texd_b), x,        y,        z);
+
+    handler.HandleUpperBoundary(&north, center, y, volume_size.y);
+
+    FPType beta = 6.0f;
+    ModifyBoundaryCoef(&beta, x, y, z, volume_size);
+
+    FPType u = -0.3f * center +
+        (west + east + south + north + far + near - b) * 1.3f / beta;
+
+    t3d.Store(u, surf, x, y, z);
+}
+
+// The second color reads the neighbors relaxed by the first one, and only the
+// center cell takes the coarse error.
+template <typename StorageType, typename UpperBoundaryHandler>
+__global__ void ProlongateAndRelaxSecondColorKernel(
+    uint3 volume_size, UpperBoundaryHandler handler)
+{
+    using FPType = typename Tex3d<StorageType>::ValType;
+
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    x = (x << 1) + ((1 + y + z) & 0x1);
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    Tex3d<StorageType> t3d;
+    FPType near   = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z - 1.0f);
+    FPType south  = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y - 1.0f, z);
+    FPType west   = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x - 1.0f, y,        z);
+    FPType center = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z) + CoarseError<StorageType>(x, y, z, volume_size);
+    FPType east   = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x + 1.0f, y,        z);
+    FPType north  = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y + 1.0f, z);
+    FPType far    = t3d(TexSel<StorageType>::Tex(tex_u, texf_u, texd_u), x,        y,        z + 1.0f);
+    FPType b      = t3d(TexSel<StorageType>::Tex(tex_b, texf_b, texd_b), x,        y,        z);
+
+    handler.HandleUpperBoundary(&north, center, y, volume_size.y);
+
+    FPType beta = 6.0f;
+    ModifyBoundaryCoef(&beta, x, y, z, volume_size);
+
+    FPType u = -0.3f * center +
+        (west + east + south + north + far + near - b) * 1.3f / beta;
+
+    t3d.Store(u, surf, x, y, z);
+}
+
 template <typename StorageType>
 __global__ void RelaxWithZeroGuessKernel(float omega, float coef,
                                          float omega_over_beta,
@@ -676,6 +810,48 @@ struct DampedJacobiKernelMeta
     }
 };
 
+template <typename StorageType>
+struct ChebyshevKernelMeta
+{
+    static void Invoke(const dim3& grid, const dim3& block, float momentum,
+                       float omega, const uint3& volume_size, bool outflow)
+    {
+        using FPType = typename Tex3d<StorageType>::ValType;
+        UpperBoundaryHandlerOutflow<FPType> outflow_handler;
+        UpperBoundaryHandlerNeumann<FPType> neumann_handler;
+        if (outflow)
+            ChebyshevKernel<StorageType><<<grid, block>>>(
+                momentum, omega, volume_size, outflow_handler);
+        else
+            ChebyshevKernel<StorageType><<<grid, block>>>(
+                momentum, omega, volume_size, neumann_handler);
+    }
+};
+
+template <typename StorageType>
+struct ProlongateAndRelaxKernelMeta
+{
+    static void Invoke(const dim3& grid, const dim3& block,
+                       const uint3& volume_size, uint color, bool outflow)
+    {
+        using FPType = typename Tex3d<StorageType>::ValType;
+        UpperBoundaryHandlerOutflow<FPType> outflow_handler;
+        UpperBoundaryHandlerNeumann<FPType> neumann_handler;
+        if (color && outflow)
+            ProlongateAndRelaxSecondColorKernel<StorageType><<<grid, block>>>(
+                volume_size, outflow_handler);
+        else if (color)
+            ProlongateAndRelaxSecondColorKernel<StorageType><<<grid, block>>>(
+                volume_size, neumann_handler);
+        else if (outflow)
+            ProlongateAndRelaxFirstColorKernel<StorageType><<<grid, block>>>(
+                volume_size, outflow_handler);
+        else
+            ProlongateAndRelaxFirstColorKernel<StorageType><<<grid, block>>>(
+                volume_size, neumann_handler);
+    }
+};
+
 DECLARE_KERNEL_META(
     RelaxWithZeroGuessKernel,
     MAKE_INVOKE_DECLARATION(float omega, float coef, float omega_over_beta,
@@ -764,8 +940,9 @@ void RelaxRedBlackGaussSeidel(cudaArray* unp1, cudaArray* un, cudaArray* b,
     if (!bound_b.Succeeded())
         return;
 
+    // An odd row holds one more cell of one of the colors.
     uint3 half_size = volume_size;
-    half_size.x /= 2;
+    half_size.x = (volume_size.x + 1) / 2;
     dim3 grid;
     dim3 block;
     ba->ArrangePrefer3dLocality(&grid, &block, half_size);
@@ -795,6 +972,65 @@ void Relax(cudaArray* unp1, cudaArray* un, cudaArray* b, bool outflow,
                                  volume_size, ba);
 }
 
+void RelaxJacobi(cudaArray* unp1, cudaArray* un, cudaArray* b, float omega,
+                 bool outflow, uint3 volume_size, BlockArrangement* ba)
+{
+    if (BindCudaSurfaceToArray(&surf, unp1) != cudaSuccess)
+        return;
+
+    auto bound_u = SelectiveBind(un, false, cudaFilterModePoint,
+                                 cudaAddressModeBorder, &tex_u, &texf_u,
+                                 &texd_u);
+    if (!bound_u.Succeeded())
+        return;
+
+    auto bound_b = SelectiveBind(b, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_b, &texf_b,
+                                 &texd_b);
+    if (!bound_b.Succeeded())
+        return;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangeRowScan(&grid, &block, volume_size);
+    InvokeKernel<DampedJacobiKernelMeta>(bound_u, grid, block, omega,
+                                         volume_size, outflow);
+    DCHECK_KERNEL();
+}
+
+void RelaxChebyshev(cudaArray* unp1, cudaArray* un, cudaArray* b,
+                    float momentum, float omega, bool outflow,
+                    uint3 volume_size, BlockArrangement* ba)
+{
+    if (BindCudaSurfaceToArray(&surf, unp1) != cudaSuccess)
+        return;
+
+    auto bound_u = SelectiveBind(un, false, cudaFilterModePoint,
+                                 cudaAddressModeBorder, &tex_u, &texf_u,
+                                 &texd_u);
+    if (!bound_u.Succeeded())
+        return;
+
+    auto bound_b = SelectiveBind(b, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_b, &texf_b,
+                                 &texd_b);
+    if (!bound_b.Succeeded())
+        return;
+
+    auto bound_p = SelectiveBind(unp1, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_p, &texf_p,
+                                 &texd_p);
+    if (!bound_p.Succeeded())
+        return;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangeRowScan(&grid, &block, volume_size);
+    InvokeKernel<ChebyshevKernelMeta>(bound_u, grid, block, momentum, omega,
+                                      volume_size, outflow);
+    DCHECK_KERNEL();
+}
+
 void RelaxWithZeroGuess(cudaArray* u, cudaArray* b, uint3 volume_size,
                         BlockArrangement* ba)
 {
@@ -818,4 +1054,47 @@ void RelaxWithZeroGuess(cudaArray* u, cudaArray* b, uint3 volume_size,
                                                omega_over_beta, volume_size);
     DCHECK_KERNEL();
 }
+
+void ProlongateErrorAndRelax(cudaArray* u, cudaArray* b, cudaArray* coarse,
+                             bool outflow, int num_of_iterations,
+                             uint3 volume_size, BlockArrangement* ba)
+{
+    if (BindCudaSurfaceToArray(&surf, u) != cudaSuccess)
+        return;
+
+    auto bound_u = SelectiveBind(u, false, cudaFilterModePoint,
+                                 cudaAddressModeBorder, &tex_u, &texf_u,
+                                 &texd_u);
+    if (!bound_u.Succeeded())
+        return;
+
+    auto bound_b = SelectiveBind(b, false, cudaFilterModePoint,
+                                 cudaAddressModeClamp, &tex_b, &texf_b,
+                                 &texd_b);
+    if (!bound_b.Succeeded())
+        return;
+
+    auto bound_p = SelectiveBind(coarse, false, cudaFilterModeLinear,
+                                 cudaAddressModeClamp, &tex_p, &texf_p,
+                                 &texd_p);
+    if (!bound_p.Succeeded())
+        return;
+
+    // An odd row holds one more cell of one of the colors.
+    uint3 half_size = volume_size;
+    half_size.x = (volume_size.x + 1) / 2;
+    dim3 grid;
+    dim3 block;
+    ba->ArrangePrefer3dLocality(&grid, &block, half_size);
+
+    // The first iteration does the prolongation as well.
+    InvokeKernel<ProlongateAndRelaxKernelMeta>(bound_u, grid, block,
+                                               volume_size, 0, outflow);
+    InvokeKernel<ProlongateAndRelaxKernelMeta>(bound_u, grid, block,
+                                               volume_size, 1, outflow);
+    DCHECK_KERNEL();
+
+    RelaxRedBlackGaussSeidel(u, u, b, outflow, num_of_iterations - 1,
+                             volume_size, ba);
+}
 }
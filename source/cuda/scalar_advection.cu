@@ -0,0 +1,480 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include <algorithm>
+#include <cassert>
+
+#include "third_party/opengl/glew.h"
+
+#include <helper_math.h>
+
+#include "cuda/advection_method.h"
+#include "cuda/block_arrangement.h"
+#include "cuda/cuda_common_host.h"
+#include "cuda/cuda_common_kern.h"
+#include "cuda/cuda_debug.h"
+
+// The scalar fields are advected in pairs. Each thread traces its departure
+// point once and samples both fields there, so the velocity is read and the
+// trace is computed half as often as advecting the fields one by one.
+surface<void, cudaSurfaceType3D> surf_0;
+surface<void, cudaSurfaceType3D> surf_1;
+texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_0;
+texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_1;
+texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_aux_0;
+texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_aux_1;
+texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_vx;
+texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_vy;
+texture<ushort, cudaTextureType3D, cudaReadModeNormalizedFloat> tex_vz;
+
+const int kMaxNumOfFusedFields = 2;
+
+template <int N>
+__device__ inline float SampleField(float3 pos)
+{
+    return tex3D(tex_0, pos.x, pos.y, pos.z);
+}
+
+template <>
+__device__ inline float SampleField<1>(float3 pos)
+{
+    return tex3D(tex_1, pos.x, pos.y, pos.z);
+}
+
+template <int N>
+__device__ inline float SampleAux(float3 pos)
+{
+    return tex3D(tex_aux_0, pos.x, pos.y, pos.z);
+}
+
+template <>
+__device__ inline float SampleAux<1>(float3 pos)
+{
+    return tex3D(tex_aux_1, pos.x, pos.y, pos.z);
+}
+
+template <int N>
+__device__ inline void WriteField(float phi, int x, int y, int z)
+{
+    auto r = __float2half_rn(phi);
+    surf3Dwrite(r, surf_0, x * sizeof(r), y, z, cudaBoundaryModeTrap);
+}
+
+template <>
+__device__ inline void WriteField<1>(float phi, int x, int y, int z)
+{
+    auto r = __float2half_rn(phi);
+    surf3Dwrite(r, surf_1, x * sizeof(r), y, z, cudaBoundaryModeTrap);
+}
+
+template <bool Staggered>
+__device__ inline float3 GetVelocity(float3 pos)
+{
+    float v_x = tex3D(tex_vx, pos.x, pos.y, pos.z);
+    float v_y = tex3D(tex_vy, pos.x, pos.y, pos.z);
+    float v_z = tex3D(tex_vz, pos.x, pos.y, pos.z);
+    return make_float3(v_x, v_y, v_z);
+}
+
+template <>
+__device__ inline float3 GetVelocity<true>(float3 pos)
+{
+    float v_x = tex3D(tex_vx, pos.x + 0.5f, pos.y,        pos.z       );
+    float v_y = tex3D(tex_vy, pos.x,        pos.y + 0.5f, pos.z       );
+    float v_z = tex3D(tex_vz, pos.x,        pos.y,        pos.z + 0.5f);
+    return make_float3(v_x, v_y, v_z);
+}
+
+template <bool Staggered, bool MidPoint>
+__device__ inline float3 Trace(float3 vel, float3 pos,
+                               float time_step_over_cell_size)
+{
+    if (MidPoint) {
+        float3 mid_point = pos - vel * 0.5f * time_step_over_cell_size;
+        vel = GetVelocity<Staggered>(mid_point);
+    }
+
+    return pos - vel * time_step_over_cell_size;
+}
+
+template <int N>
+__device__ inline float ClampToNeighborhood(float phi_new, float phi_fallback,
+                                            float3 back_traced)
+{
+    float phi0 = SampleField<N>(back_traced + make_float3(-0.5f, -0.5f, -0.5f));
+    float phi1 = SampleField<N>(back_traced + make_float3(-0.5f, -0.5f,  0.5f));
+    float phi2 = SampleField<N>(back_traced + make_float3(-0.5f,  0.5f, -0.5f));
+    float phi3 = SampleField<N>(back_traced + make_float3(-0.5f,  0.5f,  0.5f));
+    float phi4 = SampleField<N>(back_traced + make_float3( 0.5f, -0.5f, -0.5f));
+    float phi5 = SampleField<N>(back_traced + make_float3( 0.5f, -0.5f,  0.5f));
+    float phi6 = SampleField<N>(back_traced + make_float3( 0.5f,  0.5f, -0.5f));
+    float phi7 = SampleField<N>(back_traced + make_float3( 0.5f,  0.5f,  0.5f));
+
+    float phi_min = fminf(fminf(fminf(phi0, phi1), fminf(phi2, phi3)),
+                          fminf(fminf(phi4, phi5), fminf(phi6, phi7)));
+    float phi_max = fmaxf(fmaxf(fmaxf(phi0, phi1), fmaxf(phi2, phi3)),
+                          fmaxf(fmaxf(phi4, phi5), fmaxf(phi6, phi7)));
+
+    // New extrema found, revert to the first order accurate result.
+    float clamped = fmaxf(fminf(phi_new, phi_max), phi_min);
+    return clamped != phi_new ? phi_fallback : phi_new;
+}
+
+template <int N>
+__device__ inline float BfeccField(float3 back_traced)
+{
+    return ClampToNeighborhood<N>(SampleAux<N>(back_traced),
+                                  SampleField<N>(back_traced), back_traced);
+}
+
+template <int N>
+__device__ inline float MacCormackField(float3 coord, float3 back_traced,
+                                        float3 forward_trace)
+{
+    float phi_n = SampleField<N>(coord);
+    float phi_np1_hat = SampleAux<N>(coord);
+    float phi_n_hat = SampleAux<N>(forward_trace);
+    float phi_new = phi_np1_hat + 0.5f * (phi_n - phi_n_hat);
+    return ClampToNeighborhood<N>(phi_new, phi_np1_hat, back_traced);
+}
+
+template <bool Staggered, bool MidPoint, int NumOfFields>
+__global__ void AdvectFieldsBfeccKernel(float time_step_over_cell_size,
+                                        float dissipation_0,
+                                        float dissipation_1, uint3 volume_size)
+{
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    float3 coord = make_float3(x, y, z) + 0.5f;
+    float3 vel = GetVelocity<Staggered>(coord);
+    float3 back_traced = Trace<Staggered, MidPoint>(vel, coord,
+                                                    time_step_over_cell_size);
+
+    WriteField<0>(dissipation_0 * BfeccField<0>(back_traced), x, y, z);
+    if (NumOfFields > 1)
+        WriteField<1>(dissipation_1 * BfeccField<1>(back_traced), x, y, z);
+}
+
+template <bool Staggered, bool MidPoint, int NumOfFields>
+__global__ void AdvectFieldsMacCormackKernel(float time_step_over_cell_size,
+                                             float dissipation_0,
+                                             float dissipation_1,
+                                             uint3 volume_size)
+{
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    float3 coord = make_float3(x, y, z) + 0.5f;
+    float3 vel = GetVelocity<Staggered>(coord);
+    float3 back_traced = Trace<Staggered, MidPoint>(vel, coord,
+                                                    time_step_over_cell_size);
+    float3 forward_trace = Trace<Staggered, MidPoint>(
+        vel, coord, -time_step_over_cell_size);
+
+    float phi_0 = MacCormackField<0>(coord, back_traced, forward_trace);
+    WriteField<0>(dissipation_0 * phi_0, x, y, z);
+    if (NumOfFields > 1) {
+        float phi_1 = MacCormackField<1>(coord, back_traced, forward_trace);
+        WriteField<1>(dissipation_1 * phi_1, x, y, z);
+    }
+}
+
+template <bool Staggered, bool MidPoint, int NumOfFields>
+__global__ void AdvectFieldsSemiLagrangianKernel(
+    float time_step_over_cell_size, float dissipation_0, float dissipation_1,
+    uint3 volume_size)
+{
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    float3 coord = make_float3(x, y, z) + 0.5f;
+    float3 vel = GetVelocity<Staggered>(coord);
+    float3 back_traced = Trace<Staggered, MidPoint>(vel, coord,
+                                                    time_step_over_cell_size);
+
+    WriteField<0>(dissipation_0 * SampleField<0>(back_traced), x, y, z);
+    if (NumOfFields > 1)
+        WriteField<1>(dissipation_1 * SampleField<1>(back_traced), x, y, z);
+}
+
+template <bool Staggered, bool MidPoint, int NumOfFields>
+__global__ void BfeccRemoveErrorKernel(float time_step_over_cell_size,
+                                       uint3 volume_size)
+{
+    int x = VolumeX();
+    int y = VolumeY();
+    int z = VolumeZ();
+
+    if (x >= volume_size.x || y >= volume_size.y || z >= volume_size.z)
+        return;
+
+    float3 coord = make_float3(x, y, z) + 0.5f;
+    float3 vel = GetVelocity<Staggered>(coord);
+    float3 forward_trace = Trace<Staggered, MidPoint>(
+        vel, coord, -time_step_over_cell_size);
+
+    float r_0 = SampleAux<0>(forward_trace);
+    WriteField<0>(0.5f * (3.0f * SampleField<0>(coord) - r_0), x, y, z);
+    if (NumOfFields > 1) {
+        float r_1 = SampleAux<1>(forward_trace);
+        WriteField<1>(0.5f * (3.0f * SampleField<1>(coord) - r_1), x, y, z);
+    }
+}
+
+// =============================================================================
+
+enum FusedAdvectionPass
+{
+    PASS_SEMI_LAGRANGIAN,
+    PASS_BFECC_REMOVE_ERROR,
+    PASS_BFECC,
+    PASS_MACCORMACK,
+};
+
+template <bool Staggered, bool MidPoint, int NumOfFields>
+void LaunchPass(FusedAdvectionPass pass, const dim3& grid, const dim3& block,
+                float time_step_over_cell_size, const float* dissipation,
+                uint3 volume_size)
+{
+    float d_0 = dissipation[0];
+    float d_1 = NumOfFields > 1 ? dissipation[1] : 1.0f;
+    switch (pass) {
+        case PASS_SEMI_LAGRANGIAN:
+            AdvectFieldsSemiLagrangianKernel<Staggered, MidPoint, NumOfFields>
+                <<<grid, block>>>(time_step_over_cell_size, d_0, d_1,
+                                  volume_size);
+            break;
+        case PASS_BFECC_REMOVE_ERROR:
+            BfeccRemoveErrorKernel<Staggered, MidPoint, NumOfFields>
+                <<<grid, block>>>(time_step_over_cell_size, volume_size);
+            break;
+        case PASS_BFECC:
+            AdvectFieldsBfeccKernel<Staggered, MidPoint, NumOfFields>
+                <<<grid, block>>>(time_step_over_cell_size, d_0, d_1,
+                                  volume_size);
+            break;
+        case PASS_MACCORMACK:
+            AdvectFieldsMacCormackKernel<Staggered, MidPoint, NumOfFields>
+                <<<grid, block>>>(time_step_over_cell_size, d_0, d_1,
+                                  volume_size);
+            break;
+    }
+}
+
+template <bool Staggered, bool MidPoint>
+void LaunchPass(FusedAdvectionPass pass, int num_of_fields, const dim3& grid,
+                const dim3& block, float time_step_over_cell_size,
+                const float* dissipation, uint3 volume_size)
+{
+    if (num_of_fields > 1)
+        LaunchPass<Staggered, MidPoint, 2>(pass, grid, block,
+                                           time_step_over_cell_size,
+                                           dissipation, volume_size);
+    else
+        LaunchPass<Staggered, MidPoint, 1>(pass, grid, block,
+                                           time_step_over_cell_size,
+                                           dissipation, volume_size);
+}
+
+void LaunchPass(FusedAdvectionPass pass, int num_of_fields, const dim3& grid,
+                const dim3& block, float time_step_over_cell_size,
+                const float* dissipation, uint3 volume_size, bool staggered,
+                bool mid_point)
+{
+    if (staggered) {
+        if (mid_point)
+            LaunchPass<true, true>(pass, num_of_fields, grid, block,
+                                   time_step_over_cell_size, dissipation,
+                                   volume_size);
+        else
+            LaunchPass<true, false>(pass, num_of_fields, grid, block,
+                                    time_step_over_cell_size, dissipation,
+                                    volume_size);
+    } else {
+        if (mid_point)
+            LaunchPass<false, true>(pass, num_of_fields, grid, block,
+                                    time_step_over_cell_size, dissipation,
+                                    volume_size);
+        else
+            LaunchPass<false, false>(pass, num_of_fields, grid, block,
+                                     time_step_over_cell_size, dissipation,
+                                     volume_size);
+    }
+}
+
+bool BindSurfaces(cudaArray** dest, int num_of_fields)
+{
+    if (BindCudaSurfaceToArray(&surf_0, dest[0]) != cudaSuccess)
+        return false;
+
+    return num_of_fields < 2 ||
+        BindCudaSurfaceToArray(&surf_1, dest[1]) == cudaSuccess;
+}
+
+namespace kern_launcher
+{
+void AdvectScalarFields(cudaArray** fnp1, cudaArray** fn, cudaArray** aux,
+                        const float* dissipation, int num_of_fields,
+                        cudaArray* vel_x, cudaArray* vel_y, cudaArray* vel_z,
+                        float cell_size, float time_step,
+                        AdvectionMethod method, uint3 volume_size,
+                        bool staggered, bool mid_point, BlockArrangement* ba)
+{
+    auto bound_vx = BindHelper::Bind(&tex_vx, vel_x, false,
+                                     cudaFilterModeLinear,
+                                     cudaAddressModeClamp);
+    if (bound_vx.error() != cudaSuccess)
+        return;
+
+    auto bound_vy = BindHelper::Bind(&tex_vy, vel_y, false,
+                                     cudaFilterModeLinear,
+                                     cudaAddressModeClamp);
+    if (bound_vy.error() != cudaSuccess)
+        return;
+
+    auto bound_vz = BindHelper::Bind(&tex_vz, vel_z, false,
+                                     cudaFilterModeLinear,
+                                     cudaAddressModeClamp);
+    if (bound_vz.error() != cudaSuccess)
+        return;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangePrefer3dLocality(&grid, &block, volume_size);
+
+    float ts = time_step / cell_size;
+    float unit[] = {1.0f, 1.0f};
+    for (int i = 0; i < num_of_fields; i += kMaxNumOfFusedFields) {
+        int n = std::min(num_of_fields - i, kMaxNumOfFusedFields);
+        float d[] = {1.0f - dissipation[i] * time_step, 1.0f};
+        if (n > 1)
+            d[1] = 1.0f - dissipation[i + 1] * time_step;
+
+        auto bound_0 = BindHelper::Bind(&tex_0, fn[i], false,
+                                        cudaFilterModeLinear,
+                                        cudaAddressModeClamp);
+        if (bound_0.error() != cudaSuccess)
+            return;
+
+        auto bound_1 = BindHelper::Bind(&tex_1, fn[i + n - 1], false,
+                                        cudaFilterModeLinear,
+                                        cudaAddressModeClamp);
+        if (bound_1.error() != cudaSuccess)
+            return;
+
+        if (method == MACCORMACK_SEMI_LAGRANGIAN) {
+            // Pass 1: Calculate phi_n_plus_1_hat, and store in |aux|.
+            if (!BindSurfaces(aux + i, n))
+                return;
+
+            LaunchPass(PASS_SEMI_LAGRANGIAN, n, grid, block, ts, unit,
+                       volume_size, staggered, mid_point);
+
+            // Pass 2: Correct the error, and store in |fnp1|.
+            if (!BindSurfaces(fnp1 + i, n))
+                return;
+
+            auto bound_a0 = BindHelper::Bind(&tex_aux_0, aux[i], false,
+                                             cudaFilterModeLinear,
+                                             cudaAddressModeClamp);
+            if (bound_a0.error() != cudaSuccess)
+                return;
+
+            auto bound_a1 = BindHelper::Bind(&tex_aux_1, aux[i + n - 1], false,
+                                             cudaFilterModeLinear,
+                                             cudaAddressModeClamp);
+            if (bound_a1.error() != cudaSuccess)
+                return;
+
+            LaunchPass(PASS_MACCORMACK, n, grid, block, ts, d, volume_size,
+                       staggered, mid_point);
+        } else if (method == BFECC_SEMI_LAGRANGIAN) {
+            // Pass 1: Calculate phi_n_plus_1_hat, and store in |fnp1|.
+            if (!BindSurfaces(fnp1 + i, n))
+                return;
+
+            LaunchPass(PASS_SEMI_LAGRANGIAN, n, grid, block, ts, unit,
+                       volume_size, staggered, mid_point);
+
+            // Pass 2: Calculate phi_n_hat, and store in |aux|.
+            if (!BindSurfaces(aux + i, n))
+                return;
+
+            {
+                auto bound_a0 = BindHelper::Bind(&tex_aux_0, fnp1[i], false,
+                                                 cudaFilterModeLinear,
+                                                 cudaAddressModeClamp);
+                if (bound_a0.error() != cudaSuccess)
+                    return;
+
+                auto bound_a1 = BindHelper::Bind(&tex_aux_1, fnp1[i + n - 1],
+                                                 false, cudaFilterModeLinear,
+                                                 cudaAddressModeClamp);
+                if (bound_a1.error() != cudaSuccess)
+                    return;
+
+                LaunchPass(PASS_BFECC_REMOVE_ERROR, n, grid, block, ts, unit,
+                           volume_size, staggered, mid_point);
+            }
+
+            // Pass 3: Calculate the final result.
+            if (!BindSurfaces(fnp1 + i, n))
+                return;
+
+            auto bound_a0 = BindHelper::Bind(&tex_aux_0, aux[i], false,
+                                             cudaFilterModeLinear,
+                                             cudaAddressModeClamp);
+            if (bound_a0.error() != cudaSuccess)
+                return;
+
+            auto bound_a1 = BindHelper::Bind(&tex_aux_1, aux[i + n - 1], false,
+                                             cudaFilterModeLinear,
+                                             cudaAddressModeClamp);
+            if (bound_a1.error() != cudaSuccess)
+                return;
+
+            LaunchPass(PASS_BFECC, n, grid, block, ts, d, volume_size,
+                       staggered, mid_point);
+        } else {
+            if (!BindSurfaces(fnp1 + i, n))
+                return;
+
+            LaunchPass(PASS_SEMI_LAGRANGIAN, n, grid, block, ts, d,
+                       volume_size, staggered, mid_point);
+        }
+    }
+
+    DCHECK_KERNEL();
+}
+}
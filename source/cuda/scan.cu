@@ -26,6 +26,7 @@ misrepresented as being the original software.
 //
 // 1. Reoganized the structure of code.
 // 2. Rewrote as c++ style.
+// 3. Generalized into inclusive, segmented scan and stream compaction.
 // 
 
 #include <cassert>
@@ -41,11 +42,19 @@ misrepresented as being the original software.
 #include "cuda/block_arrangement.h"
 #include "cuda/cuda_common_host.h"
 #include "cuda/cuda_common_kern.h"
+#include "cuda/cuda_debug.h"
 
 namespace
 {
-typedef std::vector<std::unique_ptr<uint, std::function<void(void*)>>>
-    BlockSums;
+typedef std::unique_ptr<uint, std::function<void(void*)>> AuxBuffer;
+typedef std::vector<AuxBuffer> BlockSums;
+
+AuxBuffer AllocateAuxBuffer(int num_of_elements, AuxBufferManager* bm)
+{
+    return AuxBuffer(
+        reinterpret_cast<uint*>(bm->Allocate(num_of_elements * sizeof(uint))),
+        [bm](void* p) { bm->Free(p); });
+}
 }
 
 template <bool StoreBlockSum>
@@ -152,6 +161,71 @@ __global__ void BuildPrefixSumKernel(uint* prefix_sum, uint* block_sums,
     }
 }
 
+template <bool FirstIsSet>
+__global__ void BuildFlagsKernel(uint* flags, const uint* source,
+                                 uint num_of_elements)
+{
+    uint i = __mul24(blockIdx.x, blockDim.x) + threadIdx.x;
+    if (i >= num_of_elements)
+        return;
+
+    flags[i] = (source[i] || (FirstIsSet && !i)) ? 1 : 0;
+}
+
+__global__ void AddSourceKernel(uint* dest, const uint* prefix_sum,
+                                const uint* source, uint num_of_elements)
+{
+    uint i = __mul24(blockIdx.x, blockDim.x) + threadIdx.x;
+    if (i >= num_of_elements)
+        return;
+
+    dest[i] = prefix_sum[i] + source[i];
+}
+
+// |segments| holds the exclusive scan of the head flags, so that the
+// segment of element i is segments[i] + head - 1.
+__global__ void GatherSegmentBasesKernel(uint* bases, const uint* prefix_sum,
+                                         const uint* segments,
+                                         const uint* heads,
+                                         uint num_of_elements)
+{
+    uint i = __mul24(blockIdx.x, blockDim.x) + threadIdx.x;
+    if (i >= num_of_elements)
+        return;
+
+    if (!i || heads[i])
+        bases[segments[i]] = prefix_sum[i];
+}
+
+__global__ void ApplySegmentBasesKernel(uint* prefix_sum, const uint* bases,
+                                        const uint* segments,
+                                        const uint* heads,
+                                        uint num_of_elements)
+{
+    uint i = __mul24(blockIdx.x, blockDim.x) + threadIdx.x;
+    if (i >= num_of_elements)
+        return;
+
+    uint head = (!i || heads[i]) ? 1 : 0;
+    prefix_sum[i] -= bases[segments[i] + head - 1];
+}
+
+__global__ void ScatterIndicesKernel(uint* dest, uint* count,
+                                     const uint* positions, const uint* flags,
+                                     uint num_of_elements)
+{
+    uint i = __mul24(blockIdx.x, blockDim.x) + threadIdx.x;
+    if (i >= num_of_elements)
+        return;
+
+    uint flag = flags[i] ? 1 : 0;
+    if (flag)
+        dest[positions[i]] = i;
+
+    if (i == num_of_elements - 1)
+        *count = positions[i] + flag;
+}
+
 // =============================================================================
 
 void PrefixSumRecursive(uint* particle_offsets,
@@ -207,11 +281,13 @@ void PrefixSumRecursive(uint* particle_offsets,
 
 namespace kern_launcher
 {
-void BuildCellOffsets(uint* particle_offsets, const uint* cell_particles_counts,
-                      int num_of_cells, BlockArrangement* ba,
-                      AuxBufferManager* bm)
+void ExclusiveScan(uint* dest, const uint* source, int num_of_elements,
+                   BlockArrangement* ba, AuxBufferManager* bm)
 {
-    int elements = num_of_cells;
+    if (!num_of_elements)
+        return;
+
+    int elements = num_of_elements;
     BlockSums block_sums;
     do {
         dim3 block;
@@ -221,16 +297,83 @@ void BuildCellOffsets(uint* particle_offsets, const uint* cell_particles_counts,
         ba->ArrangeLinearReduction(&grid, &block, &num_of_blocks,
                                    &np2_last_block, nullptr, nullptr, elements);
         if (num_of_blocks > 1)
-            block_sums.push_back(
-                BlockSums::value_type(
-                    reinterpret_cast<uint*>(
-                        bm->Allocate(num_of_blocks * sizeof(uint))),
-                    [&bm](void* p) { bm->Free(p); }));
+            block_sums.push_back(AllocateAuxBuffer(num_of_blocks, bm));
 
         elements = num_of_blocks;
     } while (elements > 1);
 
-    PrefixSumRecursive(particle_offsets, cell_particles_counts, num_of_cells,
-                       block_sums, 0, ba);
+    PrefixSumRecursive(dest, source, num_of_elements, block_sums, 0, ba);
+    DCHECK_KERNEL();
+}
+
+void InclusiveScan(uint* dest, const uint* source, int num_of_elements,
+                   BlockArrangement* ba, AuxBufferManager* bm)
+{
+    if (!num_of_elements)
+        return;
+
+    AuxBuffer prefix_sum = AllocateAuxBuffer(num_of_elements, bm);
+    ExclusiveScan(prefix_sum.get(), source, num_of_elements, ba, bm);
+
+    dim3 block;
+    dim3 grid;
+    ba->ArrangeLinear(&grid, &block, num_of_elements);
+    AddSourceKernel<<<grid, block>>>(dest, prefix_sum.get(), source,
+                                     num_of_elements);
+    DCHECK_KERNEL();
+}
+
+void SegmentedScan(uint* dest, const uint* source, const uint* heads,
+                   int num_of_elements, BlockArrangement* ba,
+                   AuxBufferManager* bm)
+{
+    if (!num_of_elements)
+        return;
+
+    // A plain scan, minus the scan at the head of every segment.
+    AuxBuffer segments = AllocateAuxBuffer(num_of_elements, bm);
+    AuxBuffer bases = AllocateAuxBuffer(num_of_elements, bm);
+
+    dim3 block;
+    dim3 grid;
+    ba->ArrangeLinear(&grid, &block, num_of_elements);
+    BuildFlagsKernel<true><<<grid, block>>>(segments.get(), heads,
+                                            num_of_elements);
+    ExclusiveScan(segments.get(), segments.get(), num_of_elements, ba, bm);
+    ExclusiveScan(dest, source, num_of_elements, ba, bm);
+
+    GatherSegmentBasesKernel<<<grid, block>>>(bases.get(), dest,
+                                              segments.get(), heads,
+                                              num_of_elements);
+    ApplySegmentBasesKernel<<<grid, block>>>(dest, bases.get(),
+                                             segments.get(), heads,
+                                             num_of_elements);
+    DCHECK_KERNEL();
+}
+
+int Compact(uint* dest, const uint* flags, int num_of_elements,
+            BlockArrangement* ba, AuxBufferManager* bm)
+{
+    if (!num_of_elements)
+        return 0;
+
+    AuxBuffer positions = AllocateAuxBuffer(num_of_elements, bm);
+    AuxBuffer count = AllocateAuxBuffer(1, bm);
+
+    dim3 block;
+    dim3 grid;
+    ba->ArrangeLinear(&grid, &block, num_of_elements);
+    BuildFlagsKernel<false><<<grid, block>>>(positions.get(), flags,
+                                             num_of_elements);
+    ExclusiveScan(positions.get(), positions.get(), num_of_elements, ba, bm);
+    ScatterIndicesKernel<<<grid, block>>>(dest, count.get(), positions.get(),
+                                          flags, num_of_elements);
+    DCHECK_KERNEL();
+
+    uint result = 0;
+    cudaError_t e = cudaMemcpy(&result, count.get(), sizeof(result),
+                               cudaMemcpyDeviceToHost);
+    assert(e == cudaSuccess);
+    return static_cast<int>(result);
 }
 }
@@ -0,0 +1,57 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "scan_impl_cuda.h"
+
+#include "cuda/kernel_launcher.h"
+
+ScanImplCuda::ScanImplCuda(BlockArrangement* ba, AuxBufferManager* bm)
+    : ba_(ba)
+    , bm_(bm)
+{
+}
+
+ScanImplCuda::~ScanImplCuda()
+{
+}
+
+void ScanImplCuda::ExclusiveScan(uint32_t* dest, const uint32_t* source,
+                                 int n)
+{
+    kern_launcher::ExclusiveScan(dest, source, n, ba_, bm_);
+}
+
+void ScanImplCuda::InclusiveScan(uint32_t* dest, const uint32_t* source,
+                                 int n)
+{
+    kern_launcher::InclusiveScan(dest, source, n, ba_, bm_);
+}
+
+void ScanImplCuda::SegmentedScan(uint32_t* dest, const uint32_t* source,
+                                 const uint32_t* heads, int n)
+{
+    kern_launcher::SegmentedScan(dest, source, heads, n, ba_, bm_);
+}
+
+int ScanImplCuda::Compact(uint32_t* dest, const uint32_t* flags, int n)
+{
+    return kern_launcher::Compact(dest, flags, n, ba_, bm_);
+}
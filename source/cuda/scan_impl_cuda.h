@@ -0,0 +1,50 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _SCAN_IMPL_CUDA_H_
+#define _SCAN_IMPL_CUDA_H_
+
+#include <stdint.h>
+
+class AuxBufferManager;
+class BlockArrangement;
+class ScanImplCuda
+{
+public:
+    ScanImplCuda(BlockArrangement* ba, AuxBufferManager* bm);
+    ~ScanImplCuda();
+
+    // Same as ScanImplCpu, except that the total of the scans is left on the
+    // device.
+    void ExclusiveScan(uint32_t* dest, const uint32_t* source, int n);
+    void InclusiveScan(uint32_t* dest, const uint32_t* source, int n);
+    void SegmentedScan(uint32_t* dest, const uint32_t* source,
+                       const uint32_t* heads, int n);
+
+    // Blocks until the number of the indices is read back.
+    int Compact(uint32_t* dest, const uint32_t* flags, int n);
+
+private:
+    BlockArrangement* ba_;
+    AuxBufferManager* bm_;
+};
+
+#endif // _SCAN_IMPL_CUDA_H_
\ No newline at end of file
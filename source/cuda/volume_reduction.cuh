@@ -165,6 +165,76 @@ __global__ void ReduceVolumeKernel(FPType* dest, FPType* block_results,
     }
 }
 
+// Reduces two sums in a single pass. The scheme accumulates both of them in
+// Load(), and gets the totals in Save().
+template <uint BlockSize, bool IsPow2, typename FPType, typename DataScheme>
+__global__ void ReduceVolumePairKernel(FPType* dest, FPType* block_results,
+                                       uint total_elements, uint row_stride,
+                                       uint slice_stride, DataScheme scheme)
+{
+    extern __shared__ uint sdata_raw[];
+    FPType* sdata = reinterpret_cast<FPType*>(sdata_raw);
+
+    const uint tid = threadIdx.x;
+    uint i = blockIdx.x * (BlockSize * 2) + threadIdx.x;
+    uint grid_size = BlockSize * 2 * gridDim.x;
+    FPType sum_0 = 0.0f;
+    FPType sum_1 = 0.0f;
+
+    while (i < total_elements) {
+        scheme.Load(i, row_stride, slice_stride, &sum_0, &sum_1);
+        if (IsPow2 || i + BlockSize < total_elements)
+            scheme.Load(i + BlockSize, row_stride, slice_stride, &sum_0,
+                        &sum_1);
+
+        i += grid_size;
+    }
+
+    ReduceBlock<BlockSize>(sdata_raw, sum_0, tid);
+    if (tid == 0)
+        block_results[blockIdx.x] = sdata[0];
+
+    // The shared memory is reused by the second sum.
+    __syncthreads();
+
+    ReduceBlock<BlockSize>(sdata_raw, sum_1, tid);
+    if (tid == 0)
+        block_results[gridDim.x + blockIdx.x] = sdata[0];
+
+    __shared__ bool last_block;
+
+    __threadfence();
+
+    if (tid == 0) {
+        uint ticket = atomicInc(&retirement_count, gridDim.x);
+        last_block = (ticket == gridDim.x - 1);
+    }
+
+    __syncthreads();
+
+    if (last_block) {
+        int j = tid;
+        sum_0 = 0.0f;
+        sum_1 = 0.0f;
+
+        while (j < gridDim.x) {
+            sum_0 += block_results[j];
+            sum_1 += block_results[gridDim.x + j];
+            j += BlockSize;
+        }
+
+        ReduceBlock<BlockSize>(sdata_raw, sum_0, tid);
+        FPType total_0 = sdata[0];
+        __syncthreads();
+
+        ReduceBlock<BlockSize>(sdata_raw, sum_1, tid);
+        if (tid == 0) {
+            scheme.Save(dest, total_0, sdata[0]);
+            retirement_count = 0;
+        }
+    }
+}
+
 // =============================================================================
 
 template <typename FPType, typename DataScheme>
@@ -245,4 +315,65 @@ void ReduceVolume(FPType* dest, const DataScheme& scheme, uint3 volume_size,
     }
 }
 
+
+template <uint BlockSize, typename FPType, typename DataScheme>
+void LaunchReduceVolumePair(FPType* dest, FPType* block_results,
+                            const DataScheme& scheme, uint total_elements,
+                            const dim3& grid, const dim3& block,
+                            uint3 volume_size)
+{
+    uint smem_size = BlockSize * sizeof(FPType);
+    uint row_stride = volume_size.x;
+    uint slice_stride = volume_size.x * volume_size.y;
+    if (IsPow2(total_elements))
+        ReduceVolumePairKernel<BlockSize, true><<<grid, block, smem_size>>>(
+            dest, block_results, total_elements, row_stride, slice_stride,
+            scheme);
+    else
+        ReduceVolumePairKernel<BlockSize, false><<<grid, block, smem_size>>>(
+            dest, block_results, total_elements, row_stride, slice_stride,
+            scheme);
+}
+
+template <typename FPType, typename DataScheme>
+void ReduceVolumePair(FPType* dest, const DataScheme& scheme,
+                      uint3 volume_size, BlockArrangement* ba,
+                      AuxBufferManager* bm)
+{
+    uint total_elements = volume_size.x * volume_size.y * volume_size.z;
+
+    dim3 grid;
+    dim3 block;
+    ba->ArrangeSequential(&grid, &block, volume_size);
+
+    // Two partial sums per block.
+    std::unique_ptr<FPType, std::function<void(void*)>> block_results(
+        reinterpret_cast<FPType*>(bm->Allocate(grid.x * 2 * sizeof(FPType))),
+        [&bm](void* p) { bm->Free(p); });
+
+    FPType* r = block_results.get();
+    switch (block.x) {
+        case 1024:
+            LaunchReduceVolumePair<1024>(dest, r, scheme, total_elements, grid,
+                                         block, volume_size);
+            break;
+        case 512:
+            LaunchReduceVolumePair< 512>(dest, r, scheme, total_elements, grid,
+                                         block, volume_size);
+            break;
+        case 256:
+            LaunchReduceVolumePair< 256>(dest, r, scheme, total_elements, grid,
+                                         block, volume_size);
+            break;
+        case 128:
+            LaunchReduceVolumePair< 128>(dest, r, scheme, total_elements, grid,
+                                         block, volume_size);
+            break;
+        case 64:
+            LaunchReduceVolumePair<  64>(dest, r, scheme, total_elements, grid,
+                                         block, volume_size);
+            break;
+    }
+}
+
 #endif  // _VOLUME_REDUCTION_H_
\ No newline at end of file
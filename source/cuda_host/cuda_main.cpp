@@ -33,6 +33,7 @@
 #include "cuda/particle/flip_impl_cuda.h"
 #include "cuda/particle/particle_impl_cuda.h"
 #include "cuda/poisson_impl_cuda.h"
+#include "cuda/scan_impl_cuda.h"
 #include "cuda_mem_piece.h"
 #include "cuda_volume.h"
 #include "metrics.h" // TODO
@@ -180,6 +181,8 @@ CudaMain::CudaMain()
     , particle_impl_(
         new ParticleImplCuda(particle_ob_.get(), core_->block_arrangement(),
                              core_->buffer_manager(), core_->rand_helper()))
+    , scan_impl_(
+        new ScanImplCuda(core_->block_arrangement(), core_->buffer_manager()))
     , registerd_textures_()
     , registerd_buffers_()
 {
@@ -208,6 +211,35 @@ void CudaMain::CopyVolume(std::shared_ptr<CudaVolume> dest,
                               dest->size());
 }
 
+void CudaMain::CopyFromMemPiece(void* dest,
+                                std::shared_ptr<CudaMemPiece> source, int size)
+{
+    CudaCore::CopyFromMemPiece(dest, source->mem(), size);
+}
+
+void CudaMain::CopyFromVolume(void* dest, size_t pitch,
+                              std::shared_ptr<CudaVolume> source)
+{
+    CudaCore::CopyFromVolume(dest, pitch, source->dev_array(), source->size());
+}
+
+void CudaMain::CopyToVolume(std::shared_ptr<CudaVolume> dest,
+                            const void* source, size_t pitch)
+{
+    CudaCore::CopyToVolume(dest->dev_array(), const_cast<void*>(source), pitch,
+                           dest->size());
+}
+
+void CudaMain::CopyVolumeRegion(std::shared_ptr<CudaVolume> dest,
+                                const glm::ivec3& dest_pos,
+                                std::shared_ptr<CudaVolume> source,
+                                const glm::ivec3& source_pos,
+                                const glm::ivec3& extent)
+{
+    CudaCore::CopyVolumeRegion(dest->dev_array(), dest_pos,
+                               source->dev_array(), source_pos, extent);
+}
+
 int CudaMain::RegisterGLImage(std::shared_ptr<GLTexture> texture)
 {
     if (registerd_textures_.find(texture) != registerd_textures_.end())
@@ -275,6 +307,36 @@ void CudaMain::AdvectField(std::shared_ptr<CudaVolume> fnp1,
                                    time_step, dissipation, fnp1->size());
 }
 
+void CudaMain::AdvectFields(
+    const std::vector<std::shared_ptr<CudaVolume>>& fnp1,
+    const std::vector<std::shared_ptr<CudaVolume>>& fn,
+    const std::vector<std::shared_ptr<CudaVolume>>& aux,
+    const std::vector<float>& dissipation, std::shared_ptr<CudaVolume> vel_x,
+    std::shared_ptr<CudaVolume> vel_y, std::shared_ptr<CudaVolume> vel_z,
+    float time_step)
+{
+    assert(fnp1.size() == fn.size() && fnp1.size() == aux.size() &&
+           fnp1.size() == dissipation.size());
+    if (fnp1.empty())
+        return;
+
+    std::vector<cudaArray*> fnp1_arrays;
+    std::vector<cudaArray*> fn_arrays;
+    std::vector<cudaArray*> aux_arrays;
+    for (size_t i = 0; i < fnp1.size(); i++) {
+        fnp1_arrays.push_back(fnp1[i]->dev_array());
+        fn_arrays.push_back(fn[i]->dev_array());
+        aux_arrays.push_back(aux[i]->dev_array());
+    }
+
+    fluid_impl_->AdvectScalarFields(&fnp1_arrays[0], &fn_arrays[0],
+                                    &aux_arrays[0], &dissipation[0],
+                                    static_cast<int>(fnp1.size()),
+                                    vel_x->dev_array(), vel_y->dev_array(),
+                                    vel_z->dev_array(), time_step,
+                                    fnp1[0]->size());
+}
+
 void CudaMain::AdvectVelocity(std::shared_ptr<CudaVolume> vnp1_x,
                               std::shared_ptr<CudaVolume> vnp1_y,
                               std::shared_ptr<CudaVolume> vnp1_z,
@@ -393,6 +455,28 @@ void CudaMain::SubtractGradient(std::shared_ptr<CudaVolume> vel_x,
                                   vel_x->size());
 }
 
+void CudaMain::ComputeMaxSpeed(std::shared_ptr<CudaMemPiece> max_speed,
+                               std::shared_ptr<CudaVolume> vel_x,
+                               std::shared_ptr<CudaVolume> vel_y,
+                               std::shared_ptr<CudaVolume> vel_z)
+{
+    fluid_impl_->ComputeMaxSpeed(reinterpret_cast<float*>(max_speed->mem()),
+                                 vel_x->dev_array(), vel_y->dev_array(),
+                                 vel_z->dev_array(), vel_x->size());
+}
+
+void CudaMain::FindActiveBricks(std::shared_ptr<CudaMemPiece> active_bricks,
+                                std::shared_ptr<CudaVolume> vel_x,
+                                std::shared_ptr<CudaVolume> vel_y,
+                                std::shared_ptr<CudaVolume> vel_z,
+                                float threshold, int brick_size)
+{
+    fluid_impl_->FindActiveBricks(
+        reinterpret_cast<uint8_t*>(active_bricks->mem()), vel_x->dev_array(),
+        vel_y->dev_array(), vel_z->dev_array(), threshold, brick_size,
+        vel_x->size());
+}
+
 void CudaMain::ComputeResidual(std::shared_ptr<CudaVolume> r,
                                std::shared_ptr<CudaVolume> u,
                                std::shared_ptr<CudaVolume> b)
@@ -415,6 +499,24 @@ void CudaMain::ProlongateError(std::shared_ptr<CudaVolume> fine,
                                    fine->size());
 }
 
+void CudaMain::RelaxJacobi(std::shared_ptr<CudaVolume> unp1,
+                           std::shared_ptr<CudaVolume> un,
+                           std::shared_ptr<CudaVolume> b, float omega)
+{
+    poisson_impl_->RelaxJacobi(unp1->dev_array(), un->dev_array(),
+                               b->dev_array(), omega, unp1->size());
+}
+
+void CudaMain::RelaxChebyshev(std::shared_ptr<CudaVolume> unp1,
+                              std::shared_ptr<CudaVolume> un,
+                              std::shared_ptr<CudaVolume> b, float momentum,
+                              float omega)
+{
+    poisson_impl_->RelaxChebyshev(unp1->dev_array(), un->dev_array(),
+                                  b->dev_array(), momentum, omega,
+                                  unp1->size());
+}
+
 void CudaMain::RelaxWithZeroGuess(std::shared_ptr<CudaVolume> u,
                                   std::shared_ptr<CudaVolume> b)
 {
@@ -429,6 +531,25 @@ void CudaMain::Restrict(std::shared_ptr<CudaVolume> coarse,
                             coarse->size());
 }
 
+void CudaMain::ComputeResidualAndRestrict(std::shared_ptr<CudaVolume> coarse,
+                                          std::shared_ptr<CudaVolume> u,
+                                          std::shared_ptr<CudaVolume> b)
+{
+    poisson_impl_->ComputeResidualAndRestrict(coarse->dev_array(),
+                                              u->dev_array(), b->dev_array(),
+                                              coarse->size(), u->size());
+}
+
+void CudaMain::ProlongateErrorAndRelax(std::shared_ptr<CudaVolume> u,
+                                       std::shared_ptr<CudaVolume> b,
+                                       std::shared_ptr<CudaVolume> coarse,
+                                       int num_of_iterations)
+{
+    poisson_impl_->ProlongateErrorAndRelax(u->dev_array(), b->dev_array(),
+                                           coarse->dev_array(),
+                                           num_of_iterations, u->size());
+}
+
 void CudaMain::ApplyStencil(std::shared_ptr<CudaVolume> aux,
                             std::shared_ptr<CudaVolume> search)
 {
@@ -489,6 +610,53 @@ void CudaMain::ScaleVector(std::shared_ptr<CudaVolume> dest,
                              dest->size());
 }
 
+void CudaMain::ApplyStencilAndReduce(std::shared_ptr<CudaMemPiece> alpha,
+                                     std::shared_ptr<CudaMemPiece> beta,
+                                     std::shared_ptr<CudaMemPiece> rho,
+                                     std::shared_ptr<CudaVolume> aux,
+                                     std::shared_ptr<CudaVolume> precond,
+                                     std::shared_ptr<CudaVolume> residual,
+                                     bool restart)
+{
+    poisson_impl_->ApplyStencilAndReduce(MemPiece(alpha->mem(), alpha->size()),
+                                         MemPiece(beta->mem(), beta->size()),
+                                         MemPiece(rho->mem(), rho->size()),
+                                         aux->dev_array(), precond->dev_array(),
+                                         residual->dev_array(), restart,
+                                         aux->size());
+}
+
+void CudaMain::UpdateSearchAndVector(std::shared_ptr<CudaVolume> dest,
+                                     std::shared_ptr<CudaVolume> search,
+                                     std::shared_ptr<CudaVolume> v,
+                                     std::shared_ptr<CudaMemPiece> alpha,
+                                     std::shared_ptr<CudaMemPiece> beta,
+                                     float sign)
+{
+    poisson_impl_->UpdateSearchAndVector(dest->dev_array(),
+                                         search->dev_array(), v->dev_array(),
+                                         MemPiece(alpha->mem(), alpha->size()),
+                                         MemPiece(beta->mem(), beta->size()),
+                                         sign, dest->size());
+}
+
+void CudaMain::Extrapolate(std::shared_ptr<CudaVolume> dest,
+                           std::shared_ptr<CudaVolume> v0,
+                           std::shared_ptr<CudaVolume> v1, float coef)
+{
+    poisson_impl_->Extrapolate(dest->dev_array(), v0->dev_array(),
+                               v1->dev_array(), coef, dest->size());
+}
+
+void CudaMain::ConvertVolume(std::shared_ptr<CudaVolume> dest,
+                             std::shared_ptr<CudaVolume> v, float scale,
+                             bool accumulate)
+{
+    poisson_impl_->ConvertVolume(dest->dev_array(), v->dev_array(), scale,
+                                 accumulate, dest->byte_width() == 2,
+                                 dest->size());
+}
+
 void CudaMain::AddCurlPsi(std::shared_ptr<CudaVolume> vel_x,
                           std::shared_ptr<CudaVolume> vel_y,
                           std::shared_ptr<CudaVolume> vel_z,
@@ -670,6 +838,31 @@ void CudaMain::ResetParticles(std::shared_ptr<CudaLinearMemU16> life,
     particle_impl_->Reset(life->mem(), num_of_particles);
 }
 
+void CudaMain::ExclusiveScan(std::shared_ptr<CudaLinearMemU32> dest,
+                             std::shared_ptr<CudaLinearMemU32> source, int n)
+{
+    scan_impl_->ExclusiveScan(dest->mem(), source->mem(), n);
+}
+
+void CudaMain::InclusiveScan(std::shared_ptr<CudaLinearMemU32> dest,
+                             std::shared_ptr<CudaLinearMemU32> source, int n)
+{
+    scan_impl_->InclusiveScan(dest->mem(), source->mem(), n);
+}
+
+void CudaMain::SegmentedScan(std::shared_ptr<CudaLinearMemU32> dest,
+                             std::shared_ptr<CudaLinearMemU32> source,
+                             std::shared_ptr<CudaLinearMemU32> heads, int n)
+{
+    scan_impl_->SegmentedScan(dest->mem(), source->mem(), heads->mem(), n);
+}
+
+int CudaMain::Compact(std::shared_ptr<CudaLinearMemU32> dest,
+                      std::shared_ptr<CudaLinearMemU32> flags, int n)
+{
+    return scan_impl_->Compact(dest->mem(), flags->mem(), n);
+}
+
 bool CudaMain::CopyToVbo(uint32_t point_vbo, uint32_t extra_vbo,
                          std::shared_ptr<CudaLinearMemU16> pos_x,
                          std::shared_ptr<CudaLinearMemU16> pos_y,
@@ -701,7 +894,9 @@ void CudaMain::Raycast(std::shared_ptr<GLSurface> dest,
                        float light_intensity, float focal_length,
                        const glm::vec2& screen_size, int num_samples,
                        int num_light_samples, float absorption,
-                       float density_factor, float occlusion_factor)
+                       float density_factor, float occlusion_factor,
+                       const glm::vec3& domain_size,
+                       const glm::vec3& window_origin)
 {
     auto i = registerd_textures_.find(dest);
     assert(i != registerd_textures_.end());
@@ -712,7 +907,8 @@ void CudaMain::Raycast(std::shared_ptr<GLSurface> dest,
                    dest->size(), eye_pos, light_color, light_pos,
                    light_intensity, focal_length, screen_size, num_samples,
                    num_light_samples, absorption, density_factor,
-                   occlusion_factor, density->size());
+                   occlusion_factor, domain_size, window_origin,
+                   glm::vec3(density->size()));
 }
 
 void CudaMain::SetAdvectionMethod(AdvectionMethod method)
@@ -24,6 +24,7 @@
 
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "third_party/glm/fwd.hpp"
 #include "cuda_host/cuda_linear_mem.h"
@@ -38,6 +39,7 @@ class GLTexture;
 class GraphicsResource;
 class ParticleImplCuda;
 class PoissonImplCuda;
+class ScanImplCuda;
 class CudaMain
 {
 public:
@@ -88,6 +90,17 @@ public:
                      const glm::ivec3& volume_size);
     void CopyVolume(std::shared_ptr<CudaVolume> dest,
                     std::shared_ptr<CudaVolume> source);
+    void CopyFromMemPiece(void* dest, std::shared_ptr<CudaMemPiece> source,
+                          int size);
+    void CopyFromVolume(void* dest, size_t pitch,
+                        std::shared_ptr<CudaVolume> source);
+    void CopyToVolume(std::shared_ptr<CudaVolume> dest, const void* source,
+                      size_t pitch);
+    void CopyVolumeRegion(std::shared_ptr<CudaVolume> dest,
+                          const glm::ivec3& dest_pos,
+                          std::shared_ptr<CudaVolume> source,
+                          const glm::ivec3& source_pos,
+                          const glm::ivec3& extent);
     int RegisterGLImage(std::shared_ptr<GLTexture> texture);
     void UnregisterGLImage(std::shared_ptr<GLTexture> texture);
     int RegisterGLBuffer(uint32_t vbo);
@@ -100,6 +113,17 @@ public:
                      std::shared_ptr<CudaVolume> vel_z,
                      std::shared_ptr<CudaVolume> aux, float time_step,
                      float dissipation);
+
+    // Advects the scalar fields along the same velocity, tracing each
+    // departure point once for all of them. Every field comes with its own
+    // auxiliary volume and dissipation.
+    void AdvectFields(
+        const std::vector<std::shared_ptr<CudaVolume>>& fnp1,
+        const std::vector<std::shared_ptr<CudaVolume>>& fn,
+        const std::vector<std::shared_ptr<CudaVolume>>& aux,
+        const std::vector<float>& dissipation,
+        std::shared_ptr<CudaVolume> vel_x, std::shared_ptr<CudaVolume> vel_y,
+        std::shared_ptr<CudaVolume> vel_z, float time_step);
     void AdvectVelocity(std::shared_ptr<CudaVolume> vnp1_x,
                         std::shared_ptr<CudaVolume> vnp1_y,
                         std::shared_ptr<CudaVolume> vnp1_z,
@@ -156,6 +180,17 @@ public:
                           std::shared_ptr<CudaVolume> vel_z,
                           std::shared_ptr<CudaVolume> pressure);
 
+    // Reductions over the velocity field.
+    void ComputeMaxSpeed(std::shared_ptr<CudaMemPiece> max_speed,
+                         std::shared_ptr<CudaVolume> vel_x,
+                         std::shared_ptr<CudaVolume> vel_y,
+                         std::shared_ptr<CudaVolume> vel_z);
+    void FindActiveBricks(std::shared_ptr<CudaMemPiece> active_bricks,
+                          std::shared_ptr<CudaVolume> vel_x,
+                          std::shared_ptr<CudaVolume> vel_y,
+                          std::shared_ptr<CudaVolume> vel_z, float threshold,
+                          int brick_size);
+
     // Multigrid.
     void ComputeResidual(std::shared_ptr<CudaVolume> r,
                          std::shared_ptr<CudaVolume> u,
@@ -164,10 +199,24 @@ public:
                     std::shared_ptr<CudaVolume> coarse);
     void ProlongateError(std::shared_ptr<CudaVolume> fine,
                          std::shared_ptr<CudaVolume> coarse);
+    void RelaxJacobi(std::shared_ptr<CudaVolume> unp1,
+                     std::shared_ptr<CudaVolume> un,
+                     std::shared_ptr<CudaVolume> b, float omega);
+    void RelaxChebyshev(std::shared_ptr<CudaVolume> unp1,
+                        std::shared_ptr<CudaVolume> un,
+                        std::shared_ptr<CudaVolume> b, float momentum,
+                        float omega);
     void RelaxWithZeroGuess(std::shared_ptr<CudaVolume> u,
                             std::shared_ptr<CudaVolume> b);
     void Restrict(std::shared_ptr<CudaVolume> coarse,
                   std::shared_ptr<CudaVolume> fine);
+    void ComputeResidualAndRestrict(std::shared_ptr<CudaVolume> coarse,
+                                    std::shared_ptr<CudaVolume> u,
+                                    std::shared_ptr<CudaVolume> b);
+    void ProlongateErrorAndRelax(std::shared_ptr<CudaVolume> u,
+                                 std::shared_ptr<CudaVolume> b,
+                                 std::shared_ptr<CudaVolume> coarse,
+                                 int num_of_iterations);
 
     // Conjugate gradient.
     void ApplyStencil(std::shared_ptr<CudaVolume> aux,
@@ -192,6 +241,30 @@ public:
                      std::shared_ptr<CudaVolume> v,
                      std::shared_ptr<CudaMemPiece> coef, float sign);
 
+    // Pipelined conjugate gradient.
+    void ApplyStencilAndReduce(std::shared_ptr<CudaMemPiece> alpha,
+                               std::shared_ptr<CudaMemPiece> beta,
+                               std::shared_ptr<CudaMemPiece> rho,
+                               std::shared_ptr<CudaVolume> aux,
+                               std::shared_ptr<CudaVolume> precond,
+                               std::shared_ptr<CudaVolume> residual,
+                               bool restart);
+    void UpdateSearchAndVector(std::shared_ptr<CudaVolume> dest,
+                               std::shared_ptr<CudaVolume> search,
+                               std::shared_ptr<CudaVolume> v,
+                               std::shared_ptr<CudaMemPiece> alpha,
+                               std::shared_ptr<CudaMemPiece> beta, float sign);
+
+    // Initial guess.
+    void Extrapolate(std::shared_ptr<CudaVolume> dest,
+                     std::shared_ptr<CudaVolume> v0,
+                     std::shared_ptr<CudaVolume> v1, float coef);
+
+    // Mixed precision.
+    void ConvertVolume(std::shared_ptr<CudaVolume> dest,
+                       std::shared_ptr<CudaVolume> v, float scale,
+                       bool accumulate);
+
     // Vorticity.
     void AddCurlPsi(std::shared_ptr<CudaVolume> vel_x,
                     std::shared_ptr<CudaVolume> vel_y,
@@ -280,6 +353,17 @@ public:
     void ResetParticles(std::shared_ptr<CudaLinearMemU16> life,
                         int num_of_particles);
 
+    // Scan
+    void ExclusiveScan(std::shared_ptr<CudaLinearMemU32> dest,
+                       std::shared_ptr<CudaLinearMemU32> source, int n);
+    void InclusiveScan(std::shared_ptr<CudaLinearMemU32> dest,
+                       std::shared_ptr<CudaLinearMemU32> source, int n);
+    void SegmentedScan(std::shared_ptr<CudaLinearMemU32> dest,
+                       std::shared_ptr<CudaLinearMemU32> source,
+                       std::shared_ptr<CudaLinearMemU32> heads, int n);
+    int Compact(std::shared_ptr<CudaLinearMemU32> dest,
+                std::shared_ptr<CudaLinearMemU32> flags, int n);
+
     // Rendering
     bool CopyToVbo(uint32_t point_vbo, uint32_t extra_vbo,
                    std::shared_ptr<CudaLinearMemU16> pos_x,
@@ -289,6 +373,9 @@ public:
                    std::shared_ptr<CudaLinearMemU16> temperature,
                    std::shared_ptr<CudaMemPiece> num_of_actives,
                    float crit_density, int num_of_particles);
+
+    // |density| covers the part of the domain that starts at
+    // |window_origin|. Everything else is taken as empty.
     void Raycast(std::shared_ptr<GLSurface> dest,
                  std::shared_ptr<CudaVolume> density,
                  const glm::mat4& inv_rotation, const glm::vec3& eye_pos,
@@ -296,7 +383,8 @@ public:
                  float light_intensity, float focal_length,
                  const glm::vec2& screen_size, int num_samples,
                  int num_light_samples, float absorption, float density_factor,
-                 float occlusion_factor);
+                 float occlusion_factor, const glm::vec3& domain_size,
+                 const glm::vec3& window_origin);
 
     void SetAdvectionMethod(AdvectionMethod method);
     void SetCellSize(float cell_size);
@@ -327,6 +415,7 @@ private:
 
     std::shared_ptr<ParticleObserver> particle_ob_;
     std::unique_ptr<ParticleImplCuda> particle_impl_;
+    std::unique_ptr<ScanImplCuda> scan_impl_;
     std::map<std::shared_ptr<GLTexture>, std::unique_ptr<GraphicsResource>>
         registerd_textures_;
     std::map<uint32_t, std::unique_ptr<GraphicsResource>> registerd_buffers_;
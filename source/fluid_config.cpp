@@ -74,14 +74,24 @@ struct { GraphicsLib graphics_lib_; char* desc_; } lib_enum_desc[] = {
     {GRAPHICS_LIB_CUDA, "cuda"},
     {GRAPHICS_LIB_GLSL, "glsl"},
     {GRAPHICS_LIB_CUDA_DIAGNOSIS, "diagnosis"},
+    {GRAPHICS_LIB_CPU, "cpu"},
 };
 
 struct { PoissonSolverEnum m_; char* desc_; } method_enum_desc[] = {
     {POISSON_SOLVER_JACOBI, "j"},
     {POISSON_SOLVER_DAMPED_JACOBI, "dj"},
+    {POISSON_SOLVER_GAUSS_SEIDEL, "gs"},
     {POISSON_SOLVER_MULTI_GRID, "mg"},
     {POISSON_SOLVER_FULL_MULTI_GRID, "fmg"},
     {POISSON_SOLVER_MULTI_GRID_PRECONDITIONED_CONJUGATE_GRADIENT, "mgpcg"},
+    {POISSON_SOLVER_PIPELINED_CONJUGATE_GRADIENT, "pmgpcg"},
+    {POISSON_SOLVER_FFT, "fft"},
+    {POISSON_SOLVER_MIXED_PRECISION, "mp"},
+};
+
+struct { PoissonSmootherEnum m_; char* desc_; } smoother_enum_desc[] = {
+    {POISSON_SMOOTHER_GAUSS_SEIDEL, "gs"},
+    {POISSON_SMOOTHER_CHEBYSHEV, "chebyshev"},
 };
 
 struct { CudaMain::AdvectionMethod m_; char* desc_; } advect_enum_desc[] = {
@@ -137,6 +147,20 @@ std::istream& operator >>(std::istream& is,
     return is;
 }
 
+template <>
+std::istream& operator >>(std::istream& is,
+                          FluidConfig::ConfigField<PoissonSmootherEnum>& field)
+{
+    std::string smoother;
+    std::getline(is, smoother);
+    std::string lower_trimmed = to_lower(trimmed(smoother));
+    for (auto i : smoother_enum_desc)
+        if (lower_trimmed == i.desc_)
+            field.value_ = i.m_;
+
+    return is;
+}
+
 template <>
 std::istream& operator >>(
     std::istream& is,
@@ -235,6 +259,18 @@ std::ostream& operator <<(std::ostream& os,
     return os;
 }
 
+template <>
+std::ostream& operator <<(std::ostream& os,
+                          FluidConfig::ConfigField<PoissonSmootherEnum>& field)
+{
+    os << field.desc_ << " = ";
+    for (auto i : smoother_enum_desc)
+        if (field.value_ == i.m_)
+            os << i.desc_;
+
+    return os;
+}
+
 template <>
 std::ostream& operator <<(
     std::ostream& os,
@@ -317,6 +353,13 @@ void FluidConfig::Load(const std::string& path, const std::string& preset_path)
         Load(preset_path_ + "\\" + preset_file_.value_);
 }
 
+void FluidConfig::LoadPreset(const std::string& path)
+{
+    // Overrides the current settings without touching the file paths, so
+    // a later Reload() goes back to the preset named in the config file.
+    Load(path);
+}
+
 void FluidConfig::Reload()
 {
     if (file_path_.empty())
@@ -331,6 +374,7 @@ FluidConfig::FluidConfig()
     , preset_file_("", "preset")
     , graphics_lib_(GRAPHICS_LIB_CUDA, "graphics library")
     , poisson_method_(POISSON_SOLVER_FULL_MULTI_GRID, "poisson method")
+    , poisson_smoother_(POISSON_SMOOTHER_GAUSS_SEIDEL, "poisson smoother")
     , advection_method_(CudaMain::MACCORMACK_SEMI_LAGRANGIAN,
                         "advection method")
     , fluid_impluse_(CudaMain::IMPULSE_HOT_FLOOR, "fluid impulse")
@@ -352,6 +396,7 @@ FluidConfig::FluidConfig()
     , density_dissipation_(0.2f, "density dissipation")
     , splat_radius_factor_(0.25f, "splat radius factor")
     , fixed_time_step_(0.33f, "fixed time step")
+    , cfl_number_(0.0f, "cfl number")
     , light_intensity_(22.0f, "light intensity")
     , light_absorption_(10.0f, "light absorption")
     , raycast_density_factor_(30.0f, "raycast density factor")
@@ -359,17 +404,32 @@ FluidConfig::FluidConfig()
     , field_of_view_(1.0f, "field of view")
     , time_stretch_(1.0f, "time stretch")
     , vorticity_confinement_(0.1f, "vorticity confinement")
+    , poisson_tolerance_(0.0f, "poisson tolerance")
+    , poisson_absolute_tolerance_(0.0f, "poisson absolute tolerance")
+    , active_velocity_threshold_(0.001f, "active velocity threshold")
+    , max_sort_churn_(0.2f, "max sort churn")
+    , reseed_density_threshold_(0.0f, "reseed density threshold")
     , num_jacobi_iterations_(40, "number of jacobi iterations")
     , num_multigrid_iterations_(5, "num multigrid iterations")
     , num_full_multigrid_iterations_(2, "num full multigrid iterations")
     , num_mgpcg_iterations_(2, "num mgpcg iterations")
+    , num_refinement_iterations_(3, "num refinement iterations")
+    , max_poisson_iterations_(0, "max poisson iterations")
     , auto_impulse_(1, "auto impulse")
     , staggered_(1, "staggered")
     , mid_point_(0, "mid point")
     , outflow_(0, "outflow")
+    , pressure_warm_start_(0, "pressure warm start")
+    , extrapolate_pressure_(0, "extrapolate pressure")
+    , adaptive_domain_(0, "adaptive domain")
+    , adaptive_domain_padding_(16, "adaptive domain padding")
+    , max_num_substeps_(4, "max num substeps")
     , num_raycast_samples_(224, "num raycast samples")
     , num_raycast_light_samples_(64, "num raycast light samples")
     , max_num_particles_(1000000, "max num particles")
+    , particles_per_cell_(8, "particles per cell")
+    , min_particles_per_cell_(3, "min particles per cell")
+    , apic_transfer_(0, "apic transfer")
     , initial_viewport_width_(512)
 {
 }
@@ -409,6 +469,11 @@ void FluidConfig::Parse(const std::string& key, const std::string& value)
         return;
     }
 
+    if (lower_trimmed == poisson_smoother_.desc_) {
+        value_stream >> poisson_smoother_;
+        return;
+    }
+
     if (lower_trimmed == advection_method_.desc_) {
         value_stream >> advection_method_;
         return;
@@ -468,6 +533,7 @@ void FluidConfig::Parse(const std::string& key, const std::string& value)
         &density_dissipation_,
         &splat_radius_factor_,
         &fixed_time_step_,
+        &cfl_number_,
         &light_intensity_,
         &light_absorption_,
         &raycast_density_factor_,
@@ -475,6 +541,11 @@ void FluidConfig::Parse(const std::string& key, const std::string& value)
         &field_of_view_,
         &time_stretch_,
         &vorticity_confinement_,
+        &poisson_tolerance_,
+        &poisson_absolute_tolerance_,
+        &active_velocity_threshold_,
+        &max_sort_churn_,
+        &reseed_density_threshold_,
     };
 
     for (auto& f : float_fields) {
@@ -489,13 +560,23 @@ void FluidConfig::Parse(const std::string& key, const std::string& value)
         &num_multigrid_iterations_,
         &num_full_multigrid_iterations_,
         &num_mgpcg_iterations_,
+        &num_refinement_iterations_,
+        &max_poisson_iterations_,
         &auto_impulse_,
         &staggered_,
         &mid_point_,
         &outflow_,
+        &pressure_warm_start_,
+        &extrapolate_pressure_,
+        &adaptive_domain_,
+        &adaptive_domain_padding_,
+        &max_num_substeps_,
         &num_raycast_samples_,
         &num_raycast_light_samples_,
         &max_num_particles_,
+        &particles_per_cell_,
+        &min_particles_per_cell_,
+        &apic_transfer_,
     };
 
     for (auto& f : int_fields) {
@@ -510,6 +591,7 @@ void FluidConfig::Store(std::ostream& stream)
 {
     stream << graphics_lib_ << std::endl;
     stream << poisson_method_ << std::endl;
+    stream << poisson_smoother_ << std::endl;
     stream << advection_method_ << std::endl;
     stream << fluid_impluse_ << std::endl;
     stream << render_mode_ << std::endl;
@@ -538,6 +620,7 @@ void FluidConfig::Store(std::ostream& stream)
         density_dissipation_,
         splat_radius_factor_,
         fixed_time_step_,
+        cfl_number_,
         light_intensity_,
         light_absorption_,
         raycast_density_factor_,
@@ -545,6 +628,11 @@ void FluidConfig::Store(std::ostream& stream)
         field_of_view_,
         time_stretch_,
         vorticity_confinement_,
+        poisson_tolerance_,
+        poisson_absolute_tolerance_,
+        active_velocity_threshold_,
+        max_sort_churn_,
+        reseed_density_threshold_,
     };
 
     for (auto& f : float_fields)
@@ -555,13 +643,23 @@ void FluidConfig::Store(std::ostream& stream)
         num_multigrid_iterations_,
         num_full_multigrid_iterations_,
         num_mgpcg_iterations_,
+        num_refinement_iterations_,
+        max_poisson_iterations_,
         auto_impulse_,
         staggered_,
         mid_point_,
         outflow_,
+        pressure_warm_start_,
+        extrapolate_pressure_,
+        adaptive_domain_,
+        adaptive_domain_padding_,
+        max_num_substeps_,
         num_raycast_samples_,
         num_raycast_light_samples_,
         max_num_particles_,
+        particles_per_cell_,
+        min_particles_per_cell_,
+        apic_transfer_,
     };
 
     for (auto& f : int_fields)
@@ -46,12 +46,16 @@ public:
 
     void CreateIfNeeded(const std::string& path);
     void Load(const std::string& path, const std::string& preset_path);
+    void LoadPreset(const std::string& path);
     void Reload();
 
     GraphicsLib graphics_lib() const { return graphics_lib_.value_; }
     PoissonSolverEnum poisson_method() const {
         return poisson_method_.value_;
     }
+    PoissonSmootherEnum poisson_smoother() const {
+        return poisson_smoother_.value_;
+    }
     CudaMain::AdvectionMethod advection_method() const {
         return advection_method_.value_;
     }
@@ -77,6 +81,8 @@ public:
     float density_dissipation() const { return density_dissipation_.value_; }
     float splat_radius_factor() const { return splat_radius_factor_.value_; }
     float fixed_time_step() const { return fixed_time_step_.value_; }
+    float cfl_number() const { return cfl_number_.value_; }
+    int max_num_substeps() const { return max_num_substeps_.value_; }
     float light_intensity() const { return light_intensity_.value_; }
     float light_absorption() const { return light_absorption_.value_; }
     float raycast_density_factor() const {
@@ -97,18 +103,48 @@ public:
     int num_mgpcg_iterations() const {
         return num_mgpcg_iterations_.value_;
     }
+    int num_refinement_iterations() const {
+        return num_refinement_iterations_.value_;
+    }
+    int max_poisson_iterations() const {
+        return max_poisson_iterations_.value_;
+    }
     bool auto_impulse() const { return !!auto_impulse_.value_; }
     bool staggered() const { return !!staggered_.value_; }
     bool mid_point() const { return !!mid_point_.value_; }
     bool outflow() const { return !!outflow_.value_; }
+    bool pressure_warm_start() const { return !!pressure_warm_start_.value_; }
+    bool extrapolate_pressure() const {
+        return !!extrapolate_pressure_.value_;
+    }
+    float max_sort_churn() const { return max_sort_churn_.value_; }
+    float active_velocity_threshold() const {
+        return active_velocity_threshold_.value_;
+    }
+    bool adaptive_domain() const { return !!adaptive_domain_.value_; }
+    int adaptive_domain_padding() const {
+        return adaptive_domain_padding_.value_;
+    }
     float vorticity_confinement() const {
         return vorticity_confinement_.value_;
     }
+    float poisson_tolerance() const { return poisson_tolerance_.value_; }
+    float poisson_absolute_tolerance() const {
+        return poisson_absolute_tolerance_.value_;
+    }
     int num_raycast_samples() const { return num_raycast_samples_.value_; }
     int num_raycast_light_samples() const {
         return num_raycast_light_samples_.value_;
     }
     int max_num_particles() const { return max_num_particles_.value_; }
+    int particles_per_cell() const { return particles_per_cell_.value_; }
+    int min_particles_per_cell() const {
+        return min_particles_per_cell_.value_;
+    }
+    float reseed_density_threshold() const {
+        return reseed_density_threshold_.value_;
+    }
+    bool apic_transfer() const { return !!apic_transfer_.value_; }
     int initial_viewport_width() const { return initial_viewport_width_; }
 
 private:
@@ -124,6 +160,7 @@ private:
     ConfigField<std::string> preset_file_;
     ConfigField<GraphicsLib> graphics_lib_;
     ConfigField<PoissonSolverEnum> poisson_method_;
+    ConfigField<PoissonSmootherEnum> poisson_smoother_;
     ConfigField<CudaMain::AdvectionMethod> advection_method_;
     ConfigField<CudaMain::FluidImpulse> fluid_impluse_;
     ConfigField<RenderMode> render_mode_;
@@ -144,6 +181,7 @@ private:
     ConfigField<float> density_dissipation_;
     ConfigField<float> splat_radius_factor_;
     ConfigField<float> fixed_time_step_;
+    ConfigField<float> cfl_number_;
     ConfigField<float> light_intensity_;
     ConfigField<float> light_absorption_;
     ConfigField<float> raycast_density_factor_;
@@ -151,17 +189,32 @@ private:
     ConfigField<float> field_of_view_;
     ConfigField<float> time_stretch_;
     ConfigField<float> vorticity_confinement_;
+    ConfigField<float> poisson_tolerance_;
+    ConfigField<float> poisson_absolute_tolerance_;
+    ConfigField<float> active_velocity_threshold_;
+    ConfigField<float> max_sort_churn_; // Fraction of the particles.
+    ConfigField<float> reseed_density_threshold_;
     ConfigField<int> num_jacobi_iterations_;
     ConfigField<int> num_multigrid_iterations_;
     ConfigField<int> num_full_multigrid_iterations_;
     ConfigField<int> num_mgpcg_iterations_;
+    ConfigField<int> num_refinement_iterations_;
+    ConfigField<int> max_poisson_iterations_;
     ConfigField<int> auto_impulse_;
     ConfigField<int> staggered_;
     ConfigField<int> mid_point_;
     ConfigField<int> outflow_;
+    ConfigField<int> pressure_warm_start_;
+    ConfigField<int> extrapolate_pressure_;
+    ConfigField<int> adaptive_domain_;
+    ConfigField<int> adaptive_domain_padding_;
+    ConfigField<int> max_num_substeps_;
     ConfigField<int> num_raycast_samples_;
     ConfigField<int> num_raycast_light_samples_;
     ConfigField<int> max_num_particles_;
+    ConfigField<int> particles_per_cell_;
+    ConfigField<int> min_particles_per_cell_;
+    ConfigField<int> apic_transfer_;
     int initial_viewport_width_;
 };
 
@@ -25,6 +25,7 @@
 #include <numeric>
 
 #include "config_file_watcher.h"
+#include "cpu_host/cpu_main.h"
 #include "cuda_host/cuda_main.h"
 #include "fluid_config.h"
 #include "fluid_simulator.h"
@@ -85,6 +86,9 @@ void Cleanup(int exit_code)
         trackball_ = nullptr;
     }
 
+    if (FluidConfig::Instance()->graphics_lib() == GRAPHICS_LIB_CPU)
+        CpuMain::DestroyInstance();
+
     CudaMain::DestroyInstance();
     exit(EXIT_SUCCESS);
 }
@@ -190,41 +194,30 @@ void DisplayMetrics()
     text.precision(2);
     text << std::fixed << Metrics::Instance()->GetFrameRate() << " f/s" <<
         std::endl;
-    char* o[] = {
-        "Velocity",
-        "Temperature",
-        "Density",
-        "Buoyancy",
-        "Impulse",
-        "Divergence",
-        "Pressure",
-        "Gradient",
-
-        "FLIP Emission",
-        "FLIP Interpolation",
-        "FLIP Resampling",
-        "FLIP Advection",
-        "FLIP Cell Binding",
-        "FLIP Prefix Sum",
-        "FLIP Sorting",
-        "FLIP Transfer",
-
-        "Vorticity",
-        "Raycast",
-        "Render",
-        "Prolongate",
-    };
-    for (int i = 0; i < sizeof(o) / sizeof(o[0]); i++) {
-        float cost = Metrics::Instance()->GetOperationTimeCost(
-            static_cast<Metrics::Operations>(i));
+    for (int i = 0; i < Metrics::NUM_OF_OPERATIONS; i++) {
+        Metrics::Operations o = static_cast<Metrics::Operations>(i);
+        float cost = Metrics::Instance()->GetOperationTimeCost(o);
         if (cost > 0.01f)
-            text << o[i] << ": " << cost << std::endl;
+            text << Metrics::GetOperationName(o) << ": " << cost << std::endl;
     }
 
     int n = Metrics::Instance()->GetActiveParticleNumber();
     if (n)
         text << "Active Particles: " << n << std::endl;
 
+    n = Metrics::Instance()->GetPressureIterationNumber();
+    if (n)
+        text << "Pressure Iterations: " << n << std::endl;
+
+    float residual = Metrics::Instance()->GetPressureResidual();
+    if (residual > 0.0f)
+        text << "Pressure Residual: " << residual << std::endl;
+
+    n = Metrics::Instance()->GetSubstepNumber();
+    if (n)
+        text << "Time Step: " << Metrics::Instance()->GetTimeStep() << " x " <<
+            n << std::endl;
+
     overlay_.RenderText(text.str(), viewport_size_.x, viewport_size_.y);
 }
 
@@ -232,6 +225,7 @@ void RenderFrame()
 {
     Metrics::Instance()->OnFrameRenderingBegins();
 
+    renderer_->set_field_origin(glm::vec3(sim_->window_origin()));
     renderer_->Render(sim_->field_owner(), sim_->buf_owner());
 
     Metrics::Instance()->OnFrameRendered();
@@ -0,0 +1,347 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cpu_host/cpu_main.h"
+#include "cpu_host/cpu_volume.h"
+#include "cpu_host/simd_float.h"
+#include "cuda_host/cuda_main.h"
+#include "fluid_config.h"
+#include "fluid_simulator.h"
+#include "fluid_solver/fluid_field_owner.h"
+#include "graphics_volume.h"
+#include "graphics_volume_group.h"
+#include "metrics.h"
+#include "utility.h"
+
+// A windowless front end of the simulator for benchmarks and batch runs. It
+// loads the config the same way the interactive app does, advances a fixed
+// number of frames as fast as possible, and reports the per-stage timings
+// collected by Metrics.
+
+namespace
+{
+struct RunnerOptions
+{
+    RunnerOptions()
+        : config_path_()
+        , preset_path_()
+        , dump_path_()
+        , num_of_frames_(100)
+        , dump_interval_(0)
+        , time_step_(0.033f)
+    {
+    }
+
+    std::string config_path_;
+    std::string preset_path_;
+    std::string dump_path_;
+    int num_of_frames_;
+    int dump_interval_;
+    float time_step_;
+};
+
+void PrintUsage()
+{
+    printf(
+        "Usage: hypermorph_runner [options] [preset file]\n"
+        "  --config=<file>        base config, fluid_config.txt beside the\n"
+        "                         executable by default\n"
+        "  --frames=<n>           frames to simulate, 100 by default\n"
+        "  --time-step=<seconds>  used when the config has no fixed time step\n"
+        "  --dump=<directory>     dump density, temperature and velocity as\n"
+        "                         raw fp32 volumes\n"
+        "  --dump-interval=<n>    dump every n frames; 0 dumps the last frame\n"
+        "                         only\n");
+}
+
+bool ParseCommandLine(int argc, char* argv[], RunnerOptions* options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string key = arg;
+        std::string value;
+        size_t pos = arg.find('=');
+        if (pos != std::string::npos) {
+            key = arg.substr(0, pos);
+            value = arg.substr(pos + 1);
+        }
+
+        if (key == "--config")
+            options->config_path_ = value;
+        else if (key == "--frames")
+            options->num_of_frames_ = atoi(value.c_str());
+        else if (key == "--time-step")
+            options->time_step_ = static_cast<float>(atof(value.c_str()));
+        else if (key == "--dump")
+            options->dump_path_ = value;
+        else if (key == "--dump-interval")
+            options->dump_interval_ = atoi(value.c_str());
+        else if (arg.compare(0, 2, "--") && options->preset_path_.empty())
+            options->preset_path_ = arg;
+        else
+            return false;
+    }
+
+    return options->num_of_frames_ > 0 && options->dump_interval_ >= 0 &&
+        options->time_step_ > 0.0f;
+}
+
+void LoadConfig(const RunnerOptions& options)
+{
+    char file_path_buf[MAX_PATH] = {0};
+    GetModuleFileNameA(nullptr, file_path_buf, MAX_PATH);
+    std::string cur_path = file_path_buf;
+    cur_path.erase(cur_path.find_last_of('\\'));
+
+    std::string file_path = options.config_path_;
+    if (file_path.empty())
+        file_path = cur_path + "\\fluid_config.txt";
+
+    std::string preset_path(cur_path);
+    preset_path.erase(preset_path.find_last_of('\\'));
+    preset_path.erase(preset_path.find_last_of('\\'));
+    preset_path += "\\config";
+    DWORD attrib = GetFileAttributesA(preset_path.c_str());
+
+    if ((attrib != INVALID_FILE_ATTRIBUTES) &&
+            (attrib & FILE_ATTRIBUTE_DIRECTORY)) {
+        FluidConfig::Instance()->Load(file_path, preset_path);
+    } else {
+        FluidConfig::Instance()->Load(file_path, cur_path);
+    }
+
+    if (!options.preset_path_.empty())
+        FluidConfig::Instance()->LoadPreset(options.preset_path_);
+}
+
+bool ReadVolume(const GraphicsVolume& volume, std::vector<float>* result)
+{
+    int width = volume.GetWidth();
+    int height = volume.GetHeight();
+    int depth = volume.GetDepth();
+    int byte_width = volume.GetByteWidth();
+    int row_size = width * byte_width;
+    std::vector<char> raw(row_size * height * depth);
+
+    if (volume.graphics_lib() == GRAPHICS_LIB_CUDA) {
+        CudaMain::Instance()->CopyFromVolume(&raw[0], row_size,
+                                             volume.cuda_volume());
+    } else if (volume.graphics_lib() == GRAPHICS_LIB_CPU) {
+        std::shared_ptr<CpuVolume> v = volume.cpu_volume();
+        for (int z = 0; z < depth; z++) {
+            for (int y = 0; y < height; y++) {
+                memcpy(&raw[(z * height + y) * row_size],
+                       v->GetRowAddress(y, z), row_size);
+            }
+        }
+    } else {
+        return false;
+    }
+
+    result->resize(width * height * depth);
+    for (size_t i = 0; i < result->size(); i++) {
+        if (byte_width == 2) {
+            uint16_t h = *reinterpret_cast<uint16_t*>(&raw[i * 2]);
+            (*result)[i] = simd::HalfToFloat(h);
+        } else {
+            (*result)[i] = *reinterpret_cast<float*>(&raw[i * 4]);
+        }
+    }
+
+    return true;
+}
+
+bool DumpVolume(const GraphicsVolume* volume, const std::string& dir,
+                const char* name, int frame)
+{
+    std::vector<float> data;
+    if (!volume || !ReadVolume(*volume, &data))
+        return false;
+
+    char file_name[64];
+    sprintf(file_name, "\\%s_%04d.raw", name, frame);
+    std::string path = dir + file_name;
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+
+    size_t written = fwrite(&data[0], sizeof(data[0]), data.size(), f);
+    fclose(f);
+
+    printf("%s: %dx%dx%d fp32\n", path.c_str(), volume->GetWidth(),
+           volume->GetHeight(), volume->GetDepth());
+    return written == data.size();
+}
+
+bool DumpFields(FluidFieldOwner* field_owner, const std::string& dir,
+                int frame)
+{
+    CreateDirectoryA(dir.c_str(), nullptr);
+
+    bool result = true;
+    result &= DumpVolume(field_owner->GetDensityField(), dir, "density",
+                         frame);
+    result &= DumpVolume(field_owner->GetTemperatureField(), dir,
+                         "temperature", frame);
+
+    GraphicsVolume3* velocity = field_owner->GetVelocityField();
+    if (velocity) {
+        result &= DumpVolume(velocity->x().get(), dir, "velocity_x", frame);
+        result &= DumpVolume(velocity->y().get(), dir, "velocity_y", frame);
+        result &= DumpVolume(velocity->z().get(), dir, "velocity_z", frame);
+    }
+
+    return result;
+}
+
+void PrintMetrics(int num_of_frames, double seconds,
+                  int num_of_pressure_iterations, int num_of_substeps)
+{
+    printf("%d frames in %.3f s, %.2f f/s\n", num_of_frames, seconds,
+           num_of_frames / seconds);
+
+    // Metrics keeps a moving average of the latest samples only, which is
+    // what we want after the warm-up frames.
+    for (int i = 0; i < Metrics::NUM_OF_OPERATIONS; i++) {
+        Metrics::Operations o = static_cast<Metrics::Operations>(i);
+        float cost = Metrics::Instance()->GetOperationTimeCost(o);
+        if (cost > 0.01f)
+            printf("  %-20s %10.1f us\n", Metrics::GetOperationName(o), cost);
+    }
+
+    int n = Metrics::Instance()->GetActiveParticleNumber();
+    if (n)
+        printf("  Active Particles: %d\n", n);
+
+    if (num_of_pressure_iterations)
+        printf("  Pressure Iterations: %.2f/frame\n",
+               static_cast<double>(num_of_pressure_iterations) /
+                   num_of_frames);
+
+    if (num_of_substeps > num_of_frames)
+        printf("  Substeps: %.2f/frame\n",
+               static_cast<double>(num_of_substeps) / num_of_frames);
+}
+
+int Run(const RunnerOptions& options)
+{
+    GraphicsLib graphics_lib = FluidConfig::Instance()->graphics_lib();
+    if (graphics_lib != GRAPHICS_LIB_CUDA && graphics_lib != GRAPHICS_LIB_CPU) {
+        printf("ERROR: Only the CUDA and CPU libraries work without a GL "
+               "context.\n");
+        return -1;
+    }
+
+    if (graphics_lib == GRAPHICS_LIB_CPU &&
+            FluidConfig::Instance()->advection_method() != CudaMain::FLIP) {
+        printf("ERROR: The CPU library only runs the FLIP solver.\n");
+        return -1;
+    }
+
+    Metrics::Instance()->set_diagnosis_mode(true);
+    if (graphics_lib == GRAPHICS_LIB_CUDA)
+        Metrics::Instance()->SetOperationSync(
+            []() { CudaMain::Instance()->Sync(); });
+
+    Metrics::Instance()->SetTimeSource(
+        []() -> double { return GetCurrentTimeInSeconds(); });
+
+    std::unique_ptr<FluidSimulator> sim(new FluidSimulator());
+    sim->set_graphics_lib(graphics_lib);
+    sim->set_solver_choice(FluidConfig::Instance()->poisson_method());
+    sim->set_grid_size(FluidConfig::Instance()->grid_size());
+    if (!sim->Init()) {
+        printf("ERROR: Failed to initialize the simulator.\n");
+        return -1;
+    }
+
+    sim->NotifyConfigChanged();
+
+    float fixed_time_step = FluidConfig::Instance()->fixed_time_step();
+    float time_step = fixed_time_step > 0.0f ?
+        fixed_time_step : options.time_step_;
+
+    // Time spent on dumping is excluded from the report.
+    double seconds_elapsed = 0.0;
+    double dump_time = 0.0;
+    double begin_time = GetCurrentTimeInSeconds();
+    bool dump_succeeded = true;
+    int num_of_pressure_iterations = 0;
+    int num_of_substeps = 0;
+    for (int i = 0; i < options.num_of_frames_; i++) {
+        seconds_elapsed += time_step;
+        sim->Update(time_step, seconds_elapsed, i + 1, nullptr, nullptr);
+        num_of_pressure_iterations +=
+            Metrics::Instance()->GetPressureIterationNumber();
+        num_of_substeps += Metrics::Instance()->GetSubstepNumber();
+
+        bool last_frame = i == options.num_of_frames_ - 1;
+        bool dump = options.dump_interval_ ?
+            (i + 1) % options.dump_interval_ == 0 : last_frame;
+        if (!options.dump_path_.empty() && dump) {
+            double t = GetCurrentTimeInSeconds();
+            dump_succeeded &= DumpFields(sim->field_owner(),
+                                         options.dump_path_, i + 1);
+            dump_time += GetCurrentTimeInSeconds() - t;
+        }
+    }
+
+    if (graphics_lib == GRAPHICS_LIB_CUDA)
+        CudaMain::Instance()->Sync();
+
+    PrintMetrics(options.num_of_frames_,
+                 GetCurrentTimeInSeconds() - begin_time - dump_time,
+                 num_of_pressure_iterations, num_of_substeps);
+
+    if (!dump_succeeded)
+        printf("ERROR: Failed to dump the fields.\n");
+
+    return dump_succeeded ? 0 : -1;
+}
+} // Anonymous namespace.
+
+int main(int argc, char* argv[])
+{
+    RunnerOptions options;
+    if (!ParseCommandLine(argc, argv, &options)) {
+        PrintUsage();
+        return -1;
+    }
+
+    LoadConfig(options);
+
+    int r = Run(options);
+    if (FluidConfig::Instance()->graphics_lib() == GRAPHICS_LIB_CPU)
+        CpuMain::DestroyInstance();
+    else
+        CudaMain::DestroyInstance();
+
+    return r;
+}
@@ -23,21 +23,31 @@
 #include "fluid_simulator.h"
 
 #include <cassert>
+#include <cmath>
 
+#include "cpu_host/cpu_main.h"
 #include "cuda_host/cuda_main.h"
 #include "cuda_host/cuda_volume.h"
 #include "fluid_config.h"
+#include "fluid_solver/adaptive_domain.h"
 #include "fluid_solver/flip_fluid_solver.h"
 #include "fluid_solver/grid_fluid_solver.h"
+#include "fluid_solver/time_step_controller.h"
 #include "graphics_volume.h"
 #include "metrics.h"
 #include "opengl/gl_volume.h"
 #include "particles.h"
+#include "poisson_solver/fft_poisson_solver.h"
 #include "poisson_solver/full_multigrid_poisson_solver.h"
+#include "poisson_solver/gauss_seidel_poisson_solver.h"
+#include "poisson_solver/jacobi_poisson_solver.h"
+#include "poisson_solver/mixed_precision_poisson_solver.h"
+#include "poisson_solver/poisson_core_cpu.h"
 #include "poisson_solver/poisson_core_cuda.h"
 #include "poisson_solver/poisson_core_glsl.h"
 #include "poisson_solver/multigrid_poisson_solver.h"
 #include "poisson_solver/open_boundary_multigrid_poisson_solver.h"
+#include "poisson_solver/pipelined_conjugate_gradient.h"
 #include "poisson_solver/preconditioned_conjugate_gradient.h"
 #include "third_party/glm/vec2.hpp"
 #include "third_party/opengl/glew.h"
@@ -47,6 +57,7 @@ const float kMaxTimeStep = 0.3f;
 
 FluidSimulator::FluidSimulator()
     : grid_size_(128)
+    , cell_size_(0.15f)
     , poisson_byte_width_(2)
     , graphics_lib_(GRAPHICS_LIB_CUDA)
     , fluid_solver_()
@@ -58,6 +69,8 @@ FluidSimulator::FluidSimulator()
     , psi_solver_()
     , manual_impulse_()
     , particles_()
+    , adaptive_domain_()
+    , time_step_controller_()
 {
 }
 
@@ -76,16 +89,60 @@ bool FluidSimulator::Init()
     PoissonSolver* pressure_solver = GetPressureSolver();
     FluidSolver* fluid_solver = GetFluidSolver();
 
-    SetPoissonSolverIterations(pressure_solver);
+    // Only the corrections are solved in |poisson_byte_width_| in mixed
+    // precision. The pressure itself is kept in fp32.
+    int byte_width = solver_choice_ == POISSON_SOLVER_MIXED_PRECISION ?
+        4 : poisson_byte_width_;
 
     SetFluidProperties(fluid_solver);
     if (!fluid_solver->Initialize(graphics_lib_, width, height, depth,
-                                  poisson_byte_width_))
+                                  byte_width))
         return false;
 
     fluid_solver->SetPressureSolver(pressure_solver);
 
-    bool separated_particles = true;
+    // The fields start around the emitter and follow the smoke from then on.
+    // Solvers that can not move their fields keep the whole domain.
+    if (FluidConfig::Instance()->adaptive_domain()) {
+        float splat_radius = std::min(grid_size_.x, grid_size_.y) *
+            FluidConfig::Instance()->splat_radius_factor();
+        glm::vec3 pos =
+            FluidConfig::Instance()->emit_position() * glm::vec3(grid_size_);
+        if (FluidConfig::Instance()->fluid_impluse() ==
+                CudaMain::IMPULSE_BUOYANT_JET)
+            pos.y = splat_radius + grid_size_.y * 0.2f;
+
+        glm::ivec3 lower;
+        glm::ivec3 upper;
+        GetEmitterBox(pos, glm::vec3(pos.x, 0.0f, pos.z), splat_radius,
+                      &lower, &upper);
+
+        adaptive_domain_.reset(new AdaptiveDomain());
+        int padding = FluidConfig::Instance()->adaptive_domain_padding();
+        glm::ivec3 origin;
+        glm::ivec3 size;
+        if (adaptive_domain_->Initialize(grid_size_, padding))
+            adaptive_domain_->FitRegion(lower, upper, &origin, &size);
+        else
+            adaptive_domain_.reset();
+
+        if (adaptive_domain_ && !RewindowFields(origin, size))
+            adaptive_domain_.reset();
+    }
+
+    // The velocity is measured in CUDA and on the host. The other libraries
+    // keep one step a frame.
+    time_step_controller_.reset(new TimeStepController());
+    if (!time_step_controller_->Initialize(graphics_lib_)) {
+        time_step_controller_.reset();
+        if (FluidConfig::Instance()->cfl_number() > 0.0f)
+            PrintDebugString("WARNING: \"cfl number\" is only supported by "
+                             "the CUDA and CPU libraries, keeping one step a "
+                             "frame.\n");
+    }
+
+    // Particles are only implemented in CUDA.
+    bool separated_particles = graphics_lib_ == GRAPHICS_LIB_CUDA;
     if (separated_particles) {
         particles_.reset(
             new Particles(FluidConfig::Instance()->max_num_particles()));
@@ -113,15 +170,30 @@ void FluidSimulator::NotifyConfigChanged()
     float cell_size = FluidConfig::Instance()->domain_size();
     glm::vec3 grid_size = FluidConfig::Instance()->grid_size();
     cell_size /= std::max(std::max(grid_size.x, grid_size.y), grid_size.z);
-
-    CudaMain::Instance()->SetCellSize(cell_size);
-    CudaMain::Instance()->SetStaggered(FluidConfig::Instance()->staggered());
-    CudaMain::Instance()->SetMidPoint(FluidConfig::Instance()->mid_point());
-    CudaMain::Instance()->SetOutflow(FluidConfig::Instance()->outflow());
-    CudaMain::Instance()->SetAdvectionMethod(
-        FluidConfig::Instance()->advection_method());
-    CudaMain::Instance()->SetFluidImpulse(
-        FluidConfig::Instance()->fluid_impluse());
+    cell_size_ = cell_size;
+
+    if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        CpuMain::Instance()->SetCellSize(cell_size);
+        CpuMain::Instance()->SetOutflow(FluidConfig::Instance()->outflow());
+        CpuMain::Instance()->SetFluidImpulse(
+            FluidConfig::Instance()->fluid_impluse());
+        CpuMain::Instance()->SetMaxSortChurn(
+            FluidConfig::Instance()->max_sort_churn());
+        CpuMain::Instance()->SetParticlesPerCell(
+            FluidConfig::Instance()->particles_per_cell(),
+            FluidConfig::Instance()->min_particles_per_cell(),
+            FluidConfig::Instance()->reseed_density_threshold());
+    } else {
+        CudaMain::Instance()->SetCellSize(cell_size);
+        CudaMain::Instance()->SetStaggered(
+            FluidConfig::Instance()->staggered());
+        CudaMain::Instance()->SetMidPoint(FluidConfig::Instance()->mid_point());
+        CudaMain::Instance()->SetOutflow(FluidConfig::Instance()->outflow());
+        CudaMain::Instance()->SetAdvectionMethod(
+            FluidConfig::Instance()->advection_method());
+        CudaMain::Instance()->SetFluidImpulse(
+            FluidConfig::Instance()->fluid_impluse());
+    }
 
     SetFluidProperties(fluid_solver_.get());
 
@@ -202,6 +274,24 @@ void FluidSimulator::Update(float delta_time, double seconds_elapsed,
     if (velocity)
         initial_velocity = *velocity;
 
+    if (adaptive_domain_) {
+        glm::ivec3 lower;
+        glm::ivec3 upper;
+        GetEmitterBox(pos, hotspot, splat_radius, &lower, &upper);
+
+        glm::ivec3 origin;
+        glm::ivec3 size;
+        float threshold = FluidConfig::Instance()->active_velocity_threshold();
+        if (adaptive_domain_->Fit(field_owner_, threshold, lower, upper,
+                                  &origin, &size))
+            RewindowFields(origin, size);
+
+        // From here on, the emitter is placed in the cells of the window.
+        glm::vec3 window_origin(adaptive_domain_->window_origin());
+        pos -= window_origin;
+        hotspot -= window_origin;
+    }
+
     if (do_impulse)
         fluid_solver_->Impulse(splat_radius, pos, hotspot, impulse_density,
                                impulse_temperature, initial_velocity);
@@ -209,10 +299,34 @@ void FluidSimulator::Update(float delta_time, double seconds_elapsed,
     if (particles_ && do_impulse)
         particles_->Emit(pos, splat_radius, impulse_density);
 
-    fluid_solver_->Solve(proper_delta_time);
+    int num_of_substeps = 1;
+    float time_step = proper_delta_time;
+    if (time_step_controller_)
+        num_of_substeps = time_step_controller_->Plan(
+            field_owner_, proper_delta_time, cell_size_,
+            FluidConfig::Instance()->cfl_number(),
+            FluidConfig::Instance()->max_num_substeps(), &time_step);
+
+    Metrics::Instance()->OnTimeStepUpdated(time_step, num_of_substeps);
+
+    // The impulse goes into the first substep only, so that the amount of
+    // smoke per frame does not depend on the splitting.
+    //
+    // Metrics only keeps the iterations of the latest solve, so they are
+    // summed up over the substeps and reported per frame.
+    int num_of_pressure_iterations = 0;
+    for (int i = 0; i < num_of_substeps; i++) {
+        Metrics::Instance()->OnPressureIterationNumberUpdated(0);
+        fluid_solver_->Solve(time_step);
+        num_of_pressure_iterations +=
+            Metrics::Instance()->GetPressureIterationNumber();
+
+        if (particles_)
+            particles_->Advect(time_step, field_owner_->GetVelocityField());
+    }
 
-    if (particles_)
-        particles_->Advect(proper_delta_time, field_owner_->GetVelocityField());
+    Metrics::Instance()->OnPressureIterationNumberUpdated(
+        num_of_pressure_iterations);
 }
 
 void FluidSimulator::UpdateImpulsing(float x, float y)
@@ -227,50 +341,81 @@ void FluidSimulator::set_diagnosis(int diagnosis)
     fluid_solver_->SetDiagnosis(diagnosis);
 }
 
+glm::ivec3 FluidSimulator::window_origin() const
+{
+    return adaptive_domain_ ? adaptive_domain_->window_origin() :
+        glm::ivec3(0);
+}
+
+glm::ivec3 FluidSimulator::window_size() const
+{
+    return adaptive_domain_ ? adaptive_domain_->window_size() : grid_size_;
+}
+
 PoissonSolver* FluidSimulator::GetPressureSolver()
 {
     if (!multigrid_core_) {
         if (graphics_lib_ == GRAPHICS_LIB_CUDA)
             multigrid_core_.reset(new PoissonCoreCuda());
+        else if (graphics_lib_ == GRAPHICS_LIB_CPU)
+            multigrid_core_.reset(new PoissonCoreCpu());
         else
             multigrid_core_.reset(new PoissonCoreGlsl());
     }
 
+    if (!pressure_solver_)
+        pressure_solver_ = CreatePoissonSolver(grid_size_);
+
+    return pressure_solver_.get();
+}
+
+std::unique_ptr<PoissonSolver> FluidSimulator::CreatePoissonSolver(
+    const glm::ivec3& size)
+{
+    std::unique_ptr<PoissonSolver> solver;
     switch (solver_choice_) {
-        case POISSON_SOLVER_JACOBI:
-        case POISSON_SOLVER_GAUSS_SEIDEL:
+        case POISSON_SOLVER_JACOBI: {
+            solver.reset(new JacobiPoissonSolver(multigrid_core_.get(), 1.0f));
+            break;
+        }
         case POISSON_SOLVER_DAMPED_JACOBI: {
-            //DampedJacobi(pressure, divergence);
+            solver.reset(
+                new JacobiPoissonSolver(multigrid_core_.get(), 2.0f / 3.0f));
+            break;
+        }
+        case POISSON_SOLVER_GAUSS_SEIDEL: {
+            solver.reset(new GaussSeidelPoissonSolver(multigrid_core_.get()));
             break;
         }
         case POISSON_SOLVER_MULTI_GRID: {
-            if (!pressure_solver_) {
-                pressure_solver_.reset(
-                    new MultigridPoissonSolver(multigrid_core_.get()));
-                pressure_solver_->Initialize(grid_size_.x, grid_size_.y,
-                                             grid_size_.z, poisson_byte_width_,
-                                             32);
-            }
+            solver.reset(new MultigridPoissonSolver(multigrid_core_.get()));
             break;
         }
         case POISSON_SOLVER_FULL_MULTI_GRID: {
-            if (!pressure_solver_) {
-                pressure_solver_.reset(
-                    new FullMultigridPoissonSolver(multigrid_core_.get()));
-                pressure_solver_->Initialize(grid_size_.x, grid_size_.y,
-                                             grid_size_.z, poisson_byte_width_,
-                                             32);
-            }
+            solver.reset(
+                new FullMultigridPoissonSolver(multigrid_core_.get()));
             break;
         }
         case POISSON_SOLVER_MULTI_GRID_PRECONDITIONED_CONJUGATE_GRADIENT: {
-            if (!pressure_solver_) {
-                pressure_solver_.reset(
-                    new PreconditionedConjugateGradient(multigrid_core_.get()));
-                pressure_solver_->Initialize(grid_size_.x, grid_size_.y,
-                                             grid_size_.z, poisson_byte_width_,
-                                             32);
-            }
+            solver.reset(
+                new PreconditionedConjugateGradient(multigrid_core_.get()));
+            break;
+        }
+        case POISSON_SOLVER_PIPELINED_CONJUGATE_GRADIENT: {
+            solver.reset(
+                new PipelinedConjugateGradient(multigrid_core_.get()));
+            break;
+        }
+        case POISSON_SOLVER_FFT: {
+            solver.reset(new FftPoissonSolver(multigrid_core_.get()));
+            break;
+        }
+        case POISSON_SOLVER_MIXED_PRECISION: {
+            std::unique_ptr<PoissonSolver> nested(
+                new MultigridPoissonSolver(multigrid_core_.get()));
+            solver.reset(
+                new MixedPrecisionPoissonSolver(multigrid_core_.get(),
+                                                std::move(nested)));
             break;
         }
         default: {
@@ -278,7 +423,14 @@ PoissonSolver* FluidSimulator::GetPressureSolver()
         }
     }
 
-    return pressure_solver_.get();
+    if (!solver)
+        return solver;
+
+    if (!solver->Initialize(size.x, size.y, size.z, poisson_byte_width_, 32))
+        return std::unique_ptr<PoissonSolver>();
+
+    SetPoissonSolverIterations(solver.get());
+    return solver;
 }
 
 FluidSolver* FluidSimulator::GetFluidSolver()
@@ -286,7 +438,8 @@ FluidSolver* FluidSimulator::GetFluidSolver()
     if (!fluid_solver_) {
         if (FluidConfig::Instance()->advection_method() == CudaMain::FLIP) {
             FlipFluidSolver* solver = new FlipFluidSolver(
-                FluidConfig::Instance()->max_num_particles());
+                FluidConfig::Instance()->max_num_particles(),
+                FluidConfig::Instance()->apic_transfer());
             fluid_solver_.reset(solver);
             field_owner_ = solver;
             buf_owner_ = solver;
@@ -301,6 +454,60 @@ FluidSolver* FluidSimulator::GetFluidSolver()
     return fluid_solver_.get();
 }
 
+void FluidSimulator::GetEmitterBox(const glm::vec3& position,
+                                   const glm::vec3& hotspot,
+                                   float splat_radius, glm::ivec3* lower,
+                                   glm::ivec3* upper)
+{
+    // The boxes enclose what the impulse may write to. The hot floor and the
+    // jet are attached to the walls of the domain.
+    glm::vec3 first = position - splat_radius;
+    glm::vec3 last = position + splat_radius;
+    CudaMain::FluidImpulse impulse = FluidConfig::Instance()->fluid_impluse();
+    if (impulse == CudaMain::IMPULSE_HOT_FLOOR) {
+        first = glm::vec3(hotspot.x - splat_radius, 0.0f,
+                          hotspot.z - splat_radius);
+        last = glm::vec3(hotspot.x + splat_radius,
+                         0.025f * grid_size_.y + 2.0f,
+                         hotspot.z + splat_radius);
+    } else if (impulse == CudaMain::IMPULSE_BUOYANT_JET) {
+        first.x = 0.0f;
+        last.x = 0.02f * grid_size_.x + 2.0f;
+    }
+
+    for (int j = 0; j < 3; j++) {
+        (*lower)[j] = std::max(static_cast<int>(first[j]), 0);
+        (*upper)[j] = std::min(static_cast<int>(std::ceil(last[j])),
+                               grid_size_[j]);
+    }
+}
+
+bool FluidSimulator::RewindowFields(const glm::ivec3& origin,
+                                    const glm::ivec3& size)
+{
+    // The solvers are built for the size of the fields. A window that only
+    // moves keeps its solver. The new one is ready before the fields move,
+    // so that a failure leaves the old window in place.
+    std::unique_ptr<PoissonSolver> pressure_solver;
+    if (size != adaptive_domain_->window_size()) {
+        pressure_solver = CreatePoissonSolver(size);
+        if (!pressure_solver)
+            return false;
+    }
+
+    glm::ivec3 offset = origin - adaptive_domain_->window_origin();
+    if (!fluid_solver_->Rewindow(offset, size))
+        return false;
+
+    adaptive_domain_->SetWindow(origin, size);
+    if (pressure_solver) {
+        pressure_solver_ = std::move(pressure_solver);
+        fluid_solver_->SetPressureSolver(pressure_solver_.get());
+    }
+
+    return true;
+}
+
 void FluidSimulator::SetFluidProperties(FluidSolver* fluid_solver)
 {
     FluidSolver::FluidProperties properties;
@@ -317,6 +524,10 @@ void FluidSimulator::SetFluidProperties(FluidSolver* fluid_solver)
         FluidConfig::Instance()->vorticity_confinement();
     properties.weight_ =
         FluidConfig::Instance()->smoke_weight();
+    properties.pressure_warm_start_ =
+        FluidConfig::Instance()->pressure_warm_start();
+    properties.extrapolate_pressure_ =
+        FluidConfig::Instance()->extrapolate_pressure();
 
     fluid_solver->SetProperties(properties);
 }
@@ -328,7 +539,8 @@ void FluidSimulator::SetPoissonSolverIterations(PoissonSolver* poisson_solver)
     switch (solver_choice_) {
         case POISSON_SOLVER_JACOBI:
         case POISSON_SOLVER_GAUSS_SEIDEL:
-        case POISSON_SOLVER_DAMPED_JACOBI: {
+        case POISSON_SOLVER_DAMPED_JACOBI:
+        case POISSON_SOLVER_FFT: {
             num_iterations =
                 FluidConfig::Instance()->num_jacobi_iterations();
             break;
@@ -347,20 +559,45 @@ void FluidSimulator::SetPoissonSolverIterations(PoissonSolver* poisson_solver)
                 FluidConfig::Instance()->num_multigrid_iterations();
             break;
         }
-        case POISSON_SOLVER_MULTI_GRID_PRECONDITIONED_CONJUGATE_GRADIENT: {
+        case POISSON_SOLVER_MULTI_GRID_PRECONDITIONED_CONJUGATE_GRADIENT:
+        case POISSON_SOLVER_PIPELINED_CONJUGATE_GRADIENT: {
             num_iterations =
                 FluidConfig::Instance()->num_mgpcg_iterations();
             num_nested_iterations =
                 FluidConfig::Instance()->num_multigrid_iterations();
             break;
         }
+        case POISSON_SOLVER_MIXED_PRECISION: {
+            num_iterations =
+                FluidConfig::Instance()->num_refinement_iterations();
+            num_nested_iterations =
+                FluidConfig::Instance()->num_multigrid_iterations();
+            break;
+        }
         default: {
             break;
         }
     }
 
-    assert(pressure_solver_);
-    if (pressure_solver_)
-        pressure_solver_->SetNumOfIterations(num_iterations,
-                                             num_nested_iterations);
+    // With a tolerance given, the solver terminates as soon as the residual
+    // is small enough, and the iteration number turns into a cap.
+    float tolerance = FluidConfig::Instance()->poisson_tolerance();
+    float absolute_tolerance =
+        FluidConfig::Instance()->poisson_absolute_tolerance();
+    int max_iterations = FluidConfig::Instance()->max_poisson_iterations();
+    if ((tolerance > 0.0f || absolute_tolerance > 0.0f) && max_iterations > 0)
+        num_iterations = max_iterations;
+
+    assert(poisson_solver);
+    if (poisson_solver) {
+        poisson_solver->SetNumOfIterations(num_iterations,
+                                           num_nested_iterations);
+        poisson_solver->SetTolerance(tolerance, absolute_tolerance);
+    }
+
+    if (multigrid_core_) {
+        multigrid_core_->set_smoother(
+            FluidConfig::Instance()->poisson_smoother());
+        multigrid_core_->set_outflow(FluidConfig::Instance()->outflow());
+    }
 }
@@ -29,6 +29,7 @@
 #include "poisson_solver/poisson_solver_enum.h"
 #include "third_party/glm/vec3.hpp"
 
+class AdaptiveDomain;
 class FluidFieldOwner;
 class FluidSolver;
 class FluidUnittest;
@@ -38,6 +39,7 @@ class Particles;
 class ParticleBufferOwner;
 class PoissonCore;
 class PoissonSolver;
+class TimeStepController;
 class FluidSimulator
 {
 public:
@@ -62,14 +64,24 @@ public:
     void set_graphics_lib(GraphicsLib lib) { graphics_lib_ = lib; }
     void set_grid_size(const glm::ivec3& size) { grid_size_ = size; }
 
+    // The part of the grid that the fields cover.
+    glm::ivec3 window_origin() const;
+    glm::ivec3 window_size() const;
+
 private:
     PoissonSolver* GetPressureSolver();
+    std::unique_ptr<PoissonSolver> CreatePoissonSolver(const glm::ivec3& size);
     FluidSolver* GetFluidSolver();
+    void GetEmitterBox(const glm::vec3& position, const glm::vec3& hotspot,
+                       float splat_radius, glm::ivec3* lower,
+                       glm::ivec3* upper);
+    bool RewindowFields(const glm::ivec3& origin, const glm::ivec3& size);
 
     void SetFluidProperties(FluidSolver* fluid_solver);
     void SetPoissonSolverIterations(PoissonSolver* poisson_solver);
     
     glm::ivec3 grid_size_;
+    float cell_size_;
     int poisson_byte_width_;
     GraphicsLib graphics_lib_;
     std::unique_ptr<FluidSolver> fluid_solver_;
@@ -81,6 +93,8 @@ private:
     std::unique_ptr<PoissonSolver> psi_solver_;
     std::shared_ptr<glm::vec2> manual_impulse_;
     std::unique_ptr<Particles> particles_;
+    std::unique_ptr<AdaptiveDomain> adaptive_domain_;
+    std::unique_ptr<TimeStepController> time_step_controller_;
 };
 
 #endif // _FLUID_SIMULATOR_H_
\ No newline at end of file
@@ -0,0 +1,212 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "adaptive_domain.h"
+
+#include <algorithm>
+
+#include "cuda_host/cuda_main.h"
+#include "fluid_field_owner.h"
+#include "graphics_mem_piece.h"
+#include "graphics_volume.h"
+#include "graphics_volume_group.h"
+
+namespace
+{
+const int kBrickSize = 8;
+
+// The window is measured every so many frames. The smoke hardly moves more
+// than the padding in the meantime.
+const int kCheckInterval = 10;
+
+// The window moves in steps, so that the solvers find the sizes they like,
+// and a little wobble of the smoke does not rebuild anything.
+const int kWindowStep = 16;
+
+// Any smoke thinner than this is regarded as clean air.
+const float kDensityThreshold = 0.001f;
+
+// Shrinking is delayed until the fitted window stays much smaller than the
+// current one for a while, or the window would bounce back and forth as the
+// puffs come and go.
+const float kShrinkRatio = 0.5f;
+const int kNumOfShrinkChecks = 3;
+
+int Volume(const glm::ivec3& size)
+{
+    return size.x * size.y * size.z;
+}
+} // Anonymous namespace.
+
+// The occupied region is found on the bricks that either carry smoke or
+// move faster than the threshold. It is padded and united with the emitter
+// box, then rounded to the step and clamped to the domain. The window grows
+// as soon as the padded region pokes out of it.
+
+AdaptiveDomain::AdaptiveDomain()
+    : domain_size_(0)
+    , padding_(0)
+    , window_origin_(0)
+    , window_size_(0)
+    , occupied_bricks_()
+    , brick_flags_()
+    , num_of_frames_(0)
+    , num_of_shrink_checks_(0)
+{
+
+}
+
+AdaptiveDomain::~AdaptiveDomain()
+{
+
+}
+
+bool AdaptiveDomain::Initialize(const glm::ivec3& domain_size, int padding)
+{
+    domain_size_ = domain_size;
+    padding_ = std::max(padding, 0);
+
+    // The window never exceeds the domain, so the flags of the domain are
+    // enough for every window.
+    glm::ivec3 num_of_bricks = (domain_size_ + kBrickSize - 1) / kBrickSize;
+    int num_of_flags = Volume(num_of_bricks);
+    occupied_bricks_ = std::make_shared<GraphicsMemPiece>(GRAPHICS_LIB_CUDA);
+    if (!occupied_bricks_->Create(num_of_flags)) {
+        occupied_bricks_.reset();
+        return false;
+    }
+
+    brick_flags_.resize(num_of_flags);
+    window_origin_ = glm::ivec3(0);
+    window_size_ = domain_size_;
+    num_of_frames_ = 0;
+    num_of_shrink_checks_ = 0;
+    return true;
+}
+
+bool AdaptiveDomain::Fit(FluidFieldOwner* field_owner,
+                         float velocity_threshold,
+                         const glm::ivec3& emitter_lower,
+                         const glm::ivec3& emitter_upper, glm::ivec3* origin,
+                         glm::ivec3* size)
+{
+    if (!occupied_bricks_ || ++num_of_frames_ % kCheckInterval)
+        return false;
+
+    GraphicsVolume3* velocity = field_owner->GetVelocityField();
+    GraphicsVolume* density = field_owner->GetDensityField();
+    if (!velocity || !density)
+        return false;
+
+    glm::ivec3 lower = emitter_lower;
+    glm::ivec3 upper = emitter_upper;
+    FindOccupiedRegion(*velocity->x(), *velocity->y(), *velocity->z(),
+                       velocity_threshold, &lower, &upper);
+    FindOccupiedRegion(*density, *density, *density, kDensityThreshold,
+                       &lower, &upper);
+
+    glm::ivec3 fitted_origin;
+    glm::ivec3 fitted_size;
+    FitRegion(lower, upper, &fitted_origin, &fitted_size);
+    if (fitted_origin == window_origin_ && fitted_size == window_size_) {
+        num_of_shrink_checks_ = 0;
+        return false;
+    }
+
+    bool grow = false;
+    for (int j = 0; j < 3; j++) {
+        grow |= fitted_origin[j] < window_origin_[j];
+        grow |= fitted_origin[j] + fitted_size[j] >
+            window_origin_[j] + window_size_[j];
+    }
+
+    if (!grow) {
+        if (Volume(fitted_size) > kShrinkRatio * Volume(window_size_)) {
+            num_of_shrink_checks_ = 0;
+            return false;
+        }
+
+        if (++num_of_shrink_checks_ < kNumOfShrinkChecks)
+            return false;
+    }
+
+    num_of_shrink_checks_ = 0;
+    *origin = fitted_origin;
+    *size = fitted_size;
+    return true;
+}
+
+void AdaptiveDomain::FitRegion(const glm::ivec3& lower,
+                               const glm::ivec3& upper, glm::ivec3* origin,
+                               glm::ivec3* size) const
+{
+    for (int j = 0; j < 3; j++) {
+        int first = std::max(lower[j] - padding_, 0) / kWindowStep;
+        int last = (upper[j] + padding_ + kWindowStep - 1) / kWindowStep;
+        (*origin)[j] = first * kWindowStep;
+        (*size)[j] = std::min(last * kWindowStep, domain_size_[j]) -
+            (*origin)[j];
+    }
+}
+
+void AdaptiveDomain::SetWindow(const glm::ivec3& origin,
+                               const glm::ivec3& size)
+{
+    window_origin_ = origin;
+    window_size_ = size;
+}
+
+void AdaptiveDomain::FindOccupiedRegion(const GraphicsVolume& x,
+                                        const GraphicsVolume& y,
+                                        const GraphicsVolume& z,
+                                        float threshold, glm::ivec3* lower,
+                                        glm::ivec3* upper)
+{
+    CudaMain::Instance()->FindActiveBricks(
+        occupied_bricks_->cuda_mem_piece(), x.cuda_volume(), y.cuda_volume(),
+        z.cuda_volume(), threshold, kBrickSize);
+
+    glm::ivec3 num_of_bricks = (window_size_ + kBrickSize - 1) / kBrickSize;
+    int num_of_flags = Volume(num_of_bricks);
+    CudaMain::Instance()->CopyFromMemPiece(&brick_flags_[0],
+                                           occupied_bricks_->cuda_mem_piece(),
+                                           num_of_flags);
+
+    int i = 0;
+    for (int bz = 0; bz < num_of_bricks.z; bz++) {
+        for (int by = 0; by < num_of_bricks.y; by++) {
+            for (int bx = 0; bx < num_of_bricks.x; bx++, i++) {
+                if (!brick_flags_[i])
+                    continue;
+
+                glm::ivec3 brick(bx, by, bz);
+                for (int j = 0; j < 3; j++) {
+                    int first = window_origin_[j] + brick[j] * kBrickSize;
+                    int last = std::min(first + kBrickSize,
+                                        window_origin_[j] + window_size_[j]);
+                    (*lower)[j] = std::min((*lower)[j], first);
+                    (*upper)[j] = std::max((*upper)[j], last);
+                }
+            }
+        }
+    }
+}
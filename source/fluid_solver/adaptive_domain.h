@@ -0,0 +1,76 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _ADAPTIVE_DOMAIN_H_
+#define _ADAPTIVE_DOMAIN_H_
+
+#include <memory>
+#include <vector>
+
+#include <stdint.h>
+
+#include "third_party/glm/vec3.hpp"
+
+class FluidFieldOwner;
+class GraphicsMemPiece;
+class GraphicsVolume;
+class AdaptiveDomain
+{
+public:
+    AdaptiveDomain();
+    ~AdaptiveDomain();
+
+    // The window covers the whole domain until told otherwise.
+    bool Initialize(const glm::ivec3& domain_size, int padding);
+
+    // Measures the region the smoke occupies once in a while. Returns true
+    // with the window that should be taken, which only becomes effective
+    // after SetWindow() is called. The emitter box and the window are given
+    // in the cells of the domain.
+    bool Fit(FluidFieldOwner* field_owner, float velocity_threshold,
+             const glm::ivec3& emitter_lower, const glm::ivec3& emitter_upper,
+             glm::ivec3* origin, glm::ivec3* size);
+
+    // Pads the region and rounds it to a window within the domain.
+    void FitRegion(const glm::ivec3& lower, const glm::ivec3& upper,
+                   glm::ivec3* origin, glm::ivec3* size) const;
+    void SetWindow(const glm::ivec3& origin, const glm::ivec3& size);
+
+    const glm::ivec3& domain_size() const { return domain_size_; }
+    const glm::ivec3& window_origin() const { return window_origin_; }
+    const glm::ivec3& window_size() const { return window_size_; }
+
+private:
+    void FindOccupiedRegion(const GraphicsVolume& x, const GraphicsVolume& y,
+                            const GraphicsVolume& z, float threshold,
+                            glm::ivec3* lower, glm::ivec3* upper);
+
+    glm::ivec3 domain_size_;
+    int padding_;
+    glm::ivec3 window_origin_;
+    glm::ivec3 window_size_;
+    std::shared_ptr<GraphicsMemPiece> occupied_bricks_;
+    std::vector<uint8_t> brick_flags_;
+    int num_of_frames_;
+    int num_of_shrink_checks_;
+};
+
+#endif // _ADAPTIVE_DOMAIN_H_
\ No newline at end of file
@@ -22,6 +22,10 @@
 #include "stdafx.h"
 #include "flip_fluid_solver.h"
 
+#include <algorithm>
+
+#include "cpu_host/cpu_main.h"
+#include "cpu_host/cpu_volume.h"
 #include "cuda_host/cuda_main.h"
 #include "cuda_host/cuda_volume.h"
 #include "graphics_linear_mem.h"
@@ -32,6 +36,7 @@
 #include "poisson_solver/poisson_solver.h"
 #include "third_party/glm/vec2.hpp"
 #include "third_party/glm/vec3.hpp"
+#include "utility.h"
 
 namespace
 {
@@ -77,6 +82,28 @@ void SetCudaParticles(U* cuda_p, const V& p)
     cuda_p->num_of_actives_   = p->num_of_actives_ ? p->num_of_actives_->cuda_mem_piece() : nullptr;
     cuda_p->num_of_particles_ = p->num_of_particles_;
 }
+
+template <typename U, typename V>
+void SetCpuParticles(U* cpu_p, const V& p)
+{
+    cpu_p->particle_index_   = p->particle_index_ ? p->particle_index_->cpu_linear_mem() : nullptr;
+    cpu_p->cell_index_       = p->cell_index_->cpu_linear_mem();
+    cpu_p->in_cell_index_    = p->in_cell_index_->cpu_linear_mem();
+    cpu_p->particle_count_   = p->particle_count_ ? p->particle_count_->cpu_linear_mem() : nullptr;
+    cpu_p->position_x_       = p->position_x_->cpu_linear_mem();
+    cpu_p->position_y_       = p->position_y_->cpu_linear_mem();
+    cpu_p->position_z_       = p->position_z_->cpu_linear_mem();
+    cpu_p->velocity_x_       = p->velocity_x_->cpu_linear_mem();
+    cpu_p->velocity_y_       = p->velocity_y_->cpu_linear_mem();
+    cpu_p->velocity_z_       = p->velocity_z_->cpu_linear_mem();
+    cpu_p->density_          = p->density_->cpu_linear_mem();
+    cpu_p->temperature_      = p->temperature_->cpu_linear_mem();
+    for (int i = 0; i < 9; i++)
+        cpu_p->affine_[i] = p->affine_[i] ? p->affine_[i]->cpu_linear_mem() : nullptr;
+
+    cpu_p->num_of_actives_   = p->num_of_actives_ ? p->num_of_actives_->cpu_mem_piece() : nullptr;
+    cpu_p->num_of_particles_ = p->num_of_particles_;
+}
 } // Anonymous namespace
 
 struct FlipFluidSolver::FlipParticles
@@ -94,6 +121,7 @@ struct FlipFluidSolver::FlipParticles
     std::shared_ptr<GraphicsLinearMemU16> velocity_z_;
     std::shared_ptr<GraphicsLinearMemU16> density_;
     std::shared_ptr<GraphicsLinearMemU16> temperature_;
+    std::shared_ptr<GraphicsLinearMemU16> affine_[9];
     std::shared_ptr<GraphicsMemPiece>     num_of_actives_;
     int                                   num_of_particles_;
 
@@ -110,19 +138,21 @@ struct FlipFluidSolver::FlipParticles
         , velocity_z_()
         , density_()
         , temperature_()
+        , affine_()
         , num_of_actives_()
         , num_of_particles_(0)
     {
     }
 };
 
-FlipFluidSolver::FlipFluidSolver(int max_num_particles)
+FlipFluidSolver::FlipFluidSolver(int max_num_particles, bool apic_transfer)
     : FluidSolver()
     , FluidFieldOwner()
     , ParticleBufferOwner()
     , graphics_lib_(GRAPHICS_LIB_CUDA)
     , grid_size_(128)
     , max_num_particles_(max_num_particles)
+    , apic_transfer_(apic_transfer)
     , pressure_solver_(nullptr)
     , diagnosis_(DIAG_NONE)
     , velocity_()
@@ -159,12 +189,34 @@ void FlipFluidSolver::Impulse(float splat_radius,
             &p, impulse_position, hotspot, splat_radius, impulse_density,
             impulse_temperature, impulse_velocity,
             density_->cuda_volume()->size());
+    } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        CpuMain::FlipParticles p;
+        SetCpuParticles(&p, particles_);
+        CpuMain::Instance()->EmitFlipParticles(
+            &p, impulse_position, hotspot, splat_radius, impulse_density,
+            impulse_temperature, impulse_velocity,
+            density_->cpu_volume()->size());
     }
 }
 
 bool FlipFluidSolver::Initialize(GraphicsLib graphics_lib, int width,
                                  int height, int depth, int poisson_byte_width)
 {
+    // Particles are only implemented in CUDA and on the host.
+    if (graphics_lib != GRAPHICS_LIB_CUDA && graphics_lib != GRAPHICS_LIB_CPU)
+        return false;
+
+    graphics_lib_ = graphics_lib;
+
+    // APIC is only implemented on the host. Without the affine fields, CUDA
+    // stays on FLIP.
+    bool apic_transfer = apic_transfer_;
+    if (apic_transfer && graphics_lib_ != GRAPHICS_LIB_CPU) {
+        PrintDebugString("WARNING: APIC transfer is only supported by the "
+                         "CPU library, falling back to FLIP.\n");
+        apic_transfer = false;
+    }
+
     velocity_ = std::make_shared<GraphicsVolume3>(graphics_lib_);
     velocity_prev_ = std::make_shared<GraphicsVolume3>(graphics_lib_);
     density_ = std::make_shared<GraphicsVolume>(graphics_lib_);
@@ -206,16 +258,20 @@ bool FlipFluidSolver::Initialize(GraphicsLib graphics_lib, int width,
 
     int cell_count = grid_size_.x * grid_size_.y * grid_size_.z;
     result = InitParticles(particles_.get(), graphics_lib_, cell_count,
-                           max_num_particles_, false);
+                           max_num_particles_, apic_transfer, false);
     assert(result);
     if (!result)
         return false;
 
-    result = InitParticles(particles_aux_.get(), graphics_lib_, cell_count,
-                           max_num_particles_, true);
-    assert(result);
-    if (!result)
-        return false;
+    // The host backend sorts the particles in place, so it needs no
+    // auxiliary set of particles.
+    if (graphics_lib_ != GRAPHICS_LIB_CPU) {
+        result = InitParticles(particles_aux_.get(), graphics_lib_, cell_count,
+                               max_num_particles_, apic_transfer, true);
+        assert(result);
+        if (!result)
+            return false;
+    }
 
     Reset();
     return true;
@@ -251,8 +307,13 @@ void FlipFluidSolver::Reset()
         CudaMain::FlipParticles p;
         SetCudaParticles(&p, particles_);
         CudaMain::Instance()->ResetFlipParticles(&p, grid_size_);
+    } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        CpuMain::FlipParticles p;
+        SetCpuParticles(&p, particles_);
+        CpuMain::Instance()->ResetFlipParticles(&p, grid_size_);
     }
 
+    ResetPressure(false);
     frame_ = 0;
     Metrics::Instance()->Reset();
 }
@@ -279,19 +340,12 @@ void FlipFluidSolver::Solve(float delta_time)
     ApplyBuoyancy(delta_time);
     Metrics::Instance()->OnBuoyancyApplied();
 
-    // Calculate divergence.
-    ComputeDivergence(general1a_);
-    Metrics::Instance()->OnDivergenceComputed();
+    Project(delta_time, general1a_, general1b_);
 
-    // Solve pressure-velocity Poisson equation
-    SolvePressure(general1b_, general1a_);
-    Metrics::Instance()->OnPressureSolved();
+    if (graphics_lib_ == GRAPHICS_LIB_CUDA)
+        CudaMain::Instance()->RoundPassed(frame_);
 
-    // Rectify velocity via the gradient of pressure
-    SubtractGradient(general1b_);
-    Metrics::Instance()->OnVelocityRectified();
-
-    CudaMain::Instance()->RoundPassed(frame_++);
+    frame_++;
 }
 
 GraphicsVolume* FlipFluidSolver::GetDensityField()
@@ -341,7 +395,7 @@ GraphicsLinearMemU16* FlipFluidSolver::GetParticleTemperatureField()
 
 bool FlipFluidSolver::InitParticles(FlipParticles* particles, GraphicsLib lib,
                                     int cell_count, int max_num_particles,
-                                    bool aux)
+                                    bool apic_transfer, bool aux)
 {
     bool result = true;
     int n = max_num_particles;
@@ -358,6 +412,12 @@ bool FlipFluidSolver::InitParticles(FlipParticles* particles, GraphicsLib lib,
     result &= InitParticleField(&particles->density_,       lib, n);
     result &= InitParticleField(&particles->temperature_,   lib, n);
 
+    // The backends transfer in APIC mode whenever the affine fields are
+    // present.
+    if (apic_transfer)
+        for (auto& field : particles->affine_)
+            result &= InitParticleField(&field, lib, n);
+
     if (!aux) {
         particles->num_of_actives_ = std::make_shared<GraphicsMemPiece>(lib);
         result &= particles->num_of_actives_->Create(sizeof(int));
@@ -388,6 +448,15 @@ void FlipFluidSolver::ApplyBuoyancy(float delta_time)
             velocity_prev_->z()->cuda_volume(),
             temperature_->cuda_volume(), density_->cuda_volume(),
             delta_time, ambient_temperature, buoyancy_coef, smoke_weight);
+    } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        CpuMain::Instance()->ApplyBuoyancy(
+            velocity_->x()->cpu_volume(), velocity_->y()->cpu_volume(),
+            velocity_->z()->cpu_volume(),
+            velocity_prev_->x()->cpu_volume(),
+            velocity_prev_->y()->cpu_volume(),
+            velocity_prev_->z()->cpu_volume(),
+            temperature_->cpu_volume(), density_->cpu_volume(),
+            delta_time, ambient_temperature, buoyancy_coef, smoke_weight);
     }
 }
 
@@ -399,6 +468,11 @@ void FlipFluidSolver::ComputeDivergence(
                                                 velocity_->x()->cuda_volume(),
                                                 velocity_->y()->cuda_volume(),
                                                 velocity_->z()->cuda_volume());
+    } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        CpuMain::Instance()->ComputeDivergence(divergence->cpu_volume(),
+                                               velocity_->x()->cpu_volume(),
+                                               velocity_->y()->cpu_volume(),
+                                               velocity_->z()->cpu_volume());
     }
 }
 
@@ -447,15 +521,34 @@ void FlipFluidSolver::MoveParticles(float delta_time)
             GetProperties().temperature_dissipation_, delta_time);
 
         SwapParticleFields(particles_.get(), particles_aux_.get());
+    } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        CpuMain::FlipParticles p;
+        SetCpuParticles(&p, particles_);
+        CpuMain::FlipParticles p_aux = {};
+        CpuMain::Instance()->MoveFlipParticles(
+            &p, &num_active_particles_, &p_aux, velocity_->x()->cpu_volume(),
+            velocity_->y()->cpu_volume(), velocity_->z()->cpu_volume(),
+            velocity_prev_->x()->cpu_volume(),
+            velocity_prev_->y()->cpu_volume(),
+            velocity_prev_->z()->cpu_volume(), density_->cpu_volume(),
+            temperature_->cpu_volume(), GetProperties().velocity_dissipation_,
+            GetProperties().density_dissipation_,
+            GetProperties().temperature_dissipation_, delta_time);
     }
 }
 
 void FlipFluidSolver::SolvePressure(std::shared_ptr<GraphicsVolume> pressure,
-                                    std::shared_ptr<GraphicsVolume> divergence)
+                                    std::shared_ptr<GraphicsVolume> divergence,
+                                    bool warm_start)
 {
     if (pressure_solver_) {
         pressure_solver_->SetDiagnosis(diagnosis_ == DIAG_PRESSURE);
+        pressure_solver_->SetWarmStart(warm_start);
         pressure_solver_->Solve(pressure, divergence);
+        Metrics::Instance()->OnPressureIterationNumberUpdated(
+            pressure_solver_->GetNumOfIterationsUsed());
+        Metrics::Instance()->OnPressureResidualUpdated(
+            pressure_solver_->GetResidualNorm());
     }
 
     ComputeResidualDiagnosis(pressure, divergence);
@@ -468,6 +561,11 @@ void FlipFluidSolver::SubtractGradient(std::shared_ptr<GraphicsVolume> pressure)
                                                velocity_->y()->cuda_volume(),
                                                velocity_->z()->cuda_volume(),
                                                pressure->cuda_volume());
+    } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        CpuMain::Instance()->SubtractGradient(velocity_->x()->cpu_volume(),
+                                              velocity_->y()->cpu_volume(),
+                                              velocity_->z()->cpu_volume(),
+                                              pressure->cpu_volume());
     }
 }
 
@@ -484,4 +582,6 @@ void FlipFluidSolver::SwapParticleFields(FlipParticles* particles,
     std::swap(particles->velocity_z_,    aux->velocity_z_);
     std::swap(particles->density_,       aux->density_);
     std::swap(particles->temperature_,   aux->temperature_);
+    for (int i = 0; i < 9; i++)
+        std::swap(particles->affine_[i], aux->affine_[i]);
 }
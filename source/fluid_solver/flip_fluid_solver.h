@@ -39,7 +39,7 @@ class FlipFluidSolver : public FluidSolver, public FluidFieldOwner,
                         public ParticleBufferOwner
 {
 public:
-    explicit FlipFluidSolver(int max_num_particles);
+    FlipFluidSolver(int max_num_particles, bool apic_transfer);
     virtual ~FlipFluidSolver();
 
     // Overridden from FluidSolver:
@@ -67,25 +67,33 @@ public:
     virtual GraphicsLinearMemU16* GetParticlePosZField() override;
     virtual GraphicsLinearMemU16* GetParticleTemperatureField() override;
 
+protected:
+    // Overridden from FluidSolver:
+    virtual void ComputeDivergence(
+        std::shared_ptr<GraphicsVolume> divergence) override;
+    virtual void SolvePressure(std::shared_ptr<GraphicsVolume> pressure,
+                               std::shared_ptr<GraphicsVolume> divergence,
+                               bool warm_start) override;
+    virtual void SubtractGradient(
+        std::shared_ptr<GraphicsVolume> pressure) override;
+
 private:
     struct FlipParticles;
 
     static bool InitParticles(FlipParticles* particles, GraphicsLib lib,
-                              int cell_count, int max_num_particles, bool aux);
+                              int cell_count, int max_num_particles,
+                              bool apic_transfer, bool aux);
 
     void ApplyBuoyancy(float delta_time);
-    void ComputeDivergence(std::shared_ptr<GraphicsVolume> divergence);
     void ComputeResidualDiagnosis(std::shared_ptr<GraphicsVolume> pressure,
                                   std::shared_ptr<GraphicsVolume> divergence);
     void MoveParticles(float delta_time);
-    void SolvePressure(std::shared_ptr<GraphicsVolume> pressure,
-                       std::shared_ptr<GraphicsVolume> divergence);
-    void SubtractGradient(std::shared_ptr<GraphicsVolume> pressure);
     void SwapParticleFields(FlipParticles* particles, FlipParticles* aux);
 
     GraphicsLib graphics_lib_;
     glm::ivec3 grid_size_;
     int max_num_particles_;
+    bool apic_transfer_;
     PoissonSolver* pressure_solver_;
     int diagnosis_;
 
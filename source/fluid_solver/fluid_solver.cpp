@@ -22,8 +22,19 @@
 #include "stdafx.h"
 #include "fluid_solver.h"
 
+#include <algorithm>
+
+#include "cpu_host/cpu_main.h"
+#include "cuda_host/cuda_main.h"
+#include "graphics_volume.h"
+#include "metrics.h"
+
 FluidSolver::FluidSolver()
-    : properties_({0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f})
+    : properties_({0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, false, false})
+    , pressure_()
+    , pressure_prev_()
+    , num_pressure_frames_(0)
+    , last_delta_time_(0.0f)
 {
 }
 
@@ -31,7 +42,115 @@ FluidSolver::~FluidSolver()
 {
 }
 
+bool FluidSolver::Rewindow(const glm::ivec3& offset, const glm::ivec3& size)
+{
+    return false;
+}
+
 void FluidSolver::SetProperties(const FluidProperties& properties)
 {
     properties_ = properties;
 }
+
+void FluidSolver::Project(float delta_time,
+                          std::shared_ptr<GraphicsVolume> divergence,
+                          std::shared_ptr<GraphicsVolume> scratch)
+{
+    // Calculate divergence.
+    ComputeDivergence(divergence);
+    Metrics::Instance()->OnDivergenceComputed();
+
+    // Solve pressure-velocity Poisson equation
+    std::shared_ptr<GraphicsVolume> pressure =
+        GetInitialPressure(delta_time, scratch);
+    SolvePressure(pressure, divergence, pressure == pressure_);
+    Metrics::Instance()->OnPressureSolved();
+
+    // Rectify velocity via the gradient of pressure
+    SubtractGradient(pressure);
+    Metrics::Instance()->OnVelocityRectified();
+}
+
+void FluidSolver::ResetPressure(bool release)
+{
+    if (release) {
+        pressure_.reset();
+        pressure_prev_.reset();
+    } else if (pressure_) {
+        pressure_->Clear();
+    }
+
+    num_pressure_frames_ = 0;
+}
+
+std::shared_ptr<GraphicsVolume> FluidSolver::GetInitialPressure(
+    float delta_time, std::shared_ptr<GraphicsVolume> scratch)
+{
+    // Pressure changes slowly between frames, so the last solution makes a
+    // good initial guess. It is kept in a dedicated volume, as |scratch| is
+    // also used for other purposes.
+    if (!properties_.pressure_warm_start_) {
+        pressure_.reset();
+        pressure_prev_.reset();
+        return scratch;
+    }
+
+    GraphicsLib lib = scratch->graphics_lib();
+    if (!pressure_) {
+        pressure_ = std::make_shared<GraphicsVolume>(lib);
+        if (!pressure_->Create(scratch->GetWidth(), scratch->GetHeight(),
+                               scratch->GetDepth(), 1,
+                               scratch->GetByteWidth(), 0)) {
+            pressure_.reset();
+            return scratch;
+        }
+
+        num_pressure_frames_ = 0;
+    }
+
+    // Nothing is kept from before a reset.
+    if (!num_pressure_frames_)
+        pressure_->Clear();
+
+    if (!properties_.extrapolate_pressure_) {
+        pressure_prev_.reset();
+        num_pressure_frames_ = std::min(num_pressure_frames_ + 1, 1);
+        return pressure_;
+    }
+
+    if (!pressure_prev_) {
+        pressure_prev_ = std::make_shared<GraphicsVolume>(lib);
+        if (!pressure_prev_->Create(pressure_->GetWidth(),
+                                    pressure_->GetHeight(),
+                                    pressure_->GetDepth(), 1,
+                                    pressure_->GetByteWidth(), 0)) {
+            pressure_prev_.reset();
+            return pressure_;
+        }
+
+        num_pressure_frames_ = std::min(num_pressure_frames_, 1);
+    }
+
+    // p(n+1) ~= p(n) + dt(n+1) / dt(n) * (p(n) - p(n-1)).
+    //
+    // The guess is written over p(n-1) and then swapped in, so that
+    // |pressure_prev_| keeps p(n) for the next frame. Until two frames are
+    // available, p(n) is merely copied.
+    float coef = 0.0f;
+    if (num_pressure_frames_ > 1 && last_delta_time_ > 0.0f)
+        coef = delta_time / last_delta_time_;
+
+    if (lib == GRAPHICS_LIB_CUDA)
+        CudaMain::Instance()->Extrapolate(pressure_prev_->cuda_volume(),
+                                          pressure_->cuda_volume(),
+                                          pressure_prev_->cuda_volume(), coef);
+    else if (lib == GRAPHICS_LIB_CPU)
+        CpuMain::Instance()->Extrapolate(pressure_prev_->cpu_volume(),
+                                         pressure_->cpu_volume(),
+                                         pressure_prev_->cpu_volume(), coef);
+
+    std::swap(pressure_, pressure_prev_);
+    num_pressure_frames_ = std::min(num_pressure_frames_ + 1, 2);
+    last_delta_time_ = delta_time;
+    return pressure_;
+}
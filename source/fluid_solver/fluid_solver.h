@@ -22,6 +22,8 @@
 #ifndef _FLUID_SOLVER_H_
 #define _FLUID_SOLVER_H_
 
+#include <memory>
+
 #include "graphics_lib_enum.h"
 #include "third_party/glm/fwd.hpp"
 
@@ -39,6 +41,8 @@ public:
         float ambient_temperature_;
         float vorticity_confinement_;
         float buoyancy_coef_;
+        bool pressure_warm_start_;
+        bool extrapolate_pressure_;
     };
 
     FluidSolver();
@@ -48,9 +52,16 @@ public:
                          const glm::vec3& hotspot, float impulse_density,
                          float impulse_temperature,
                          const glm::vec3& impulse_velocity) = 0;
+
+    // Returns false if the solver has no implementation for |graphics_lib|.
     virtual bool Initialize(GraphicsLib graphics_lib, int width, int height,
                             int depth, int poisson_byte_width) = 0;
     virtual void Reset() = 0;
+
+    // Moves the fields to a window of |size| whose origin lies at |offset|
+    // from the current one, keeping whatever the two windows share. Returns
+    // false if the solver stays where it is.
+    virtual bool Rewindow(const glm::ivec3& offset, const glm::ivec3& size);
     virtual void SetDiagnosis(int diagnosis) = 0;
     virtual void SetPressureSolver(PoissonSolver* solver) = 0;
     virtual void SetProperties(const FluidProperties& properties);
@@ -59,8 +70,34 @@ public:
 protected:
     const FluidProperties& GetProperties() const { return properties_; }
 
+    // Makes the velocity divergence-free, through ComputeDivergence() into
+    // |divergence|, SolvePressure() and SubtractGradient(). The pressure is
+    // warm-started from the last frames as the properties ask, otherwise it
+    // is solved in |scratch|.
+    void Project(float delta_time, std::shared_ptr<GraphicsVolume> divergence,
+                 std::shared_ptr<GraphicsVolume> scratch);
+
+    // Forgets the pressure of the last frames. |release| frees the volumes
+    // as well, which is needed once the grid changes its size.
+    void ResetPressure(bool release);
+
+    // The steps of Project() that the solvers implement.
+    virtual void ComputeDivergence(
+        std::shared_ptr<GraphicsVolume> divergence) = 0;
+    virtual void SolvePressure(std::shared_ptr<GraphicsVolume> pressure,
+                               std::shared_ptr<GraphicsVolume> divergence,
+                               bool warm_start) = 0;
+    virtual void SubtractGradient(std::shared_ptr<GraphicsVolume> pressure) = 0;
+
 private:
+    std::shared_ptr<GraphicsVolume> GetInitialPressure(
+        float delta_time, std::shared_ptr<GraphicsVolume> scratch);
+
     FluidProperties properties_;
+    std::shared_ptr<GraphicsVolume> pressure_;
+    std::shared_ptr<GraphicsVolume> pressure_prev_;
+    int num_pressure_frames_;
+    float last_delta_time_;
 };
 
 #endif // _FLUID_SOLVER_H_
\ No newline at end of file
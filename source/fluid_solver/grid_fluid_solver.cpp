@@ -22,6 +22,7 @@
 #include "stdafx.h"
 #include "grid_fluid_solver.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "cuda_host/cuda_main.h"
@@ -69,6 +70,7 @@ GridFluidSolver::GridFluidSolver()
     , graphics_lib_(GRAPHICS_LIB_CUDA)
     , grid_size_(128)
     , pressure_solver_(nullptr)
+    , poisson_byte_width_(2)
     , diagnosis_(DIAG_NONE)
     , velocity_()
     , velocity_prime_()
@@ -113,7 +115,7 @@ void GridFluidSolver::Impulse(float splat_radius,
                                            splat_radius, impulse_velocity,
                                            impulse_density,
                                            impulse_temperature);
-    } else {
+    } else if (graphics_lib_ == GRAPHICS_LIB_GLSL) {
         ImpulseDensity(impulse_position, hotspot, splat_radius,
                        impulse_density);
 
@@ -126,17 +128,8 @@ void GridFluidSolver::Impulse(float splat_radius,
 bool GridFluidSolver::Initialize(GraphicsLib graphics_lib, int width,
                                  int height, int depth, int poisson_byte_width)
 {
-    velocity_       = std::make_shared<GraphicsVolume3>(graphics_lib_);
-    velocity_prime_ = std::make_shared<GraphicsVolume3>(graphics_lib_);
-    vorticity_      = std::make_shared<GraphicsVolume3>(graphics_lib_);
-    aux_            = std::make_shared<GraphicsVolume3>(graphics_lib_);
-    vort_conf_      = std::make_shared<GraphicsVolume3>(graphics_lib_);
-    density_        = std::make_shared<GraphicsVolume>(graphics_lib_);
-    temperature_    = std::make_shared<GraphicsVolume>(graphics_lib_);
-    general1a_      = std::make_shared<GraphicsVolume>(graphics_lib_);
-    general1b_      = std::make_shared<GraphicsVolume>(graphics_lib_);
-    general1c_      = std::make_shared<GraphicsVolume>(graphics_lib_);
-    general1d_      = std::make_shared<GraphicsVolume>(graphics_lib_);
+    if (graphics_lib == GRAPHICS_LIB_CPU)
+        return false;
 
     // A hard lesson had told us: locality is a vital factor of the performance
     // of raycast. Even a trivial-like adjustment that packing the temperature
@@ -153,46 +146,9 @@ bool GridFluidSolver::Initialize(GraphicsLib graphics_lib, int width,
     // cache miss in GPU during raycast. So, it's a problem all about the cache
     // shortage in graphic cards.
 
-    grid_size_ = glm::ivec3(width, height, depth);
-
-    bool result = velocity_->Create(width, height, depth, 1, 2, 0);
-    assert(result);
-    if (!result)
-        return false;
-
-    result = velocity_prime_->Create(width, height, depth, 1, 2, 0);
-    assert(result);
-    if (!result)
-        return false;
-
-    result = density_->Create(width, height, depth, 1, 2, 0);
-    assert(result);
-    if (!result)
-        return false;
-
-    result = temperature_->Create(width, height, depth, 1, 2, 0);
-    assert(result);
-    if (!result)
-        return false;
-
-    result = general1a_->Create(width, height, depth, 1, 2, 0);
-    assert(result);
-    if (!result)
-        return false;
-
-    result = general1b_->Create(width, height, depth, 1, 2, 0);
-    assert(result);
-    if (!result)
-        return false;
-
-    result = general1c_->Create(width, height, depth, 1, poisson_byte_width, 0);
-    assert(result);
-    if (!result)
-        return false;
+    poisson_byte_width_ = poisson_byte_width;
 
-    result = general1d_->Create(width, height, depth, 1, poisson_byte_width, 0);
-    assert(result);
-    if (!result)
+    if (!CreateFields(width, height, depth, poisson_byte_width))
         return false;
 
     if (graphics_lib_ == GRAPHICS_LIB_GLSL ||
@@ -275,11 +231,74 @@ void GridFluidSolver::Reset()
     }
 
     diagnosis_volume_.reset();
+
+    ResetPressure(false);
     frame_ = 0;
 
     Metrics::Instance()->Reset();
 }
 
+bool GridFluidSolver::Rewindow(const glm::ivec3& offset,
+                               const glm::ivec3& size)
+{
+    if (graphics_lib_ != GRAPHICS_LIB_CUDA)
+        return false;
+
+    std::shared_ptr<GraphicsVolume3> velocity = velocity_;
+    std::shared_ptr<GraphicsVolume> density = density_;
+    std::shared_ptr<GraphicsVolume> temperature = temperature_;
+    glm::ivec3 old_size = grid_size_;
+
+    // If the new window can not be allocated, the fields are rebuilt in the
+    // old one, as some of them might have been replaced already.
+    glm::ivec3 shift = offset;
+    bool result = CreateFields(size.x, size.y, size.z, poisson_byte_width_);
+    if (!result) {
+        shift = glm::ivec3(0);
+        if (!CreateFields(old_size.x, old_size.y, old_size.z,
+                          poisson_byte_width_))
+            return false;
+    }
+
+    density_->Clear();
+    temperature_->Clear();
+    general1a_->Clear();
+    general1b_->Clear();
+    general1c_->Clear();
+    general1d_->Clear();
+    for (int i = 0; i < GraphicsVolume3::num_of_volumes(); i++) {
+        (*velocity_)[i]->Clear();
+        (*velocity_prime_)[i]->Clear();
+    }
+
+    // The overlap of the windows, in the coordinates of the old one.
+    glm::ivec3 lower;
+    glm::ivec3 extent;
+    for (int j = 0; j < 3; j++) {
+        lower[j] = std::max(shift[j], 0);
+        extent[j] = std::min(shift[j] + grid_size_[j], old_size[j]) - lower[j];
+    }
+
+    if (extent.x > 0 && extent.y > 0 && extent.z > 0) {
+        CudaMain* m = CudaMain::Instance();
+        for (int i = 0; i < GraphicsVolume3::num_of_volumes(); i++)
+            m->CopyVolumeRegion((*velocity_)[i]->cuda_volume(), lower - shift,
+                                (*velocity)[i]->cuda_volume(), lower, extent);
+
+        m->CopyVolumeRegion(density_->cuda_volume(), lower - shift,
+                            density->cuda_volume(), lower, extent);
+        m->CopyVolumeRegion(temperature_->cuda_volume(), lower - shift,
+                            temperature->cuda_volume(), lower, extent);
+    }
+
+    // Nothing of the pressure can be carried over, the solver starts cold in
+    // the new window.
+    ResetPressure(true);
+    diagnosis_volume_.reset();
+
+    return result;
+}
+
 void GridFluidSolver::SetDiagnosis(int diagnosis)
 {
     diagnosis_ = diagnosis % NUM_DIAG_TARGETS;
@@ -306,23 +325,10 @@ void GridFluidSolver::Solve(float delta_time)
     ApplyBuoyancy(delta_time);
     Metrics::Instance()->OnBuoyancyApplied();
 
-    // Calculate divergence.
-    ComputeDivergence(general1c_);
-    Metrics::Instance()->OnDivergenceComputed();
-
-    // Solve pressure-velocity Poisson equation
-    SolvePressure(general1d_, general1c_);
-    Metrics::Instance()->OnPressureSolved();
-
-    // Rectify velocity via the gradient of pressure
-    SubtractGradient(general1d_);
-    Metrics::Instance()->OnVelocityRectified();
+    Project(delta_time, general1c_, general1d_);
 
     // Advect density and temperature
-    AdvectTemperature(delta_time);
-    Metrics::Instance()->OnTemperatureAvected();
-
-    AdvectDensity(delta_time);
+    AdvectFields(delta_time);
     Metrics::Instance()->OnDensityAvected();
 
     ReviseDensity();
@@ -340,7 +346,10 @@ void GridFluidSolver::Solve(float delta_time)
     // shader/kernel execution.
     // I may find some time to explore into it.
 
-    CudaMain::Instance()->RoundPassed(frame_++);
+    if (graphics_lib_ == GRAPHICS_LIB_CUDA)
+        CudaMain::Instance()->RoundPassed(frame_);
+
+    frame_++;
 }
 
 GraphicsVolume* GridFluidSolver::GetDensityField()
@@ -358,6 +367,29 @@ GraphicsVolume* GridFluidSolver::GetTemperatureField()
     return temperature_.get();
 }
 
+void GridFluidSolver::AdvectFields(float delta_time)
+{
+    float density_dissipation = GetProperties().density_dissipation_;
+    float temperature_dissipation = GetProperties().temperature_dissipation_;
+    if (graphics_lib_ == GRAPHICS_LIB_CUDA) {
+        // The velocity has been advected and projected by now, so
+        // |velocity_prime_| is free to hold the intermediate results.
+        CudaMain::Instance()->AdvectFields(
+            {general1a_->cuda_volume(), general1b_->cuda_volume()},
+            {density_->cuda_volume(), temperature_->cuda_volume()},
+            {velocity_prime_->x()->cuda_volume(),
+                velocity_prime_->y()->cuda_volume()},
+            {density_dissipation, temperature_dissipation},
+            velocity_->x()->cuda_volume(), velocity_->y()->cuda_volume(),
+            velocity_->z()->cuda_volume(), delta_time);
+        density_->Swap(*general1a_);
+        std::swap(temperature_, general1b_);
+    } else {
+        AdvectTemperature(delta_time);
+        AdvectDensity(delta_time);
+    }
+}
+
 void GridFluidSolver::AdvectDensity(float delta_time)
 {
     float density_dissipation = GetProperties().density_dissipation_;
@@ -435,7 +467,7 @@ void GridFluidSolver::AdvectVelocity(float delta_time)
             CudaMain::Instance()->PrintVolume(velocity_->z()->cuda_volume(),
                                               "VelocityZ");
         }
-    } else {
+    } else if (graphics_lib_ == GRAPHICS_LIB_GLSL) {
         glUseProgram(Programs.Advect);
 
         SetUniform("InverseSize",
@@ -482,7 +514,7 @@ void GridFluidSolver::ApplyBuoyancy(float delta_time)
                                             density_->cuda_volume(),
                                             delta_time, ambient_temperature,
                                             buoyancy_coef, smoke_weight);
-    } else {
+    } else if (graphics_lib_ == GRAPHICS_LIB_GLSL) {
         glUseProgram(Programs.ApplyBuoyancy);
 
         SetUniform("Velocity", 0);
@@ -515,7 +547,7 @@ void GridFluidSolver::ComputeDivergence(
                                                 velocity_->x()->cuda_volume(),
                                                 velocity_->y()->cuda_volume(),
                                                 velocity_->z()->cuda_volume());
-    } else {
+    } else if (graphics_lib_ == GRAPHICS_LIB_GLSL) {
         float cell_size = 0.15f;
         float half_inverse_cell_size = 0.5f / cell_size;
 
@@ -617,6 +649,66 @@ void GridFluidSolver::ComputeResidualDiagnosis(
     }
 }
 
+bool GridFluidSolver::CreateFields(int width, int height, int depth,
+                                   int poisson_byte_width)
+{
+    velocity_       = std::make_shared<GraphicsVolume3>(graphics_lib_);
+    velocity_prime_ = std::make_shared<GraphicsVolume3>(graphics_lib_);
+    vorticity_      = std::make_shared<GraphicsVolume3>(graphics_lib_);
+    aux_            = std::make_shared<GraphicsVolume3>(graphics_lib_);
+    vort_conf_      = std::make_shared<GraphicsVolume3>(graphics_lib_);
+    density_        = std::make_shared<GraphicsVolume>(graphics_lib_);
+    temperature_    = std::make_shared<GraphicsVolume>(graphics_lib_);
+    general1a_      = std::make_shared<GraphicsVolume>(graphics_lib_);
+    general1b_      = std::make_shared<GraphicsVolume>(graphics_lib_);
+    general1c_      = std::make_shared<GraphicsVolume>(graphics_lib_);
+    general1d_      = std::make_shared<GraphicsVolume>(graphics_lib_);
+
+    grid_size_ = glm::ivec3(width, height, depth);
+
+    bool result = velocity_->Create(width, height, depth, 1, 2, 0);
+    assert(result);
+    if (!result)
+        return false;
+
+    result = velocity_prime_->Create(width, height, depth, 1, 2, 0);
+    assert(result);
+    if (!result)
+        return false;
+
+    result = density_->Create(width, height, depth, 1, 2, 0);
+    assert(result);
+    if (!result)
+        return false;
+
+    result = temperature_->Create(width, height, depth, 1, 2, 0);
+    assert(result);
+    if (!result)
+        return false;
+
+    result = general1a_->Create(width, height, depth, 1, 2, 0);
+    assert(result);
+    if (!result)
+        return false;
+
+    result = general1b_->Create(width, height, depth, 1, 2, 0);
+    assert(result);
+    if (!result)
+        return false;
+
+    result = general1c_->Create(width, height, depth, 1, poisson_byte_width, 0);
+    assert(result);
+    if (!result)
+        return false;
+
+    result = general1d_->Create(width, height, depth, 1, poisson_byte_width, 0);
+    assert(result);
+    if (!result)
+        return false;
+
+    return true;
+}
+
 void GridFluidSolver::DampedJacobi(std::shared_ptr<GraphicsVolume> pressure,
                                    std::shared_ptr<GraphicsVolume> divergence,
                                    float cell_size, int num_of_iterations)
@@ -626,7 +718,7 @@ void GridFluidSolver::DampedJacobi(std::shared_ptr<GraphicsVolume> pressure,
                                     pressure->cuda_volume(),
                                     divergence->cuda_volume(),
                                     num_of_iterations);
-    } else {
+    } else if (graphics_lib_ == GRAPHICS_LIB_GLSL) {
         float one_minus_omega = 0.33333333f;
         float minus_square_cell_size = -(cell_size * cell_size);
         float omega_over_beta = 0.11111111f;
@@ -656,7 +748,7 @@ void GridFluidSolver::ImpulseField(std::shared_ptr<GraphicsVolume> dest,
                                    float value)
 {
     if (graphics_lib_ == GRAPHICS_LIB_CUDA) {
-    } else {
+    } else if (graphics_lib_ == GRAPHICS_LIB_GLSL) {
         glUseProgram(Programs.ApplyImpulse);
 
         SetUniform("center_point", position);
@@ -678,7 +770,7 @@ void GridFluidSolver::ImpulseDensity(const glm::vec3& position,
                                      float splat_radius, float value)
 {
     if (graphics_lib_ == GRAPHICS_LIB_CUDA) {
-    } else {
+    } else if (graphics_lib_ == GRAPHICS_LIB_GLSL) {
         glUseProgram(Programs.ApplyImpulse);
 
         SetUniform("center_point", position);
@@ -707,11 +799,17 @@ void GridFluidSolver::ReviseDensity()
 }
 
 void GridFluidSolver::SolvePressure(std::shared_ptr<GraphicsVolume> pressure,
-                                    std::shared_ptr<GraphicsVolume> divergence)
+                                    std::shared_ptr<GraphicsVolume> divergence,
+                                    bool warm_start)
 {
     if (pressure_solver_) {
         pressure_solver_->SetDiagnosis(diagnosis_ == DIAG_PRESSURE);
+        pressure_solver_->SetWarmStart(warm_start);
         pressure_solver_->Solve(pressure, divergence);
+        Metrics::Instance()->OnPressureIterationNumberUpdated(
+            pressure_solver_->GetNumOfIterationsUsed());
+        Metrics::Instance()->OnPressureResidualUpdated(
+            pressure_solver_->GetResidualNorm());
     }
 
     ComputeResidualDiagnosis(pressure, divergence);
@@ -734,7 +832,7 @@ void GridFluidSolver::SubtractGradient(std::shared_ptr<GraphicsVolume> pressure)
                                                velocity_->y()->cuda_volume(),
                                                velocity_->z()->cuda_volume(),
                                                pressure->cuda_volume());
-    } else {
+    } else if (graphics_lib_ == GRAPHICS_LIB_GLSL) {
         float cell_size = 0.15f;
         const float half_inverse_cell_size = 0.5f / cell_size;
 
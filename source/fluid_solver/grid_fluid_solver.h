@@ -47,6 +47,8 @@ public:
     virtual bool Initialize(GraphicsLib graphics_lib, int width, int height,
                             int depth, int poisson_byte_width) override;
     virtual void Reset() override;
+    virtual bool Rewindow(const glm::ivec3& offset,
+                          const glm::ivec3& size) override;
     virtual void SetDiagnosis(int diagnosis) override;
     virtual void SetPressureSolver(PoissonSolver* solver) override;
     virtual void Solve(float delta_time) override;
@@ -56,18 +58,30 @@ public:
     virtual GraphicsVolume3* GetVelocityField() override;
     virtual GraphicsVolume* GetTemperatureField() override;
 
+protected:
+    // Overridden from FluidSolver:
+    virtual void ComputeDivergence(
+        std::shared_ptr<GraphicsVolume> divergence) override;
+    virtual void SolvePressure(std::shared_ptr<GraphicsVolume> pressure,
+                               std::shared_ptr<GraphicsVolume> divergence,
+                               bool warm_start) override;
+    virtual void SubtractGradient(
+        std::shared_ptr<GraphicsVolume> pressure) override;
+
 private:
     friend class FluidUnittest;
 
     void AdvectDensity(float delta_time);
+    void AdvectFields(float delta_time);
     void AdvectImpl(const GraphicsVolume& source, float delta_time,
                     float dissipation);
     void AdvectTemperature(float delta_time);
     void AdvectVelocity(float delta_time);
     void ApplyBuoyancy(float delta_time);
-    void ComputeDivergence(std::shared_ptr<GraphicsVolume> divergence);
     void ComputeResidualDiagnosis(std::shared_ptr<GraphicsVolume> pressure,
                                   std::shared_ptr<GraphicsVolume> divergence);
+    bool CreateFields(int width, int height, int depth,
+                      int poisson_byte_width);
     void DampedJacobi(std::shared_ptr<GraphicsVolume> pressure,
                       std::shared_ptr<GraphicsVolume> divergence,
                       float cell_size, int num_of_iterations);
@@ -78,9 +92,6 @@ private:
                         float splat_radius,
                         float value);
     void ReviseDensity();
-    void SolvePressure(std::shared_ptr<GraphicsVolume> pressure,
-                       std::shared_ptr<GraphicsVolume> divergence);
-    void SubtractGradient(std::shared_ptr<GraphicsVolume> pressure);
 
     // Vorticity.
     void AddCurlPsi(const GraphicsVolume3& psi);
@@ -108,6 +119,7 @@ private:
     GraphicsLib graphics_lib_;
     glm::ivec3 grid_size_;
     PoissonSolver* pressure_solver_;
+    int poisson_byte_width_;
     int diagnosis_;
 
     std::shared_ptr<GraphicsVolume3> velocity_;
@@ -0,0 +1,106 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "time_step_controller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "cpu_host/cpu_main.h"
+#include "cpu_host/cpu_mem_piece.h"
+#include "cuda_host/cuda_main.h"
+#include "fluid_field_owner.h"
+#include "graphics_mem_piece.h"
+#include "graphics_volume.h"
+#include "graphics_volume_group.h"
+
+// In CUDA the maximum speed is reduced on the device, and only the single
+// float comes back, once a frame. That is the only sync point the controller
+// adds, and it costs far less than a substep that is not needed. On the host
+// the reduction is split over the thread pool.
+
+TimeStepController::TimeStepController()
+    : max_speed_()
+{
+
+}
+
+TimeStepController::~TimeStepController()
+{
+
+}
+
+bool TimeStepController::Initialize(GraphicsLib graphics_lib)
+{
+    if (graphics_lib != GRAPHICS_LIB_CUDA && graphics_lib != GRAPHICS_LIB_CPU)
+        return false;
+
+    max_speed_ = std::make_shared<GraphicsMemPiece>(graphics_lib);
+    if (!max_speed_->Create(sizeof(float))) {
+        max_speed_.reset();
+        return false;
+    }
+
+    return true;
+}
+
+int TimeStepController::Plan(FluidFieldOwner* field_owner, float frame_time,
+                             float cell_size, float cfl_number,
+                             int max_num_substeps, float* time_step)
+{
+    *time_step = frame_time;
+    if (!max_speed_ || cfl_number <= 0.0f || max_num_substeps <= 1)
+        return 1;
+
+    GraphicsVolume3* velocity = field_owner->GetVelocityField();
+    if (!velocity)
+        return 1;
+
+    float max_speed = 0.0f;
+    if (max_speed_->graphics_lib() == GRAPHICS_LIB_CUDA) {
+        CudaMain::Instance()->ComputeMaxSpeed(max_speed_->cuda_mem_piece(),
+                                              velocity->x()->cuda_volume(),
+                                              velocity->y()->cuda_volume(),
+                                              velocity->z()->cuda_volume());
+        CudaMain::Instance()->CopyFromMemPiece(&max_speed,
+                                               max_speed_->cuda_mem_piece(),
+                                               sizeof(max_speed));
+    } else {
+        CpuMain::Instance()->ComputeMaxSpeed(max_speed_->cpu_mem_piece(),
+                                             velocity->x()->cpu_volume(),
+                                             velocity->y()->cpu_volume(),
+                                             velocity->z()->cpu_volume());
+        max_speed = *static_cast<float*>(max_speed_->cpu_mem_piece()->mem());
+    }
+    if (!(max_speed > 0.0f))
+        return 1;
+
+    // A calm field takes the whole frame in one step.
+    float cfl_time_step = cfl_number * cell_size / max_speed;
+    if (frame_time <= cfl_time_step)
+        return 1;
+
+    int n = static_cast<int>(std::ceil(frame_time / cfl_time_step));
+    n = std::min(n, max_num_substeps);
+    *time_step = frame_time / n;
+    return n;
+}
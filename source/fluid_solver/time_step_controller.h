@@ -0,0 +1,50 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _TIME_STEP_CONTROLLER_H_
+#define _TIME_STEP_CONTROLLER_H_
+
+#include <memory>
+
+#include "graphics_lib_enum.h"
+
+class FluidFieldOwner;
+class GraphicsMemPiece;
+class TimeStepController
+{
+public:
+    TimeStepController();
+    ~TimeStepController();
+
+    // The velocity is measured in CUDA and on the host only.
+    bool Initialize(GraphicsLib graphics_lib);
+
+    // Splits the frame into substeps that are short enough for the fastest
+    // cell to travel no more than |cfl_number| cells. Returns the number of
+    // substeps, and the time step of each in |time_step|.
+    int Plan(FluidFieldOwner* field_owner, float frame_time, float cell_size,
+             float cfl_number, int max_num_substeps, float* time_step);
+
+private:
+    std::shared_ptr<GraphicsMemPiece> max_speed_;
+};
+
+#endif // _TIME_STEP_CONTROLLER_H_
\ No newline at end of file
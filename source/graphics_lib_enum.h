@@ -27,6 +27,10 @@ enum GraphicsLib
     GRAPHICS_LIB_GLSL,
     GRAPHICS_LIB_CUDA,
     GRAPHICS_LIB_CUDA_DIAGNOSIS,
+
+    // Host memory. The volumes, the pressure solvers and the FLIP solver are
+    // implemented for it. The grid solver refuses it in Initialize().
+    GRAPHICS_LIB_CPU,
 };
 
 #endif // _GRAPHICS_LIB_ENUM_H_
\ No newline at end of file
@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 
+#include "cpu_host/cpu_linear_mem.h"
 #include "cuda_host/cuda_linear_mem.h"
 #include "graphics_lib_enum.h"
 
@@ -37,6 +38,7 @@ public:
     explicit GraphicsLinearMem(GraphicsLib lib)
         : graphics_lib_(lib)
         , cuda_linear_mem_()
+        , cpu_linear_mem_()
     {
     }
     ~GraphicsLinearMem() {}
@@ -51,6 +53,15 @@ public:
                 cuda_linear_mem_ = r;
             }
 
+            return result;
+        } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+            std::shared_ptr<CpuLinearMem<T>> r =
+                std::make_shared<CpuLinearMem<T>>();
+            bool result = r->Create(num_of_elements);
+            if (result) {
+                cpu_linear_mem_ = r;
+            }
+
             return result;
         }
 
@@ -63,10 +74,16 @@ public:
         assert(cuda_linear_mem_);
         return cuda_linear_mem_;
     }
+    std::shared_ptr<CpuLinearMem<T>> cpu_linear_mem() const
+    {
+        assert(cpu_linear_mem_);
+        return cpu_linear_mem_;
+    }
 
 private:
     GraphicsLib graphics_lib_;
     std::shared_ptr<CudaLinearMem<T>> cuda_linear_mem_;
+    std::shared_ptr<CpuLinearMem<T>> cpu_linear_mem_;
 };
 
 typedef GraphicsLinearMem<uint8_t> GraphicsLinearMemU8;
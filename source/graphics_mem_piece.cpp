@@ -24,12 +24,14 @@
 
 #include <cassert>
 
+#include "cpu_host/cpu_mem_piece.h"
 #include "cuda_host/cuda_main.h"
 #include "cuda_host/cuda_mem_piece.h"
 
 GraphicsMemPiece::GraphicsMemPiece(GraphicsLib lib)
     : graphics_lib_(lib)
     , cuda_mem_piece_()
+    , cpu_mem_piece_()
 {
 }
 
@@ -46,6 +48,14 @@ bool GraphicsMemPiece::Create(int size)
             cuda_mem_piece_ = r;
         }
 
+        return result;
+    } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        std::shared_ptr<CpuMemPiece> r = std::make_shared<CpuMemPiece>();
+        bool result = r->Create(size);
+        if (result) {
+            cpu_mem_piece_ = r;
+        }
+
         return result;
     }
 
@@ -57,3 +67,9 @@ std::shared_ptr<CudaMemPiece> GraphicsMemPiece::cuda_mem_piece() const
     assert(cuda_mem_piece_);
     return cuda_mem_piece_;
 }
+
+std::shared_ptr<CpuMemPiece> GraphicsMemPiece::cpu_mem_piece() const
+{
+    assert(cpu_mem_piece_);
+    return cpu_mem_piece_;
+}
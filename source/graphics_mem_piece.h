@@ -26,6 +26,7 @@
 
 #include "graphics_lib_enum.h"
 
+class CpuMemPiece;
 class CudaMemPiece;
 class GraphicsMemPiece
 {
@@ -37,10 +38,12 @@ public:
 
     GraphicsLib graphics_lib() const { return graphics_lib_; }
     std::shared_ptr<CudaMemPiece> cuda_mem_piece() const;
+    std::shared_ptr<CpuMemPiece> cpu_mem_piece() const;
 
 private:
     GraphicsLib graphics_lib_;
     std::shared_ptr<CudaMemPiece> cuda_mem_piece_;
+    std::shared_ptr<CpuMemPiece> cpu_mem_piece_;
 };
 
 #endif // _GRAPHICS_MEM_PIECE_H_
\ No newline at end of file
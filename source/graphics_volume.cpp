@@ -24,6 +24,7 @@
 
 #include <cassert>
 
+#include "cpu_host/cpu_volume.h"
 #include "cuda_host/cuda_main.h"
 #include "cuda_host/cuda_volume.h"
 #include "opengl/gl_volume.h"
@@ -33,6 +34,7 @@ GraphicsVolume::GraphicsVolume(GraphicsLib lib)
     : graphics_lib_(lib)
     , gl_volume_()
     , cuda_volume_()
+    , cpu_volume_()
 {
 }
 
@@ -47,6 +49,9 @@ void GraphicsVolume::Clear()
 
     if (cuda_volume_)
         cuda_volume_->Clear();
+
+    if (cpu_volume_)
+        cpu_volume_->Clear();
 }
 
 bool GraphicsVolume::Create(int width, int height, int depth,
@@ -65,6 +70,16 @@ bool GraphicsVolume::Create(int width, int height, int depth,
 
         Clear(); // TODO
         return result;
+    } else if (graphics_lib_ == GRAPHICS_LIB_CPU) {
+        std::shared_ptr<CpuVolume> r(new CpuVolume());
+        bool result = r->Create(width, height, depth, num_of_components,
+                                byte_width, border);
+        if (result) {
+            cpu_volume_ = r;
+        }
+
+        Clear();
+        return result;
     } else {
         GLuint internal_format = byte_width == 2 ? GL_RGBA16F : GL_RGBA32F;
         GLenum format = GL_RGBA;
@@ -118,6 +133,12 @@ std::shared_ptr<CudaVolume> GraphicsVolume::cuda_volume() const
     return cuda_volume_;
 }
 
+std::shared_ptr<CpuVolume> GraphicsVolume::cpu_volume() const
+{
+    assert(cpu_volume_);
+    return cpu_volume_;
+}
+
 bool GraphicsVolume::HasSameProperties(const GraphicsVolume& other) const
 {
     if (graphics_lib_ != other.graphics_lib_)
@@ -129,6 +150,9 @@ bool GraphicsVolume::HasSameProperties(const GraphicsVolume& other) const
     if (graphics_lib_ == GRAPHICS_LIB_GLSL)
         return gl_volume_->HasSameProperties(*other.gl_volume());
 
+    if (graphics_lib_ == GRAPHICS_LIB_CPU)
+        return cpu_volume_->HasSameProperties(*other.cpu_volume());
+
     return false;
 }
 
@@ -140,52 +164,61 @@ void GraphicsVolume::Swap(GraphicsVolume& other)
 
     std::swap(gl_volume_, other.gl_volume_);
     std::swap(cuda_volume_, other.cuda_volume_);
+    std::swap(cpu_volume_, other.cpu_volume_);
 }
 
 int GraphicsVolume::GetWidth() const
 {
-    assert(gl_volume_ || cuda_volume_);
-    if (!gl_volume_ && !cuda_volume_)
+    assert(gl_volume_ || cuda_volume_ || cpu_volume_);
+    if (!gl_volume_ && !cuda_volume_ && !cpu_volume_)
         return 0;
 
     if (gl_volume_)
         return gl_volume_->width();
-    else
+    else if (cuda_volume_)
         return cuda_volume_->width();
+    else
+        return cpu_volume_->width();
 }
 
 int GraphicsVolume::GetHeight() const
 {
-    assert(gl_volume_ || cuda_volume_);
-    if (!gl_volume_ && !cuda_volume_)
+    assert(gl_volume_ || cuda_volume_ || cpu_volume_);
+    if (!gl_volume_ && !cuda_volume_ && !cpu_volume_)
         return 0;
 
     if (gl_volume_)
         return gl_volume_->height();
-    else
+    else if (cuda_volume_)
         return cuda_volume_->height();
+    else
+        return cpu_volume_->height();
 }
 
 int GraphicsVolume::GetDepth() const
 {
-    assert(gl_volume_ || cuda_volume_);
-    if (!gl_volume_ && !cuda_volume_)
+    assert(gl_volume_ || cuda_volume_ || cpu_volume_);
+    if (!gl_volume_ && !cuda_volume_ && !cpu_volume_)
         return 0;
 
     if (gl_volume_)
         return gl_volume_->depth();
-    else
+    else if (cuda_volume_)
         return cuda_volume_->depth();
+    else
+        return cpu_volume_->depth();
 }
 
 int GraphicsVolume::GetByteWidth() const
 {
-    assert(gl_volume_ || cuda_volume_);
-    if (!gl_volume_ && !cuda_volume_)
+    assert(gl_volume_ || cuda_volume_ || cpu_volume_);
+    if (!gl_volume_ && !cuda_volume_ && !cpu_volume_)
         return 0;
 
     if (gl_volume_)
         return gl_volume_->byte_width();
-    else
+    else if (cuda_volume_)
         return cuda_volume_->byte_width();
+    else
+        return cpu_volume_->byte_width();
 }
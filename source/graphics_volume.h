@@ -26,6 +26,7 @@
 
 #include "graphics_lib_enum.h"
 
+class CpuVolume;
 class CudaVolume;
 class GLVolume;
 class GraphicsVolume
@@ -48,11 +49,13 @@ public:
 
     std::shared_ptr<GLVolume> gl_volume() const;
     std::shared_ptr<CudaVolume> cuda_volume() const;
+    std::shared_ptr<CpuVolume> cpu_volume() const;
 
 private:
     GraphicsLib graphics_lib_;
     std::shared_ptr<GLVolume> gl_volume_;
     std::shared_ptr<CudaVolume> cuda_volume_;
+    std::shared_ptr<CpuVolume> cpu_volume_;
 };
 
 #endif // _GRAPHICS_VOLUME_H_
\ No newline at end of file
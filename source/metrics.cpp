@@ -28,6 +28,34 @@ namespace
 {
 const size_t kMaxNumOfTimeStamps = 100;
 const int kNumOfSamples = 20;
+
+const char* kOperationNames[] = {
+    "Velocity",
+    "Temperature",
+    "Density",
+    "Buoyancy",
+    "Impulse",
+    "Divergence",
+    "Pressure",
+    "Gradient",
+
+    "FLIP Emission",
+    "FLIP Interpolation",
+    "FLIP Resampling",
+    "FLIP Advection",
+    "FLIP Cell Binding",
+    "FLIP Prefix Sum",
+    "FLIP Sorting",
+    "FLIP Transfer",
+
+    "Vorticity",
+    "Raycast",
+    "Render",
+    "Prolongate",
+};
+static_assert(sizeof(kOperationNames) / sizeof(kOperationNames[0]) ==
+                  Metrics::NUM_OF_OPERATIONS,
+              "Operation names mismatch.");
 }
 
 Metrics* Metrics::Instance()
@@ -39,6 +67,11 @@ Metrics* Metrics::Instance()
     return m;
 }
 
+const char* Metrics::GetOperationName(Operations o)
+{
+    return kOperationNames[o];
+}
+
 Metrics::Metrics()
     : diagnosis_mode_(false)
     , sync_operation_()
@@ -47,6 +80,10 @@ Metrics::Metrics()
     , last_operation_time_(0.0)
     , operation_time_costs_()
     , num_active_particles_(0)
+    , num_pressure_iterations_(0)
+    , pressure_residual_(0.0f)
+    , time_step_(0.0f)
+    , num_substeps_(0)
 {
 }
 
@@ -207,6 +244,22 @@ void Metrics::OnParticleNumberUpdated(int n)
     num_active_particles_ = n;
 }
 
+void Metrics::OnPressureIterationNumberUpdated(int n)
+{
+    num_pressure_iterations_ = n;
+}
+
+void Metrics::OnPressureResidualUpdated(float residual)
+{
+    pressure_residual_ = residual;
+}
+
+void Metrics::OnTimeStepUpdated(float time_step, int num_of_substeps)
+{
+    time_step_ = time_step;
+    num_substeps_ = num_of_substeps;
+}
+
 void Metrics::OnProlongated()
 {
     OnOperationProceeded(POISSON_PROLONGATE);
@@ -217,6 +270,26 @@ int Metrics::GetActiveParticleNumber() const
     return num_active_particles_;
 }
 
+int Metrics::GetPressureIterationNumber() const
+{
+    return num_pressure_iterations_;
+}
+
+float Metrics::GetPressureResidual() const
+{
+    return pressure_residual_;
+}
+
+float Metrics::GetTimeStep() const
+{
+    return time_step_;
+}
+
+int Metrics::GetSubstepNumber() const
+{
+    return num_substeps_;
+}
+
 float Metrics::GetOperationTimeCost(Operations o) const
 {
     auto& samples = operation_time_costs_[o];
@@ -232,6 +305,10 @@ void Metrics::Reset()
     time_stamps_.clear();
     last_operation_time_ = 0.0;
     num_active_particles_ = 0;
+    num_pressure_iterations_ = 0;
+    pressure_residual_ = 0.0f;
+    time_step_ = 0.0f;
+    num_substeps_ = 0;
     for (auto& i : operation_time_costs_)
         i.clear();
 }
@@ -59,6 +59,7 @@ public:
     };
 
     static Metrics* Instance();
+    static const char* GetOperationName(Operations o);
 
     Metrics();
     ~Metrics();
@@ -95,9 +96,16 @@ public:
     void OnRaycastPerformed();
 
     void OnParticleNumberUpdated(int n);
+    void OnPressureIterationNumberUpdated(int n);
+    void OnPressureResidualUpdated(float residual);
+    void OnTimeStepUpdated(float time_step, int num_of_substeps);
     void OnProlongated();
 
     int GetActiveParticleNumber() const;
+    int GetPressureIterationNumber() const;
+    float GetPressureResidual() const;
+    float GetTimeStep() const;
+    int GetSubstepNumber() const;
     float GetOperationTimeCost(Operations o) const;
 
     void Reset();
@@ -114,6 +122,10 @@ private:
     double last_operation_time_;
     SampleArray operation_time_costs_;
     int num_active_particles_;
+    int num_pressure_iterations_;
+    float pressure_residual_;
+    float time_step_;
+    int num_substeps_;
 };
 
 #endif // _METRICS_H_
\ No newline at end of file
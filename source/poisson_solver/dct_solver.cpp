@@ -0,0 +1,434 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "dct_solver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+
+#include "cpu_host/thread_pool.h"
+
+namespace
+{
+typedef std::complex<double> Complex;
+
+const double kPi = 3.14159265358979323846;
+
+// Number of adjacent columns whose lines along y or z are transformed
+// together.
+const int kBlockWidth = 16;
+
+void ParallelFor(ThreadPool* pool, int begin, int end,
+                 const ThreadPool::RangeFunc& func)
+{
+    if (pool)
+        pool->ParallelFor(begin, end, func);
+    else
+        func(begin, end);
+}
+
+// Forward complex FFT of any length, in the Stockham autosort form with
+// decimation in frequency. Radix 4 and 2 are special-cased, and the other
+// prime factors go through a plain DFT of the radix.
+class ComplexFft
+{
+public:
+    explicit ComplexFft(int n);
+
+    // Transforms |x| in-place. |work| has the same length.
+    void Transform(Complex* x, Complex* work) const;
+
+    int size() const { return n_; }
+
+private:
+    struct Stage
+    {
+        int radix_;
+        int m_;
+        int s_;
+        std::vector<Complex> twiddles_;
+        std::vector<Complex> roots_;
+    };
+
+    void RunStage(const Stage& stage, const Complex* x, Complex* y) const;
+
+    int n_;
+    int max_radix_;
+    std::vector<Stage> stages_;
+};
+
+ComplexFft::ComplexFft(int n)
+    : n_(n)
+    , max_radix_(1)
+    , stages_()
+{
+    std::vector<int> radices;
+    int rest = n;
+    while (rest % 4 == 0) {
+        radices.push_back(4);
+        rest /= 4;
+    }
+    while (rest % 2 == 0) {
+        radices.push_back(2);
+        rest /= 2;
+    }
+    for (int p = 3; rest > 1; p += 2) {
+        while (rest % p == 0) {
+            radices.push_back(p);
+            rest /= p;
+        }
+    }
+
+    int len = n;
+    int s = 1;
+    for (int p : radices) {
+        Stage stage;
+        stage.radix_ = p;
+        stage.m_ = len / p;
+        stage.s_ = s;
+        stage.twiddles_.resize(len);
+        for (int q = 0; q < stage.m_; q++)
+            for (int t = 0; t < p; t++)
+                stage.twiddles_[q * p + t] =
+                    std::polar(1.0, -2.0 * kPi * q * t / len);
+
+        stage.roots_.resize(p);
+        for (int r = 0; r < p; r++)
+            stage.roots_[r] = std::polar(1.0, -2.0 * kPi * r / p);
+
+        stages_.push_back(stage);
+        max_radix_ = std::max(max_radix_, p);
+        len = stage.m_;
+        s *= p;
+    }
+}
+
+void ComplexFft::Transform(Complex* x, Complex* work) const
+{
+    Complex* source = x;
+    Complex* dest = work;
+    for (const Stage& stage : stages_) {
+        RunStage(stage, source, dest);
+        std::swap(source, dest);
+    }
+
+    if (source != x)
+        std::copy(source, source + n_, x);
+}
+
+void ComplexFft::RunStage(const Stage& stage, const Complex* x,
+                          Complex* y) const
+{
+    int p = stage.radix_;
+    int m = stage.m_;
+    int s = stage.s_;
+    const Complex* w = &stage.twiddles_[0];
+    if (p == 2) {
+        for (int q = 0; q < m; q++) {
+            for (int k = 0; k < s; k++) {
+                Complex a = x[k + s * q];
+                Complex b = x[k + s * (q + m)];
+                y[k + s * (2 * q)] = a + b;
+                y[k + s * (2 * q + 1)] = (a - b) * w[q * 2 + 1];
+            }
+        }
+    } else if (p == 4) {
+        for (int q = 0; q < m; q++) {
+            for (int k = 0; k < s; k++) {
+                Complex a0 = x[k + s * q];
+                Complex a1 = x[k + s * (q + m)];
+                Complex a2 = x[k + s * (q + 2 * m)];
+                Complex a3 = x[k + s * (q + 3 * m)];
+                Complex b0 = a0 + a2;
+                Complex b1 = a0 - a2;
+                Complex b2 = a1 + a3;
+                Complex d = a1 - a3;
+                Complex b3(d.imag(), -d.real());
+                y[k + s * (4 * q)] = b0 + b2;
+                y[k + s * (4 * q + 1)] = (b1 + b3) * w[q * 4 + 1];
+                y[k + s * (4 * q + 2)] = (b0 - b2) * w[q * 4 + 2];
+                y[k + s * (4 * q + 3)] = (b1 - b3) * w[q * 4 + 3];
+            }
+        }
+    } else {
+        const Complex* roots = &stage.roots_[0];
+        std::vector<Complex> a(p);
+        for (int q = 0; q < m; q++) {
+            for (int k = 0; k < s; k++) {
+                for (int r = 0; r < p; r++)
+                    a[r] = x[k + s * (q + r * m)];
+
+                for (int t = 0; t < p; t++) {
+                    Complex sum = a[0];
+                    for (int r = 1; r < p; r++)
+                        sum += a[r] * roots[(r * t) % p];
+
+                    y[k + s * (p * q + t)] = sum * w[q * p + t];
+                }
+            }
+        }
+    }
+}
+} // Anonymous namespace.
+
+// The unnormalized transform of a line and its exact inverse.
+//
+// The DCT-II goes through a complex FFT of the same length (Makhoul), after
+// the even samples are put in the front and the odd ones reversed in the
+// back. The DCT-IV is done with a zero-padded FFT of twice the length, and
+// is its own inverse up to a factor of 2 / n.
+//
+// An open begin is an open end of the reversed line. With both ends open,
+// the DST-II is the DCT-II of the line with the odd samples negated, whose
+// coefficients come out in reverse order, so only the eigenvalues change.
+class DctSolver::Plan
+{
+public:
+    Plan(int n, bool open_begin, bool open_end);
+
+    void Forward(double* line, Complex* buf, Complex* work) const;
+    void Inverse(double* line, Complex* buf, Complex* work) const;
+
+    double eigenvalue(int k) const { return eigenvalues_[k]; }
+    int fft_size() const { return fft_.size(); }
+
+private:
+    void Permute(double* line) const;
+
+    int n_;
+    bool open_end_;
+    bool reverse_;
+    bool alternate_;
+    ComplexFft fft_;
+    std::vector<Complex> pre_;
+    std::vector<Complex> post_;
+    std::vector<double> eigenvalues_;
+};
+
+DctSolver::Plan::Plan(int n, bool open_begin, bool open_end)
+    : n_(n)
+    , open_end_(open_begin != open_end)
+    , reverse_(open_begin && !open_end)
+    , alternate_(open_begin && open_end)
+    , fft_(open_end_ ? 2 * n : n)
+    , pre_()
+    , post_(n)
+    , eigenvalues_(n)
+{
+    double shift = open_end_ ? 0.5 : 0.0;
+    for (int k = 0; k < n; k++) {
+        post_[k] = std::polar(1.0, -kPi * (k + shift) / (2.0 * n));
+        eigenvalues_[k] = 2.0 * std::cos(kPi * (k + shift) / n) - 2.0;
+        if (alternate_)
+            eigenvalues_[k] = -2.0 * std::cos(kPi * k / n) - 2.0;
+    }
+
+    if (open_end_) {
+        pre_.resize(n);
+        for (int i = 0; i < n; i++)
+            pre_[i] = std::polar(1.0, -kPi * i / (2.0 * n));
+    }
+}
+
+void DctSolver::Plan::Forward(double* line, Complex* buf, Complex* work) const
+{
+    Permute(line);
+    if (open_end_) {
+        for (int i = 0; i < n_; i++)
+            buf[i] = line[i] * pre_[i];
+
+        std::fill(buf + n_, buf + 2 * n_, Complex(0.0));
+    } else {
+        for (int i = 0; i < n_; i++)
+            buf[i & 1 ? n_ - 1 - (i >> 1) : i >> 1] = line[i];
+    }
+
+    fft_.Transform(buf, work);
+    for (int k = 0; k < n_; k++)
+        line[k] = (post_[k] * buf[k]).real();
+}
+
+void DctSolver::Plan::Inverse(double* line, Complex* buf, Complex* work) const
+{
+    if (open_end_) {
+        for (int i = 0; i < n_; i++)
+            buf[i] = line[i] * pre_[i];
+
+        std::fill(buf + n_, buf + 2 * n_, Complex(0.0));
+        fft_.Transform(buf, work);
+        double scale = 2.0 / n_;
+        for (int i = 0; i < n_; i++)
+            line[i] = (post_[i] * buf[i]).real() * scale;
+
+        Permute(line);
+        return;
+    }
+
+    // V[k] = conj(post[k]) * (X[k] - i * X[n - k]), and the inverse FFT is
+    // done as the conjugate of the forward one of the conjugate.
+    for (int k = 0; k < n_; k++) {
+        Complex z(line[k], k ? -line[n_ - k] : 0.0);
+        buf[k] = std::conj(std::conj(post_[k]) * z);
+    }
+
+    fft_.Transform(buf, work);
+    double scale = 1.0 / n_;
+    for (int i = 0; i < n_; i++)
+        line[i] = buf[i & 1 ? n_ - 1 - (i >> 1) : i >> 1].real() * scale;
+
+    Permute(line);
+}
+
+// Both the reversal and the negation are their own inverses.
+void DctSolver::Plan::Permute(double* line) const
+{
+    if (reverse_)
+        std::reverse(line, line + n_);
+
+    if (alternate_)
+        for (int i = 1; i < n_; i += 2)
+            line[i] = -line[i];
+}
+
+DctSolver::DctSolver(ThreadPool* pool)
+    : pool_(pool)
+    , plans_()
+    , size_(0)
+    , data_()
+{
+
+}
+
+DctSolver::~DctSolver()
+{
+
+}
+
+void DctSolver::Solve(float* u, const float* b, const glm::ivec3& size,
+                      const glm::bvec3& open_lower,
+                      const glm::bvec3& open_upper)
+{
+    if (size != size_) {
+        data_.resize(size.x * size.y * size.z);
+        size_ = size;
+    }
+
+    const Plan& plan_x = GetPlan(size.x, open_lower.x, open_upper.x);
+    const Plan& plan_y = GetPlan(size.y, open_lower.y, open_upper.y);
+    const Plan& plan_z = GetPlan(size.z, open_lower.z, open_upper.z);
+
+    int num_of_cells = size.x * size.y * size.z;
+    std::copy(b, b + num_of_cells, data_.begin());
+
+    TransformAxis(0, plan_x, false);
+    TransformAxis(1, plan_y, false);
+    TransformAxis(2, plan_z, false);
+
+    // The eigenvalues are all negative, except the one of the constant mode
+    // with closed walls.
+    double* data = &data_[0];
+    ParallelFor(pool_, 0, size.z, [&](int z0, int z1) {
+        for (int z = z0; z < z1; z++) {
+            for (int y = 0; y < size.y; y++) {
+                double* v = data + (z * size.y + y) * size.x;
+                double eyz = plan_y.eigenvalue(y) + plan_z.eigenvalue(z);
+                for (int x = 0; x < size.x; x++) {
+                    double lambda = plan_x.eigenvalue(x) + eyz;
+                    v[x] = lambda < 0.0 ? v[x] / lambda : 0.0;
+                }
+            }
+        }
+    });
+
+    TransformAxis(0, plan_x, true);
+    TransformAxis(1, plan_y, true);
+    TransformAxis(2, plan_z, true);
+
+    for (int i = 0; i < num_of_cells; i++)
+        u[i] = static_cast<float>(data_[i]);
+}
+
+const DctSolver::Plan& DctSolver::GetPlan(int n, bool open_begin,
+                                          bool open_end)
+{
+    int ends = (open_begin ? 1 : 0) | (open_end ? 2 : 0);
+    std::unique_ptr<Plan>& plan = plans_[std::make_pair(n, ends)];
+    if (!plan)
+        plan.reset(new Plan(n, open_begin, open_end));
+
+    return *plan;
+}
+
+void DctSolver::TransformAxis(int axis, const Plan& plan, bool inverse)
+{
+    glm::ivec3 size = size_;
+    double* data = &data_[0];
+    int fft_size = plan.fft_size();
+    if (axis == 0) {
+        ParallelFor(pool_, 0, size.y * size.z, [&](int r0, int r1) {
+            std::vector<Complex> buf(fft_size);
+            std::vector<Complex> work(fft_size);
+            for (int r = r0; r < r1; r++) {
+                double* line = data + r * size.x;
+                if (inverse)
+                    plan.Inverse(line, &buf[0], &work[0]);
+                else
+                    plan.Forward(line, &buf[0], &work[0]);
+            }
+        });
+        return;
+    }
+
+    // The lines of a block are gathered into contiguous memory, so that both
+    // the gathering and the transforms stay in cache.
+    int n = axis == 1 ? size.y : size.z;
+    int stride = axis == 1 ? size.x : size.x * size.y;
+    int num_of_outers = axis == 1 ? size.z : size.y;
+    int outer_stride = axis == 1 ? size.x * size.y : size.x;
+    int num_of_blocks = (size.x + kBlockWidth - 1) / kBlockWidth;
+    ParallelFor(pool_, 0, num_of_outers * num_of_blocks, [&](int i0, int i1) {
+        std::vector<Complex> buf(fft_size);
+        std::vector<Complex> work(fft_size);
+        std::vector<double> block(kBlockWidth * n);
+        for (int i = i0; i < i1; i++) {
+            int x0 = (i % num_of_blocks) * kBlockWidth;
+            int width = std::min(kBlockWidth, size.x - x0);
+            double* base = data + (i / num_of_blocks) * outer_stride + x0;
+            for (int j = 0; j < n; j++)
+                for (int c = 0; c < width; c++)
+                    block[c * n + j] = base[j * stride + c];
+
+            for (int c = 0; c < width; c++) {
+                if (inverse)
+                    plan.Inverse(&block[c * n], &buf[0], &work[0]);
+                else
+                    plan.Forward(&block[c * n], &buf[0], &work[0]);
+            }
+
+            for (int j = 0; j < n; j++)
+                for (int c = 0; c < width; c++)
+                    base[j * stride + c] = block[c * n + j];
+        }
+    });
+}
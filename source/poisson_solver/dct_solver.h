@@ -0,0 +1,71 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _DCT_SOLVER_H_
+#define _DCT_SOLVER_H_
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "third_party/glm/vec3.hpp"
+
+class ThreadPool;
+
+// Exact solver of the 7-point Poisson equation on a box, running on the
+// host. With Neumann walls the operator is diagonalized by the DCT-II along
+// every axis. An open face, whose ghost cells hold the negated pressure as
+// the outflow boundary does for positive pressure, turns its axis into a
+// DCT-IV, or into a DST-II if the opposite face is open too. A solve is then
+// a forward transform, a division by the eigenvalues and an inverse
+// transform, which is O(N log N) in all.
+//
+// The transforms go through a mixed-radix complex FFT, so any grid size
+// works. The plans, i.e. the twiddle factors and the eigenvalues, are cached
+// per axis length. Lines along y and z are gathered in blocks of adjacent
+// columns to stay in cache, and the blocks are spread over |pool|.
+class DctSolver
+{
+public:
+    explicit DctSolver(ThreadPool* pool);
+    ~DctSolver();
+
+    // |u| and |b| are dense fp32 arrays of |size| in x-major order, and may
+    // point to the same memory. |open_lower| and |open_upper| select the open
+    // faces on either end of each axis. With closed walls, the null space of
+    // the operator is dropped, i.e. |u| comes out with zero mean.
+    void Solve(float* u, const float* b, const glm::ivec3& size,
+               const glm::bvec3& open_lower, const glm::bvec3& open_upper);
+
+private:
+    class Plan;
+
+    const Plan& GetPlan(int n, bool open_begin, bool open_end);
+    void TransformAxis(int axis, const Plan& plan, bool inverse);
+
+    ThreadPool* pool_;
+    std::map<std::pair<int, int>, std::unique_ptr<Plan>> plans_;
+    glm::ivec3 size_;
+    std::vector<double> data_;
+};
+
+#endif // _DCT_SOLVER_H_
\ No newline at end of file
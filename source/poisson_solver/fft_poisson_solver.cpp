@@ -0,0 +1,115 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "fft_poisson_solver.h"
+
+#include "graphics_volume.h"
+#include "poisson_core.h"
+
+// The exact solution is computed in a single pass, through the fast
+// transforms on the host. Every call costs two transfers between the host
+// and the device, but no iteration.
+//
+// Besides being a fast path, this is meant as the ground truth for measuring
+// the other solvers.
+
+FftPoissonSolver::FftPoissonSolver(PoissonCore* core)
+    : core_(core)
+    , num_iterations_(1)
+    , num_iterations_used_(0)
+    , open_lower_(false)
+    , open_upper_(false)
+{
+
+}
+
+FftPoissonSolver::~FftPoissonSolver()
+{
+
+}
+
+bool FftPoissonSolver::Initialize(int width, int height, int depth,
+                                  int byte_width, int minimum_grid_width)
+{
+    return true;
+}
+
+void FftPoissonSolver::SetAuxiliaryVolumes(
+    const std::vector<std::shared_ptr<GraphicsVolume>>& volumes)
+{
+
+}
+
+void FftPoissonSolver::SetDiagnosis(bool diagnosis)
+{
+
+}
+
+void FftPoissonSolver::SetNumOfIterations(int num_iterations,
+                                          int nested_solver)
+{
+    // Only for the fallback.
+    num_iterations_ = num_iterations;
+}
+
+void FftPoissonSolver::Solve(std::shared_ptr<GraphicsVolume> u,
+                             std::shared_ptr<GraphicsVolume> b)
+{
+    num_iterations_used_ = 1;
+    if (core_->SolveDirect(*u, *b, open_lower_, open_upper_))
+        return;
+
+    // No host transfer in this core, or an outflow boundary. The relaxation
+    // only knows the walls and the outflow.
+    u->Clear();
+    core_->Relax(*u, *b, num_iterations_);
+    num_iterations_used_ = num_iterations_;
+}
+
+void FftPoissonSolver::SetTolerance(float relative_tolerance,
+                                    float absolute_tolerance)
+{
+
+}
+
+int FftPoissonSolver::GetNumOfIterationsUsed() const
+{
+    return num_iterations_used_;
+}
+
+void FftPoissonSolver::SetWarmStart(bool warm_start)
+{
+
+}
+
+bool FftPoissonSolver::SetOpenFaces(const glm::bvec3& lower,
+                                    const glm::bvec3& upper)
+{
+    // The fallback relaxation only knows the walls.
+    bool open = lower != glm::bvec3(false) || upper != glm::bvec3(false);
+    if (open && !core_->CanSolveDirect())
+        return false;
+
+    open_lower_ = lower;
+    open_upper_ = upper;
+    return true;
+}
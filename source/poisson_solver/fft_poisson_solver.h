@@ -0,0 +1,61 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _FFT_POISSON_SOLVER_H_
+#define _FFT_POISSON_SOLVER_H_
+
+#include <memory>
+#include <vector>
+
+#include "poisson_solver.h"
+
+class PoissonCore;
+class FftPoissonSolver : public PoissonSolver
+{
+public:
+    explicit FftPoissonSolver(PoissonCore* core);
+    virtual ~FftPoissonSolver();
+
+    virtual bool Initialize(int width, int height, int depth,
+                            int byte_width, int minimum_grid_width) override;
+    virtual void SetAuxiliaryVolumes(
+        const std::vector<std::shared_ptr<GraphicsVolume>>& volumes) override;
+    virtual void SetDiagnosis(bool diagnosis) override;
+    virtual void SetNumOfIterations(int num_iterations,
+                                    int nested_solver) override;
+    virtual void Solve(std::shared_ptr<GraphicsVolume> u,
+                       std::shared_ptr<GraphicsVolume> b) override;
+    virtual void SetTolerance(float relative_tolerance,
+                              float absolute_tolerance) override;
+    virtual int GetNumOfIterationsUsed() const override;
+    virtual void SetWarmStart(bool warm_start) override;
+    virtual bool SetOpenFaces(const glm::bvec3& lower,
+                              const glm::bvec3& upper) override;
+
+private:
+    PoissonCore* core_;
+    int num_iterations_;
+    int num_iterations_used_;
+    glm::bvec3 open_lower_;
+    glm::bvec3 open_upper_;
+};
+
+#endif // _FFT_POISSON_SOLVER_H_
\ No newline at end of file
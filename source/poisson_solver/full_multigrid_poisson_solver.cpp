@@ -26,6 +26,7 @@
 #include <algorithm>
 
 #include "graphics_volume.h"
+#include "multigrid_hierarchy.h"
 #include "multigrid_poisson_solver.h"
 #include "poisson_core.h"
 #include "utility.h"
@@ -38,6 +39,10 @@ FullMultigridPoissonSolver::FullMultigridPoissonSolver(PoissonCore* core)
     , volume_resource_()
     , num_iterations_(1)
     , num_nested_iterations_(2)
+    , relative_tolerance_(0.0f)
+    , absolute_tolerance_(0.0f)
+    , num_iterations_used_(0)
+    , warm_start_(false)
 {
 
 }
@@ -59,27 +64,21 @@ bool FullMultigridPoissonSolver::Initialize(int width, int height, int depth,
     volume_resource_.clear();
     volume_resource_.push_back(VolumePair());
 
-    int min_width = std::min(std::min(width, height), depth);
-
-    int scale = 2;
-    while (min_width / scale > minimum_grid_width - 1) {
-        int w = width / scale;
-        int h = height / scale;
-        int d = depth / scale;
-
-        std::shared_ptr<GraphicsVolume> v0 = core_->CreateVolume(w, h, d, 1,
-                                                                 byte_width);
+    // Must be identical to that of |solver_|.
+    std::vector<glm::ivec3> levels = BuildMultigridHierarchy(
+        glm::ivec3(width, height, depth), minimum_grid_width);
+    for (auto& size : levels) {
+        std::shared_ptr<GraphicsVolume> v0 = core_->CreateVolume(
+            size.x, size.y, size.z, 1, byte_width);
         if (!v0)
             return false;
 
-        std::shared_ptr<GraphicsVolume> v1 = core_->CreateVolume(w, h, d, 1,
-                                                                 byte_width);
+        std::shared_ptr<GraphicsVolume> v1 = core_->CreateVolume(
+            size.x, size.y, size.z, 1, byte_width);
         if (!v1)
             return false;
 
         volume_resource_.push_back(std::make_pair(v0, v1));
-
-        scale <<= 1;
     }
 
     return true;
@@ -108,16 +107,56 @@ void FullMultigridPoissonSolver::Solve(std::shared_ptr<GraphicsVolume> u,
 {
     if (u->GetWidth() < 32) {
         solver_->Solve(u, b);
+        num_iterations_used_ = solver_->GetNumOfIterationsUsed();
         return;
     }
 
-    for (int i = 0; i < num_iterations_; i++)
-        Iterate(u, b, !i);
+    // The residual of the finest level is evaluated by |solver_|.
+    bool check_convergence = relative_tolerance_ > 0.0f ||
+        absolute_tolerance_ > 0.0f;
+
+    // Unless warm started, the first pass starts with a zero guess.
+    float initial_norm = 0.0f;
+    if (check_convergence)
+        initial_norm = warm_start_ ? solver_->ComputeResidualNorm(*u, *b) :
+            solver_->ComputeNorm(*b);
+
+    num_iterations_used_ = num_iterations_;
+    for (int i = 0; i < num_iterations_; i++) {
+        Iterate(u, b, !i && !warm_start_, !i);
+
+        if (check_convergence && i < num_iterations_ - 1) {
+            float norm = solver_->ComputeResidualNorm(*u, *b);
+            if (IsConverged(norm, initial_norm, relative_tolerance_,
+                            absolute_tolerance_)) {
+                num_iterations_used_ = i + 1;
+                break;
+            }
+        }
+    }
+}
+
+void FullMultigridPoissonSolver::SetTolerance(float relative_tolerance,
+                                              float absolute_tolerance)
+{
+    relative_tolerance_ = relative_tolerance;
+    absolute_tolerance_ = absolute_tolerance;
+}
+
+int FullMultigridPoissonSolver::GetNumOfIterationsUsed() const
+{
+    return num_iterations_used_;
+}
+
+void FullMultigridPoissonSolver::SetWarmStart(bool warm_start)
+{
+    warm_start_ = warm_start;
 }
 
 void FullMultigridPoissonSolver::Iterate(std::shared_ptr<GraphicsVolume> u,
                                          std::shared_ptr<GraphicsVolume> b,
-                                         bool apply_initial_guess)
+                                         bool apply_initial_guess,
+                                         bool restrict_rhs)
 {
     assert(volume_resource_.size() > 1);
     if (volume_resource_.size() <= 1)
@@ -141,7 +180,7 @@ void FullMultigridPoissonSolver::Iterate(std::shared_ptr<GraphicsVolume> u,
 
         core_->Restrict(*coarse_volume.first, *fine_volume.first);
 
-        if (apply_initial_guess)
+        if (restrict_rhs)
             core_->Restrict(*coarse_volume.second, *fine_volume.second);
     }
 
@@ -149,7 +188,8 @@ void FullMultigridPoissonSolver::Iterate(std::shared_ptr<GraphicsVolume> u,
     //if (as_precondition)
     //    core_->RelaxWithZeroGuess(*coarsest.first, *coarsest.second, level_cell_size);
 
-    core_->Relax(*coarsest.first, *coarsest.second, 16);
+    if (!core_->SolveCoarsest(*coarsest.first, *coarsest.second))
+        core_->Relax(*coarsest.first, *coarsest.second, 16);
 
     for (int j = num_of_levels - 2; j >= 0; j--) {
         VolumePair coarse_volume = volume_resource_[j + 1];
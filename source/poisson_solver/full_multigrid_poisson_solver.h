@@ -44,6 +44,10 @@ public:
                                     int nested_solver) override;
     virtual void Solve(std::shared_ptr<GraphicsVolume> u,
                        std::shared_ptr<GraphicsVolume> b) override;
+    virtual void SetTolerance(float relative_tolerance,
+                              float absolute_tolerance) override;
+    virtual int GetNumOfIterationsUsed() const override;
+    virtual void SetWarmStart(bool warm_start) override;
 
 private:
     typedef std::pair<std::shared_ptr<GraphicsVolume>,
@@ -51,13 +55,17 @@ private:
 
     void Iterate(std::shared_ptr<GraphicsVolume> u,
                  std::shared_ptr<GraphicsVolume> b,
-                 bool apply_initial_guess);
+                 bool apply_initial_guess, bool restrict_rhs);
 
     PoissonCore* core_;
     std::unique_ptr<MultigridPoissonSolver> solver_;
     std::vector<VolumePair> volume_resource_;
     int num_iterations_;
     int num_nested_iterations_;
+    float relative_tolerance_;
+    float absolute_tolerance_;
+    int num_iterations_used_;
+    bool warm_start_;
 };
 
 #endif // _FULL_MULTIGRID_POISSON_SOLVER_H_
\ No newline at end of file
@@ -0,0 +1,151 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "gauss_seidel_poisson_solver.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "graphics_mem_piece.h"
+#include "graphics_volume.h"
+#include "poisson_core.h"
+
+namespace
+{
+// The residual is examined every |kConvergenceCheckInterval| iterations,
+// which costs about as much as one iteration plus a read-back.
+const int kConvergenceCheckInterval = 4;
+} // Anonymous namespace.
+
+GaussSeidelPoissonSolver::GaussSeidelPoissonSolver(PoissonCore* core)
+    : core_(core)
+    , residual_()
+    , residual_norm_()
+    , num_iterations_(1)
+    , relative_tolerance_(0.0f)
+    , absolute_tolerance_(0.0f)
+    , num_iterations_used_(0)
+    , warm_start_(false)
+{
+
+}
+
+GaussSeidelPoissonSolver::~GaussSeidelPoissonSolver()
+{
+
+}
+
+bool GaussSeidelPoissonSolver::Initialize(int width, int height, int depth,
+                                          int byte_width,
+                                          int minimum_grid_width)
+{
+    // Red-black Gauss-Seidel updates |u| in-place, so that unlike the
+    // ping-pong Jacobi, no volume is needed other than the one for testing
+    // the convergence, which is created on demand.
+    residual_norm_ = core_->CreateMemPiece(
+        std::max(sizeof(float), static_cast<size_t>(byte_width)));
+    if (!residual_norm_)
+        return false;
+
+    return true;
+}
+
+void GaussSeidelPoissonSolver::SetAuxiliaryVolumes(
+    const std::vector<std::shared_ptr<GraphicsVolume>>& volumes)
+{
+
+}
+
+void GaussSeidelPoissonSolver::SetDiagnosis(bool diagnosis)
+{
+
+}
+
+void GaussSeidelPoissonSolver::SetNumOfIterations(int num_iterations,
+                                                  int nested_solver)
+{
+    num_iterations_ = num_iterations;
+}
+
+void GaussSeidelPoissonSolver::Solve(std::shared_ptr<GraphicsVolume> u,
+                                     std::shared_ptr<GraphicsVolume> b)
+{
+    if (!warm_start_)
+        u->Clear();
+
+    bool check_convergence =
+        relative_tolerance_ > 0.0f || absolute_tolerance_ > 0.0f;
+    if (check_convergence && !residual_) {
+        residual_ = core_->CreateVolume(u->GetWidth(), u->GetHeight(),
+                                        u->GetDepth(), 1, u->GetByteWidth());
+        if (!residual_)
+            check_convergence = false;
+    }
+
+    if (!check_convergence) {
+        core_->Relax(*u, *b, num_iterations_);
+        num_iterations_used_ = num_iterations_;
+        return;
+    }
+
+    float initial_norm = ComputeResidualNorm(*u, *b);
+
+    num_iterations_used_ = 0;
+    while (num_iterations_used_ < num_iterations_) {
+        int n = std::min(kConvergenceCheckInterval,
+                         num_iterations_ - num_iterations_used_);
+        core_->Relax(*u, *b, n);
+        num_iterations_used_ += n;
+
+        if (num_iterations_used_ < num_iterations_) {
+            float norm = ComputeResidualNorm(*u, *b);
+            if (IsConverged(norm, initial_norm, relative_tolerance_,
+                            absolute_tolerance_))
+                break;
+        }
+    }
+}
+
+void GaussSeidelPoissonSolver::SetTolerance(float relative_tolerance,
+                                            float absolute_tolerance)
+{
+    relative_tolerance_ = relative_tolerance;
+    absolute_tolerance_ = absolute_tolerance;
+}
+
+int GaussSeidelPoissonSolver::GetNumOfIterationsUsed() const
+{
+    return num_iterations_used_;
+}
+
+void GaussSeidelPoissonSolver::SetWarmStart(bool warm_start)
+{
+    warm_start_ = warm_start;
+}
+
+float GaussSeidelPoissonSolver::ComputeResidualNorm(const GraphicsVolume& u,
+                                                    const GraphicsVolume& b)
+{
+    core_->ComputeResidual(*residual_, u, b);
+    core_->ComputeRho(*residual_norm_, *residual_, *residual_);
+    return std::sqrt(std::abs(core_->ReadScalar(*residual_norm_)));
+}
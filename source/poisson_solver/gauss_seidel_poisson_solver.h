@@ -0,0 +1,66 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _GAUSS_SEIDEL_POISSON_SOLVER_H_
+#define _GAUSS_SEIDEL_POISSON_SOLVER_H_
+
+#include <memory>
+#include <vector>
+
+#include "poisson_solver.h"
+
+class GraphicsMemPiece;
+class PoissonCore;
+class GaussSeidelPoissonSolver : public PoissonSolver
+{
+public:
+    explicit GaussSeidelPoissonSolver(PoissonCore* core);
+    virtual ~GaussSeidelPoissonSolver();
+
+    virtual bool Initialize(int width, int height, int depth,
+                            int byte_width, int minimum_grid_width) override;
+    virtual void SetAuxiliaryVolumes(
+        const std::vector<std::shared_ptr<GraphicsVolume>>& volumes) override;
+    virtual void SetDiagnosis(bool diagnosis) override;
+    virtual void SetNumOfIterations(int num_iterations,
+                                    int nested_solver) override;
+    virtual void Solve(std::shared_ptr<GraphicsVolume> u,
+                       std::shared_ptr<GraphicsVolume> b) override;
+    virtual void SetTolerance(float relative_tolerance,
+                              float absolute_tolerance) override;
+    virtual int GetNumOfIterationsUsed() const override;
+    virtual void SetWarmStart(bool warm_start) override;
+
+private:
+    float ComputeResidualNorm(const GraphicsVolume& u,
+                              const GraphicsVolume& b);
+
+    PoissonCore* core_;
+    std::shared_ptr<GraphicsVolume> residual_;
+    std::shared_ptr<GraphicsMemPiece> residual_norm_;
+    int num_iterations_;
+    float relative_tolerance_;
+    float absolute_tolerance_;
+    int num_iterations_used_;
+    bool warm_start_;
+};
+
+#endif // _GAUSS_SEIDEL_POISSON_SOLVER_H_
\ No newline at end of file
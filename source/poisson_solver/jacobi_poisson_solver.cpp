@@ -0,0 +1,147 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "jacobi_poisson_solver.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "graphics_mem_piece.h"
+#include "graphics_volume.h"
+#include "poisson_core.h"
+
+namespace
+{
+// The residual is examined every |kConvergenceCheckInterval| iterations,
+// which costs about as much as two sweeps plus a read-back.
+const int kConvergenceCheckInterval = 8;
+} // Anonymous namespace.
+
+JacobiPoissonSolver::JacobiPoissonSolver(PoissonCore* core, float omega)
+    : core_(core)
+    , aux_()
+    , residual_norm_()
+    , omega_(omega)
+    , num_iterations_(2)
+    , relative_tolerance_(0.0f)
+    , absolute_tolerance_(0.0f)
+    , num_iterations_used_(0)
+    , warm_start_(false)
+{
+
+}
+
+JacobiPoissonSolver::~JacobiPoissonSolver()
+{
+
+}
+
+bool JacobiPoissonSolver::Initialize(int width, int height, int depth,
+                                     int byte_width, int minimum_grid_width)
+{
+    aux_ = core_->CreateVolume(width, height, depth, 1, byte_width);
+    if (!aux_)
+        return false;
+
+    residual_norm_ = core_->CreateMemPiece(
+        std::max(sizeof(float), static_cast<size_t>(byte_width)));
+    if (!residual_norm_)
+        return false;
+
+    return true;
+}
+
+void JacobiPoissonSolver::SetAuxiliaryVolumes(
+    const std::vector<std::shared_ptr<GraphicsVolume>>& volumes)
+{
+
+}
+
+void JacobiPoissonSolver::SetDiagnosis(bool diagnosis)
+{
+
+}
+
+void JacobiPoissonSolver::SetNumOfIterations(int num_iterations,
+                                             int nested_solver)
+{
+    // Rounded up to even, so that the ping-pong always ends up in |u|.
+    num_iterations_ = std::max(num_iterations + (num_iterations & 1), 2);
+}
+
+void JacobiPoissonSolver::Solve(std::shared_ptr<GraphicsVolume> u,
+                                std::shared_ptr<GraphicsVolume> b)
+{
+    assert(aux_ && u->HasSameProperties(*aux_));
+    if (!aux_ || !u->HasSameProperties(*aux_))
+        return;
+
+    if (!warm_start_)
+        u->Clear();
+
+    bool check_convergence =
+        relative_tolerance_ > 0.0f || absolute_tolerance_ > 0.0f;
+    float initial_norm = check_convergence ? ComputeResidualNorm(*u, *b) :
+        0.0f;
+
+    num_iterations_used_ = 0;
+    while (num_iterations_used_ < num_iterations_) {
+        core_->RelaxJacobi(*aux_, *u, *b, omega_);
+        core_->RelaxJacobi(*u, *aux_, *b, omega_);
+        num_iterations_used_ += 2;
+
+        if (check_convergence && num_iterations_used_ < num_iterations_ &&
+                num_iterations_used_ % kConvergenceCheckInterval == 0) {
+            float norm = ComputeResidualNorm(*u, *b);
+            if (IsConverged(norm, initial_norm, relative_tolerance_,
+                            absolute_tolerance_))
+                break;
+        }
+    }
+}
+
+void JacobiPoissonSolver::SetTolerance(float relative_tolerance,
+                                       float absolute_tolerance)
+{
+    relative_tolerance_ = relative_tolerance;
+    absolute_tolerance_ = absolute_tolerance;
+}
+
+int JacobiPoissonSolver::GetNumOfIterationsUsed() const
+{
+    return num_iterations_used_;
+}
+
+void JacobiPoissonSolver::SetWarmStart(bool warm_start)
+{
+    warm_start_ = warm_start;
+}
+
+float JacobiPoissonSolver::ComputeResidualNorm(const GraphicsVolume& u,
+                                               const GraphicsVolume& b)
+{
+    // |aux_| is free to use between two pairs of sweeps.
+    core_->ComputeResidual(*aux_, u, b);
+    core_->ComputeRho(*residual_norm_, *aux_, *aux_);
+    return std::sqrt(std::abs(core_->ReadScalar(*residual_norm_)));
+}
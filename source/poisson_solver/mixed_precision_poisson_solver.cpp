@@ -0,0 +1,165 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "mixed_precision_poisson_solver.h"
+
+#include <cmath>
+
+#include "graphics_mem_piece.h"
+#include "graphics_volume.h"
+#include "poisson_core.h"
+
+// Iterative refinement: the residual and the solution are kept in fp32,
+// while the correction of each round is solved by |solver_| in the lower
+// precision. The fp16 solvers stall at a residual of about 1e-3 relative to
+// the right-hand side, but every round starts over from the fp32 residual,
+// so the error keeps shrinking by that factor per round, at the cost of two
+// fp32 passes per round.
+//
+// The residual is scaled to a unit RMS before it is converted, or it would
+// soon fall into the subnormal range of fp16.
+
+MixedPrecisionPoissonSolver::MixedPrecisionPoissonSolver(
+        PoissonCore* core, std::unique_ptr<PoissonSolver> solver)
+    : core_(core)
+    , solver_(std::move(solver))
+    , residual_()
+    , correction_()
+    , residual_norm_()
+    , num_refinements_(1)
+    , relative_tolerance_(0.0f)
+    , absolute_tolerance_(0.0f)
+    , num_iterations_used_(0)
+    , final_residual_norm_(0.0f)
+    , warm_start_(false)
+{
+
+}
+
+MixedPrecisionPoissonSolver::~MixedPrecisionPoissonSolver()
+{
+
+}
+
+bool MixedPrecisionPoissonSolver::Initialize(int width, int height, int depth,
+                                             int byte_width,
+                                             int minimum_grid_width)
+{
+    residual_norm_ = core_->CreateMemPiece(sizeof(float));
+    if (!residual_norm_)
+        return false;
+
+    residual_ = core_->CreateVolume(width, height, depth, 1, byte_width);
+    if (!residual_)
+        return false;
+
+    correction_ = core_->CreateVolume(width, height, depth, 1, byte_width);
+    if (!correction_)
+        return false;
+
+    // The corrections always start from zero.
+    solver_->SetWarmStart(false);
+    return solver_->Initialize(width, height, depth, byte_width,
+                               minimum_grid_width);
+}
+
+void MixedPrecisionPoissonSolver::SetAuxiliaryVolumes(
+    const std::vector<std::shared_ptr<GraphicsVolume>>& volumes)
+{
+    solver_->SetAuxiliaryVolumes(volumes);
+}
+
+void MixedPrecisionPoissonSolver::SetDiagnosis(bool diagnosis)
+{
+    solver_->SetDiagnosis(diagnosis);
+}
+
+void MixedPrecisionPoissonSolver::SetNumOfIterations(int num_iterations,
+                                                     int nested_solver)
+{
+    num_refinements_ = num_iterations;
+    solver_->SetNumOfIterations(nested_solver, 0);
+}
+
+void MixedPrecisionPoissonSolver::Solve(std::shared_ptr<GraphicsVolume> u,
+                                        std::shared_ptr<GraphicsVolume> b)
+{
+    if (!warm_start_)
+        u->Clear();
+
+    std::shared_ptr<GraphicsVolume> r = core_->GetScratchVolume(*u);
+    if (!r)
+        return;
+
+    float num_of_cells = static_cast<float>(u->GetWidth()) * u->GetHeight() *
+        u->GetDepth();
+    float norm = ComputeResidualNorm(*r, *u, *b);
+    float initial_norm = norm;
+
+    num_iterations_used_ = 0;
+    for (int i = 0; i < num_refinements_; i++) {
+        if (norm == 0.0f ||
+                IsConverged(norm, initial_norm, relative_tolerance_,
+                            absolute_tolerance_))
+            break;
+
+        float scale = std::sqrt(num_of_cells) / norm;
+        core_->ConvertVolume(*residual_, *r, scale, false);
+        solver_->Solve(correction_, residual_);
+        core_->ConvertVolume(*u, *correction_, 1.0f / scale, true);
+
+        num_iterations_used_ += solver_->GetNumOfIterationsUsed();
+        norm = ComputeResidualNorm(*r, *u, *b);
+    }
+
+    final_residual_norm_ = norm;
+}
+
+void MixedPrecisionPoissonSolver::SetTolerance(float relative_tolerance,
+                                               float absolute_tolerance)
+{
+    relative_tolerance_ = relative_tolerance;
+    absolute_tolerance_ = absolute_tolerance;
+}
+
+int MixedPrecisionPoissonSolver::GetNumOfIterationsUsed() const
+{
+    return num_iterations_used_;
+}
+
+void MixedPrecisionPoissonSolver::SetWarmStart(bool warm_start)
+{
+    warm_start_ = warm_start;
+}
+
+float MixedPrecisionPoissonSolver::GetResidualNorm() const
+{
+    return final_residual_norm_;
+}
+
+float MixedPrecisionPoissonSolver::ComputeResidualNorm(
+    const GraphicsVolume& r, const GraphicsVolume& u, const GraphicsVolume& b)
+{
+    core_->ComputeResidual(r, u, b);
+    core_->ComputeRho(*residual_norm_, r, r);
+    return std::sqrt(std::abs(core_->ReadScalar(*residual_norm_)));
+}
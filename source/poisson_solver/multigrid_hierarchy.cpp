@@ -0,0 +1,60 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "multigrid_hierarchy.h"
+
+#include <algorithm>
+
+#include "graphics_volume.h"
+
+namespace
+{
+// The short axes are not to be coarsened below this, or the smoother would
+// hardly see a neighbor in that direction.
+const int kMinimumExtent = 4;
+} // Anonymous namespace.
+
+glm::ivec3 CoarsenGridSize(const glm::ivec3& size)
+{
+    return (size + 1) / 2;
+}
+
+std::vector<glm::ivec3> BuildMultigridHierarchy(const glm::ivec3& size,
+                                                int minimum_grid_width)
+{
+    std::vector<glm::ivec3> levels;
+    glm::ivec3 coarse = CoarsenGridSize(size);
+    while (std::max(std::max(coarse.x, coarse.y), coarse.z) >=
+            minimum_grid_width &&
+            std::min(std::min(coarse.x, coarse.y), coarse.z) >=
+            kMinimumExtent) {
+        levels.push_back(coarse);
+        coarse = CoarsenGridSize(coarse);
+    }
+
+    return levels;
+}
+
+glm::ivec3 GetGridSize(const GraphicsVolume& v)
+{
+    return glm::ivec3(v.GetWidth(), v.GetHeight(), v.GetDepth());
+}
@@ -0,0 +1,52 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _MULTIGRID_HIERARCHY_H_
+#define _MULTIGRID_HIERARCHY_H_
+
+#include <vector>
+
+#include "third_party/glm/vec3.hpp"
+
+class GraphicsVolume;
+
+// The grid one level coarser than |size|. Every axis is halved, and odd
+// extents are rounded up, in which case the last coarse cell covers the
+// border cell and its Neumann ghost. The cells stay cubic, so the same
+// 7-point stencil applies to all the levels.
+glm::ivec3 CoarsenGridSize(const glm::ivec3& size);
+
+// The sizes of all the coarser levels below |size|, finest first. Coarsening
+// goes on while the longest axis of the next level is no less than
+// |minimum_grid_width|, so that the coarsest level of an elongated domain is
+// as cheap to relax as that of a cubic one.
+//
+// The axes are always coarsened together, not semi-coarsened: halving only
+// the long axes would make the coarse cells anisotropic and every relaxation
+// kernel would need per-axis weights. The short axes stop at 4 cells instead,
+// and an elongated domain then converges per V-cycle about as fast as a cubic
+// one.
+std::vector<glm::ivec3> BuildMultigridHierarchy(const glm::ivec3& size,
+                                                int minimum_grid_width);
+
+glm::ivec3 GetGridSize(const GraphicsVolume& v);
+
+#endif // _MULTIGRID_HIERARCHY_H_
\ No newline at end of file
@@ -22,12 +22,15 @@
 #include "stdafx.h"
 #include "multigrid_poisson_solver.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <tuple>
 
+#include "graphics_mem_piece.h"
 #include "graphics_volume.h"
-#include "graphics_volume_group.h"
 #include "metrics.h"
+#include "multigrid_hierarchy.h"
 #include "poisson_core.h"
 #include "utility.h"
 
@@ -49,9 +52,13 @@
 MultigridPoissonSolver::MultigridPoissonSolver(PoissonCore* core)
     : core_(core)
     , volume_resource_()
-    , residual_volume_()
+    , residual_norm_()
     , num_iterations_(1)
     , num_finest_level_iteration_per_pass_(2)
+    , relative_tolerance_(0.0f)
+    , absolute_tolerance_(0.0f)
+    , num_iterations_used_(0)
+    , warm_start_(false)
     , diagnosis_(false)
     , diagnosis_volume_()
 {
@@ -66,23 +73,25 @@ bool MultigridPoissonSolver::Initialize(int width, int height, int depth,
                                         int byte_width, int minimum_grid_width)
 {
     volume_resource_.clear();
-    residual_volume_ = core_->CreateVolume(width, height, depth, 1, byte_width);
-
-    int min_width = std::min(std::min(width, height), depth);
-    int scale = 2;
-    while (min_width / scale > minimum_grid_width - 1) {
-        int w = width / scale;
-        int h = height / scale;
-        int d = depth / scale;
-
-        std::shared_ptr<GraphicsVolume3> g = core_->CreateVolumeGroup(
-            w, h, d, 1, byte_width);
-        if (!g)
+    residual_norm_ = core_->CreateMemPiece(
+        std::max(sizeof(float), static_cast<size_t>(byte_width)));
+    if (!residual_norm_)
+        return false;
+
+    std::vector<glm::ivec3> levels = BuildMultigridHierarchy(
+        glm::ivec3(width, height, depth), minimum_grid_width);
+    for (auto& size : levels) {
+        std::shared_ptr<GraphicsVolume> v0 = core_->CreateVolume(
+            size.x, size.y, size.z, 1, byte_width);
+        if (!v0)
             return false;
 
-        volume_resource_.push_back(g);
+        std::shared_ptr<GraphicsVolume> v1 = core_->CreateVolume(
+            size.x, size.y, size.z, 1, byte_width);
+        if (!v1)
+            return false;
 
-        scale <<= 1;
+        volume_resource_.push_back(std::make_pair(v0, v1));
     }
 
     return true;
@@ -111,80 +120,133 @@ void MultigridPoissonSolver::Solve(std::shared_ptr<GraphicsVolume> u,
     if (!ValidateVolume(u) || !ValidateVolume(b))
         return;
 
-    for (int i = 0; i < num_iterations_; i++)
-        Iterate(u, b, !i);
+    // Testing the convergence costs an extra residual computing and a dot
+    // product in every pass, plus a scratch volume held by the core.
+    bool check_convergence =
+        relative_tolerance_ > 0.0f || absolute_tolerance_ > 0.0f;
+
+    // Unless warm started, the first pass starts with a zero guess.
+    float initial_norm = 0.0f;
+    if (check_convergence)
+        initial_norm = warm_start_ ? ComputeResidualNorm(*u, *b) :
+            ComputeNorm(*b);
+
+    num_iterations_used_ = num_iterations_;
+    for (int i = 0; i < num_iterations_; i++) {
+        Iterate(u, b, !i && !warm_start_);
+
+        if (check_convergence && i < num_iterations_ - 1) {
+            float norm = ComputeResidualNorm(*u, *b);
+            if (IsConverged(norm, initial_norm, relative_tolerance_,
+                            absolute_tolerance_)) {
+                num_iterations_used_ = i + 1;
+                break;
+            }
+        }
+    }
+}
+
+void MultigridPoissonSolver::SetTolerance(float relative_tolerance,
+                                          float absolute_tolerance)
+{
+    relative_tolerance_ = relative_tolerance;
+    absolute_tolerance_ = absolute_tolerance;
+}
+
+int MultigridPoissonSolver::GetNumOfIterationsUsed() const
+{
+    return num_iterations_used_;
+}
+
+void MultigridPoissonSolver::SetWarmStart(bool warm_start)
+{
+    warm_start_ = warm_start;
+}
+
+float MultigridPoissonSolver::ComputeNorm(const GraphicsVolume& v)
+{
+    core_->ComputeRho(*residual_norm_, v, v);
+    return std::sqrt(std::abs(core_->ReadScalar(*residual_norm_)));
+}
+
+float MultigridPoissonSolver::ComputeResidualNorm(const GraphicsVolume& u,
+                                                  const GraphicsVolume& b)
+{
+    std::shared_ptr<GraphicsVolume> r = core_->GetScratchVolume(u);
+    if (!r)
+        return 0.0f;
+
+    core_->ComputeResidual(*r, u, b);
+    return ComputeNorm(*r);
 }
 
 bool MultigridPoissonSolver::ValidateVolume(
     std::shared_ptr<GraphicsVolume> v)
 {
-    if (volume_resource_.empty())
-        return false;
+    // Any level that has a coarser one below it.
+    glm::ivec3 coarse_size = CoarsenGridSize(GetGridSize(*v));
+    for (auto& level : volume_resource_)
+        if (GetGridSize(*level.first) == coarse_size)
+            return true;
 
-    if (v->GetWidth() > volume_resource_[0]->x()->GetWidth() * 2 ||
-            v->GetHeight() > volume_resource_[0]->x()->GetHeight() * 2 ||
-            v->GetDepth() > volume_resource_[0]->x()->GetDepth() * 2)
-        return false;
-
-    return true;
+    return false;
 }
 
 void MultigridPoissonSolver::Iterate(std::shared_ptr<GraphicsVolume> u,
                                      std::shared_ptr<GraphicsVolume> b,
                                      bool apply_initial_guess)
 {
+    glm::ivec3 coarse_size = CoarsenGridSize(GetGridSize(*u));
     auto i = volume_resource_.begin();
-    auto prev = i;
-    for (; i != volume_resource_.end(); ++i) {
-        if ((*i)->x()->GetWidth() * 2 == u->GetWidth())
+    for (; i != volume_resource_.end(); ++i)
+        if (GetGridSize(*i->first) == coarse_size)
             break;
 
-        prev = i;
-    }
-
     assert(i != volume_resource_.end());
     if (i == volume_resource_.end())
         return;
 
-    std::shared_ptr<GraphicsVolume> residual_volume =
-        i == prev ? residual_volume_ : (*prev)->z();
-    std::vector<std::shared_ptr<GraphicsVolume3>> volumes(
-        1, std::make_shared<GraphicsVolume3>(u, b, residual_volume));
-
+    std::vector<VolumePair> volumes(1, std::make_pair(u, b));
     volumes.insert(volumes.end(), i, volume_resource_.end());
 
     int times_to_iterate = num_finest_level_iteration_per_pass_;
 
+    // The residual is restricted as it is computed, so none of the levels
+    // keeps a residual volume.
     const int num_of_levels = static_cast<int>(volumes.size());
     for (int i = 0; i < num_of_levels - 1; i++) {
-        std::shared_ptr<GraphicsVolume3> fine_volumes = volumes[i];
-        std::shared_ptr<GraphicsVolume> coarse_volume = volumes[i + 1]->y();
+        VolumePair fine_volumes = volumes[i];
+        std::shared_ptr<GraphicsVolume> coarse_volume = volumes[i + 1].second;
 
         if (i || apply_initial_guess)
-            core_->RelaxWithZeroGuess(*fine_volumes->x(), *fine_volumes->y());
+            core_->RelaxWithZeroGuess(*fine_volumes.first,
+                                      *fine_volumes.second);
         else
-            core_->Relax(*fine_volumes->x(), *fine_volumes->y(), 2);
+            core_->Relax(*fine_volumes.first, *fine_volumes.second, 2);
 
-        core_->Relax(*fine_volumes->x(), *fine_volumes->y(),
-                     times_to_iterate - 2);
-        core_->ComputeResidual(*fine_volumes->z(), *fine_volumes->x(),
-                               *fine_volumes->y());
-        core_->Restrict(*coarse_volume, *fine_volumes->z());
+        core_->Smooth(*fine_volumes.first, *fine_volumes.second,
+                      times_to_iterate - 2);
+        core_->ComputeResidualAndRestrict(*coarse_volume, *fine_volumes.first,
+                                          *fine_volumes.second);
 
         times_to_iterate *= 2;
     }
 
-    std::shared_ptr<GraphicsVolume3> coarsest = volumes[num_of_levels - 1];
-    core_->RelaxWithZeroGuess(*coarsest->x(), *coarsest->y());
-    core_->Relax(*coarsest->x(), *coarsest->y(), times_to_iterate - 2 + 30);
+    VolumePair coarsest = volumes[num_of_levels - 1];
+    if (!core_->SolveCoarsest(*coarsest.first, *coarsest.second)) {
+        core_->RelaxWithZeroGuess(*coarsest.first, *coarsest.second);
+        core_->Relax(*coarsest.first, *coarsest.second,
+                     times_to_iterate - 2 + 30);
+    }
 
     for (int j = num_of_levels - 2; j >= 0; j--) {
-        std::shared_ptr<GraphicsVolume> coarse_volume = volumes[j + 1]->x();
-        std::shared_ptr<GraphicsVolume3> fine_volume = volumes[j];
+        std::shared_ptr<GraphicsVolume> coarse_volume = volumes[j + 1].first;
+        VolumePair fine_volume = volumes[j];
 
         times_to_iterate /= 2;
 
-        core_->ProlongateError(*fine_volume->x(), *coarse_volume);
-        core_->Relax(*fine_volume->x(), *fine_volume->y(), times_to_iterate);
+        core_->ProlongateErrorAndSmooth(*fine_volume.first,
+                                        *fine_volume.second, *coarse_volume,
+                                        times_to_iterate);
     }
 }
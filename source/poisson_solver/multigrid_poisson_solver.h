@@ -27,8 +27,8 @@
 
 #include "poisson_solver.h"
 
+class GraphicsMemPiece;
 class GraphicsVolume;
-class GraphicsVolume3;
 class PoissonCore;
 class MultigridPoissonSolver : public PoissonSolver
 {
@@ -45,22 +45,39 @@ public:
                                     int nested_solver) override;
     virtual void Solve(std::shared_ptr<GraphicsVolume> u,
                        std::shared_ptr<GraphicsVolume> b) override;
+    virtual void SetTolerance(float relative_tolerance,
+                              float absolute_tolerance) override;
+    virtual int GetNumOfIterationsUsed() const override;
+    virtual void SetWarmStart(bool warm_start) override;
+
+    // Both are meant for volumes of the finest level, and the results are
+    // read back from the device.
+    float ComputeNorm(const GraphicsVolume& v);
+    float ComputeResidualNorm(const GraphicsVolume& u,
+                              const GraphicsVolume& b);
 
     void set_num_finest_level_iteration_per_pass(int n) {
         num_finest_level_iteration_per_pass_ = n;
     }
 
 private:
+    typedef std::pair<std::shared_ptr<GraphicsVolume>,
+        std::shared_ptr<GraphicsVolume>> VolumePair;
+
     void Iterate(std::shared_ptr<GraphicsVolume> u,
                  std::shared_ptr<GraphicsVolume> b,
                  bool apply_initial_guess);
     bool ValidateVolume(std::shared_ptr<GraphicsVolume> v);
 
     PoissonCore* core_;
-    std::vector<std::shared_ptr<GraphicsVolume3>> volume_resource_;
-    std::shared_ptr<GraphicsVolume> residual_volume_;
+    std::vector<VolumePair> volume_resource_;
+    std::shared_ptr<GraphicsMemPiece> residual_norm_;
     int num_iterations_;
     int num_finest_level_iteration_per_pass_;
+    float relative_tolerance_;
+    float absolute_tolerance_;
+    int num_iterations_used_;
+    bool warm_start_;
     bool diagnosis_;
 
     // For diagnosis.
@@ -26,13 +26,13 @@
 #include <tuple>
 
 #include "graphics_volume.h"
+#include "multigrid_hierarchy.h"
 #include "poisson_core.h"
 
 OpenBoundaryMultigridPoissonSolver::OpenBoundaryMultigridPoissonSolver(
         PoissonCore* core)
     : core_(core)
     , volume_resource_()
-    , residual_volume_()
     , num_finest_level_iteration_per_pass_(2)
 {
 }
@@ -47,23 +47,21 @@ bool OpenBoundaryMultigridPoissonSolver::Initialize(int width, int height,
                                                     int byte_width)
 {
     volume_resource_.clear();
-    residual_volume_ = core_->CreateVolume(width, height, depth, 1, byte_width);
-
-    int min_width = std::min(std::min(width, height), depth);
-    int scale = 2;
-    while (min_width / scale > 8) {
-        int w = width / scale;
-        int h = height / scale;
-        int d = depth / scale;
-
-        std::shared_ptr<GraphicsVolume3> v = core_->CreateVolumeGroup(
-            w, h, d, 1, byte_width);
-        if (!v)
+
+    std::vector<glm::ivec3> levels = BuildMultigridHierarchy(
+        glm::ivec3(width, height, depth), 16);
+    for (auto& size : levels) {
+        std::shared_ptr<GraphicsVolume> v0 = core_->CreateVolume(
+            size.x, size.y, size.z, 1, byte_width);
+        if (!v0)
             return false;
 
-        volume_resource_.push_back(v);
+        std::shared_ptr<GraphicsVolume> v1 = core_->CreateVolume(
+            size.x, size.y, size.z, 1, byte_width);
+        if (!v1)
+            return false;
 
-        scale <<= 1;
+        volume_resource_.push_back(std::make_pair(v0, v1));
     }
 
     return true;
@@ -72,58 +70,51 @@ bool OpenBoundaryMultigridPoissonSolver::Initialize(int width, int height,
 void OpenBoundaryMultigridPoissonSolver::Solve(
     std::shared_ptr<GraphicsVolume> u, std::shared_ptr<GraphicsVolume> b)
 {
+    glm::ivec3 coarse_size = CoarsenGridSize(GetGridSize(*u));
     auto i = volume_resource_.begin();
-    auto prev = i;
-    for (; i != volume_resource_.end(); ++i) {
-        if ((*i)->x()->GetWidth() * 2 == u->GetWidth())
+    for (; i != volume_resource_.end(); ++i)
+        if (GetGridSize(*i->first) == coarse_size)
             break;
 
-        prev = i;
-    }
-
     assert(i != volume_resource_.end());
     if (i == volume_resource_.end())
         return;
 
-    std::shared_ptr<GraphicsVolume> residual_volume =
-        i == prev ? residual_volume_ : (*prev)->z();
-    std::vector<std::shared_ptr<GraphicsVolume3>> volumes(
-        1, std::make_shared<GraphicsVolume3>(u, b, residual_volume));
-
+    std::vector<VolumePair> volumes(1, std::make_pair(u, b));
     volumes.insert(volumes.end(), i, volume_resource_.end());
 
     int times_to_iterate = num_finest_level_iteration_per_pass_;
 
     const int num_of_levels = static_cast<int>(volumes.size());
     for (int i = 0; i < num_of_levels - 1; i++) {
-        std::shared_ptr<GraphicsVolume3> fine_volumes = volumes[i];
-        std::shared_ptr<GraphicsVolume> coarse_volume = volumes[i + 1]->y();
+        VolumePair fine_volumes = volumes[i];
+        std::shared_ptr<GraphicsVolume> coarse_volume = volumes[i + 1].second;
 
         if (i)
-            core_->RelaxWithZeroGuess(*fine_volumes->x(), *fine_volumes->y());
+            core_->RelaxWithZeroGuess(*fine_volumes.first,
+                                      *fine_volumes.second);
         else
-            Relax(fine_volumes->x(), fine_volumes->y(), 2);
+            Relax(fine_volumes.first, fine_volumes.second, 2);
 
-        Relax(fine_volumes->x(), fine_volumes->y(), times_to_iterate - 2);
-        core_->ComputeResidual(*fine_volumes->z(), *fine_volumes->x(),
-                               *fine_volumes->y());
-        core_->Restrict(*coarse_volume, *fine_volumes->z());
+        Relax(fine_volumes.first, fine_volumes.second, times_to_iterate - 2);
+        core_->ComputeResidualAndRestrict(*coarse_volume, *fine_volumes.first,
+                                          *fine_volumes.second);
 
         times_to_iterate *= 2;
     }
 
-    std::shared_ptr<GraphicsVolume3> coarsest = volumes[num_of_levels - 1];
-    core_->RelaxWithZeroGuess(*coarsest->x(), *coarsest->y());
-    Relax(coarsest->x(), coarsest->y(), times_to_iterate - 2);
+    VolumePair coarsest = volumes[num_of_levels - 1];
+    core_->RelaxWithZeroGuess(*coarsest.first, *coarsest.second);
+    Relax(coarsest.first, coarsest.second, times_to_iterate - 2);
 
     for (int j = num_of_levels - 2; j >= 0; j--) {
-        std::shared_ptr<GraphicsVolume> coarse_volume = volumes[j + 1]->x();
-        std::shared_ptr<GraphicsVolume3> fine_volume = volumes[j];
+        std::shared_ptr<GraphicsVolume> coarse_volume = volumes[j + 1].first;
+        VolumePair fine_volume = volumes[j];
 
         times_to_iterate /= 2;
 
-        core_->ProlongateError(*fine_volume->x(), *coarse_volume);
-        Relax(fine_volume->x(), fine_volume->y(), times_to_iterate);
+        core_->ProlongateErrorAndRelax(*fine_volume.first, *fine_volume.second,
+                                       *coarse_volume, times_to_iterate);
     }
 }
 
@@ -25,7 +25,7 @@
 #include <memory>
 #include <vector>
 
-#include "graphics_volume_group.h"
+#include "graphics_volume.h"
 
 class PoissonCore;
 class OpenBoundaryMultigridPoissonSolver
@@ -44,12 +44,14 @@ public:
     }
 
 private:
+    typedef std::pair<std::shared_ptr<GraphicsVolume>,
+        std::shared_ptr<GraphicsVolume>> VolumePair;
+
     void Relax(std::shared_ptr<GraphicsVolume> u,
                std::shared_ptr<GraphicsVolume> b, int times);
 
     PoissonCore* core_;
-    std::vector<std::shared_ptr<GraphicsVolume3>> volume_resource_;
-    std::shared_ptr<GraphicsVolume> residual_volume_;
+    std::vector<VolumePair> volume_resource_;
     int num_finest_level_iteration_per_pass_;
 };
 
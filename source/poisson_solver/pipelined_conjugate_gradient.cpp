@@ -0,0 +1,212 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "pipelined_conjugate_gradient.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "graphics_mem_piece.h"
+#include "graphics_volume.h"
+#include "multigrid_poisson_solver.h"
+#include "poisson_core.h"
+
+PipelinedConjugateGradient::PipelinedConjugateGradient(PoissonCore* core)
+    : core_(core)
+    , preconditioner_(new MultigridPoissonSolver(core))
+    , alpha_()
+    , beta_()
+    , rho_()
+    , residual_()
+    , preconditioned_()
+    , aux_()
+    , search_()
+    , aux_search_()
+    , num_iterations_(1)
+    , num_nested_iterations_(2)
+    , relative_tolerance_(0.0f)
+    , absolute_tolerance_(0.0f)
+    , num_iterations_used_(0)
+    , warm_start_(false)
+    , diagnosis_(false)
+{
+
+}
+
+PipelinedConjugateGradient::~PipelinedConjugateGradient()
+{
+
+}
+
+bool PipelinedConjugateGradient::Initialize(int width, int height, int depth,
+                                            int byte_width,
+                                            int minimum_grid_width)
+{
+    if (!preconditioner_->Initialize(width, height, depth, byte_width,
+                                     minimum_grid_width))
+        return false;
+
+    size_t scalar_byte_width = std::max(sizeof(float),
+                                        static_cast<size_t>(byte_width));
+
+    alpha_ = core_->CreateMemPiece(scalar_byte_width);
+    if (!alpha_)
+        return false;
+
+    beta_ = core_->CreateMemPiece(scalar_byte_width);
+    if (!beta_)
+        return false;
+
+    rho_ = core_->CreateMemPiece(scalar_byte_width);
+    if (!rho_)
+        return false;
+
+    preconditioned_ = core_->CreateVolume(width, height, depth, 1, byte_width);
+    if (!preconditioned_)
+        return false;
+
+    if (!aux_) {
+        aux_ = core_->CreateVolume(width, height, depth, 1, byte_width);
+        if (!aux_)
+            return false;
+    }
+
+    if (!search_) {
+        search_ = core_->CreateVolume(width, height, depth, 1, byte_width);
+        if (!search_)
+            return false;
+    }
+
+    aux_search_ = core_->CreateVolume(width, height, depth, 1, byte_width);
+    if (!aux_search_)
+        return false;
+
+    return true;
+}
+
+void PipelinedConjugateGradient::SetAuxiliaryVolumes(
+    const std::vector<std::shared_ptr<GraphicsVolume>>& volumes)
+{
+    if (volumes.size() >= 1)
+        aux_ = volumes[0];
+
+    if (volumes.size() >= 2)
+        search_ = volumes[1];
+}
+
+void PipelinedConjugateGradient::SetDiagnosis(bool diagnosis)
+{
+    diagnosis_ = diagnosis;
+}
+
+void PipelinedConjugateGradient::SetNumOfIterations(int num_iterations,
+                                                    int nested_solver)
+{
+    num_iterations_ = num_iterations;
+    num_nested_iterations_ = nested_solver;
+}
+
+void PipelinedConjugateGradient::Solve(std::shared_ptr<GraphicsVolume> u,
+                                       std::shared_ptr<GraphicsVolume> b)
+{
+    std::shared_ptr<GraphicsVolume> r = b;
+
+    // As in PreconditionedConjugateGradient, |b| is used as the residual
+    // unless it has to be kept for diagnosis, or the residual of a warm
+    // start is needed.
+    if (warm_start_ || (diagnosis_ && num_iterations_ > 1)) {
+        if (!residual_) {
+            residual_ = core_->CreateVolume(b->GetWidth(), b->GetHeight(),
+                                            b->GetDepth(), 1,
+                                            b->GetByteWidth());
+            if (!residual_)
+                return;
+        }
+
+        if (!warm_start_)
+            u->Clear();
+
+        core_->ComputeResidual(*residual_, *u, *b);
+        r = residual_;
+    } else {
+        u->Clear();
+    }
+
+    // The search directions are always accumulated, but scaled by a zero
+    // beta in the first iteration, which must not meet any garbage.
+    search_->Clear();
+    aux_search_->Clear();
+
+    preconditioner_->set_num_finest_level_iteration_per_pass(
+        num_nested_iterations_);
+    preconditioner_->Solve(preconditioned_, r);
+    core_->ApplyStencilAndReduce(*alpha_, *beta_, *rho_, *aux_,
+                                 *preconditioned_, *r, true);
+
+    bool check_convergence =
+        relative_tolerance_ > 0.0f || absolute_tolerance_ > 0.0f;
+    float initial_norm = 0.0f;
+    if (check_convergence)
+        initial_norm = std::sqrt(std::abs(core_->ReadScalar(*rho_)));
+
+    num_iterations_used_ = num_iterations_;
+    for (int i = 0; i < num_iterations_; i++) {
+        core_->UpdateSearchAndVector(*u, *search_, *preconditioned_, *alpha_,
+                                     *beta_, 1.0f);
+        if (i == num_iterations_ - 1)
+            break;
+
+        core_->UpdateSearchAndVector(*r, *aux_search_, *aux_, *alpha_, *beta_,
+                                     -1.0f);
+        preconditioner_->Solve(preconditioned_, r);
+
+        // The only reduction of the iteration.
+        core_->ApplyStencilAndReduce(*alpha_, *beta_, *rho_, *aux_,
+                                     *preconditioned_, *r, false);
+        if (check_convergence) {
+            float norm = std::sqrt(std::abs(core_->ReadScalar(*rho_)));
+            if (IsConverged(norm, initial_norm, relative_tolerance_,
+                            absolute_tolerance_)) {
+                num_iterations_used_ = i + 1;
+                return;
+            }
+        }
+    }
+}
+
+void PipelinedConjugateGradient::SetTolerance(float relative_tolerance,
+                                              float absolute_tolerance)
+{
+    relative_tolerance_ = relative_tolerance;
+    absolute_tolerance_ = absolute_tolerance;
+}
+
+int PipelinedConjugateGradient::GetNumOfIterationsUsed() const
+{
+    return num_iterations_used_;
+}
+
+void PipelinedConjugateGradient::SetWarmStart(bool warm_start)
+{
+    warm_start_ = warm_start;
+}
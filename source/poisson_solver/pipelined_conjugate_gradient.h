@@ -0,0 +1,80 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _PIPELINED_CONJUGATE_GRADIENT_H_
+#define _PIPELINED_CONJUGATE_GRADIENT_H_
+
+#include <memory>
+#include <vector>
+
+#include "poisson_solver.h"
+
+class GraphicsMemPiece;
+class MultigridPoissonSolver;
+class PoissonCore;
+
+// Multigrid preconditioned conjugate gradient, rearranged as Chronopoulos and
+// Gear did, so that the two dot products of an iteration are computed
+// together in the stencil sweep. Each iteration then has one reduction
+// instead of three, and the vector updates are merged into two sweeps.
+// Mathematically equivalent to PreconditionedConjugateGradient, though
+// slightly less stable in finite precision.
+class PipelinedConjugateGradient : public PoissonSolver
+{
+public:
+    explicit PipelinedConjugateGradient(PoissonCore* core);
+    virtual ~PipelinedConjugateGradient();
+
+    virtual bool Initialize(int width, int height, int depth,
+                            int byte_width, int minimum_grid_width) override;
+    virtual void SetAuxiliaryVolumes(
+        const std::vector<std::shared_ptr<GraphicsVolume>>& volumes) override;
+    virtual void SetDiagnosis(bool diagnosis) override;
+    virtual void SetNumOfIterations(int num_iterations,
+                                    int nested_solver) override;
+    virtual void Solve(std::shared_ptr<GraphicsVolume> u,
+                       std::shared_ptr<GraphicsVolume> b) override;
+    virtual void SetTolerance(float relative_tolerance,
+                              float absolute_tolerance) override;
+    virtual int GetNumOfIterationsUsed() const override;
+    virtual void SetWarmStart(bool warm_start) override;
+
+private:
+    PoissonCore* core_;
+    std::unique_ptr<MultigridPoissonSolver> preconditioner_;
+    std::shared_ptr<GraphicsMemPiece> alpha_;
+    std::shared_ptr<GraphicsMemPiece> beta_;
+    std::shared_ptr<GraphicsMemPiece> rho_;
+    std::shared_ptr<GraphicsVolume> residual_;
+    std::shared_ptr<GraphicsVolume> preconditioned_; // M^-1 * r
+    std::shared_ptr<GraphicsVolume> aux_;            // A * M^-1 * r
+    std::shared_ptr<GraphicsVolume> search_;         // p
+    std::shared_ptr<GraphicsVolume> aux_search_;     // A * p
+    int num_iterations_;
+    int num_nested_iterations_;
+    float relative_tolerance_;
+    float absolute_tolerance_;
+    int num_iterations_used_;
+    bool warm_start_;
+    bool diagnosis_;
+};
+
+#endif // _PIPELINED_CONJUGATE_GRADIENT_H_
\ No newline at end of file
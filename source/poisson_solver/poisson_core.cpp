@@ -22,7 +22,29 @@
 #include "stdafx.h"
 #include "poisson_core.h"
 
+#include <algorithm>
+
+#include "cpu_host/thread_pool.h"
+#include "dct_solver.h"
+#include "graphics_volume.h"
+
+namespace
+{
+// Bounds of the eigenvalues of D^-1 * A that the Chebyshev smoother targets.
+// 2 is the upper bound of the 7-point Laplacian with Neumann boundaries
+// (Gershgorin), and the lower third of the spectrum is left to the coarser
+// levels.
+const float kChebyshevUpperBound = 2.0f;
+const float kChebyshevRange = 6.0f;
+} // Anonymous namespace.
+
 PoissonCore::PoissonCore()
+    : smoother_(POISSON_SMOOTHER_GAUSS_SEIDEL)
+    , outflow_(false)
+    , direct_solver_()
+    , direct_buffer_()
+    , host_pool_()
+    , scratch_volumes_()
 {
 
 }
@@ -31,3 +53,125 @@ PoissonCore::~PoissonCore()
 {
 
 }
+
+void PoissonCore::Smooth(const GraphicsVolume& u, const GraphicsVolume& b,
+                         int num_of_iterations)
+{
+    if (smoother_ != POISSON_SMOOTHER_CHEBYSHEV || num_of_iterations <= 0) {
+        Relax(u, b, num_of_iterations);
+        return;
+    }
+
+    std::shared_ptr<GraphicsVolume> scratch = GetScratchVolume(u);
+    if (!scratch)
+        return;
+
+    float upper = kChebyshevUpperBound;
+    float lower = upper / kChebyshevRange;
+    float theta = (upper + lower) * 0.5f;
+    float delta = (upper - lower) * 0.5f;
+    float sigma = theta / delta;
+
+    const GraphicsVolume& aux = *scratch;
+    RelaxJacobi(aux, u, b, 1.0f / theta);
+
+    const GraphicsVolume* prev = &u;
+    const GraphicsVolume* cur = &aux;
+    float rho = 1.0f / sigma;
+    for (int i = 1; i < num_of_iterations; i++) {
+        float rho_new = 1.0f / (2.0f * sigma - rho);
+        RelaxChebyshev(*prev, *cur, b, rho_new * rho, 2.0f * rho_new / delta);
+
+        std::swap(prev, cur);
+        rho = rho_new;
+    }
+
+    // The iterates are ping-ponged between |u| and |aux|, so an odd number
+    // of sweeps leaves the result in |aux|. A Jacobi sweep with no weight
+    // copies it back.
+    if (cur != &u)
+        RelaxJacobi(u, aux, b, 0.0f);
+}
+
+void PoissonCore::ProlongateErrorAndSmooth(const GraphicsVolume& u,
+                                           const GraphicsVolume& b,
+                                           const GraphicsVolume& coarse,
+                                           int num_of_iterations)
+{
+    if (smoother_ == POISSON_SMOOTHER_CHEBYSHEV || num_of_iterations <= 0) {
+        ProlongateError(u, coarse);
+        Smooth(u, b, num_of_iterations);
+        return;
+    }
+
+    ProlongateErrorAndRelax(u, b, coarse, num_of_iterations);
+}
+
+bool PoissonCore::SolveDirect(const GraphicsVolume& u, const GraphicsVolume& b)
+{
+    return SolveDirect(u, b, glm::bvec3(false), glm::bvec3(false));
+}
+
+bool PoissonCore::SolveDirect(const GraphicsVolume& u, const GraphicsVolume& b,
+                              const glm::bvec3& open_lower,
+                              const glm::bvec3& open_upper)
+{
+    if (!CanSolveDirect())
+        return false;
+
+    glm::ivec3 size(u.GetWidth(), u.GetHeight(), u.GetDepth());
+    direct_buffer_.resize(size.x * size.y * size.z);
+    if (!ReadVolume(&direct_buffer_[0], b))
+        return false;
+
+    if (!direct_solver_)
+        direct_solver_.reset(new DctSolver(GetHostThreadPool()));
+
+    direct_solver_->Solve(&direct_buffer_[0], &direct_buffer_[0], size,
+                          open_lower, open_upper);
+    return WriteVolume(u, &direct_buffer_[0]);
+}
+
+bool PoissonCore::SolveCoarsest(const GraphicsVolume& u,
+                                const GraphicsVolume& b)
+{
+    return HasHostVolumes() && SolveDirect(u, b);
+}
+
+bool PoissonCore::CanSolveDirect() const
+{
+    return HasHostTransfer() && !outflow_;
+}
+
+bool PoissonCore::HasHostTransfer() const
+{
+    return true;
+}
+
+bool PoissonCore::HasHostVolumes() const
+{
+    return false;
+}
+
+ThreadPool* PoissonCore::GetHostThreadPool()
+{
+    if (!host_pool_)
+        host_pool_.reset(new ThreadPool(0));
+
+    return host_pool_.get();
+}
+
+std::shared_ptr<GraphicsVolume> PoissonCore::GetScratchVolume(
+    const GraphicsVolume& v)
+{
+    for (auto& scratch : scratch_volumes_)
+        if (scratch->HasSameProperties(v))
+            return scratch;
+
+    std::shared_ptr<GraphicsVolume> scratch = CreateVolume(
+        v.GetWidth(), v.GetHeight(), v.GetDepth(), 1, v.GetByteWidth());
+    if (scratch)
+        scratch_volumes_.push_back(scratch);
+
+    return scratch;
+}
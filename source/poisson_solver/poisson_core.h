@@ -23,16 +23,66 @@
 #define _POISSON_CORE_H_
 
 #include <memory>
+#include <vector>
 
+#include "poisson_solver_enum.h"
+#include "third_party/glm/vec3.hpp"
+
+class DctSolver;
 class GraphicsMemPiece;
 class GraphicsVolume;
 class GraphicsVolume3;
+class ThreadPool;
 class PoissonCore
 {
 public:
     PoissonCore();
     virtual ~PoissonCore();
 
+    // Smooths |u| with |num_of_iterations| sweeps of the smoother selected.
+    // The Chebyshev smoother takes a scratch volume of the same size, see
+    // GetScratchVolume(), and an extra pass to copy the result back after an
+    // odd number of sweeps.
+    void Smooth(const GraphicsVolume& u, const GraphicsVolume& b,
+                int num_of_iterations);
+
+    // The upward half of a V-cycle on one level: ProlongateError() followed
+    // by Smooth(). The Gauss-Seidel smoother takes the fused path.
+    void ProlongateErrorAndSmooth(const GraphicsVolume& u,
+                                  const GraphicsVolume& b,
+                                  const GraphicsVolume& coarse,
+                                  int num_of_iterations);
+
+    // Solves the equation exactly on the host, see DctSolver. Returns false
+    // if the core has no host transfer or the outflow boundary is set, which
+    // the transforms do not cover. The caller should then fall back to
+    // relaxation.
+    bool SolveDirect(const GraphicsVolume& u, const GraphicsVolume& b);
+
+    // Same as above, with the faces selected in |open_lower| and
+    // |open_upper| open as well, see DctSolver.
+    bool SolveDirect(const GraphicsVolume& u, const GraphicsVolume& b,
+                     const glm::bvec3& open_lower,
+                     const glm::bvec3& open_upper);
+
+    // SolveDirect() for the coarsest level of a multigrid. Only the cores
+    // that keep their volumes on the host take it, the others would pay two
+    // transfers on every V-cycle. Returns false if the caller should relax
+    // instead.
+    bool SolveCoarsest(const GraphicsVolume& u, const GraphicsVolume& b);
+
+    // Whether SolveDirect() is available with the current boundaries.
+    bool CanSolveDirect() const;
+
+    // Returns a volume with the same properties as |v| that the caller is
+    // free to scribble on until the next call. The volumes are created on
+    // demand and kept by the core, so that the solvers do not have to
+    // reserve one for every level in case it is needed.
+    std::shared_ptr<GraphicsVolume> GetScratchVolume(const GraphicsVolume& v);
+
+    void set_outflow(bool outflow) { outflow_ = outflow; }
+    void set_smoother(PoissonSmootherEnum smoother) { smoother_ = smoother; }
+
     virtual std::shared_ptr<GraphicsMemPiece> CreateMemPiece(int size) = 0;
     virtual std::shared_ptr<GraphicsVolume> CreateVolume(int width, int height,
                                                          int depth,
@@ -52,11 +102,41 @@ public:
                                  const GraphicsVolume& coarse) = 0;
     virtual void Relax(const GraphicsVolume& u, const GraphicsVolume& b,
                        int num_of_iterations) = 0;
+
+    // A single (damped) Jacobi sweep. Unlike Relax(), which is a red-black
+    // Gauss-Seidel that works in-place, |unp1| and |un| must be different
+    // volumes.
+    virtual void RelaxJacobi(const GraphicsVolume& unp1,
+                             const GraphicsVolume& un, const GraphicsVolume& b,
+                             float omega) = 0;
+
+    // A single sweep of the Chebyshev semi-iteration, in the form of
+    // |unp1| = |un| + momentum * (|un| - |unp1|) + omega * D^-1 * r, where
+    // |unp1| holds the iterate before |un| on entry.
+    virtual void RelaxChebyshev(const GraphicsVolume& unp1,
+                                const GraphicsVolume& un,
+                                const GraphicsVolume& b, float momentum,
+                                float omega) = 0;
     virtual void RelaxWithZeroGuess(const GraphicsVolume& u,
                                     const GraphicsVolume& b) = 0;
     virtual void Restrict(const GraphicsVolume& coarse,
                           const GraphicsVolume& fine) = 0;
 
+    // ComputeResidual() and Restrict() in a single pass. The residual of
+    // the fine level is evaluated on the fly and never written out.
+    virtual void ComputeResidualAndRestrict(const GraphicsVolume& coarse,
+                                            const GraphicsVolume& u,
+                                            const GraphicsVolume& b) = 0;
+
+    // ProlongateError() and Relax() with the prolongation folded into the
+    // first sweep: each color adds the interpolated error to the cells it
+    // reads before they are corrected, so the sum is never stored
+    // separately.
+    virtual void ProlongateErrorAndRelax(const GraphicsVolume& u,
+                                         const GraphicsVolume& b,
+                                         const GraphicsVolume& coarse,
+                                         int num_of_iterations) = 0;
+
     // Conjugate gradient.
     virtual void ApplyStencil(const GraphicsVolume& aux,
                               const GraphicsVolume& search) = 0;
@@ -78,6 +158,66 @@ public:
     virtual void ScaleVector(const GraphicsVolume& dest,
                              const GraphicsVolume& v,
                              const GraphicsMemPiece& coef, float sign) = 0;
+
+    // Pipelined conjugate gradient.
+    //
+    // Computes |aux| = A * |precond| in the same sweep as the two dot
+    // products gamma = (|residual|, |precond|) and delta = (|aux|, |precond|),
+    // from which |rho|, |alpha| and |beta| are updated in place without going
+    // back to the host. |restart| discards the previous search direction.
+    virtual void ApplyStencilAndReduce(const GraphicsMemPiece& alpha,
+                                       const GraphicsMemPiece& beta,
+                                       const GraphicsMemPiece& rho,
+                                       const GraphicsVolume& aux,
+                                       const GraphicsVolume& precond,
+                                       const GraphicsVolume& residual,
+                                       bool restart) = 0;
+
+    // |search| = |v| + beta * |search|, then
+    // |dest| = |dest| + sign * alpha * |search|.
+    virtual void UpdateSearchAndVector(const GraphicsVolume& dest,
+                                       const GraphicsVolume& search,
+                                       const GraphicsVolume& v,
+                                       const GraphicsMemPiece& alpha,
+                                       const GraphicsMemPiece& beta,
+                                       float sign) = 0;
+
+    // Mixed precision.
+    //
+    // |dest| = |v| * scale, or |dest| + |v| * scale if |accumulate| is set.
+    // Unlike the other operations, the two volumes may differ in precision.
+    virtual void ConvertVolume(const GraphicsVolume& dest,
+                               const GraphicsVolume& v, float scale,
+                               bool accumulate) = 0;
+
+    // Reads back a scalar produced by the kernels above, which stalls the
+    // pipeline.
+    virtual float ReadScalar(const GraphicsMemPiece& scalar) = 0;
+
+    // Host transfers of a single-component volume, as a dense fp32 array in
+    // x-major order.
+    virtual bool ReadVolume(float* dest, const GraphicsVolume& v) = 0;
+    virtual bool WriteVolume(const GraphicsVolume& v, const float* source) = 0;
+
+protected:
+    // Whether ReadVolume() and WriteVolume() are implemented.
+    virtual bool HasHostTransfer() const;
+
+    // Whether the volumes live in the host memory, where ReadVolume() and
+    // WriteVolume() are plain copies.
+    virtual bool HasHostVolumes() const;
+
+    // The threads that SolveDirect() runs on. Unless overridden, the core
+    // starts a pool of its own on first use.
+    virtual ThreadPool* GetHostThreadPool();
+
+private:
+    PoissonSmootherEnum smoother_;
+    bool outflow_;
+    std::unique_ptr<DctSolver> direct_solver_;
+    std::vector<float> direct_buffer_;
+    std::unique_ptr<ThreadPool> host_pool_;
+    std::vector<std::shared_ptr<GraphicsVolume>> scratch_volumes_;
 };
 
 #endif // _POISSON_CORE_H_
\ No newline at end of file
@@ -0,0 +1,269 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "poisson_core_cpu.h"
+
+#include <cassert>
+
+#include "cpu_host/cpu_main.h"
+#include "cpu_host/cpu_mem_piece.h"
+#include "graphics_mem_piece.h"
+#include "graphics_volume.h"
+#include "graphics_volume_group.h"
+#include "utility.h"
+
+PoissonCoreCpu::PoissonCoreCpu()
+    : PoissonCore()
+{
+
+}
+
+PoissonCoreCpu::~PoissonCoreCpu()
+{
+
+}
+
+std::shared_ptr<GraphicsMemPiece> PoissonCoreCpu::CreateMemPiece(int size)
+{
+    std::shared_ptr<GraphicsMemPiece> r =
+        std::make_shared<GraphicsMemPiece>(GRAPHICS_LIB_CPU);
+    bool succeeded = r->Create(size);
+    return succeeded ? r : std::shared_ptr<GraphicsMemPiece>();
+}
+
+std::shared_ptr<GraphicsVolume> PoissonCoreCpu::CreateVolume(
+    int width, int height, int depth, int num_of_components, int byte_width)
+{
+    std::shared_ptr<GraphicsVolume> r =
+        std::make_shared<GraphicsVolume>(GRAPHICS_LIB_CPU);
+    bool succeeded = r->Create(width, height, depth, num_of_components,
+                               byte_width, 0);
+
+    return succeeded ? r : std::shared_ptr<GraphicsVolume>();
+}
+
+std::shared_ptr<GraphicsVolume3> PoissonCoreCpu::CreateVolumeGroup(
+    int width, int height, int depth, int num_of_components, int byte_width)
+{
+    std::shared_ptr<GraphicsVolume3> r(new GraphicsVolume3(GRAPHICS_LIB_CPU));
+    bool succeeded = r->Create(width, height, depth, num_of_components,
+                               byte_width, 0);
+    return succeeded ? r : std::shared_ptr<GraphicsVolume3>();
+}
+
+void PoissonCoreCpu::ComputeResidual(const GraphicsVolume& r,
+                                     const GraphicsVolume& u,
+                                     const GraphicsVolume& b)
+{
+    CpuMain::Instance()->ComputeResidual(r.cpu_volume(), u.cpu_volume(),
+                                         b.cpu_volume());
+}
+
+void PoissonCoreCpu::Prolongate(const GraphicsVolume& fine,
+                                const GraphicsVolume& coarse)
+{
+    CpuMain::Instance()->Prolongate(fine.cpu_volume(), coarse.cpu_volume());
+}
+
+void PoissonCoreCpu::ProlongateError(const GraphicsVolume& fine,
+                                     const GraphicsVolume& coarse)
+{
+    CpuMain::Instance()->ProlongateError(fine.cpu_volume(),
+                                         coarse.cpu_volume());
+}
+
+void PoissonCoreCpu::Relax(const GraphicsVolume& u, const GraphicsVolume& b,
+                           int num_of_iterations)
+{
+    CpuMain::Instance()->Relax(u.cpu_volume(), b.cpu_volume(),
+                               num_of_iterations);
+}
+
+void PoissonCoreCpu::RelaxJacobi(const GraphicsVolume& unp1,
+                                 const GraphicsVolume& un,
+                                 const GraphicsVolume& b, float omega)
+{
+    CpuMain::Instance()->RelaxJacobi(unp1.cpu_volume(), un.cpu_volume(),
+                                     b.cpu_volume(), omega);
+}
+
+void PoissonCoreCpu::RelaxChebyshev(const GraphicsVolume& unp1,
+                                    const GraphicsVolume& un,
+                                    const GraphicsVolume& b, float momentum,
+                                    float omega)
+{
+    CpuMain::Instance()->RelaxChebyshev(unp1.cpu_volume(), un.cpu_volume(),
+                                        b.cpu_volume(), momentum, omega);
+}
+
+void PoissonCoreCpu::RelaxWithZeroGuess(const GraphicsVolume& u,
+                                        const GraphicsVolume& b)
+{
+    CpuMain::Instance()->RelaxWithZeroGuess(u.cpu_volume(), b.cpu_volume());
+}
+
+void PoissonCoreCpu::Restrict(const GraphicsVolume& coarse,
+                              const GraphicsVolume& fine)
+{
+    CpuMain::Instance()->Restrict(coarse.cpu_volume(), fine.cpu_volume());
+}
+
+void PoissonCoreCpu::ComputeResidualAndRestrict(const GraphicsVolume& coarse,
+                                                const GraphicsVolume& u,
+                                                const GraphicsVolume& b)
+{
+    CpuMain::Instance()->ComputeResidualAndRestrict(coarse.cpu_volume(),
+                                                    u.cpu_volume(),
+                                                    b.cpu_volume());
+}
+
+void PoissonCoreCpu::ProlongateErrorAndRelax(const GraphicsVolume& u,
+                                             const GraphicsVolume& b,
+                                             const GraphicsVolume& coarse,
+                                             int num_of_iterations)
+{
+    CpuMain::Instance()->ProlongateErrorAndRelax(u.cpu_volume(),
+                                                 b.cpu_volume(),
+                                                 coarse.cpu_volume(),
+                                                 num_of_iterations);
+}
+
+void PoissonCoreCpu::ApplyStencil(const GraphicsVolume& aux,
+                                  const GraphicsVolume& search)
+{
+    CpuMain::Instance()->ApplyStencil(aux.cpu_volume(), search.cpu_volume());
+}
+
+void PoissonCoreCpu::ComputeAlpha(const GraphicsMemPiece& alpha,
+                                  const GraphicsMemPiece& rho,
+                                  const GraphicsVolume& aux,
+                                  const GraphicsVolume& search)
+{
+    CpuMain::Instance()->ComputeAlpha(alpha.cpu_mem_piece(),
+                                      rho.cpu_mem_piece(), aux.cpu_volume(),
+                                      search.cpu_volume());
+}
+
+void PoissonCoreCpu::ComputeRho(const GraphicsMemPiece& rho,
+                                const GraphicsVolume& search,
+                                const GraphicsVolume& residual)
+{
+    CpuMain::Instance()->ComputeRho(rho.cpu_mem_piece(), search.cpu_volume(),
+                                    residual.cpu_volume());
+}
+
+void PoissonCoreCpu::ComputeRhoAndBeta(const GraphicsMemPiece& beta,
+                                       const GraphicsMemPiece& rho_new,
+                                       const GraphicsMemPiece& rho,
+                                       const GraphicsVolume& aux,
+                                       const GraphicsVolume& residual)
+{
+    CpuMain::Instance()->ComputeRhoAndBeta(beta.cpu_mem_piece(),
+                                           rho_new.cpu_mem_piece(),
+                                           rho.cpu_mem_piece(),
+                                           aux.cpu_volume(),
+                                           residual.cpu_volume());
+}
+
+void PoissonCoreCpu::ScaledAdd(const GraphicsVolume& dest,
+                               const GraphicsVolume& v0,
+                               const GraphicsVolume& v1,
+                               const GraphicsMemPiece& coef, float sign)
+{
+    CpuMain::Instance()->ScaledAdd(dest.cpu_volume(), v0.cpu_volume(),
+                                   v1.cpu_volume(), coef.cpu_mem_piece(),
+                                   sign);
+}
+
+void PoissonCoreCpu::ScaleVector(const GraphicsVolume& dest,
+                                 const GraphicsVolume& v,
+                                 const GraphicsMemPiece& coef,
+                                 float sign)
+{
+    CpuMain::Instance()->ScaleVector(dest.cpu_volume(), v.cpu_volume(),
+                                     coef.cpu_mem_piece(), sign);
+}
+
+void PoissonCoreCpu::ApplyStencilAndReduce(const GraphicsMemPiece& alpha,
+                                           const GraphicsMemPiece& beta,
+                                           const GraphicsMemPiece& rho,
+                                           const GraphicsVolume& aux,
+                                           const GraphicsVolume& precond,
+                                           const GraphicsVolume& residual,
+                                           bool restart)
+{
+    CpuMain::Instance()->ApplyStencilAndReduce(alpha.cpu_mem_piece(),
+                                               beta.cpu_mem_piece(),
+                                               rho.cpu_mem_piece(),
+                                               aux.cpu_volume(),
+                                               precond.cpu_volume(),
+                                               residual.cpu_volume(), restart);
+}
+
+void PoissonCoreCpu::UpdateSearchAndVector(const GraphicsVolume& dest,
+                                           const GraphicsVolume& search,
+                                           const GraphicsVolume& v,
+                                           const GraphicsMemPiece& alpha,
+                                           const GraphicsMemPiece& beta,
+                                           float sign)
+{
+    CpuMain::Instance()->UpdateSearchAndVector(dest.cpu_volume(),
+                                               search.cpu_volume(),
+                                               v.cpu_volume(),
+                                               alpha.cpu_mem_piece(),
+                                               beta.cpu_mem_piece(), sign);
+}
+
+void PoissonCoreCpu::ConvertVolume(const GraphicsVolume& dest,
+                                   const GraphicsVolume& v, float scale,
+                                   bool accumulate)
+{
+    CpuMain::Instance()->ConvertVolume(dest.cpu_volume(), v.cpu_volume(),
+                                       scale, accumulate);
+}
+
+float PoissonCoreCpu::ReadScalar(const GraphicsMemPiece& scalar)
+{
+    return *static_cast<float*>(scalar.cpu_mem_piece()->mem());
+}
+
+bool PoissonCoreCpu::ReadVolume(float* dest, const GraphicsVolume& v)
+{
+    CpuMain::Instance()->CopyFromVolume(dest, v.cpu_volume());
+    return true;
+}
+
+bool PoissonCoreCpu::WriteVolume(const GraphicsVolume& v, const float* source)
+{
+    CpuMain::Instance()->CopyToVolume(v.cpu_volume(), source);
+    return true;
+}
+
+bool PoissonCoreCpu::HasHostVolumes() const
+{
+    return true;
+}
+
+ThreadPool* PoissonCoreCpu::GetHostThreadPool()
+{
+    return CpuMain::Instance()->thread_pool();
+}
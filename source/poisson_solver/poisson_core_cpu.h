@@ -0,0 +1,120 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _MULTIGRID_CORE_CPU_H_
+#define _MULTIGRID_CORE_CPU_H_
+
+#include <memory>
+
+#include "poisson_core.h"
+
+class PoissonCoreCpu : public PoissonCore
+{
+public:
+    PoissonCoreCpu();
+    virtual ~PoissonCoreCpu();
+
+    virtual std::shared_ptr<GraphicsMemPiece> CreateMemPiece(int size) override;
+    virtual std::shared_ptr<GraphicsVolume> CreateVolume(
+        int width, int height, int depth, int num_of_components,
+        int byte_width) override;
+    virtual std::shared_ptr<GraphicsVolume3> CreateVolumeGroup(
+        int width, int height, int depth, int num_of_components,
+        int byte_width) override;
+
+    // Multigrid.
+    virtual void ComputeResidual(const GraphicsVolume& r,
+                                 const GraphicsVolume& u,
+                                 const GraphicsVolume& b) override;
+    virtual void Prolongate(const GraphicsVolume& fine,
+                            const GraphicsVolume& coarse) override;
+    virtual void ProlongateError(const GraphicsVolume& fine,
+                                 const GraphicsVolume& coarse) override;
+    virtual void Relax(const GraphicsVolume& u, const GraphicsVolume& b,
+                       int num_of_iterations) override;
+    virtual void RelaxJacobi(const GraphicsVolume& unp1,
+                             const GraphicsVolume& un, const GraphicsVolume& b,
+                             float omega) override;
+    virtual void RelaxChebyshev(const GraphicsVolume& unp1,
+                                const GraphicsVolume& un,
+                                const GraphicsVolume& b, float momentum,
+                                float omega) override;
+    virtual void RelaxWithZeroGuess(const GraphicsVolume& u,
+                                    const GraphicsVolume& b) override;
+    virtual void Restrict(const GraphicsVolume& coarse,
+                          const GraphicsVolume& fine) override;
+    virtual void ComputeResidualAndRestrict(const GraphicsVolume& coarse,
+                                            const GraphicsVolume& u,
+                                            const GraphicsVolume& b) override;
+    virtual void ProlongateErrorAndRelax(const GraphicsVolume& u,
+                                         const GraphicsVolume& b,
+                                         const GraphicsVolume& coarse,
+                                         int num_of_iterations) override;
+
+    // Conjugate gradient.
+    virtual void ApplyStencil(const GraphicsVolume& aux,
+                              const GraphicsVolume& search) override;
+    virtual void ComputeAlpha(const GraphicsMemPiece& alpha,
+                              const GraphicsMemPiece& rho,
+                              const GraphicsVolume& aux,
+                              const GraphicsVolume& search) override;
+    virtual void ComputeRhoAndBeta(const GraphicsMemPiece& beta,
+                                   const GraphicsMemPiece& rho_new,
+                                   const GraphicsMemPiece& rho,
+                                   const GraphicsVolume& aux,
+                                   const GraphicsVolume& residual) override;
+    virtual void ComputeRho(const GraphicsMemPiece& rho,
+                            const GraphicsVolume& search,
+                            const GraphicsVolume& residual) override;
+    virtual void ScaledAdd(const GraphicsVolume& dest, const GraphicsVolume& v0,
+                           const GraphicsVolume& v1,
+                           const GraphicsMemPiece& coef, float sign) override;
+    virtual void ScaleVector(const GraphicsVolume& dest,
+                             const GraphicsVolume& v,
+                             const GraphicsMemPiece& coef,
+                             float sign) override;
+    virtual void ApplyStencilAndReduce(const GraphicsMemPiece& alpha,
+                                       const GraphicsMemPiece& beta,
+                                       const GraphicsMemPiece& rho,
+                                       const GraphicsVolume& aux,
+                                       const GraphicsVolume& precond,
+                                       const GraphicsVolume& residual,
+                                       bool restart) override;
+    virtual void UpdateSearchAndVector(const GraphicsVolume& dest,
+                                       const GraphicsVolume& search,
+                                       const GraphicsVolume& v,
+                                       const GraphicsMemPiece& alpha,
+                                       const GraphicsMemPiece& beta,
+                                       float sign) override;
+    virtual void ConvertVolume(const GraphicsVolume& dest,
+                               const GraphicsVolume& v, float scale,
+                               bool accumulate) override;
+    virtual float ReadScalar(const GraphicsMemPiece& scalar) override;
+    virtual bool ReadVolume(float* dest, const GraphicsVolume& v) override;
+    virtual bool WriteVolume(const GraphicsVolume& v,
+                             const float* source) override;
+
+protected:
+    virtual bool HasHostVolumes() const override;
+    virtual ThreadPool* GetHostThreadPool() override;
+};
+
+#endif // _MULTIGRID_CORE_CPU_H_
\ No newline at end of file
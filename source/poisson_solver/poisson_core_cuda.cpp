@@ -23,8 +23,13 @@
 #include "poisson_core_cuda.h"
 
 #include <cassert>
+#include <vector>
 
+#include <stdint.h>
+
+#include "cpu_host/volume_rows.h"
 #include "cuda_host/cuda_main.h"
+#include "cuda_host/cuda_volume.h"
 #include "graphics_mem_piece.h"
 #include "graphics_volume.h"
 #include "graphics_volume_group.h"
@@ -97,6 +102,23 @@ void PoissonCoreCuda::Relax(const GraphicsVolume& u, const GraphicsVolume& b,
                                 b.cuda_volume(), num_of_iterations);
 }
 
+void PoissonCoreCuda::RelaxJacobi(const GraphicsVolume& unp1,
+                                  const GraphicsVolume& un,
+                                  const GraphicsVolume& b, float omega)
+{
+    CudaMain::Instance()->RelaxJacobi(unp1.cuda_volume(), un.cuda_volume(),
+                                      b.cuda_volume(), omega);
+}
+
+void PoissonCoreCuda::RelaxChebyshev(const GraphicsVolume& unp1,
+                                     const GraphicsVolume& un,
+                                     const GraphicsVolume& b, float momentum,
+                                     float omega)
+{
+    CudaMain::Instance()->RelaxChebyshev(unp1.cuda_volume(), un.cuda_volume(),
+                                         b.cuda_volume(), momentum, omega);
+}
+
 void PoissonCoreCuda::RelaxWithZeroGuess(const GraphicsVolume& u,
                                          const GraphicsVolume& b)
 {
@@ -109,6 +131,26 @@ void PoissonCoreCuda::Restrict(const GraphicsVolume& coarse,
     CudaMain::Instance()->Restrict(coarse.cuda_volume(), fine.cuda_volume());
 }
 
+void PoissonCoreCuda::ComputeResidualAndRestrict(const GraphicsVolume& coarse,
+                                                 const GraphicsVolume& u,
+                                                 const GraphicsVolume& b)
+{
+    CudaMain::Instance()->ComputeResidualAndRestrict(coarse.cuda_volume(),
+                                                     u.cuda_volume(),
+                                                     b.cuda_volume());
+}
+
+void PoissonCoreCuda::ProlongateErrorAndRelax(const GraphicsVolume& u,
+                                              const GraphicsVolume& b,
+                                              const GraphicsVolume& coarse,
+                                              int num_of_iterations)
+{
+    CudaMain::Instance()->ProlongateErrorAndRelax(u.cuda_volume(),
+                                                  b.cuda_volume(),
+                                                  coarse.cuda_volume(),
+                                                  num_of_iterations);
+}
+
 void PoissonCoreCuda::ApplyStencil(const GraphicsVolume& aux,
                                    const GraphicsVolume& search)
 {
@@ -164,3 +206,86 @@ void PoissonCoreCuda::ScaleVector(const GraphicsVolume& dest,
     CudaMain::Instance()->ScaleVector(dest.cuda_volume(), v.cuda_volume(),
                                       coef.cuda_mem_piece(), sign);
 }
+
+void PoissonCoreCuda::ApplyStencilAndReduce(const GraphicsMemPiece& alpha,
+                                            const GraphicsMemPiece& beta,
+                                            const GraphicsMemPiece& rho,
+                                            const GraphicsVolume& aux,
+                                            const GraphicsVolume& precond,
+                                            const GraphicsVolume& residual,
+                                            bool restart)
+{
+    CudaMain::Instance()->ApplyStencilAndReduce(alpha.cuda_mem_piece(),
+                                                beta.cuda_mem_piece(),
+                                                rho.cuda_mem_piece(),
+                                                aux.cuda_volume(),
+                                                precond.cuda_volume(),
+                                                residual.cuda_volume(),
+                                                restart);
+}
+
+void PoissonCoreCuda::UpdateSearchAndVector(const GraphicsVolume& dest,
+                                            const GraphicsVolume& search,
+                                            const GraphicsVolume& v,
+                                            const GraphicsMemPiece& alpha,
+                                            const GraphicsMemPiece& beta,
+                                            float sign)
+{
+    CudaMain::Instance()->UpdateSearchAndVector(dest.cuda_volume(),
+                                                search.cuda_volume(),
+                                                v.cuda_volume(),
+                                                alpha.cuda_mem_piece(),
+                                                beta.cuda_mem_piece(), sign);
+}
+
+void PoissonCoreCuda::ConvertVolume(const GraphicsVolume& dest,
+                                    const GraphicsVolume& v, float scale,
+                                    bool accumulate)
+{
+    CudaMain::Instance()->ConvertVolume(dest.cuda_volume(), v.cuda_volume(),
+                                        scale, accumulate);
+}
+
+float PoissonCoreCuda::ReadScalar(const GraphicsMemPiece& scalar)
+{
+    float r = 0.0f;
+    CudaMain::Instance()->CopyFromMemPiece(&r, scalar.cuda_mem_piece(),
+                                           sizeof(r));
+    return r;
+}
+
+bool PoissonCoreCuda::ReadVolume(float* dest, const GraphicsVolume& v)
+{
+    std::shared_ptr<CudaVolume> source = v.cuda_volume();
+    int width = source->width();
+    if (source->byte_width() == sizeof(float)) {
+        CudaMain::Instance()->CopyFromVolume(dest, width * sizeof(float),
+                                             source);
+        return true;
+    }
+
+    int n = width * source->height() * source->depth();
+    std::vector<uint16_t> staging(n);
+    CudaMain::Instance()->CopyFromVolume(&staging[0], width * sizeof(uint16_t),
+                                         source);
+    ConvertRow(dest, &staging[0], n);
+    return true;
+}
+
+bool PoissonCoreCuda::WriteVolume(const GraphicsVolume& v, const float* source)
+{
+    std::shared_ptr<CudaVolume> dest = v.cuda_volume();
+    int width = dest->width();
+    if (dest->byte_width() == sizeof(float)) {
+        CudaMain::Instance()->CopyToVolume(dest, source,
+                                           width * sizeof(float));
+        return true;
+    }
+
+    int n = width * dest->height() * dest->depth();
+    std::vector<uint16_t> staging(n);
+    ConvertRow(&staging[0], source, n);
+    CudaMain::Instance()->CopyToVolume(dest, &staging[0],
+                                       width * sizeof(uint16_t));
+    return true;
+}
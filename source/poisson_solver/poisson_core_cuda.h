@@ -51,10 +51,24 @@ public:
                                  const GraphicsVolume& coarse) override;
     virtual void Relax(const GraphicsVolume& u, const GraphicsVolume& b,
                        int num_of_iterations) override;
+    virtual void RelaxJacobi(const GraphicsVolume& unp1,
+                             const GraphicsVolume& un, const GraphicsVolume& b,
+                             float omega) override;
+    virtual void RelaxChebyshev(const GraphicsVolume& unp1,
+                                const GraphicsVolume& un,
+                                const GraphicsVolume& b, float momentum,
+                                float omega) override;
     virtual void RelaxWithZeroGuess(const GraphicsVolume& u,
                                     const GraphicsVolume& b) override;
     virtual void Restrict(const GraphicsVolume& coarse,
                           const GraphicsVolume& fine) override;
+    virtual void ComputeResidualAndRestrict(const GraphicsVolume& coarse,
+                                            const GraphicsVolume& u,
+                                            const GraphicsVolume& b) override;
+    virtual void ProlongateErrorAndRelax(const GraphicsVolume& u,
+                                         const GraphicsVolume& b,
+                                         const GraphicsVolume& coarse,
+                                         int num_of_iterations) override;
 
     // Conjugate gradient.
     virtual void ApplyStencil(const GraphicsVolume& aux,
@@ -78,6 +92,26 @@ public:
                              const GraphicsVolume& v,
                              const GraphicsMemPiece& coef,
                              float sign) override;
+    virtual void ApplyStencilAndReduce(const GraphicsMemPiece& alpha,
+                                       const GraphicsMemPiece& beta,
+                                       const GraphicsMemPiece& rho,
+                                       const GraphicsVolume& aux,
+                                       const GraphicsVolume& precond,
+                                       const GraphicsVolume& residual,
+                                       bool restart) override;
+    virtual void UpdateSearchAndVector(const GraphicsVolume& dest,
+                                       const GraphicsVolume& search,
+                                       const GraphicsVolume& v,
+                                       const GraphicsMemPiece& alpha,
+                                       const GraphicsMemPiece& beta,
+                                       float sign) override;
+    virtual void ConvertVolume(const GraphicsVolume& dest,
+                               const GraphicsVolume& v, float scale,
+                               bool accumulate) override;
+    virtual float ReadScalar(const GraphicsMemPiece& scalar) override;
+    virtual bool ReadVolume(float* dest, const GraphicsVolume& v) override;
+    virtual bool WriteVolume(const GraphicsVolume& v,
+                             const float* source) override;
 };
 
 #endif // _MULTIGRID_CORE_CUDA_H_
\ No newline at end of file
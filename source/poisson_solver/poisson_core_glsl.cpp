@@ -158,6 +158,35 @@ void PoissonCoreGlsl::Relax(const GraphicsVolume& u, const GraphicsVolume& b,
     }
 }
 
+void PoissonCoreGlsl::RelaxJacobi(const GraphicsVolume& unp1,
+                                  const GraphicsVolume& un,
+                                  const GraphicsVolume& b, float omega)
+{
+    // |b| is packed along with |un|, and carried over to |unp1| by the
+    // program.
+    float cell_size = 0.15f;
+    GetRelaxPackedProgram()->Use();
+
+    SetUniform("packed_tex", 0);
+    SetUniform("one_minus_omega", 1.0f - omega);
+    SetUniform("minus_h_square", -(cell_size * cell_size));
+    SetUniform("omega_over_beta", omega / 6.0f);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, unp1.gl_volume()->frame_buffer());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, un.gl_volume()->texture_handle());
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, unp1.gl_volume()->depth());
+    ResetState();
+}
+
+void PoissonCoreGlsl::RelaxChebyshev(const GraphicsVolume& unp1,
+                                     const GraphicsVolume& un,
+                                     const GraphicsVolume& b, float momentum,
+                                     float omega)
+{
+
+}
+
 void PoissonCoreGlsl::RelaxWithZeroGuess(const GraphicsVolume& u,
                                          const GraphicsVolume& b)
 {
@@ -195,6 +224,28 @@ void PoissonCoreGlsl::Restrict(const GraphicsVolume& coarse,
     ResetState();
 }
 
+void PoissonCoreGlsl::ComputeResidualAndRestrict(const GraphicsVolume& coarse,
+                                                 const GraphicsVolume& u,
+                                                 const GraphicsVolume& b)
+{
+    // No fused program yet. Goes through a scratch volume instead.
+    std::shared_ptr<GraphicsVolume> r = GetScratchVolume(u);
+    if (!r)
+        return;
+
+    ComputeResidual(*r, u, b);
+    Restrict(coarse, *r);
+}
+
+void PoissonCoreGlsl::ProlongateErrorAndRelax(const GraphicsVolume& u,
+                                              const GraphicsVolume& b,
+                                              const GraphicsVolume& coarse,
+                                              int num_of_iterations)
+{
+    ProlongateError(u, coarse);
+    Relax(u, b, num_of_iterations);
+}
+
 void PoissonCoreGlsl::ApplyStencil(const GraphicsVolume& aux,
                                    const GraphicsVolume& search)
 {
@@ -240,6 +291,27 @@ void PoissonCoreGlsl::ScaleVector(const GraphicsVolume& dest,
 
 }
 
+void PoissonCoreGlsl::ApplyStencilAndReduce(const GraphicsMemPiece& alpha,
+                                            const GraphicsMemPiece& beta,
+                                            const GraphicsMemPiece& rho,
+                                            const GraphicsVolume& aux,
+                                            const GraphicsVolume& precond,
+                                            const GraphicsVolume& residual,
+                                            bool restart)
+{
+
+}
+
+void PoissonCoreGlsl::UpdateSearchAndVector(const GraphicsVolume& dest,
+                                            const GraphicsVolume& search,
+                                            const GraphicsVolume& v,
+                                            const GraphicsMemPiece& alpha,
+                                            const GraphicsMemPiece& beta,
+                                            float sign)
+{
+
+}
+
 GLProgram* PoissonCoreGlsl::GetProlongatePackedProgram()
 {
     if (!prolongate_packed_program_)
@@ -317,3 +389,30 @@ GLProgram* PoissonCoreGlsl::GetRestrictResidualPackedProgram()
 
     return restrict_residual_packed_program_.get();
 }
+
+void PoissonCoreGlsl::ConvertVolume(const GraphicsVolume& dest,
+                                    const GraphicsVolume& v, float scale,
+                                    bool accumulate)
+{
+
+}
+
+float PoissonCoreGlsl::ReadScalar(const GraphicsMemPiece& scalar)
+{
+    return 0.0f;
+}
+
+bool PoissonCoreGlsl::ReadVolume(float* dest, const GraphicsVolume& v)
+{
+    return false;
+}
+
+bool PoissonCoreGlsl::WriteVolume(const GraphicsVolume& v, const float* source)
+{
+    return false;
+}
+
+bool PoissonCoreGlsl::HasHostTransfer() const
+{
+    return false;
+}
@@ -31,3 +31,22 @@ PoissonSolver::~PoissonSolver()
 {
 
 }
+
+float PoissonSolver::GetResidualNorm() const
+{
+    return 0.0f;
+}
+
+bool PoissonSolver::SetOpenFaces(const glm::bvec3& lower,
+                                 const glm::bvec3& upper)
+{
+    return false;
+}
+
+bool PoissonSolver::IsConverged(float norm, float initial_norm,
+                                float relative_tolerance,
+                                float absolute_tolerance)
+{
+    return norm <= relative_tolerance * initial_norm ||
+        norm <= absolute_tolerance;
+}
@@ -25,6 +25,8 @@
 #include <memory>
 #include <vector>
 
+#include "third_party/glm/vec3.hpp"
+
 class GraphicsVolume;
 class PoissonSolver
 {
@@ -54,6 +56,37 @@ public:
     virtual void SetNumOfIterations(int num_iterations, int nested_solver) = 0;
     virtual void Solve(std::shared_ptr<GraphicsVolume> u,
                        std::shared_ptr<GraphicsVolume> b) = 0;
+
+    // Allows the solver to stop once the norm of the residual falls below
+    // either |relative_tolerance| times the initial norm, or
+    // |absolute_tolerance|. The number set by SetNumOfIterations() then
+    // becomes the upper limit. Zero disables the test, which is the default,
+    // as checking the residual requires a read-back from the device.
+    virtual void SetTolerance(float relative_tolerance,
+                              float absolute_tolerance) = 0;
+
+    // The number of iterations consumed by the latest Solve().
+    virtual int GetNumOfIterationsUsed() const = 0;
+
+    // Takes the content of |u| as the initial guess in the following Solve()
+    // calls, instead of starting from zero. The relative tolerance is then
+    // measured against the residual of that guess.
+    virtual void SetWarmStart(bool warm_start) = 0;
+
+    // The norm of the residual left by the latest Solve(), for the solvers
+    // that measure it anyway. Zero otherwise.
+    virtual float GetResidualNorm() const;
+
+    // Opens the faces of the box selected in |lower| and |upper|, where the
+    // pressure is held at zero instead of behind the walls. Returns false if
+    // the solver only knows the walls, which is the default.
+    virtual bool SetOpenFaces(const glm::bvec3& lower,
+                              const glm::bvec3& upper);
+
+protected:
+    static bool IsConverged(float norm, float initial_norm,
+                            float relative_tolerance,
+                            float absolute_tolerance);
 };
 
 #endif // _POISSON_SOLVER_H_
\ No newline at end of file
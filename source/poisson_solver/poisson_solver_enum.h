@@ -29,7 +29,16 @@ enum PoissonSolverEnum
     POISSON_SOLVER_GAUSS_SEIDEL,
     POISSON_SOLVER_MULTI_GRID,
     POISSON_SOLVER_FULL_MULTI_GRID,
-    POISSON_SOLVER_MULTI_GRID_PRECONDITIONED_CONJUGATE_GRADIENT
+    POISSON_SOLVER_MULTI_GRID_PRECONDITIONED_CONJUGATE_GRADIENT,
+    POISSON_SOLVER_PIPELINED_CONJUGATE_GRADIENT,
+    POISSON_SOLVER_FFT,
+    POISSON_SOLVER_MIXED_PRECISION
+};
+
+enum PoissonSmootherEnum
+{
+    POISSON_SMOOTHER_GAUSS_SEIDEL,
+    POISSON_SMOOTHER_CHEBYSHEV
 };
 
 #endif // _POISSON_SOLVER_ENUM_H_
\ No newline at end of file
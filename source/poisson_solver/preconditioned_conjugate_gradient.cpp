@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 
 #include "graphics_mem_piece.h"
 #include "graphics_volume.h"
@@ -43,6 +44,10 @@ PreconditionedConjugateGradient::PreconditionedConjugateGradient(
     , search_()
     , num_iterations_(1)
     , num_nested_iterations_(2)
+    , relative_tolerance_(0.0f)
+    , absolute_tolerance_(0.0f)
+    , num_iterations_used_(0)
+    , warm_start_(false)
     , diagnosis_(false)
 {
 
@@ -123,10 +128,11 @@ void PreconditionedConjugateGradient::Solve(std::shared_ptr<GraphicsVolume> u,
     bool initialized = false;
     std::shared_ptr<GraphicsVolume> r = b;
 
-    // |residual_| is actually not necessary in solving the pressure. It is
-    // diagnosing that require an extra buffer to store the temporary data so
-    // that |b| can be used to compute residual later.
-    if (diagnosis_ && num_iterations_ > 1) {
+    // |residual_| is actually not necessary in solving the pressure from a
+    // zero guess. It is diagnosing that require an extra buffer to store the
+    // temporary data so that |b| can be used to compute residual later, and
+    // so does warm starting, whose initial residual is b - Au.
+    if (warm_start_ || (diagnosis_ && num_iterations_ > 1)) {
         if (!residual_) {
             residual_ = core_->CreateVolume(b->GetWidth(), b->GetHeight(),
                                             b->GetDepth(), 1,
@@ -135,9 +141,10 @@ void PreconditionedConjugateGradient::Solve(std::shared_ptr<GraphicsVolume> u,
                 return;
         }
 
-        u->Clear();
+        // Copy |b| to |residual_| if |u| is cleared.
+        if (!warm_start_)
+            u->Clear();
 
-        // Copy |b| to |residual_|.
         core_->ComputeResidual(*residual_, *u, *b);
         r = residual_;
         initialized = true;
@@ -147,6 +154,16 @@ void PreconditionedConjugateGradient::Solve(std::shared_ptr<GraphicsVolume> u,
         num_nested_iterations_);
     preconditioner_->Solve(search_, r);
     core_->ComputeRho(*rho_, *search_, *r);
+
+    // rho is the squared norm of the residual measured by the preconditioner,
+    // which comes for free in every iteration.
+    bool check_convergence =
+        relative_tolerance_ > 0.0f || absolute_tolerance_ > 0.0f;
+    float initial_norm = 0.0f;
+    if (check_convergence)
+        initial_norm = std::sqrt(std::abs(core_->ReadScalar(*rho_)));
+
+    num_iterations_used_ = num_iterations_;
     for (int i = 0; i < num_iterations_ - 1; i++) {
         core_->ApplyStencil(*aux_, *search_);
 
@@ -159,6 +176,15 @@ void PreconditionedConjugateGradient::Solve(std::shared_ptr<GraphicsVolume> u,
         std::swap(rho_new_, rho_);
 
         UpdateU(*u, *search_, *alpha_, &initialized);
+        if (check_convergence) {
+            float norm = std::sqrt(std::abs(core_->ReadScalar(*rho_)));
+            if (IsConverged(norm, initial_norm, relative_tolerance_,
+                            absolute_tolerance_)) {
+                num_iterations_used_ = i + 1;
+                return;
+            }
+        }
+
         core_->ScaledAdd(*search_, *aux_, *search_, *beta_, 1.0f);
     }
 
@@ -167,6 +193,23 @@ void PreconditionedConjugateGradient::Solve(std::shared_ptr<GraphicsVolume> u,
     UpdateU(*u, *search_, *alpha_, &initialized);
 }
 
+void PreconditionedConjugateGradient::SetTolerance(float relative_tolerance,
+                                                   float absolute_tolerance)
+{
+    relative_tolerance_ = relative_tolerance;
+    absolute_tolerance_ = absolute_tolerance;
+}
+
+int PreconditionedConjugateGradient::GetNumOfIterationsUsed() const
+{
+    return num_iterations_used_;
+}
+
+void PreconditionedConjugateGradient::SetWarmStart(bool warm_start)
+{
+    warm_start_ = warm_start;
+}
+
 void PreconditionedConjugateGradient::UpdateU(const GraphicsVolume& u,
                                               const GraphicsVolume& search,
                                               const GraphicsMemPiece& alpha,
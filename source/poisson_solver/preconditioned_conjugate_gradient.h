@@ -45,6 +45,10 @@ public:
                                     int nested_solver) override;
     virtual void Solve(std::shared_ptr<GraphicsVolume> u,
                        std::shared_ptr<GraphicsVolume> b) override;
+    virtual void SetTolerance(float relative_tolerance,
+                              float absolute_tolerance) override;
+    virtual int GetNumOfIterationsUsed() const override;
+    virtual void SetWarmStart(bool warm_start) override;
 
 private:
     void UpdateU(const GraphicsVolume& u, const GraphicsVolume& search,
@@ -61,6 +65,10 @@ private:
     std::shared_ptr<GraphicsVolume> search_;
     int num_iterations_;
     int num_nested_iterations_;
+    float relative_tolerance_;
+    float absolute_tolerance_;
+    int num_iterations_used_;
+    bool warm_start_;
     bool diagnosis_;
 };
 
@@ -25,6 +25,7 @@
 Renderer::Renderer()
     : graphics_lib_(GRAPHICS_LIB_CUDA)
     , viewport_size_(0)
+    , field_origin_(0.0f)
     , fov_(1.0f)
 {
 }
@@ -41,6 +41,9 @@ public:
 
     void set_graphics_lib(GraphicsLib lib) { graphics_lib_ = lib; }
     void set_grid_size(const glm::vec3& grid_size) { grid_size_ = grid_size; }
+
+    // Where the fields start within the grid, if they cover only a part of it.
+    void set_field_origin(const glm::vec3& origin) { field_origin_ = origin; }
     void set_fov(float fov) { fov_ = fov; }
 
 protected:
@@ -49,6 +52,7 @@ protected:
     GraphicsLib graphics_lib() const { return graphics_lib_; }
     const glm::ivec2& viewport_size() const { return viewport_size_; }
     const glm::vec3& grid_size() const { return grid_size_; }
+    const glm::vec3& field_origin() const { return field_origin_; }
     float fov() const { return fov_; }
 
     void set_viewport_size(const glm::ivec2& viewport_size)
@@ -60,6 +64,7 @@ private:
     GraphicsLib graphics_lib_;
     glm::ivec2 viewport_size_;
     glm::vec3 grid_size_;
+    glm::vec3 field_origin_;
     float fov_;
 };
 
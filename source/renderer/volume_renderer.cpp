@@ -106,7 +106,8 @@ void VolumeRenderer::Render(FluidFieldOwner* field_owner,
             FluidConfig::Instance()->num_raycast_light_samples(),
             FluidConfig::Instance()->light_absorption(),
             FluidConfig::Instance()->raycast_density_factor(),
-            FluidConfig::Instance()->raycast_occlusion_factor());
+            FluidConfig::Instance()->raycast_occlusion_factor(), grid_size(),
+            field_origin());
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
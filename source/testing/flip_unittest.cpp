@@ -0,0 +1,357 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "flip_unittest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cpu_host/cpu_main.h"
+#include "cpu_host/cpu_volume.h"
+#include "cpu_host/flip_impl_cpu.h"
+#include "cuda/particle/flip.h"
+#include "half_float/half.h"
+#include "third_party/glm/vec3.hpp"
+#include "utility.h"
+
+namespace
+{
+const int kGridSize = 32;
+const int kMinParticlesPerCell = 4;
+const int kMaxParticlesPerCell = 32;
+const int kParticlesPerCell = 8;
+
+// The survivors sample the flow more coarsely, so the grid moves a little.
+const double kMaxMomentumError = 0.015;
+
+// A thin slab is enough, as the rotation is about the z axis.
+const int kRotationDepth = 4;
+const float kAngularVelocity = 0.1f;
+const int kNumOfRoundTrips = 10;
+const int kRotationParticlesPerCell = 16;
+
+// The faces next to the border miss the particles beyond it.
+const int kRotationMargin = 2;
+
+// APIC carries a linear field exactly, so what is left is the rounding of
+// the particle velocities to halves.
+const double kMaxRotationError = 0.0001;
+
+class NullObserver : public FlipImplCpu::Observer
+{
+public:
+    virtual void OnEmitted() override {}
+    virtual void OnVelocityInterpolated() override {}
+    virtual void OnResampled() override {}
+    virtual void OnAdvected() override {}
+    virtual void OnCellBound() override {}
+    virtual void OnPrefixSumCalculated() override {}
+    virtual void OnSorted() override {}
+    virtual void OnTransferred() override {}
+};
+
+// The fields of the particles, sorted by their cells.
+struct ParticleBuffers
+{
+    std::vector<uint32_t> particle_index_;
+    std::vector<uint32_t> cell_index_;
+    std::vector<uint32_t> particle_count_;
+    std::vector<uint8_t>  in_cell_index_;
+    std::vector<uint16_t> fields_[8];
+    std::vector<uint16_t> affine_[9];
+    int                   num_of_actives_;
+
+    FlipParticles GetParticles()
+    {
+        FlipParticles p = {};
+        p.particle_index_ = &particle_index_[0];
+        p.cell_index_     = &cell_index_[0];
+        p.particle_count_ = &particle_count_[0];
+        p.in_cell_index_  = &in_cell_index_[0];
+        p.position_x_     = &fields_[0][0];
+        p.position_y_     = &fields_[1][0];
+        p.position_z_     = &fields_[2][0];
+        p.velocity_x_     = &fields_[3][0];
+        p.velocity_y_     = &fields_[4][0];
+        p.velocity_z_     = &fields_[5][0];
+        p.density_        = &fields_[6][0];
+        p.temperature_    = &fields_[7][0];
+        for (int i = 0; i < 9; i++)
+            p.affine_[i] = affine_[i].empty() ? nullptr : &affine_[i][0];
+
+        p.num_of_actives_ = &num_of_actives_;
+        p.num_of_particles_ = static_cast<int>(cell_index_.size());
+        return p;
+    }
+};
+
+float RandomFloat()
+{
+    return static_cast<float>(rand()) / (RAND_MAX + 1.0f);
+}
+
+uint16_t ToHalf(float f)
+{
+    return half(f).bits();
+}
+
+// A smooth flow, which varies along every axis.
+glm::vec3 SampleVelocity(const glm::vec3& pos)
+{
+    return glm::vec3(1.0f + 0.5f * std::sin(0.3f * pos.y),
+                     0.5f * std::cos(0.2f * pos.x),
+                     0.25f + 0.5f * pos.z / kGridSize);
+}
+
+// Lays |min_count| to |max_count| particles in every cell, which sample
+// SampleVelocity().
+void LayParticles(ParticleBuffers* buffers, const glm::ivec3& volume_size,
+                  int min_count, int max_count)
+{
+    int slice_size = volume_size.x * volume_size.y;
+    int num_of_cells = slice_size * volume_size.z;
+    buffers->particle_index_.resize(num_of_cells);
+    buffers->particle_count_.resize(num_of_cells);
+    for (int cell = 0; cell < num_of_cells; cell++) {
+        int count = min_count + rand() % (max_count - min_count + 1);
+        buffers->particle_index_[cell] =
+            static_cast<uint32_t>(buffers->cell_index_.size());
+        buffers->particle_count_[cell] = count;
+
+        glm::vec3 corner(cell % volume_size.x,
+                         cell / volume_size.x % volume_size.y,
+                         cell / slice_size);
+        // The particles that came first are on one side of the cell, as
+        // the ones carried in by a steady flow are.
+        std::vector<glm::vec3> offsets(count);
+        for (glm::vec3& offset : offsets)
+            offset = glm::vec3(RandomFloat(), RandomFloat(), RandomFloat());
+
+        std::sort(offsets.begin(), offsets.end(),
+                  [](const glm::vec3& a, const glm::vec3& b) {
+            return a.x > b.x;
+        });
+        for (int i = 0; i < count; i++) {
+            glm::vec3 pos = corner + offsets[i];
+            glm::vec3 vel = SampleVelocity(pos);
+            float values[] = {
+                pos.x, pos.y, pos.z, vel.x, vel.y, vel.z, 1.0f, 20.0f
+            };
+            for (int f = 0; f < 8; f++)
+                buffers->fields_[f].push_back(ToHalf(values[f]));
+
+            buffers->cell_index_.push_back(cell);
+            buffers->in_cell_index_.push_back(static_cast<uint8_t>(i));
+        }
+    }
+
+    buffers->num_of_actives_ =
+        static_cast<int>(buffers->cell_index_.size());
+}
+
+void ReadVolume(std::vector<float>* result, const CpuVolume& v)
+{
+    result->clear();
+    for (int z = 0; z < v.depth(); z++) {
+        for (int y = 0; y < v.height(); y++) {
+            const float* row = static_cast<float*>(v.GetRowAddress(y, z));
+            result->insert(result->end(), row, row + v.width());
+        }
+    }
+}
+
+// Compares the momentum of every face, relative to the total momentum.
+double CompareMomentum(const std::vector<float>& result,
+                       const std::vector<float>& expected)
+{
+    double error = 0.0;
+    double total = 0.0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        error += std::abs(result[i] - expected[i]);
+        total += std::abs(expected[i]);
+    }
+
+    return error / total;
+}
+
+// The velocity of a rigid rotation about the z axis through the center of
+// the slab.
+glm::vec3 RotationVelocity(const glm::vec3& pos)
+{
+    glm::vec3 r = pos - glm::vec3(kGridSize * 0.5f);
+    return kAngularVelocity * glm::vec3(-r.y, r.x, 0.0f);
+}
+
+// Every component lives on the lower face of its cell.
+void SetRotation(CpuVolume* vel_x, CpuVolume* vel_y, CpuVolume* vel_z)
+{
+    for (int z = 0; z < kRotationDepth; z++) {
+        for (int y = 0; y < kGridSize; y++) {
+            float* row_x = static_cast<float*>(vel_x->GetRowAddress(y, z));
+            float* row_y = static_cast<float*>(vel_y->GetRowAddress(y, z));
+            float* row_z = static_cast<float*>(vel_z->GetRowAddress(y, z));
+            for (int x = 0; x < kGridSize; x++) {
+                glm::vec3 center = glm::vec3(x, y, z) + 0.5f;
+                row_x[x] = RotationVelocity(center - glm::vec3(0.5f, 0, 0)).x;
+                row_y[x] = RotationVelocity(center - glm::vec3(0, 0.5f, 0)).y;
+                row_z[x] = 0.0f;
+            }
+        }
+    }
+}
+
+// Returns the RMS error of the velocity against the rotation, relative to
+// the RMS velocity.
+double CompareRotation(const CpuVolume& vel_x, const CpuVolume& vel_y)
+{
+    CpuVolume expected_x;
+    CpuVolume expected_y;
+    CpuVolume expected_z;
+    for (CpuVolume* v : {&expected_x, &expected_y, &expected_z})
+        v->Create(kGridSize, kGridSize, kRotationDepth, 1, 4, 0);
+
+    SetRotation(&expected_x, &expected_y, &expected_z);
+
+    std::vector<float> result[2];
+    std::vector<float> expected[2];
+    ReadVolume(&result[0], vel_x);
+    ReadVolume(&result[1], vel_y);
+    ReadVolume(&expected[0], expected_x);
+    ReadVolume(&expected[1], expected_y);
+
+    double error = 0.0;
+    double total = 0.0;
+    for (int c = 0; c < 2; c++) {
+        for (size_t i = 0; i < expected[c].size(); i++) {
+            int x = static_cast<int>(i % kGridSize);
+            int y = static_cast<int>(i / kGridSize % kGridSize);
+            if (std::min(x, y) < kRotationMargin ||
+                    std::max(x, y) >= kGridSize - kRotationMargin)
+                continue;
+
+            double diff = result[c][i] - expected[c][i];
+            error += diff * diff;
+            total += expected[c][i] * expected[c][i];
+        }
+    }
+
+    return std::sqrt(error / total);
+}
+} // Anonymous namespace.
+
+void FlipUnittest::TestGovernor(int random_seed)
+{
+    srand(random_seed);
+
+    ParticleBuffers buffers;
+    LayParticles(&buffers, glm::ivec3(kGridSize), kMinParticlesPerCell,
+                 kMaxParticlesPerCell);
+    FlipParticles p = buffers.GetParticles();
+    int num_of_cells = kGridSize * kGridSize * kGridSize;
+    int expected_culled = 0;
+    for (int cell = 0; cell < num_of_cells; cell++)
+        expected_culled += std::max(
+            static_cast<int>(p.particle_count_[cell]) - kParticlesPerCell, 0);
+
+    CpuVolume volumes[5];
+    for (CpuVolume& v : volumes)
+        v.Create(kGridSize, kGridSize, kGridSize, 1, 4, 0);
+
+    NullObserver observer;
+    FlipImplCpu flip(&observer, CpuMain::Instance()->thread_pool(), nullptr);
+    flip.set_particles_per_cell(kParticlesPerCell);
+
+    std::vector<float> momentum[3];
+    flip.TransferToGrid(&volumes[0], &volumes[1], &volumes[2], &volumes[3],
+                        &volumes[4], p);
+    for (int c = 0; c < 3; c++)
+        ReadVolume(&momentum[c], volumes[c]);
+
+    glm::ivec3 volume_size(kGridSize);
+    int culled = flip.CullParticles(p, volume_size);
+    flip.TransferToGrid(&volumes[0], &volumes[1], &volumes[2], &volumes[3],
+                        &volumes[4], p);
+
+    double max_error = 0.0;
+    std::vector<float> result;
+    for (int c = 0; c < 3; c++) {
+        ReadVolume(&result, volumes[c]);
+        max_error = std::max(max_error, CompareMomentum(result, momentum[c]));
+    }
+
+    bool passed = culled == expected_culled && max_error < kMaxMomentumError;
+
+    // The survivors must be the first ones of their cells.
+    for (int cell = 0; cell < num_of_cells && passed; cell++) {
+        uint32_t begin = p.particle_index_[cell];
+        uint32_t count = p.particle_count_[cell];
+        passed = static_cast<int>(count) <= kParticlesPerCell;
+        for (uint32_t i = begin; i < begin + count && passed; i++)
+            passed = p.cell_index_[i] == static_cast<uint32_t>(cell);
+    }
+
+    PrintDebugString("%s %d^3: culled %d of %d, momentum error %.5f %s\n",
+                     __FUNCTION__, kGridSize, culled, *p.num_of_actives_,
+                     max_error, passed ? "passed" : "FAILED");
+}
+
+void FlipUnittest::TestRigidRotation(int random_seed)
+{
+    srand(random_seed);
+
+    // The particles stay where they are, and only the velocity goes back and
+    // forth between them and the grid.
+    glm::ivec3 volume_size(kGridSize, kGridSize, kRotationDepth);
+    ParticleBuffers buffers;
+    LayParticles(&buffers, volume_size, kRotationParticlesPerCell,
+                 kRotationParticlesPerCell);
+    for (std::vector<uint16_t>& field : buffers.affine_)
+        field.assign(buffers.cell_index_.size(), 0);
+
+    FlipParticles p = buffers.GetParticles();
+
+    CpuVolume volumes[5];
+    for (CpuVolume& v : volumes)
+        v.Create(volume_size.x, volume_size.y, volume_size.z, 1, 4, 0);
+
+    SetRotation(&volumes[0], &volumes[1], &volumes[2]);
+
+    NullObserver observer;
+    FlipImplCpu flip(&observer, CpuMain::Instance()->thread_pool(), nullptr);
+    double max_error = 0.0;
+    for (int i = 0; i < kNumOfRoundTrips; i++) {
+        flip.InterpolateDeltaVelocity(p, &volumes[0], &volumes[1],
+                                      &volumes[2], &volumes[0], &volumes[1],
+                                      &volumes[2]);
+        flip.TransferToGrid(&volumes[0], &volumes[1], &volumes[2],
+                            &volumes[3], &volumes[4], p);
+        max_error = std::max(max_error,
+                             CompareRotation(volumes[0], volumes[1]));
+    }
+
+    bool passed = max_error < kMaxRotationError;
+    PrintDebugString("%s %dx%dx%d, %d round trips: error %.6f %s\n",
+                     __FUNCTION__, volume_size.x, volume_size.y,
+                     volume_size.z, kNumOfRoundTrips, max_error,
+                     passed ? "passed" : "FAILED");
+}
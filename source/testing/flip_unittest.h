@@ -0,0 +1,41 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#ifndef _FLIP_UNITTEST_H_
+#define _FLIP_UNITTEST_H_
+
+// Checks the stages of the host FLIP backend on particles laid out by hand.
+class FlipUnittest
+{
+public:
+    // The grid momentum must survive culling the crowded cells.
+    static void TestGovernor(int random_seed);
+
+    // APIC must keep a rigid rotation over round trips between the grid and
+    // the particles.
+    static void TestRigidRotation(int random_seed);
+
+private:
+    FlipUnittest();
+    ~FlipUnittest();
+};
+
+#endif // _FLIP_UNITTEST_H_
\ No newline at end of file
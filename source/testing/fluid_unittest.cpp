@@ -197,6 +197,56 @@ void FluidUnittest::TestDivergenceCalculation(int random_seed)
                                            __FUNCTION__);
 }
 
+void FluidUnittest::TestFieldsAdvection(int random_seed)
+{
+    srand(random_seed);
+
+    GridFluidSolver sim_cuda;
+    GridFluidSolver sim_glsl;
+    if (!UnittestCommon::InitializeSimulators(&sim_cuda, &sim_glsl))
+        return;
+
+    int width = sim_cuda.velocity_->x()->GetWidth();
+    int height = sim_cuda.velocity_->x()->GetHeight();
+    int depth = sim_cuda.velocity_->x()->GetDepth();
+    int n_4 = 4;
+    int n_1 = 1;
+    int pitch_4 = width * sizeof(uint16_t) * n_4;
+    int pitch_1 = width * sizeof(uint16_t) * n_1;
+    int size_4 = pitch_4 * height * depth;
+    int size_1 = pitch_1 * height * depth;
+
+    // Copy the initialized data to GPU.
+    UnittestCommon::InitializeVolume4(sim_cuda.velocity_->x().get(),
+                                      sim_glsl.velocity_->x().get(), width,
+                                      height, depth, n_4, pitch_4, size_4,
+                                      std::make_pair(-5.0f, 5.0f));
+    UnittestCommon::InitializeVolume1(sim_cuda.temperature_.get(),
+                                      sim_glsl.temperature_.get(), width,
+                                      height, depth, n_1, pitch_1, size_1,
+                                      std::make_pair(0.0f, 40.0f));
+    UnittestCommon::InitializeVolume1(sim_cuda.density_.get(),
+                                      sim_glsl.density_.get(), width,
+                                      height, depth, n_1, pitch_1, size_1,
+                                      std::make_pair(0.0f, 3.0f));
+
+    // The fused pass must match the fields advected one at a time.
+    sim_cuda.AdvectFields(kTimeStep);
+    sim_glsl.AdvectTemperature(kTimeStep);
+    sim_glsl.AdvectDensity(kTimeStep);
+
+    UnittestCommon::CollectAndVerifyResult(width, height, depth, size_1,
+                                           pitch_1, n_1, 1,
+                                           sim_cuda.temperature_.get(),
+                                           sim_glsl.temperature_.get(),
+                                           __FUNCTION__);
+    UnittestCommon::CollectAndVerifyResult(width, height, depth, size_1,
+                                           pitch_1, n_1, 1,
+                                           sim_cuda.density_.get(),
+                                           sim_glsl.density_.get(),
+                                           __FUNCTION__);
+}
+
 void FluidUnittest::TestGradientSubtraction(int random_seed)
 {
     srand(random_seed);
@@ -29,6 +29,7 @@ public:
     static void TestDampedJacobi(int random_seed);
     static void TestDensityAdvection(int random_seed);
     static void TestDivergenceCalculation(int random_seed);
+    static void TestFieldsAdvection(int random_seed);
     static void TestGradientSubtraction(int random_seed);
     static void TestTemperatureAdvection(int random_seed);
     static void TestVelocityAdvection(int random_seed);
@@ -0,0 +1,223 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "scan_unittest.h"
+
+#include <memory>
+#include <vector>
+
+#include "cpu_host/cpu_linear_mem.h"
+#include "cpu_host/cpu_main.h"
+#include "cuda/cuda_core.h"
+#include "cuda_host/cuda_linear_mem.h"
+#include "cuda_host/cuda_main.h"
+#include "utility.h"
+
+namespace
+{
+enum ScanOperation
+{
+    SCAN_OPERATION_COMPACTION,
+    SCAN_OPERATION_EXCLUSIVE,
+    SCAN_OPERATION_INCLUSIVE,
+    SCAN_OPERATION_SEGMENTED,
+};
+
+const int kGridSizes[] = {64, 128, 256, 512};
+const int kNumOfRounds = 10;
+
+// Returns the number of valid elements in |result|.
+int ScanSerially(ScanOperation op, std::vector<uint32_t>* result,
+                 const std::vector<uint32_t>& source,
+                 const std::vector<uint32_t>& heads)
+{
+    int n = static_cast<int>(source.size());
+    if (op == SCAN_OPERATION_COMPACTION) {
+        int count = 0;
+        for (int i = 0; i < n; i++)
+            if (source[i])
+                (*result)[count++] = i;
+
+        return count;
+    }
+
+    uint32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        if (op == SCAN_OPERATION_SEGMENTED && heads[i])
+            sum = 0;
+
+        (*result)[i] = op == SCAN_OPERATION_INCLUSIVE ? sum + source[i] : sum;
+        sum += source[i];
+    }
+
+    return n;
+}
+
+template <typename Memory, typename Main>
+int RunScan(ScanOperation op, Main* m, std::shared_ptr<Memory> dest,
+            std::shared_ptr<Memory> source, std::shared_ptr<Memory> heads,
+            int n)
+{
+    switch (op) {
+        case SCAN_OPERATION_COMPACTION:
+            return m->Compact(dest, source, n);
+        case SCAN_OPERATION_EXCLUSIVE:
+            m->ExclusiveScan(dest, source, n);
+            break;
+        case SCAN_OPERATION_INCLUSIVE:
+            m->InclusiveScan(dest, source, n);
+            break;
+        case SCAN_OPERATION_SEGMENTED:
+            m->SegmentedScan(dest, source, heads, n);
+            break;
+    }
+
+    return n;
+}
+
+bool VerifyResult(const uint32_t* result, int count,
+                  const std::vector<uint32_t>& expected, int expected_count)
+{
+    if (count != expected_count)
+        return false;
+
+    for (int i = 0; i < count; i++)
+        if (result[i] != expected[i])
+            return false;
+
+    return true;
+}
+
+double TimeCpu(ScanOperation op, int n, const std::vector<uint32_t>& source,
+               const std::vector<uint32_t>& heads,
+               const std::vector<uint32_t>& expected, int expected_count,
+               bool* passed)
+{
+    std::shared_ptr<CpuLinearMemU32> dest_mem(new CpuLinearMemU32());
+    std::shared_ptr<CpuLinearMemU32> source_mem(new CpuLinearMemU32());
+    std::shared_ptr<CpuLinearMemU32> heads_mem(new CpuLinearMemU32());
+    dest_mem->Create(n);
+    source_mem->Create(n);
+    heads_mem->Create(n);
+    memcpy(source_mem->mem(), &source[0], n * sizeof(uint32_t));
+    memcpy(heads_mem->mem(), &heads[0], n * sizeof(uint32_t));
+
+    CpuMain* m = CpuMain::Instance();
+    int count = RunScan(op, m, dest_mem, source_mem, heads_mem, n);
+
+    double t = GetCurrentTimeInSeconds();
+    for (int i = 0; i < kNumOfRounds; i++)
+        RunScan(op, m, dest_mem, source_mem, heads_mem, n);
+
+    t = GetCurrentTimeInSeconds() - t;
+
+    *passed = VerifyResult(dest_mem->mem(), count, expected, expected_count);
+    return t / kNumOfRounds;
+}
+
+double TimeCuda(ScanOperation op, int n, const std::vector<uint32_t>& source,
+                const std::vector<uint32_t>& heads,
+                const std::vector<uint32_t>& expected, int expected_count,
+                bool* passed)
+{
+    std::shared_ptr<CudaLinearMemU32> dest_mem(new CudaLinearMemU32());
+    std::shared_ptr<CudaLinearMemU32> source_mem(new CudaLinearMemU32());
+    std::shared_ptr<CudaLinearMemU32> heads_mem(new CudaLinearMemU32());
+    dest_mem->Create(n);
+    source_mem->Create(n);
+    heads_mem->Create(n);
+    CudaCore::CopyToMemPiece(source_mem->mem(), &source[0],
+                             n * sizeof(uint32_t));
+    CudaCore::CopyToMemPiece(heads_mem->mem(), &heads[0],
+                             n * sizeof(uint32_t));
+
+    CudaMain* m = CudaMain::Instance();
+    int count = RunScan(op, m, dest_mem, source_mem, heads_mem, n);
+    m->Sync();
+
+    double t = GetCurrentTimeInSeconds();
+    for (int i = 0; i < kNumOfRounds; i++)
+        RunScan(op, m, dest_mem, source_mem, heads_mem, n);
+
+    m->Sync();
+    t = GetCurrentTimeInSeconds() - t;
+
+    std::vector<uint32_t> result(n);
+    CudaCore::CopyFromMemPiece(&result[0], dest_mem->mem(),
+                               n * sizeof(uint32_t));
+    *passed = VerifyResult(&result[0], count, expected, expected_count);
+    return t / kNumOfRounds;
+}
+
+void TestScan(ScanOperation op, int random_seed, const char* name)
+{
+    srand(random_seed);
+    for (int grid_size : kGridSizes) {
+        int n = grid_size * grid_size * grid_size;
+
+        // Compaction takes the source as flags, which are mostly off like
+        // those of the occupied bricks.
+        std::vector<uint32_t> source(n);
+        std::vector<uint32_t> heads(n);
+        for (int i = 0; i < n; i++) {
+            source[i] = op == SCAN_OPERATION_COMPACTION ?
+                (rand() % 8 == 0 ? 1 : 0) : rand() % 8;
+            heads[i] = (!i || rand() % 64 == 0) ? 1 : 0;
+        }
+
+        std::vector<uint32_t> expected(n);
+        int expected_count = ScanSerially(op, &expected, source, heads);
+
+        bool cpu_passed = false;
+        bool cuda_passed = false;
+        double cpu_time = TimeCpu(op, n, source, heads, expected,
+                                  expected_count, &cpu_passed);
+        double cuda_time = TimeCuda(op, n, source, heads, expected,
+                                    expected_count, &cuda_passed);
+
+        PrintDebugString("%s %d^3: cpu %.3fms %s, cuda %.3fms %s\n", name,
+                         grid_size, cpu_time * 1000.0,
+                         cpu_passed ? "passed" : "FAILED", cuda_time * 1000.0,
+                         cuda_passed ? "passed" : "FAILED");
+    }
+}
+} // Anonymous namespace.
+
+void ScanUnittest::TestCompaction(int random_seed)
+{
+    TestScan(SCAN_OPERATION_COMPACTION, random_seed, __FUNCTION__);
+}
+
+void ScanUnittest::TestExclusiveScan(int random_seed)
+{
+    TestScan(SCAN_OPERATION_EXCLUSIVE, random_seed, __FUNCTION__);
+}
+
+void ScanUnittest::TestInclusiveScan(int random_seed)
+{
+    TestScan(SCAN_OPERATION_INCLUSIVE, random_seed, __FUNCTION__);
+}
+
+void ScanUnittest::TestSegmentedScan(int random_seed)
+{
+    TestScan(SCAN_OPERATION_SEGMENTED, random_seed, __FUNCTION__);
+}
@@ -0,0 +1,293 @@
+//
+// Hypermorph - Fluid Simulator for interactive applications
+// Copyright (C) 2016. JIANWEN TAN(jianwen.tan@gmail.com). All rights reserved.
+//
+// Hypermorph license (* see part 1 below)
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. Acknowledgement of the
+//    original author is required if you publish this in a paper, or use it
+//    in a product.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+
+#include "stdafx.h"
+#include "sort_unittest.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "cpu_host/counting_sort.h"
+#include "cpu_host/cpu_main.h"
+#include "utility.h"
+
+namespace
+{
+const int kGridSizes[] = {32, 64, 128};
+const int kParticlesPerCell = 4;
+const uint32_t kCapacity = 8;
+const float kMaxChurn = 0.1f;
+
+// A light churn should be patched, and a heavy one refused.
+const float kChurns[] = {0.02f, 0.3f};
+
+struct SortResult
+{
+    std::vector<uint32_t> counts_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> sorted_keys_;
+    int num_of_kept_;
+};
+
+void ApplyDestinations(std::vector<uint32_t>* sorted,
+                       const std::vector<uint32_t>& keys,
+                       const uint32_t* destinations)
+{
+    int n = static_cast<int>(keys.size());
+    sorted->assign(n, 0);
+    for (int i = 0; i < n; i++)
+        (*sorted)[destinations[i]] = keys[i];
+}
+
+double SortFully(CountingSort* sort, SortResult* result,
+                 const std::vector<uint32_t>& keys, int num_of_keys)
+{
+    int n = static_cast<int>(keys.size());
+    result->counts_.resize(num_of_keys);
+    result->offsets_.resize(num_of_keys);
+
+    double t = GetCurrentTimeInSeconds();
+    sort->Count(&keys[0], n, num_of_keys, kCapacity, &result->counts_[0]);
+    result->num_of_kept_ = sort->ComputeOffsets(&result->counts_[0],
+                                                num_of_keys,
+                                                &result->offsets_[0]);
+    t = GetCurrentTimeInSeconds() - t;
+
+    ApplyDestinations(&result->sorted_keys_, keys, sort->destinations());
+    return t;
+}
+
+bool IsPermutation(const uint32_t* destinations, int n)
+{
+    std::vector<bool> taken(n, false);
+    for (int i = 0; i < n; i++) {
+        if (destinations[i] >= static_cast<uint32_t>(n) ||
+                taken[destinations[i]])
+            return false;
+
+        taken[destinations[i]] = true;
+    }
+
+    return true;
+}
+
+// The update keeps the stayers where they are, so the elements of a key
+// may come in another order than that of a full sort, and it may keep
+// other elements when a key overflows. Still, the counts, the offsets and
+// the sorted keys must be the same.
+bool VerifyResult(const SortResult& result, const SortResult& expected)
+{
+    if (result.num_of_kept_ != expected.num_of_kept_ ||
+            result.counts_ != expected.counts_ ||
+            result.offsets_ != expected.offsets_)
+        return false;
+
+    for (int i = 0; i < expected.num_of_kept_; i++)
+        if (result.sorted_keys_[i] != expected.sorted_keys_[i])
+            return false;
+
+    return true;
+}
+
+uint32_t RandomKey(int num_of_keys)
+{
+    // Some of the particles leave the domain.
+    if (rand() % 64 == 0)
+        return CountingSort::kDropped;
+
+    return static_cast<uint32_t>(
+        (static_cast<uint64_t>(rand()) * RAND_MAX + rand()) % num_of_keys);
+}
+
+// The values of the narrower fields are derived from the index in the
+// widest one, so that a field permuted differently from the others shows.
+uint16_t ToField16(uint32_t i)
+{
+    return static_cast<uint16_t>(i ^ 0x5A5A);
+}
+
+uint8_t ToField8(uint32_t i)
+{
+    return static_cast<uint8_t>(i * 7);
+}
+
+// The kept elements must come in the order of a stable sort by key, and all
+// the fields must be moved alike.
+bool VerifyPermutation(const std::vector<uint32_t>& field32,
+                       const std::vector<uint16_t>& field16,
+                       const std::vector<uint8_t>& field8,
+                       const std::vector<uint32_t>& expected,
+                       int num_of_kept)
+{
+    int n = static_cast<int>(field32.size());
+    if (!IsPermutation(&field32[0], n))
+        return false;
+
+    for (int i = 0; i < num_of_kept; i++)
+        if (field32[i] != expected[i])
+            return false;
+
+    for (int i = 0; i < n; i++)
+        if (field16[i] != ToField16(field32[i]) ||
+                field8[i] != ToField8(field32[i]))
+            return false;
+
+    return true;
+}
+} // Anonymous namespace.
+
+void SortUnittest::TestPermute(int random_seed)
+{
+    srand(random_seed);
+    ThreadPool* pool = CpuMain::Instance()->thread_pool();
+    for (int grid_size : kGridSizes) {
+        int num_of_keys = grid_size * grid_size * grid_size;
+        int n = num_of_keys * kParticlesPerCell;
+        std::vector<uint32_t> keys(n);
+        for (int i = 0; i < n; i++)
+            keys[i] = RandomKey(num_of_keys);
+
+        std::vector<uint32_t> field32(n);
+        std::vector<uint16_t> field16(n);
+        std::vector<uint8_t> field8(n);
+        for (int i = 0; i < n; i++) {
+            field32[i] = i;
+            field16[i] = ToField16(i);
+            field8[i] = ToField8(i);
+        }
+
+        CountingSort::Field fields[] = {
+            {&field32[0], nullptr, sizeof(uint32_t)},
+            {&field16[0], nullptr, sizeof(uint16_t)},
+            {&field8[0],  nullptr, sizeof(uint8_t)},
+        };
+
+        CountingSort sort(pool);
+        std::vector<uint32_t> counts(num_of_keys);
+        std::vector<uint32_t> offsets(num_of_keys);
+        double t = GetCurrentTimeInSeconds();
+        sort.Count(&keys[0], n, num_of_keys, kCapacity, &counts[0]);
+        int num_of_kept = sort.ComputeOffsets(&counts[0], num_of_keys,
+                                              &offsets[0]);
+        sort.Permute(fields, sizeof(fields) / sizeof(fields[0]));
+        double permute_time = GetCurrentTimeInSeconds() - t;
+
+        // Only the first |kCapacity| elements of a key are kept, and the
+        // dropped ones go last.
+        t = GetCurrentTimeInSeconds();
+        std::vector<uint32_t> expected(n);
+        for (int i = 0; i < n; i++)
+            expected[i] = i;
+
+        std::stable_sort(expected.begin(), expected.end(),
+                         [&keys](uint32_t a, uint32_t b) {
+            return keys[a] < keys[b];
+        });
+        double sort_time = GetCurrentTimeInSeconds() - t;
+
+        std::vector<uint32_t> kept;
+        for (int i = 0; i < n; i++) {
+            uint32_t key = keys[expected[i]];
+            if (key == CountingSort::kDropped)
+                break;
+
+            if (i < static_cast<int>(kCapacity) ||
+                    keys[expected[i - kCapacity]] != key)
+                kept.push_back(expected[i]);
+        }
+
+        bool passed = num_of_kept == static_cast<int>(kept.size()) &&
+            VerifyPermutation(field32, field16, field8, kept, num_of_kept);
+
+        PrintDebugString("%s %d^3: permute %.3fms %s, std::stable_sort "
+                         "%.3fms\n", __FUNCTION__, grid_size,
+                         permute_time * 1000.0, passed ? "passed" : "FAILED",
+                         sort_time * 1000.0);
+    }
+}
+
+void SortUnittest::TestUpdate(int random_seed)
+{
+    srand(random_seed);
+    ThreadPool* pool = CpuMain::Instance()->thread_pool();
+    for (int grid_size : kGridSizes) {
+        int num_of_keys = grid_size * grid_size * grid_size;
+        int n = num_of_keys * kParticlesPerCell;
+        for (float churn : kChurns) {
+            std::vector<uint32_t> keys(n);
+            for (int i = 0; i < n; i++)
+                keys[i] = RandomKey(num_of_keys);
+
+            // Move the keys into the order of the last sort, as the
+            // particles are, then change some of them and emit a few more.
+            CountingSort sort(pool);
+            SortResult last;
+            SortFully(&sort, &last, keys, num_of_keys);
+
+            std::vector<uint32_t> new_keys = last.sorted_keys_;
+            for (int i = 0; i < n; i++)
+                if (rand() < churn * RAND_MAX)
+                    new_keys[i] = RandomKey(num_of_keys);
+
+            int num_of_emitted = n / 256;
+            for (int i = 0; i < num_of_emitted; i++)
+                new_keys.push_back(RandomKey(num_of_keys));
+
+            int new_n = static_cast<int>(new_keys.size());
+            SortResult updated;
+            updated.counts_.resize(num_of_keys);
+            updated.offsets_ = last.offsets_;
+
+            double t = GetCurrentTimeInSeconds();
+            bool accepted = sort.Update(&new_keys[0], new_n, num_of_keys,
+                                        kCapacity, kMaxChurn,
+                                        &updated.counts_[0],
+                                        &updated.offsets_[0]);
+            double update_time = GetCurrentTimeInSeconds() - t;
+
+            CountingSort full_sort(pool);
+            SortResult expected;
+            double sort_time = SortFully(&full_sort, &expected, new_keys,
+                                         num_of_keys);
+
+            bool passed = false;
+            if (churn > kMaxChurn) {
+                // Nothing may be touched if the update is refused.
+                passed = !accepted && updated.offsets_ == last.offsets_;
+            } else if (accepted &&
+                    IsPermutation(sort.destinations(), new_n)) {
+                updated.num_of_kept_ = 0;
+                for (uint32_t count : updated.counts_)
+                    updated.num_of_kept_ += count;
+
+                ApplyDestinations(&updated.sorted_keys_, new_keys,
+                                  sort.destinations());
+                passed = VerifyResult(updated, expected);
+            }
+
+            PrintDebugString("%s %d^3, churn %.2f: update %.3fms %s, full "
+                             "sort %.3fms\n", __FUNCTION__, grid_size, churn,
+                             update_time * 1000.0,
+                             passed ? "passed" : "FAILED",
+                             sort_time * 1000.0);
+        }
+    }
+}
@@ -24,8 +24,11 @@
 
 #include "third_party/opengl/glew.h"
 #include "third_party/opengl/freeglut.h"
+#include "flip_unittest.h"
 #include "fluid_unittest.h"
 #include "multigrid_unittest.h"
+#include "scan_unittest.h"
+#include "sort_unittest.h"
 #include "utility.h"
 
 int APIENTRY wWinMain(HINSTANCE instance, HINSTANCE prev_instance,
@@ -78,6 +81,7 @@ int APIENTRY wWinMain(HINSTANCE instance, HINSTANCE prev_instance,
     //FluidUnittest::TestVelocityAdvection(random_seed);
     //FluidUnittest::TestDensityAdvection(random_seed);
     //FluidUnittest::TestTemperatureAdvection(random_seed);
+    //FluidUnittest::TestFieldsAdvection(random_seed);
     //FluidUnittest::TestBuoyancyApplication(random_seed);
     //FluidUnittest::TestDivergenceCalculation(random_seed);
     FluidUnittest::TestDampedJacobi(random_seed);
@@ -89,6 +93,17 @@ int APIENTRY wWinMain(HINSTANCE instance, HINSTANCE prev_instance,
     //MultigridUnittest::TestRestriction(random_seed);
     //MultigridUnittest::TestProlongation(random_seed);
 
+    //ScanUnittest::TestExclusiveScan(random_seed);
+    //ScanUnittest::TestInclusiveScan(random_seed);
+    //ScanUnittest::TestSegmentedScan(random_seed);
+    //ScanUnittest::TestCompaction(random_seed);
+
+    //SortUnittest::TestPermute(random_seed);
+    //SortUnittest::TestUpdate(random_seed);
+
+    //FlipUnittest::TestGovernor(random_seed);
+    //FlipUnittest::TestRigidRotation(random_seed);
+
     if (main_frame_handle)
         glutDestroyWindow(main_frame_handle);
 